@@ -0,0 +1,54 @@
+#ifndef LV_PORT_BACKLIGHT_H
+#define LV_PORT_BACKLIGHT_H
+
+#include "lvgl.h"
+#include <stdbool.h>
+
+// Automatic backlight dimming.
+// Set to 1 to fade the backlight to policy.dim_pct after policy.dim_after_ms
+// without input and off after policy.off_after_ms. A pen-down fades it back
+// up straight from the touch IRQ; the LVGL side only follows. The policy
+// timer is scheduled for the next deadline and paused while off.
+#ifndef LV_PORT_BL_AUTODIM
+#define LV_PORT_BL_AUTODIM 0
+#endif
+
+typedef enum {
+    BL_STATE_ON = 0,
+    BL_STATE_DIM,
+    BL_STATE_OFF
+} lv_port_bl_state_t;
+
+typedef struct {
+    uint8_t on_pct;
+    uint8_t dim_pct;
+    uint32_t dim_after_ms;  // 0: never dim
+    uint32_t off_after_ms;  // 0: never off, otherwise > dim_after_ms
+    uint16_t fade_down_ms;
+    uint16_t fade_up_ms;
+} lv_port_bl_policy_t;
+
+#define LV_PORT_BL_POLICY_DEFAULT { \
+    .on_pct = 100,                  \
+    .dim_pct = 15,                  \
+    .dim_after_ms = 30000,          \
+    .off_after_ms = 60000,          \
+    .fade_down_ms = 1000,           \
+    .fade_up_ms = 150,              \
+}
+
+#if LV_PORT_BL_AUTODIM
+
+// Starts in BL_STATE_ON with LV_PORT_BL_POLICY_DEFAULT (done by
+// lv_port_indev_init, after the touch driver is up)
+void lv_port_bl_init(void);
+
+void lv_port_bl_set_policy(const lv_port_bl_policy_t *policy);
+lv_port_bl_state_t lv_port_bl_get_state(void);
+
+// Hook: touch samples (read_cb)
+void lv_port_bl_input(bool pressed);
+
+#endif // LV_PORT_BL_AUTODIM
+
+#endif // LV_PORT_BACKLIGHT_H
@@ -0,0 +1,40 @@
+#ifndef LV_PORT_BLEND_H
+#define LV_PORT_BLEND_H
+
+#include "lvgl.h"
+
+// RGB565 blend kernels for the software renderer.
+// Set to 1 to replace the blend step of LVGL's draw context (every fill,
+// image copy and anti-aliased edge ends there) with kernels that move two
+// pixels per 32-bit load/store and skip or copy four mask bytes at a time.
+// Opaque fills and copies go to memset/memcpy, i.e. the RP2040 ROM routines
+// with LV_MEMCPY_MEMSET_STD = 1.
+//
+// Mixed pixels are lv_color_mix(fg, bg, opa) as LVGL 8.3 computes it with
+// LV_COLOR_16_SWAP = 1 and LV_COLOR_MIX_ROUND_OFS = 0: per channel with the
+// 8-bit opacity, rounded down, so the output is the same pixel for pixel
+// (sim/blend_sim.c checks it).
+// Other blend modes, set_px_cb and transparent screens use LVGL's
+// lv_draw_sw_blend_basic().
+#ifndef LV_PORT_FAST_BLEND
+#define LV_PORT_FAST_BLEND 0
+#endif
+
+// Band used by lv_port_blend_bench(), taken from the LVGL heap while it runs
+#define BLEND_BENCH_W    LV_HOR_RES_MAX
+#define BLEND_BENCH_H    8
+#define BLEND_BENCH_REPS 20
+
+#if LV_PORT_FAST_BLEND
+
+// Set as lv_disp_drv_t.draw_ctx_init (done by lv_port_disp_init)
+void lv_port_blend_ctx_init(lv_disp_drv_t *drv, lv_draw_ctx_t *draw_ctx);
+
+// Runs each kind of blend through lv_draw_sw_blend_basic() and the port's
+// kernels and prints cycles per pixel and the number of pixels that differ.
+// Call after lv_port_disp_init(), outside lv_timer_handler().
+void lv_port_blend_bench(void);
+
+#endif // LV_PORT_FAST_BLEND
+
+#endif // LV_PORT_BLEND_H
@@ -0,0 +1,50 @@
+#ifndef LV_PORT_DFLUSH_H
+#define LV_PORT_DFLUSH_H
+
+#include "lvgl.h"
+#include "st7789.h"
+#include <stdbool.h>
+
+// Differential flush.
+// Set to 1 to keep a 32-bit hash of every DFLUSH_SEG_W pixel segment of
+// every panel row and send only the rows whose segments changed since they
+// were last sent. Changed rows with the same span of segments go out
+// together in one window. Invalidated areas are widened to segment
+// boundaries by the display rounder so every flushed segment can be hashed.
+//
+// RAM: ST7789_HEIGHT * DFLUSH_SEGS * 4 bytes (5 kB at 60 pixel segments).
+#ifndef LV_PORT_DIFF_FLUSH
+#define LV_PORT_DIFF_FLUSH 0
+#endif
+
+#define DFLUSH_SEG_W 60 // Even, divides ST7789_WIDTH
+#define DFLUSH_SEGS  (ST7789_WIDTH / DFLUSH_SEG_W)
+
+typedef struct {
+    uint32_t frames;
+    uint32_t windows;             // Windows opened for sending
+    uint64_t bytes_rendered;      // What a plain flush would have sent
+    uint64_t bytes_sent;
+    uint32_t last_frame_rendered; // Same for the last complete frame
+    uint32_t last_frame_sent;
+} lv_port_dflush_stats_t;
+
+#if LV_PORT_DIFF_FLUSH
+
+// Rounder hook: widens the area to whole segments
+void lv_port_dflush_round(lv_area_t *area);
+
+// Sends the changed rows of a rendered band, returns the bytes sent.
+// last: lv_disp_flush_is_last(), closes the frame statistics.
+size_t lv_port_dflush_send(const lv_area_t *area, const uint16_t *pixels, bool last);
+
+// Forget the hashes, e.g. after writing to the panel outside LVGL
+void lv_port_dflush_invalidate(void);
+// Same for the segments an area touches, so they're sent when next flushed
+void lv_port_dflush_forget(const lv_area_t *area);
+
+void lv_port_dflush_get_stats(lv_port_dflush_stats_t *stats);
+
+#endif // LV_PORT_DIFF_FLUSH
+
+#endif // LV_PORT_DFLUSH_H
@@ -2,7 +2,17 @@
 #define LV_PORT_DISP_H
 
 #include "lvgl.h"
+#include "st7789.h"
 
 void lv_port_disp_init(void);
 
+// Registers one more LVGL display for an initialized panel (see
+// st7789_panel_init), with the caller's draw buffers (buf_2 may be NULL).
+// Its bands go out by DMA while LVGL renders on, so panels on separate SPI
+// instances flush in parallel. The port hooks (profiler, governor,
+// differential flush, ...) only follow the display of lv_port_disp_init().
+#if !ST7789_SINGLE_PANEL
+lv_disp_t *lv_port_disp_add_panel(st7789_t *panel, lv_color_t *buf_1, lv_color_t *buf_2, uint32_t buf_px);
+#endif
+
 #endif // LV_PORT_DISP_H
@@ -0,0 +1,29 @@
+#ifndef LV_PORT_FS_H
+#define LV_PORT_FS_H
+
+#include "lvgl.h"
+#include "port_lfs.h"
+
+// LVGL drive over the LittleFS partition (port_lfs.h), enabled with
+// LV_PORT_FS. Paths are "F:/dir/file", e.g. lv_img_set_src(img,
+// "F:/logo.bin") or lv_font_load("F:/font_24.bin").
+//
+// LVGL's own LittleFS driver (LV_USE_FS_LITTLEFS) stays off: it allocates
+// each file's cache from the heap and has only LVGL's generic read cache,
+// which starts at whatever position was read and is dropped on every seek
+// outside it.
+#define LV_PORT_FS_LETTER 'F'
+
+#if LV_PORT_FS
+
+// Mounts the partition (formatting it if it holds no file system) and
+// registers the drive. Call after lv_init(). Returns false when the flash
+// can't be mounted.
+bool lv_port_fs_init(void);
+
+// Flash reads and read cache use since port_lfs_reset_stats()
+void lv_port_fs_print(void);
+
+#endif // LV_PORT_FS
+
+#endif // LV_PORT_FS_H
@@ -0,0 +1,67 @@
+#ifndef LV_PORT_GOV_H
+#define LV_PORT_GOV_H
+
+#include "lvgl.h"
+#include <stdbool.h>
+
+// Refresh-rate governor.
+// Set to 1 to switch the LVGL refresh period and the panel frame rate
+// (FRCTRL2) together between an active level, while something animates or
+// the pen is down, and an idle level for static screens. It goes up on the
+// first sign of activity and comes down only after policy.idle_windows quiet
+// windows in a row.
+#ifndef LV_PORT_REFRESH_GOV
+#define LV_PORT_REFRESH_GOV 0
+#endif
+
+// Activity is judged per window. The timer is paused while idle and quiet.
+#define GOV_WINDOW_MS 100
+
+typedef enum {
+    GOV_LEVEL_IDLE = 0,
+    GOV_LEVEL_ACTIVE,
+    GOV_LEVEL_COUNT
+} lv_port_gov_level_t;
+
+typedef struct {
+    uint16_t refr_period_ms; // LVGL display refresh timer period
+    uint8_t panel_hz;        // ST7789 frame rate, 39..119
+} lv_port_gov_rate_t;
+
+typedef struct {
+    lv_port_gov_rate_t rate[GOV_LEVEL_COUNT];
+    uint32_t active_px;    // Invalidated pixels per window that count as activity
+    uint16_t idle_windows; // Quiet windows before going back to idle
+    bool anim_is_active;   // Running lv_anims count as activity
+} lv_port_gov_policy_t;
+
+#define LV_PORT_GOV_POLICY_DEFAULT {                                     \
+    .rate = { [GOV_LEVEL_IDLE] = { 50, 40 }, [GOV_LEVEL_ACTIVE] = { 16, 60 } }, \
+    .active_px = 2000,                                                   \
+    .idle_windows = 10,                                                  \
+    .anim_is_active = true,                                              \
+}
+
+typedef struct {
+    uint32_t transitions;
+    uint32_t ms_in[GOV_LEVEL_COUNT];
+} lv_port_gov_stats_t;
+
+#if LV_PORT_REFRESH_GOV
+
+// Starts at the idle level with LV_PORT_GOV_POLICY_DEFAULT (done by
+// lv_port_disp_init)
+void lv_port_gov_init(lv_disp_t *disp);
+
+void lv_port_gov_set_policy(const lv_port_gov_policy_t *policy);
+void lv_port_gov_get_policy(lv_port_gov_policy_t *policy);
+lv_port_gov_level_t lv_port_gov_get_level(void);
+void lv_port_gov_get_stats(lv_port_gov_stats_t *stats);
+
+// Hooks: invalidated areas (disp rounder) and touch samples (read_cb)
+void lv_port_gov_invalidate(const lv_area_t *area);
+void lv_port_gov_input(bool pressed);
+
+#endif // LV_PORT_REFRESH_GOV
+
+#endif // LV_PORT_GOV_H
@@ -0,0 +1,78 @@
+#ifndef LV_PORT_LATENCY_H
+#define LV_PORT_LATENCY_H
+
+#include "lvgl.h"
+#include <stdbool.h>
+
+// Touch-to-photon latency tracing.
+// Set to 1 to follow each touch sample from the pen-down edge on PIN_XPT_IRQ,
+// through xpt2046_read_cb, the first area LVGL invalidates afterwards, the
+// render of the bands covering that area, until the last of them has left
+// st7789_send_pixels (with ST7789_CXX, until its DMA transfer has ended).
+// With 0 all hooks compile out.
+#ifndef LV_PORT_LATENCY_TRACE
+#define LV_PORT_LATENCY_TRACE 0
+#endif
+
+// Histogram layout: LAT_HIST_BUCKETS buckets of LAT_HIST_BUCKET_MS each,
+// the last bucket collects everything above.
+#define LAT_HIST_BUCKET_MS 5
+#define LAT_HIST_BUCKETS   25
+
+// A sample that doesn't invalidate anything within this time is dropped
+// (e.g. a touch on an inactive area)
+#define LAT_TRACE_TIMEOUT_MS 200
+
+// A trace whose area doesn't reach the panel within this time of the sample
+// is given up as stalled (e.g. the invalidated object was deleted or moved
+// off screen before the refresh), so the next touch can be traced
+#define LAT_TRACE_STALL_MS 1000
+
+// Stages of one interaction
+typedef enum {
+    LAT_STAGE_INPUT = 0,   // pen-down edge -> read_cb sample
+    LAT_STAGE_EVENT,       // read_cb sample -> area invalidated
+    LAT_STAGE_RENDER,      // area invalidated -> first covering band rendered
+    LAT_STAGE_FLUSH,       // first band rendered -> last band sent to the panel
+    LAT_STAGE_TOTAL,       // pen-down edge -> last band sent
+    LAT_STAGE_COUNT
+} lat_stage_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+} lat_stage_stats_t;
+
+typedef struct {
+    uint32_t interactions;            // traces that reached the panel
+    uint32_t dropped;                 // traces that timed out without a redraw
+    uint32_t stalled;                 // traces that invalidated an area that was never sent
+    lat_stage_stats_t stage[LAT_STAGE_COUNT];
+    uint32_t hist[LAT_HIST_BUCKETS];  // LAT_STAGE_TOTAL histogram
+} lat_stats_t;
+
+#if LV_PORT_LATENCY_TRACE
+
+// Hooks, called from the display and input ports
+void lv_port_latency_input(const lv_indev_data_t *data);
+void lv_port_latency_invalidate(const lv_area_t *area);
+void lv_port_latency_flush_begin(const lv_area_t *area);
+void lv_port_latency_flush_end(void);
+void lv_port_latency_refresh_done(void);
+
+// Synthetic touches: while an injection is active, xpt2046_read_cb reports
+// (x, y) as pressed for hold_ms instead of reading the XPT2046. The trace
+// starts at the injection time, so the same statistics are produced without
+// a finger on the panel.
+void lv_port_latency_inject(uint16_t x, uint16_t y, uint32_t hold_ms);
+bool lv_port_latency_injected(lv_indev_data_t *data);
+
+void lv_port_latency_get_stats(lat_stats_t *stats);
+void lv_port_latency_reset(void);
+void lv_port_latency_print(void);
+
+#endif // LV_PORT_LATENCY_TRACE
+
+#endif // LV_PORT_LATENCY_H
@@ -0,0 +1,46 @@
+#ifndef LV_PORT_LAYER_H
+#define LV_PORT_LAYER_H
+
+#include "lvgl.h"
+
+// Direct opacity layers.
+// Set to 1 to draw widgets with opa_layered (or a fade of a whole
+// container) straight into the display band instead of into a separate
+// ARGB layer buffer. Before the widget draws, the band pixels under it are
+// saved; afterwards each pixel is mixed back with them at the layer
+// opacity, which gives the same result as LVGL's simple layer. The saved
+// copy is RGB565, from the LVGL heap, for at most LAYER_DIRECT_BUF_SIZE
+// bytes of rows at a time; a layer taller than that is drawn in slices.
+//
+// LV_LAYER_SIMPLE_BUF_SIZE (24 kB of LVGL heap per layer, 3 bytes per
+// pixel) is then not used. Transformed widgets (angle, zoom) and layers
+// inside them still go through LVGL's layer, which needs the whole widget
+// in one buffer. Blend modes other than normal are composited as normal.
+#ifndef LV_PORT_DIRECT_LAYER
+#define LV_PORT_DIRECT_LAYER 0
+#endif
+
+#define LAYER_DIRECT_BUF_SIZE (LV_HOR_RES_MAX * 16 * 2) // 16 full-width rows
+
+typedef struct {
+    uint32_t direct;     // Layers drawn into the band
+    uint32_t slices;     // Saved copies taken, one per slice of rows
+    uint32_t lvgl;       // Layers left to LVGL (transforms, nested in one)
+    uint32_t failed;     // No heap even for one row, widget not drawn
+    uint32_t buf_peak;   // Largest saved copy, bytes
+    uint32_t px;         // Pixels composited
+} lv_port_layer_stats_t;
+
+#if LV_PORT_DIRECT_LAYER
+
+// Set as lv_disp_drv_t.draw_ctx_init (done by lv_port_disp_init); sets up
+// the fast blend and the overdraw counting first when they're enabled
+void lv_port_layer_ctx_init(lv_disp_drv_t *drv, lv_draw_ctx_t *draw_ctx);
+
+void lv_port_layer_get_stats(lv_port_layer_stats_t *stats);
+void lv_port_layer_reset_stats(void);
+void lv_port_layer_print(void);
+
+#endif // LV_PORT_DIRECT_LAYER
+
+#endif // LV_PORT_LAYER_H
@@ -0,0 +1,62 @@
+#ifndef LV_PORT_MEM_H
+#define LV_PORT_MEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// LVGL heap for LV_MEM_CUSTOM = 1 (see lv_conf.h).
+// Large requests go to a TLSF allocator (O(1) alloc/free with good-fit
+// segregated free lists), small ones to per-size-class slabs so the many
+// short-lived style/event/object allocations don't cut up the TLSF pool.
+
+// Size of the static pool, replaces LV_MEM_SIZE
+#ifndef LV_PORT_MEM_SIZE
+#define LV_PORT_MEM_SIZE (48U * 1024U)
+#endif
+
+// Requests up to the largest class are served from slabs, one page of this
+// size each, taken from the end of the pool. Classes are multiples of 8 so
+// slots stay pointer-aligned on 64-bit hosts.
+#define LV_PORT_MEM_SLAB_SIZE 512
+#define LV_PORT_MEM_CLASSES   { 16, 24, 32, 48, 64 }
+
+// A warning is logged (at most once a second) when the used part of the
+// pool goes above this percentage
+#define LV_PORT_MEM_WARN_PCT 90
+
+typedef struct {
+    uint32_t total_bytes;      // Pool size usable for blocks
+    uint32_t used_bytes;       // Allocated, including block and slab overhead
+    uint32_t high_water_bytes; // Largest used_bytes seen
+    uint32_t free_bytes;       // In TLSF free blocks
+    uint32_t largest_free;     // Largest single TLSF free block
+    uint8_t frag_pct;          // 100 - largest_free / free_bytes, like lv_mem_monitor
+    uint8_t used_pct;
+    uint32_t slab_bytes;       // Slab pages, empty ones included (part of used_bytes)
+    uint32_t slab_slots_used;
+    uint32_t alloc_count;
+    uint32_t free_count;
+    uint32_t fail_count;
+} lv_port_mem_stats_t;
+
+void *lv_port_mem_alloc(size_t size);
+void lv_port_mem_free(void *ptr);
+void *lv_port_mem_realloc(void *ptr, size_t size);
+
+// Called when an allocation fails, before NULL is returned to LVGL (whose
+// LV_ASSERT_MALLOC then halts). If the callback frees memory, e.g. cached
+// screens, and returns 1 the allocation is retried once.
+typedef int (*lv_port_mem_oom_cb_t)(size_t size);
+void lv_port_mem_set_oom_cb(lv_port_mem_oom_cb_t cb);
+
+// Called after every alloc ('a', old_ptr NULL), free ('f', new_ptr NULL)
+// and realloc ('r') LVGL makes, to record allocation traces for
+// sim/mem_soak.c (lvgl_bench --mem-trace). new_ptr is NULL on a failure.
+typedef void (*lv_port_mem_trace_cb_t)(char op, const void *old_ptr, const void *new_ptr, size_t size);
+void lv_port_mem_set_trace_cb(lv_port_mem_trace_cb_t cb);
+
+void lv_port_mem_get_stats(lv_port_mem_stats_t *stats);
+uint32_t lv_port_mem_used(void); // used_bytes alone, without the free list walk
+void lv_port_mem_reset_high_water(void);
+
+#endif // LV_PORT_MEM_H
@@ -0,0 +1,86 @@
+#ifndef LV_PORT_MSGQ_H
+#define LV_PORT_MSGQ_H
+
+#include "lvgl.h"
+#include <stdbool.h>
+
+// Widget update queue.
+// Set to 1 so code running outside the LVGL thread (core1, IRQ handlers)
+// can update widgets without a mutex around lv_timer_handler(). Producers
+// post small typed messages into a bounded queue (port_msgq.h) and never
+// touch LVGL; the LVGL loop applies them in batches of up to MSGQ_BATCH
+// before each lv_timer_handler(). Within a batch only the last value or
+// text posted for a widget is applied, so a producer faster than the frame
+// rate costs one update per frame, not one per message.
+//
+// Posting never blocks: when the queue is full the message is dropped and
+// counted (lv_port_msgq_get_stats()). Chart samples are never coalesced.
+#ifndef LV_PORT_MSGQ
+#define LV_PORT_MSGQ 0
+#endif
+
+#define MSGQ_SLOTS        64 // Power of 2
+#define MSGQ_TEXT_MAX     24 // Including the terminator, longer text is cut
+#define MSGQ_CHART_VALUES 8  // Values per chart push, one per series
+#define MSGQ_BATCH        32 // Messages applied per drain by default
+#define MSGQ_CHECK_OBJ    1  // Skip messages whose widget has been deleted
+
+typedef enum {
+    LV_PORT_MSG_SET_VALUE = 0, // lv_bar/lv_slider/lv_arc value, number for a label
+    LV_PORT_MSG_SET_TEXT,      // lv_label text
+    LV_PORT_MSG_CHART_PUSH,    // Next point of each series, lv_chart or lv_port_schart
+    LV_PORT_MSG_CALL           // Runs cb(arg) in the LVGL thread
+} lv_port_msg_type_t;
+
+typedef struct {
+    uint8_t type;     // lv_port_msg_type_t
+    uint8_t count;    // CHART_PUSH: values used
+    lv_obj_t *obj;
+    uint32_t t_us;    // Posted at, for the latency stats
+    union {
+        int32_t value;
+        char text[MSGQ_TEXT_MAX];
+        int16_t values[MSGQ_CHART_VALUES];
+        struct {
+            void (*cb)(void *arg);
+            void *arg;
+        } call;
+    } u;
+} lv_port_msg_t;
+
+typedef struct {
+    uint32_t applied;
+    uint32_t coalesced;   // Superseded later in the same batch
+    uint32_t stale;       // Widget deleted before the message was applied
+    uint32_t dropped;     // Queue full at post
+    uint32_t drains;      // Drains that found messages
+    uint32_t batch_max;
+    uint32_t drain_max_us;
+    uint32_t lat_max_us;  // Post -> applied
+    uint64_t lat_sum_us;  // Over all messages taken
+} lv_port_msgq_stats_t;
+
+#if LV_PORT_MSGQ
+
+// Called by lv_port_disp_init(), before any producer starts
+void lv_port_msgq_init(void);
+
+// Producers, any core or IRQ. Return false when the queue is full.
+bool lv_port_msgq_post(lv_port_msg_t *msg); // Sets msg->t_us
+bool lv_port_msgq_set_value(lv_obj_t *obj, int32_t value);
+bool lv_port_msgq_set_text(lv_obj_t *obj, const char *text);
+bool lv_port_msgq_chart_push(lv_obj_t *obj, const int16_t *values, uint32_t count);
+bool lv_port_msgq_call(void (*cb)(void *arg), void *arg);
+
+// LVGL thread: applies up to max messages (0: MSGQ_BATCH) and returns how
+// many were taken from the queue. lv_port_sched_step() calls it; without
+// LV_PORT_TICKLESS call it before lv_timer_handler().
+uint32_t lv_port_msgq_drain(uint32_t max);
+
+void lv_port_msgq_get_stats(lv_port_msgq_stats_t *stats);
+void lv_port_msgq_reset_stats(void);
+void lv_port_msgq_print(void);
+
+#endif // LV_PORT_MSGQ
+
+#endif // LV_PORT_MSGQ_H
@@ -0,0 +1,75 @@
+#ifndef LV_PORT_OVERDRAW_H
+#define LV_PORT_OVERDRAW_H
+
+#include "lvgl.h"
+#include "st7789.h"
+
+// Overdraw and invalidation analysis.
+// Set to 1 to count, per pixel, how many times the renderer writes it into
+// buf_1/buf_2 in a frame (every blend with a non-zero mask), and per
+// OVD_CELL x OVD_CELL cell of the panel how often it is invalidated and
+// flushed. Writes are charged to the widget being drawn, so the widgets
+// that paint over already painted pixels can be listed.
+//
+// RAM: 2 * ST7789_WIDTH * ST7789_HEIGHT bytes for the pixel maps (150 kB),
+// which only fits in the host simulator build (see README.md), not next to
+// the draw buffers on the RP2040. Pixels drawn into a layer (opacity or
+// transform styles) count once in the layer and once when it's blended.
+#ifndef LV_PORT_OVERDRAW
+#define LV_PORT_OVERDRAW 0
+#endif
+
+#define OVD_CELL        8  // Divides ST7789_WIDTH and ST7789_HEIGHT
+#define OVD_CELLS_X     (ST7789_WIDTH / OVD_CELL)
+#define OVD_CELLS_Y     (ST7789_HEIGHT / OVD_CELL)
+#define OVD_MAX_WIDGETS 128 // Widgets tracked; further ones go to the last entry
+
+typedef struct {
+    uint32_t frames;
+    uint64_t px_written;     // Pixel writes by the renderer
+    uint64_t px_unique;      // Distinct pixels written, per frame, summed
+    uint64_t px_invalidated; // Invalidated areas, summed (overlaps count twice)
+    uint64_t px_flushed;     // Areas sent to the panel
+    uint8_t max_depth;       // Most writes to one pixel in a frame
+} ovd_stats_t;
+
+typedef struct {
+    const lv_obj_t *obj;            // May be deleted by now, only to tell widgets apart
+    const lv_obj_class_t *class_p;
+    lv_area_t coords;               // At its last draw
+    uint64_t px_written;
+    uint64_t px_over;               // Writes to pixels already written in that frame
+    uint32_t frames;                // Frames it drew in
+    uint32_t last_frame;
+} ovd_widget_t;
+
+typedef enum {
+    OVD_MAP_DEPTH = 0,   // Per pixel: most writes in one frame
+    OVD_MAP_OVERDRAW,    // Per cell: writes beyond the first, all frames
+    OVD_MAP_INVALIDATED, // Per cell: invalidations covering it
+    OVD_MAP_FLUSHED,     // Per cell: flushes covering it
+} ovd_map_t;
+
+#if LV_PORT_OVERDRAW
+
+// Hooks, called from the display port
+void lv_port_overdraw_ctx_init(lv_disp_drv_t *drv, lv_draw_ctx_t *draw_ctx); // As lv_disp_drv_t.draw_ctx_init
+void lv_port_overdraw_invalidate(const lv_area_t *area);
+void lv_port_overdraw_flush(const lv_area_t *area);
+void lv_port_overdraw_refresh_done(void);
+
+// Value of a map at a panel pixel (cell maps give their cell's value)
+uint32_t lv_port_overdraw_value(ovd_map_t map, uint32_t x, uint32_t y);
+uint32_t lv_port_overdraw_max(ovd_map_t map);
+
+// Widgets sorted by px_over, returns how many were copied
+uint32_t lv_port_overdraw_top(ovd_widget_t *out, uint32_t max);
+const char *lv_port_overdraw_class_name(const lv_obj_class_t *class_p);
+
+void lv_port_overdraw_get_stats(ovd_stats_t *stats);
+void lv_port_overdraw_reset(void);
+void lv_port_overdraw_print(uint32_t top);
+
+#endif // LV_PORT_OVERDRAW
+
+#endif // LV_PORT_OVERDRAW_H
@@ -0,0 +1,31 @@
+#ifndef LV_PORT_PCSAMPLE_H
+#define LV_PORT_PCSAMPLE_H
+
+#include <stdint.h>
+
+// Sampling profiler for the hot function list.
+// Set to 1 to sample the interrupted PC of the calling core from a timer
+// alarm at PCSAMPLE_PERIOD_US. The alarm is claimed from the unused ones on
+// the first start (the SDK's default alarm pool keeps alarm 3), and kept.
+// tools/hot_funcs.py turns the dump into the list of functions to move to
+// SRAM (see port_fast_mem.h).
+#ifndef LV_PORT_PC_SAMPLER
+#define LV_PORT_PC_SAMPLER 0
+#endif
+
+#define PCSAMPLE_PERIOD_US 500  // 2 kHz
+#define PCSAMPLE_COUNT     1024 // Samples kept until the next dump (4 kB), a power of two
+
+#if LV_PORT_PC_SAMPLER
+
+void lv_port_pcsample_start(void);
+void lv_port_pcsample_stop(void);
+
+// Prints the samples collected so far as "PCS <hex>" lines and frees their
+// slots. The timer IRQ keeps sampling meanwhile; once PCSAMPLE_COUNT
+// samples wait for a dump it stops re-arming until this frees a slot.
+void lv_port_pcsample_dump(void);
+
+#endif // LV_PORT_PC_SAMPLER
+
+#endif // LV_PORT_PCSAMPLE_H
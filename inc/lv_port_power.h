@@ -0,0 +1,40 @@
+#ifndef LV_PORT_POWER_H
+#define LV_PORT_POWER_H
+
+#include "lvgl.h"
+#include <stdbool.h>
+
+// Panel power states.
+// Set to 1 for lv_port_power_sleep()/wake(). Sleep turns the backlight off,
+// puts the panel in SLPIN and holds LVGL's refresh; objects can still be
+// changed meanwhile. The panel keeps its frame memory, so on wake LVGL only
+// redraws the areas invalidated during sleep, then the backlight returns to
+// its level from before.
+#ifndef LV_PORT_PANEL_SLEEP
+#define LV_PORT_PANEL_SLEEP 0
+#endif
+
+#define POWER_WAKE_FADE_MS 100
+
+typedef struct {
+    uint32_t sleeps;
+    uint32_t asleep_ms;         // Total, including the current sleep
+    uint32_t last_wake_us;      // lv_port_power_wake() -> backlight on after the redraw
+    uint32_t last_wake_areas;   // Areas redrawn on the last wake
+} lv_port_power_stats_t;
+
+#if LV_PORT_PANEL_SLEEP
+
+// Wraps the refresh timer (done by lv_port_disp_init)
+void lv_port_power_init(lv_disp_t *disp);
+
+// Both from the LVGL thread
+void lv_port_power_sleep(void);
+void lv_port_power_wake(void);
+bool lv_port_power_is_asleep(void);
+
+void lv_port_power_get_stats(lv_port_power_stats_t *stats);
+
+#endif // LV_PORT_PANEL_SLEEP
+
+#endif // LV_PORT_POWER_H
@@ -0,0 +1,75 @@
+#ifndef LV_PORT_PROF_H
+#define LV_PORT_PROF_H
+
+#include "lvgl.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Per-frame render/flush profiler.
+// Set to 1 to record, for every refresh, where the time went and stream it
+// as binary records over USB serial. Unlike LV_USE_PERF_MONITOR nothing is
+// drawn on the screen. With 0 all hooks compile out.
+#ifndef LV_PORT_PROFILER
+#define LV_PORT_PROFILER 0
+#endif
+
+// RAM ring sizes, in records. Records that don't fit until the next
+// lv_port_prof_stream() are dropped and counted.
+#define PROF_FRAME_RING 32
+#define PROF_BAND_RING  64
+
+// Stream format (decoded by tools/prof_decode.py):
+//   0xA5 0x5A type len payload[len] crc8
+// The payload is a list of unsigned LEB128 varints, in the order listed
+// below. crc8 (poly 0x07, init 0) covers type, len and payload.
+#define PROF_SYNC0 0xA5
+#define PROF_SYNC1 0x5A
+
+#define PROF_REC_FRAME 0x01 // seq interval handler input refresh render flush idle bytes areas bands
+#define PROF_REC_BAND  0x02 // seq y1 y2 render flush
+#define PROF_REC_DROP  0x03 // frames bands
+
+// One refresh and everything that happened since the previous one, in us
+typedef struct {
+    uint32_t seq;
+    uint32_t interval_us; // previous frame end -> this frame end
+    uint32_t handler_us;  // inside lv_timer_handler
+    uint32_t input_us;    // indev read timer, including the events it sends
+    uint32_t refresh_us;  // display refresh timer (layout + render + flush)
+    uint32_t render_us;   // refresh without flush
+    uint32_t flush_us;    // in disp_flush, i.e. SPI time
+    uint32_t idle_us;     // outside lv_timer_handler
+    uint32_t bytes;       // pixel bytes sent to the panel
+    uint16_t areas;       // disp_flush calls
+    uint16_t bands;       // bands rendered (equal to areas unless a flush is split)
+} prof_frame_t;
+
+typedef struct {
+    uint32_t seq; // frame the band belongs to
+    uint16_t y1, y2;
+    uint32_t render_us;
+    uint32_t flush_us;
+} prof_band_t;
+
+#if LV_PORT_PROFILER
+
+// Wraps the refresh and input timers of the registered devices
+void lv_port_prof_init(lv_disp_t *disp, lv_indev_t *indev);
+
+// Use instead of lv_timer_handler() in the main loop, it also tracks idle time
+uint32_t lv_port_prof_timer_handler(void);
+
+// Hooks, called from disp_flush around the SPI transfer
+void lv_port_prof_flush_begin(const lv_area_t *area);
+void lv_port_prof_flush_end(uint32_t bytes);
+
+// Encodes pending records and writes them to stdout. Call when idle.
+void lv_port_prof_stream(void);
+
+// Encodes one record into buf (at least 64 bytes), returns its length
+size_t lv_port_prof_encode_frame(const prof_frame_t *f, uint8_t *buf);
+size_t lv_port_prof_encode_band(const prof_band_t *b, uint8_t *buf);
+
+#endif // LV_PORT_PROFILER
+
+#endif // LV_PORT_PROF_H
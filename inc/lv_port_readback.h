@@ -0,0 +1,25 @@
+#ifndef LV_PORT_READBACK_H
+#define LV_PORT_READBACK_H
+
+#include "lvgl.h"
+#include "port_readback.h"
+
+// Idle-time panel check with LV_PORT_READBACK (port_readback.h): an LVGL
+// timer reads back READBACK_ROWS rows every READBACK_PERIOD_MS while no
+// frame is pending, so a full pass over the panel takes
+// ST7789_HEIGHT / READBACK_ROWS * READBACK_PERIOD_MS (8 s). Segments that
+// don't match are invalidated and LVGL redraws just those.
+#define READBACK_ROWS      4   // About 4 ms of bus time per step
+#define READBACK_PERIOD_MS 100
+
+#if LV_PORT_READBACK
+
+// Checks that the panel answers and starts the timer; by lv_port_disp_init()
+void lv_port_readback_init(lv_disp_t *disp);
+
+// Rows and segments checked, and redrawn, since port_readback_reset_stats()
+void lv_port_readback_print(void);
+
+#endif // LV_PORT_READBACK
+
+#endif // LV_PORT_READBACK_H
@@ -0,0 +1,45 @@
+#ifndef LV_PORT_SCHART_H
+#define LV_PORT_SCHART_H
+
+#include "lvgl.h"
+
+// Streaming chart widget.
+// Set to 1 for a line chart made for telemetry pushed at a steady rate: the
+// series keep a fixed number of points in a ring, drawn left to right like
+// an oscilloscope sweep. A new point only invalidates its own column, the
+// segment from the previous point and SCHART_GAP erased columns ahead of
+// it, so one push costs a strip a few pixels wide instead of the whole plot
+// area that lv_chart invalidates.
+//
+// Old data is not shifted, so no panel scrolling is needed (the ST7789 only
+// scrolls full-width bands along its 320-pixel axis anyway).
+#ifndef LV_PORT_STREAM_CHART
+#define LV_PORT_STREAM_CHART 0
+#endif
+
+#define SCHART_MAX_SERIES 8
+#define SCHART_GAP        2 // Blank points between the newest and the oldest
+
+#if LV_PORT_STREAM_CHART
+
+extern const lv_obj_class_t lv_port_schart_class;
+
+// capacity: points across the plot (the content width at most). The series
+// and their points come from the LVGL heap. Line width and opacity are
+// taken from the LV_PART_ITEMS style (2 px by default).
+lv_obj_t *lv_port_schart_create(lv_obj_t *parent, uint16_t capacity);
+
+// Returns the series id, or -1 when SCHART_MAX_SERIES are taken or the heap
+// is out of memory
+int32_t lv_port_schart_add_series(lv_obj_t *obj, lv_color_t color);
+void lv_port_schart_set_range(lv_obj_t *obj, int16_t min, int16_t max);
+
+// One new point for every series (values[series_count]), advances the sweep
+void lv_port_schart_push(lv_obj_t *obj, const int16_t *values);
+
+// Drops all points
+void lv_port_schart_clear(lv_obj_t *obj);
+
+#endif // LV_PORT_STREAM_CHART
+
+#endif // LV_PORT_SCHART_H
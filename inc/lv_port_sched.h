@@ -0,0 +1,61 @@
+#ifndef LV_PORT_SCHED_H
+#define LV_PORT_SCHED_H
+
+#include "lvgl.h"
+#include <stdbool.h>
+
+// Tickless main loop.
+// Set to 1 to let the LVGL core sleep (WFE with a timer alarm) until the
+// next LVGL timer is due, the pen goes down or lv_port_sched_wake() is
+// called, instead of spinning on lv_timer_handler(). Touch polling is
+// paused while the pen is up, so a static screen has no periodic work.
+// The LVGL tick comes from time_us_64() (LV_TICK_CUSTOM in lv_conf.h),
+// nothing calls lv_tick_inc().
+#ifndef LV_PORT_TICKLESS
+#define LV_PORT_TICKLESS 0
+#endif
+
+// Longest sleep when no LVGL timer is pending, so the application still gets
+// lv_port_sched_step() returns for its idle work (log flush, ...)
+#define SCHED_MAX_SLEEP_MS 1000
+
+typedef struct {
+    uint64_t total_us;        // Since init or the last reset
+    uint64_t run_us;          // In lv_timer_handler
+    uint64_t sleep_us;        // Waiting in WFE
+    uint32_t steps;
+    uint32_t wfe_returns;     // Including the spurious ones
+    uint32_t wake_timer;
+    uint32_t wake_touch;
+    uint32_t wake_msg;
+    uint32_t timer_late_max_us; // Due time of the next LVGL timer -> awake
+    uint32_t timer_late_sum_us;
+    uint32_t touch_wake_max_us; // Pen-down edge -> awake
+    uint32_t touch_wake_sum_us;
+} lv_port_sched_stats_t;
+
+#if LV_PORT_TICKLESS
+
+// Touch device whose polling is paused while the pen is up (done by
+// lv_port_indev_init)
+void lv_port_sched_set_indev(lv_indev_t *indev);
+
+// One loop iteration: runs lv_timer_handler() and sleeps until there is
+// something to do. Returns true when lv_port_sched_wake() was called, the
+// caller then handles its messages before the next step:
+//
+//     while (1) {
+//         if (lv_port_sched_step()) app_handle_messages();
+//     }
+bool lv_port_sched_step(void);
+
+// Ends the current or next sleep early. Safe from IRQs and from core1.
+void lv_port_sched_wake(void);
+
+void lv_port_sched_get_stats(lv_port_sched_stats_t *stats);
+void lv_port_sched_reset_stats(void);
+void lv_port_sched_print(void);
+
+#endif // LV_PORT_TICKLESS
+
+#endif // LV_PORT_SCHED_H
@@ -0,0 +1,82 @@
+#ifndef LV_PORT_SCRCACHE_H
+#define LV_PORT_SCRCACHE_H
+
+#include "lvgl.h"
+#include <stdbool.h>
+
+// Screen cache.
+// Set to 1 to build screens ahead of time and keep them alive, so switching
+// to a heavy screen is an lv_scr_load() instead of creating, styling and
+// laying out its objects first. Screens are registered with a builder that
+// creates them in steps; lv_port_scrcache_prefetch() marks a screen as a
+// likely next one, and an LVGL timer runs its steps in slices of at most
+// SCRCACHE_SLICE_US while no frame is waiting to be rendered. The last step
+// is followed by a layout update, so the first render after a switch only
+// draws.
+//
+// The building runs in the LVGL thread: LVGL isn't thread-safe, so core1
+// can't create objects while core0 renders.
+//
+// At most SCRCACHE_MAX_ALIVE screens stay built, within SCRCACHE_MEM_BUDGET
+// bytes of the LVGL heap; beyond that the least recently shown one is
+// deleted. The active screen, the one being loaded or animated out and the
+// one being built are never deleted.
+//
+// With LV_MEM_CUSTOM (lv_port_mem.h) the cache holds SCRCACHE_OOM_RESERVE
+// bytes of the heap back. An allocation that fails gets the reserve and is
+// retried; the cached screen is deleted later by the idle timer, never from
+// inside the allocator (which may run while LVGL renders or walks the very
+// objects being deleted), and the reserve is taken again after it.
+#ifndef LV_PORT_SCREEN_CACHE
+#define LV_PORT_SCREEN_CACHE 0
+#endif
+
+#define SCRCACHE_MAX_SCREENS     8    // Registered screens
+#define SCRCACHE_MAX_ALIVE       3    // Built screens kept, the active one included
+#define SCRCACHE_MEM_BUDGET      (16U * 1024U)
+#define SCRCACHE_SLICE_US        4000 // Build time per idle slice
+#define SCRCACHE_IDLE_PERIOD_MS  20
+#define SCRCACHE_OOM_RESERVE     2048 // Heap lent to a failing allocation
+
+// Creates part of the screen on each call, step counting from 0. Returns
+// true when the screen is complete.
+typedef bool (*lv_port_scrcache_build_cb_t)(lv_obj_t *scr, uint32_t step);
+
+typedef struct {
+    const char *name;
+    bool built;           // All steps done
+    bool alive;           // Objects exist (possibly partly built)
+    uint32_t mem_bytes;   // LVGL heap taken by its objects
+    uint32_t steps;
+    uint32_t build_us;    // Last complete build, all steps
+    uint32_t slice_max_us; // Longest single step
+    uint32_t switch_us;   // Last lv_port_scrcache_show()
+    uint32_t hits;        // Shown ready-built
+    uint32_t misses;      // Shown while not (fully) built
+    uint32_t evictions;
+} lv_port_scrcache_stats_t;
+
+#if LV_PORT_SCREEN_CACHE
+
+// Returns the screen id, or -1 when SCRCACHE_MAX_SCREENS are registered
+int32_t lv_port_scrcache_register(const char *name, lv_port_scrcache_build_cb_t build);
+
+// Changes the limits (defaults SCRCACHE_MAX_ALIVE, SCRCACHE_MEM_BUDGET)
+void lv_port_scrcache_set_limits(uint32_t max_alive, uint32_t mem_budget);
+
+// Builds the screen in idle slices if it isn't already
+void lv_port_scrcache_prefetch(int32_t id);
+
+// Loads the screen, finishing its build first if needed. The screen that was
+// active stays cached. Returns the screen object.
+lv_obj_t *lv_port_scrcache_show(int32_t id, lv_scr_load_anim_t anim, uint32_t time_ms);
+
+// Deletes a cached screen (not the active one), e.g. after its data changed
+void lv_port_scrcache_drop(int32_t id);
+
+void lv_port_scrcache_get_stats(int32_t id, lv_port_scrcache_stats_t *stats);
+void lv_port_scrcache_print(void);
+
+#endif // LV_PORT_SCREEN_CACHE
+
+#endif // LV_PORT_SCRCACHE_H
@@ -0,0 +1,23 @@
+#ifndef PORT_FAST_MEM_H
+#define PORT_FAST_MEM_H
+
+#include "pico/platform.h"
+
+// Set to 1 to run the per-pixel paths of the drivers and ports (disp_flush,
+// st7789_send_pixels, ...) from SRAM instead of XIP flash, so large blends
+// can't evict them from the 16 KB XIP cache. pico-sdk copies the
+// .time_critical sections to SRAM at boot.
+//
+// The hot LVGL functions are moved with the same section by renaming them in
+// liblvgl.a from a sampling profile, see tools/hot_funcs.py.
+#ifndef LV_PORT_FAST_MEM
+#define LV_PORT_FAST_MEM 0
+#endif
+
+#if LV_PORT_FAST_MEM
+#define PORT_FAST_FUNC(func) __not_in_flash_func(func)
+#else
+#define PORT_FAST_FUNC(func) func
+#endif
+
+#endif // PORT_FAST_MEM_H
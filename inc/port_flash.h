@@ -0,0 +1,17 @@
+#ifndef PORT_FLASH_H
+#define PORT_FLASH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Erase and program of the onboard flash the code runs from, for the LittleFS
+// partition (port_lfs.h) and the SPI clock record (spi_tune.h). Both run the
+// ROM routine through flash_safe_execute(), with the other core parked and
+// IRQs off, so nothing executes from XIP meanwhile: when core1 runs, call
+// flash_safe_execute_core_init() on it. Offsets are from the start of the
+// flash, sector aligned for erase and page aligned for program. False if the
+// lockout couldn't be taken.
+bool port_flash_erase(uint32_t offset, uint32_t size);
+bool port_flash_program(uint32_t offset, const void *data, uint32_t size);
+
+#endif // PORT_FLASH_H
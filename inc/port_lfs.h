@@ -0,0 +1,106 @@
+#ifndef PORT_LFS_H
+#define PORT_LFS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// LittleFS on the onboard flash.
+// Set LV_PORT_FS to 1 to keep images, fonts and other assets in a LittleFS
+// partition at the end of the flash instead of compiling them in, so they
+// can be replaced without reflashing the firmware (see lv_port_fs.h for the
+// LVGL drive). Needs the littlefs sources (lfs.c, lfs_util.c) in the build.
+//
+// Reads come straight from the XIP window: small ones (LittleFS metadata)
+// through the cached alias, larger ones through the non-allocating alias so
+// streaming an asset doesn't evict the code running from the 16 kB XIP
+// cache. On the RP2040, word-aligned reads of PORT_LFS_STREAM_MIN bytes or
+// more use the XIP streaming FIFO with DMA, which reads sequentially at the
+// full QSPI rate instead of one bus transaction per word.
+//
+// Each open file has a read cache of up to PORT_LFS_RA_SIZE bytes, filled
+// from a PORT_LFS_RA_ALIGN boundary, so the many small reads of a font
+// loader or an image decoder cost one flash read per fill and short seeks
+// backwards stay in the cache. The fill size grows while reads are
+// sequential and drops back after a seek elsewhere. Reads of at least
+// PORT_LFS_RA_SIZE bytes go directly into the caller's buffer.
+//
+// Writes and erases go through port_flash.h: when core1 runs, call
+// flash_safe_execute_core_init() on it so it can be paused.
+#ifndef LV_PORT_FS
+#define LV_PORT_FS 0
+#endif
+
+#define PORT_LFS_SIZE       (512u * 1024u) // At the end of the flash, keep the firmware below it
+#define PORT_LFS_OFFSET     (PICO_FLASH_SIZE_BYTES - PORT_LFS_SIZE)
+#define PORT_LFS_BLOCK      4096u          // Flash sector
+#define PORT_LFS_PROG       256u           // Flash page
+#define PORT_LFS_MAX_FILES  2              // Open at the same time
+#define PORT_LFS_RA_SIZE    2048u          // Read cache per open file
+#define PORT_LFS_RA_ALIGN   256u
+#define PORT_LFS_NOCACHE_MIN 64u           // Smaller reads go through the cached XIP alias
+#define PORT_LFS_STREAM_MIN 256u
+
+#ifndef PORT_LFS_XIP_STREAM
+#if defined(PICO_RP2040) && PICO_RP2040
+#define PORT_LFS_XIP_STREAM 1
+#else
+#define PORT_LFS_XIP_STREAM 0
+#endif
+#endif
+
+typedef struct {
+    uint32_t bd_reads;      // Block device reads by LittleFS
+    uint32_t bd_read_bytes;
+    uint32_t bd_streamed;   // Of those, through the XIP stream
+    uint32_t bd_progs;
+    uint32_t bd_erases;
+    uint32_t reads;         // port_lfs_read() calls
+    uint32_t hits;          // Served from the read cache only
+    uint32_t fills;         // Read cache refills
+    uint32_t direct;        // Large reads into the caller's buffer
+} port_lfs_stats_t;
+
+#if LV_PORT_FS
+
+#include "lfs.h"
+
+typedef struct {
+    lfs_file_t file;
+    struct lfs_file_config cfg;     // LittleFS keeps a pointer to it until close
+    uint8_t lfs_buf[PORT_LFS_PROG]; // LittleFS file cache
+    uint8_t ra[PORT_LFS_RA_SIZE] __attribute__((aligned(4)));
+    uint32_t ra_pos;  // File offset of ra[0]
+    uint32_t ra_len;
+    uint32_t ra_win;  // Next fill size
+    uint32_t pos;     // Next read/write
+    uint32_t lfs_pos; // Where LittleFS' own position is
+    bool used;
+} port_lfs_file_t;
+
+// Mounts the partition; with format, formats it first if it doesn't mount.
+// Returns 0 or a LittleFS error.
+int port_lfs_mount(bool format);
+void port_lfs_unmount(void);
+
+// The mounted file system, for directories and other LittleFS calls
+lfs_t *port_lfs(void);
+
+// flags: LFS_O_*. Returns NULL when the file can't be opened or
+// PORT_LFS_MAX_FILES are open.
+port_lfs_file_t *port_lfs_open(const char *path, int flags);
+int port_lfs_close(port_lfs_file_t *f);
+
+// Return the bytes done or a LittleFS error
+int32_t port_lfs_read(port_lfs_file_t *f, void *buf, uint32_t len);
+int32_t port_lfs_write(port_lfs_file_t *f, const void *buf, uint32_t len);
+
+void port_lfs_seek(port_lfs_file_t *f, uint32_t pos);
+uint32_t port_lfs_tell(const port_lfs_file_t *f);
+uint32_t port_lfs_size(port_lfs_file_t *f);
+
+void port_lfs_get_stats(port_lfs_stats_t *stats);
+void port_lfs_reset_stats(void);
+
+#endif // LV_PORT_FS
+
+#endif // PORT_LFS_H
@@ -0,0 +1,101 @@
+#ifndef PORT_LOG_H
+#define PORT_LOG_H
+
+#include "pico/stdlib.h"
+#include <stdint.h>
+
+// Deferred logging for the drivers and ports.
+// A log call only stores the format string pointer, a timestamp and up to
+// PORT_LOG_MAX_ARGS integer arguments in a per-core ring (a few dozen
+// cycles, no USB traffic). port_log_flush() does the printf later, from
+// idle time or from core1, so a log in a hot path can't block the LVGL loop.
+//
+// Arguments are stored as uint32_t: use integer conversions (%d %u %x %c).
+// %s is only safe for strings that outlive the record, e.g. literals, and
+// needs an explicit (uint32_t) cast.
+
+#define PORT_LOG_LEVEL_NONE  0
+#define PORT_LOG_LEVEL_ERROR 1
+#define PORT_LOG_LEVEL_WARN  2
+#define PORT_LOG_LEVEL_INFO  3
+#define PORT_LOG_LEVEL_DEBUG 4
+
+// Calls above this level compile to nothing, arguments included
+#ifndef PORT_LOG_LEVEL
+#define PORT_LOG_LEVEL PORT_LOG_LEVEL_INFO
+#endif
+
+#define PORT_LOG_MAX_ARGS 4
+#define PORT_LOG_RING     64 // Records per core, power of 2
+
+typedef struct {
+    const char *fmt;
+    uint32_t t_us;
+    uint8_t level;
+    uint8_t nargs;
+    uint32_t args[PORT_LOG_MAX_ARGS];
+} port_log_rec_t;
+
+void port_log_write(uint8_t level, const char *fmt, const uint32_t *args, uint32_t nargs);
+
+// Prints up to max_records pending records (0: all) from both cores' rings.
+// Only one caller at a time, either the idle loop on core0 or core1.
+uint32_t port_log_flush(uint32_t max_records);
+
+// Records lost because a ring was full, since boot
+uint32_t port_log_dropped(void);
+
+#define PORT_LOG_NARGS_(...) (sizeof((uint32_t[]){0, ##__VA_ARGS__}) / sizeof(uint32_t) - 1)
+
+#define PORT_LOG_WRITE_(level, fmt, ...)                                        \
+    do {                                                                        \
+        _Static_assert(PORT_LOG_NARGS_(__VA_ARGS__) <= PORT_LOG_MAX_ARGS,       \
+                       "too many log arguments");                               \
+        port_log_write(level, fmt, (const uint32_t[]){0, ##__VA_ARGS__} + 1,    \
+                       PORT_LOG_NARGS_(__VA_ARGS__));                           \
+    } while (0)
+
+// Logs at most once per period_ms from this call site, later calls are skipped
+#define PORT_LOG_RATELIMIT_(period_ms, level, fmt, ...)                         \
+    do {                                                                        \
+        static uint32_t port_log_last_;                                         \
+        static bool port_log_once_;                                             \
+        uint32_t port_log_now_ = to_ms_since_boot(get_absolute_time());         \
+        if (!port_log_once_ || port_log_now_ - port_log_last_ >= (period_ms)) { \
+            port_log_once_ = true;                                              \
+            port_log_last_ = port_log_now_;                                     \
+            PORT_LOG_WRITE_(level, fmt, ##__VA_ARGS__);                         \
+        }                                                                       \
+    } while (0)
+
+#if PORT_LOG_LEVEL >= PORT_LOG_LEVEL_ERROR
+#define PORT_LOGE(fmt, ...) PORT_LOG_WRITE_(PORT_LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define PORT_LOGE(fmt, ...) ((void)0)
+#endif
+
+#if PORT_LOG_LEVEL >= PORT_LOG_LEVEL_WARN
+#define PORT_LOGW(fmt, ...) PORT_LOG_WRITE_(PORT_LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define PORT_LOGW_EVERY(ms, fmt, ...) PORT_LOG_RATELIMIT_(ms, PORT_LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define PORT_LOGW(fmt, ...) ((void)0)
+#define PORT_LOGW_EVERY(ms, fmt, ...) ((void)0)
+#endif
+
+#if PORT_LOG_LEVEL >= PORT_LOG_LEVEL_INFO
+#define PORT_LOGI(fmt, ...) PORT_LOG_WRITE_(PORT_LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define PORT_LOGI_EVERY(ms, fmt, ...) PORT_LOG_RATELIMIT_(ms, PORT_LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define PORT_LOGI(fmt, ...) ((void)0)
+#define PORT_LOGI_EVERY(ms, fmt, ...) ((void)0)
+#endif
+
+#if PORT_LOG_LEVEL >= PORT_LOG_LEVEL_DEBUG
+#define PORT_LOGD(fmt, ...) PORT_LOG_WRITE_(PORT_LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define PORT_LOGD_EVERY(ms, fmt, ...) PORT_LOG_RATELIMIT_(ms, PORT_LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define PORT_LOGD(fmt, ...) ((void)0)
+#define PORT_LOGD_EVERY(ms, fmt, ...) ((void)0)
+#endif
+
+#endif // PORT_LOG_H
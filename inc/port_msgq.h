@@ -0,0 +1,55 @@
+#ifndef PORT_MSGQ_H
+#define PORT_MSGQ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Bounded multi-producer/single-consumer queue of fixed-size records.
+// Each slot carries a sequence number that tells the consumer whether the
+// record in it is published (Vyukov's bounded queue). Producers only
+// contend for the head index; the record copy and the consumer side take
+// no lock.
+//
+// On the RP2040 (Cortex-M0+, no exclusive load/store) the head is reserved
+// under a hardware spin lock, with interrupts masked on the posting core
+// for the few cycles it's held, so both cores and IRQ handlers can post.
+// Elsewhere (RP2350, the host simulator) the head moves with a
+// compare-and-swap and the queue is lock-free.
+#if defined(__ARM_ARCH_6M__)
+#include "hardware/sync.h"
+#define PORT_MSGQ_SPINLOCK 1
+#else
+#define PORT_MSGQ_SPINLOCK 0
+#endif
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t mask;      // Slots - 1, slots a power of 2
+    uint32_t rec_size;
+    uint32_t stride;    // Sequence word + record, word aligned
+    volatile uint32_t head; // Next slot to reserve, all producers
+    uint32_t tail;      // Next slot to read, consumer only
+    volatile uint32_t dropped;
+#if PORT_MSGQ_SPINLOCK
+    spin_lock_t *lock;
+#endif
+} port_msgq_t;
+
+#define PORT_MSGQ_STRIDE(rec_size)          (4u + (((rec_size) + 3u) & ~3u))
+#define PORT_MSGQ_BUF_WORDS(slots, rec_size) ((slots) * PORT_MSGQ_STRIDE(rec_size) / 4u)
+
+// buf: PORT_MSGQ_BUF_WORDS(slots, rec_size) words; slots a power of 2.
+// Call before any producer runs.
+void port_msgq_init(port_msgq_t *q, uint32_t *buf, uint32_t slots, uint32_t rec_size);
+
+// Copies rec_size bytes into the queue. Returns false (and counts a drop)
+// when it's full.
+bool port_msgq_post(port_msgq_t *q, const void *rec);
+
+// Consumer: copies the oldest record out, false when none is published
+bool port_msgq_pop(port_msgq_t *q, void *rec);
+
+// Records reserved but not yet popped (some may still be being written)
+uint32_t port_msgq_count(const port_msgq_t *q);
+
+#endif // PORT_MSGQ_H
@@ -0,0 +1,64 @@
+#ifndef PORT_READBACK_H
+#define PORT_READBACK_H
+
+#include "st7789.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Panel content check by readback.
+// Set LV_PORT_READBACK to 1 to keep a CRC-16 of every READBACK_SEG_W pixel
+// segment of every panel row as it is flushed, read the panel memory back
+// (RAMRD over MISO) a few rows at a time and report the segments that no
+// longer match, e.g. after an ESD hit or a brownout of the panel. Only
+// segments flushed whole get a CRC; lv_port_disp widens invalidated areas
+// to whole segments for that.
+//
+// Needs the panel's SDO on PIN_SPI_MISO and the panel on its own SPI (see
+// st7789_panel_read_rect). A read back row takes 3 bytes per pixel at
+// ST7789_READ_BAUD, about 1 ms for 240 pixels. The CRCs take
+// ST7789_HEIGHT * READBACK_SEGS * 2 bytes of RAM (2.5 kB at 60 pixel
+// segments) and about 10 cycles per flushed byte.
+#ifndef LV_PORT_READBACK
+#define LV_PORT_READBACK 0
+#endif
+
+#define READBACK_SEG_W 60 // Even, divides ST7789_WIDTH; DFLUSH_SEG_W if both are on
+#define READBACK_SEGS  (ST7789_WIDTH / READBACK_SEG_W)
+
+typedef struct {
+    uint32_t rows;        // Rows read back
+    uint32_t segs;        // Segments compared (the others had no CRC)
+    uint32_t bad;         // Segments that didn't match
+    uint32_t passes;      // Complete passes over the panel
+    uint32_t step_us_max; // Longest port_readback_step()
+    uint64_t bytes_read;  // SPI bytes clocked in
+} port_readback_stats_t;
+
+// A run of bad segments on a row, x1..x2 in panel coordinates
+typedef void (*port_readback_bad_cb_t)(int32_t x1, int32_t x2, int32_t y, void *ctx);
+
+#if LV_PORT_READBACK
+
+// Reads the display ID (RDDID) to see whether the panel answers on MISO.
+// Returns false, and checks nothing afterwards, when it doesn't.
+bool port_readback_init(void);
+
+// CRCs of a flushed area (pixels as sent, width x2 - x1 + 1). Segments the
+// area covers only partly lose theirs.
+void port_readback_record(int32_t x1, int32_t y1, int32_t x2, int32_t y2, const uint16_t *pixels);
+
+// Forget the CRCs, e.g. after writing to the panel outside the port
+void port_readback_forget(void);
+
+// Reads back the next rows (wrapping at the bottom, rows without a CRC are
+// skipped) and calls bad for each run of mismatching segments; those lose
+// their CRC until flushed again. Does nothing while the panel sleeps.
+// Returns the bad segments found.
+uint32_t port_readback_step(uint32_t rows, port_readback_bad_cb_t bad, void *ctx);
+
+void port_readback_get_stats(port_readback_stats_t *stats);
+void port_readback_reset_stats(void);
+
+#endif // LV_PORT_READBACK
+
+#endif // PORT_READBACK_H
@@ -0,0 +1,73 @@
+#ifndef SPI_BUS_H
+#define SPI_BUS_H
+
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include <stdbool.h>
+
+// Shared SPI bus for modules where the XPT2046 sits on the display's SPI.
+// Set SPI_BUS_SHARED to 1 to run both on SPI_PORT (SCK/MOSI/MISO of the
+// display, own CS each). The bus switches the baud rate per device. Pixel
+// data goes out by DMA in SPI_BUS_BURST pieces; short transactions queued
+// meanwhile (touch samples, from IRQs) run in the gaps between pieces, so
+// touch sampling neither waits for a frame nor stalls it.
+#ifndef SPI_BUS_SHARED
+#define SPI_BUS_SHARED 0
+#endif
+
+#define SPI_BUS_BURST    1024 // Stream bytes between two gaps, even
+#define SPI_BUS_QUEUE    4    // Pending short transactions
+#define SPI_BUS_GAP_TXNS 2    // Run per gap at most, the stream keeps the bus otherwise
+#define SPI_BUS_TXN_MAX  12   // Bytes per short transaction
+
+typedef enum {
+    SPI_BUS_DEV_DISPLAY = 0,
+    SPI_BUS_DEV_TOUCH,
+    SPI_BUS_DEV_COUNT
+} spi_bus_dev_t;
+
+// Queue order: higher priority first, submission order within a priority
+typedef enum {
+    SPI_BUS_PRIO_LOW = 0,
+    SPI_BUS_PRIO_HIGH
+} spi_bus_prio_t;
+
+// Called with the bytes clocked in, from the context that ran the transaction
+typedef void (*spi_bus_done_cb_t)(const uint8_t *rx, size_t len, void *ctx);
+
+typedef struct {
+    uint32_t streams;
+    uint32_t bursts;
+    uint32_t gaps;            // Bursts followed by queued transactions
+    uint32_t txns;
+    uint32_t txn_wait_max_us; // Queued -> run
+    uint32_t queue_full;      // Rejected submits
+} spi_bus_stats_t;
+
+#if SPI_BUS_SHARED
+
+void spi_bus_init(spi_inst_t *spi, uint sck_pin, uint mosi_pin, uint miso_pin);
+void spi_bus_add_device(spi_bus_dev_t dev, uint cs_pin, uint32_t baud);
+// Changes a device's rate once the bus is free, returns the rate it gets
+uint32_t spi_bus_set_baud(spi_bus_dev_t dev, uint32_t baud);
+
+// Blocking write from thread context, waits until the bus is free
+void spi_bus_write(spi_bus_dev_t dev, const uint8_t *tx, size_t len);
+
+// Streams h rows of row_bytes (stride_bytes apart) and returns after the
+// last byte. resume() is called with the device selected after each gap,
+// e.g. to re-issue a memory write command.
+void spi_bus_stream(spi_bus_dev_t dev, const uint8_t *data, size_t row_bytes, size_t h, size_t stride_bytes,
+                    void (*resume)(void));
+
+// Queues a full-duplex transaction of up to SPI_BUS_TXN_MAX bytes; it runs
+// at once if the bus is free, else at the next gap or release. Safe from
+// IRQs and core1. Returns false if the queue is full.
+bool spi_bus_submit(spi_bus_dev_t dev, spi_bus_prio_t prio, const uint8_t *tx, size_t len,
+                    spi_bus_done_cb_t cb, void *ctx);
+
+void spi_bus_get_stats(spi_bus_stats_t *stats);
+
+#endif // SPI_BUS_SHARED
+
+#endif // SPI_BUS_H
@@ -0,0 +1,90 @@
+#ifndef SPI_TUNE_H
+#define SPI_TUNE_H
+
+#include "st7789.h"
+#include "port_lfs.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// SPI clock calibration of the panel link.
+// Set SPI_CLOCK_TUNE to 1 to run the panel at the fastest write rate its
+// wiring carries instead of trusting SPI_BAUD_RATE. spi_tune_panel() steps
+// through the rates the SPI can make, clk_peri / 2n with clk_peri from
+// clk_sys or from pll_usb, fastest first. At each rate it writes test
+// patterns (all bits toggling, 0x5555 / 0xAAAA, walking ones, pseudo-random)
+// to the last SPI_TUNE_ROWS panel rows and reads them back at
+// ST7789_READ_BAUD. It picks the fastest rate that passes SPI_TUNE_CONFIRM
+// more patterns and lies SPI_TUNE_MARGIN_PCT below every rate that failed.
+// When the fastest rate tried passes, the link's limit may lie right above
+// it, so the pick lies SPI_TUNE_MARGIN_PCT below that rate instead (it is
+// only kept when no slower rate is left).
+// The pick is stored in the flash sector below the asset partition; later
+// starts check it with one pattern and tune again only if that fails or
+// clk_sys or the wiring changed.
+//
+// Needs panel reads (see st7789_panel_read_rect); without them the
+// configured rate stays. With clk_peri on pll_usb the UART rates change
+// too: stdio's UART is set up again, other UARTs and SPIs must be set up
+// after the tuning. Tuning takes about 0.15 s with the backlight off.
+#ifndef SPI_CLOCK_TUNE
+#define SPI_CLOCK_TUNE 0
+#endif
+
+#define SPI_TUNE_MIN_BAUD     (10 * 1000 * 1000)  // Slowest rate tried
+#define SPI_TUNE_MAX_BAUD     (100 * 1000 * 1000) // Beyond the ST7789 rating, for an overclocked clk_sys
+#define SPI_TUNE_PERI_USB     1                   // Also try clk_peri from pll_usb (48 MHz)
+#define SPI_TUNE_MARGIN_PCT   15
+#define SPI_TUNE_PASSES       3                   // Patterns per rate while searching
+#define SPI_TUNE_CONFIRM      8                   // More for the rate picked
+#define SPI_TUNE_ROWS         8                   // Panel rows per pattern
+#define SPI_TUNE_MAX_RATES    24
+#define SPI_TUNE_FLASH_OFFSET (PORT_LFS_OFFSET - FLASH_SECTOR_SIZE) // Below the asset partition
+
+typedef enum {
+    SPI_TUNE_PERI_SYS = 0,
+    SPI_TUNE_PERI_PLL_USB,
+} spi_tune_peri_t;
+
+typedef struct {
+    uint32_t baud;    // What the divider gives
+    uint32_t peri_hz; // clk_peri for it
+    uint8_t peri;     // spi_tune_peri_t
+} spi_tune_rate_t;
+
+typedef struct {
+    spi_tune_rate_t rate; // Picked
+    uint32_t fail_min;    // Slowest rate that failed, 0: none
+    uint32_t rates_tried;
+    uint32_t probes;      // Patterns written and read back
+    bool ok;              // Some rate passed
+    bool stored;          // Rate from the flash, not searched
+} spi_tune_result_t;
+
+// Writes pattern number pass at the rate and reads it back; true if intact
+typedef bool (*spi_tune_probe_t)(const spi_tune_rate_t *rate, uint32_t pass, void *ctx);
+
+#if SPI_CLOCK_TUNE
+
+// The rates clk_peri / 2n in [min, max] for each clk_peri frequency
+// (indexed by spi_tune_peri_t), fastest first; of equal rates the one from
+// the lower index is kept. Returns how many were written.
+uint32_t spi_tune_rates(const uint32_t *peri_hz, uint32_t sources, uint32_t min, uint32_t max,
+                        spi_tune_rate_t *out, uint32_t max_rates);
+
+// The search itself, over rates fastest first; no hardware access besides
+// what probe does. Returns res->ok.
+bool spi_tune_search(const spi_tune_rate_t *rates, uint32_t n, spi_tune_probe_t probe, void *ctx,
+                     spi_tune_result_t *res);
+
+// Sets the panel's rate (and clk_peri) from the stored calibration, or
+// calibrates when there is none, it fails or recalibrate is set. Call
+// right after st7789_panel_init() (lv_port_disp_init does for the default
+// panel). Returns the rate the panel writes at.
+uint32_t spi_tune_panel(st7789_t *panel, bool recalibrate);
+
+// Of the last spi_tune_panel()
+void spi_tune_get_result(spi_tune_result_t *res);
+
+#endif // SPI_CLOCK_TUNE
+
+#endif // SPI_TUNE_H
@@ -8,16 +8,48 @@
 #define SPI_PORT spi0
 #define PIN_SPI_SCK  18
 #define PIN_SPI_MOSI 19
-#define PIN_SPI_MISO 16 // Optional, not used in this example for write-only
+#define PIN_SPI_MISO 16 // Panel SDO, only for reads (RDDID, RAMRD)
 #define PIN_DC       20
 #define PIN_CS       17
 #define PIN_RST      21
 #define PIN_BLK      22 // Backlight control
 
+// SPI configuration
+// Requested rate: the ST7789's 16 ns write cycle. The SPI runs at clk_peri
+// divided by an even number, so at most clk_peri / 2 (62.5 MHz at 125 MHz);
+// st7789_get_baud() is the rate it got. SPI_CLOCK_TUNE (spi_tune.h) finds
+// the fastest rate the wiring carries.
+#define SPI_BAUD_RATE (62.5 * 1000 * 1000)
+#define ST7789_READ_BAUD (6 * 1000 * 1000)  // Reads: serial read cycle is 150 ns at least
+
+// Backlight PWM on PIN_BLK: 12-bit duty at about 30 kHz, levels in percent
+// are gamma corrected (2.2). Fades are written to the compare register by
+// DMA, paced by the wrap of another PWM slice that only counts (its pins
+// keep their function), so they take no CPU time.
+#define ST7789_BL_PWM_WRAP      4095
+#define ST7789_BL_FADE_SLICE    7   // Pacing slice, must differ from PIN_BLK's
+#define ST7789_BL_FADE_HZ       200 // Fade steps per second
+#define ST7789_BL_FADE_MAX_STEPS 256 // Longer fades take slower steps, up to about 30 s
+
 // Display dimensions
 #define ST7789_WIDTH  240
 #define ST7789_HEIGHT 320
 
+#define ST7789_NO_PIN       0xFF // Reset/backlight not wired
+#define ST7789_MAX_PANELS   2    // Handles that can flush asynchronously at a time
+
+// 1 (default): only st7789_default_panel with ST7789_CONFIG_DEFAULT. The
+// config fields are then compile-time constants in the driver (pins, SPI
+// instance, offsets fold into the code as with the hard-wired driver);
+// lv_port_disp_add_panel() isn't available. 0 for several panels.
+#ifndef ST7789_SINGLE_PANEL
+#define ST7789_SINGLE_PANEL 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // ST7789 Commands
 #define ST7789_NOP     0x00
 #define ST7789_SWRESET 0x01
@@ -40,6 +72,7 @@
 
 #define ST7789_PTLAR   0x30
 #define ST7789_COLMOD  0x3A
+#define ST7789_WRMEMC  0x3C // Write memory continue
 #define ST7789_MADCTL  0x36
 
 #define ST7789_FRMCTR1 0xB1
@@ -65,6 +98,87 @@
 #define ST7789_PVGAMCTRL 0xE0
 #define ST7789_NVGAMCTRL 0xE1
 
+// Panel handle: one per ST7789, so several panels (or boards wired
+// differently) can be driven from one firmware. Panels on separate SPI
+// instances flush in parallel, each on its own DMA channel; panels sharing
+// an SPI instance (own CS and DC) take turns.
+typedef struct {
+    spi_inst_t *spi;
+    uint32_t baud;
+    uint8_t pin_sck;
+    uint8_t pin_mosi;
+    uint8_t pin_miso;    // ST7789_NO_PIN: SDO not wired, no reads
+    uint8_t pin_dc;
+    uint8_t pin_cs;
+    uint8_t pin_rst;     // ST7789_NO_PIN: SWRESET only; panels sharing a reset line list it once
+    uint8_t pin_blk;     // The first panel with a backlight pin gets the PWM/fade backlight, others plain on
+    uint16_t width;      // Visible area after MADCTL
+    uint16_t height;
+    uint16_t x_offset;   // Of the visible area in the controller's 240 x 320 memory
+    uint16_t y_offset;
+    uint8_t madctl;
+    uint8_t colmod;      // 0x55: RGB565
+} st7789_config_t;
+
+// The wiring defined above
+#define ST7789_CONFIG_DEFAULT {                                                   \
+    .spi = SPI_PORT, .baud = SPI_BAUD_RATE,                                       \
+    .pin_sck = PIN_SPI_SCK, .pin_mosi = PIN_SPI_MOSI, .pin_dc = PIN_DC,           \
+    .pin_miso = PIN_SPI_MISO,                                                     \
+    .pin_cs = PIN_CS, .pin_rst = PIN_RST, .pin_blk = PIN_BLK,                     \
+    .width = ST7789_WIDTH, .height = ST7789_HEIGHT, .x_offset = 0, .y_offset = 0, \
+    .madctl = 0x00, .colmod = 0x55,                                               \
+}
+
+typedef struct st7789 st7789_t;
+typedef void (*st7789_done_cb_t)(st7789_t *panel, void *ctx);
+
+struct st7789 {
+    st7789_config_t cfg;
+    uint32_t baud;                // Actual SPI rate for writes
+    int dma_chan;                 // Claimed on the first async send
+    volatile bool busy;           // Async send in flight
+    st7789_done_cb_t done_cb;
+    void *done_ctx;
+    bool on_shared_bus;           // SPI_BUS_SHARED and on SPI_PORT
+    bool miso_ready;              // pin_miso switched to SPI by the first read
+    bool sleeping;
+    absolute_time_t slpin_time;   // Last SLPIN
+    absolute_time_t slpout_time;  // Last SLPOUT
+};
+
+void st7789_panel_init(st7789_t *panel, const st7789_config_t *cfg);
+void st7789_panel_write_cmd(st7789_t *panel, uint8_t cmd);
+void st7789_panel_write_data(st7789_t *panel, const uint8_t *data, size_t len);
+void st7789_panel_set_window(st7789_t *panel, uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end);
+void st7789_panel_send_pixels(st7789_t *panel, const uint16_t *pixels, size_t len);
+void st7789_panel_send_pixels_rect(st7789_t *panel, const uint16_t *pixels, size_t w, size_t h, size_t stride);
+// Starts a DMA transfer and returns; cb runs from the DMA IRQ after the
+// last bit has left. Commands to the panel wait for it.
+void st7789_panel_send_pixels_async(st7789_t *panel, const uint16_t *pixels, size_t len,
+                                    st7789_done_cb_t cb, void *ctx);
+void st7789_panel_wait(st7789_t *panel);
+void st7789_panel_set_frame_rate(st7789_t *panel, uint8_t hz);
+void st7789_panel_sleep(st7789_t *panel);
+void st7789_panel_wake(st7789_t *panel);
+bool st7789_panel_is_sleeping(const st7789_t *panel);
+// Changes the write rate (cfg.baud is the one at init); both return the
+// rate the divider gives, which is at most the one asked for
+uint32_t st7789_panel_set_baud(st7789_t *panel, uint32_t baud);
+uint32_t st7789_panel_get_baud(const st7789_t *panel);
+// Reads need the panel's SDO on pin_miso and a panel of its own on the SPI
+// (not on SPI_BUS_SHARED); they run at ST7789_READ_BAUD.
+// RDDID: the 24-bit display ID, 0 or 0xFFFFFF when nothing answers.
+uint32_t st7789_panel_read_id(st7789_t *panel);
+// RAMRD of a window into out (w * h pixels), RGB565 in the byte order
+// st7789_panel_send_pixels() takes, so the two round-trip. Returns false
+// if the panel can't be read.
+bool st7789_panel_read_rect(st7789_t *panel, uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end,
+                            uint16_t *out);
+
+// The functions below work on st7789_default_panel, set up by st7789_init()
+// with ST7789_CONFIG_DEFAULT
+extern st7789_t st7789_default_panel;
 
 void st7789_init();
 void st7789_write_cmd(uint8_t cmd);
@@ -72,7 +186,26 @@ void st7789_write_data(const uint8_t *data, size_t len);
 void st7789_write_data_byte(uint8_t data);
 void st7789_set_window(uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end);
 void st7789_fill_color(uint16_t color, uint32_t len); // For testing
-void st7789_set_backlight(uint8_t brightness_percent); // 0-100
+void st7789_set_backlight(uint8_t brightness_percent); // 0-100, stops a running fade
+void st7789_fade_backlight(uint8_t brightness_percent, uint32_t duration_ms); // Returns at once, IRQ safe
+uint8_t st7789_get_backlight(void); // Level set or faded to
+
+// Panel sleep: DISPOFF + SLPIN, the frame memory is kept. Both wait only as
+// long as the datasheet requires since the previous SLPIN/SLPOUT
+// (120 ms SLPIN -> SLPOUT and SLPOUT -> SLPIN, 5 ms SLPOUT -> commands).
+// The backlight is left to the caller.
+void st7789_sleep(void);
+void st7789_wake(void);
+bool st7789_is_sleeping(void);
 void st7789_send_pixels(const uint16_t* pixels, size_t len);
+void st7789_send_pixels_rect(const uint16_t *pixels, size_t w, size_t h, size_t stride); // Rows of a larger buffer, one RAMWR
+void st7789_set_frame_rate(uint8_t hz); // Normal mode frame rate (FRCTRL2), 39-119 Hz, default 60
+uint32_t st7789_get_baud(void);
+uint32_t st7789_read_id(void);
+bool st7789_read_rect(uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end, uint16_t *out);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif // ST7789_DRIVER_H
@@ -0,0 +1,302 @@
+#ifndef ST7789_HPP
+#define ST7789_HPP
+
+// Header-only C++17 ST7789 driver for firmware whose panel is fixed at build
+// time: St7789<Bus, Width, Height, Rotation> resolves the wiring, the
+// transport, the rotation (MADCTL and the window offsets) and the init
+// sequence at compile time, so a flush is the same few SPI calls as the C
+// driver with ST7789_SINGLE_PANEL and nothing is looked up at run time.
+//
+//     using namespace st7789_cxx;
+//     using Panel = St7789<SpiDma<DefaultWiring>, 240, 240, Rotation::R90>;
+//     Panel::init();
+//     Panel::set_window(x1, y1, x2, y2);
+//     Panel::send_pixels_async(px, n, done, ctx);
+//
+// Width x Height is the glass in its native (portrait) orientation,
+// Panel::width x Panel::height the area drawn after rotation. Pixels are
+// RGB565 (COLMOD 0x55) in the byte order the panel takes, as with
+// st7789_send_pixels(). Sleep, reads and the PWM backlight stay with the C
+// driver (st7789.h); here the backlight pin is only switched on. C code uses
+// the default panel through st7789_cxx.h.
+
+#include "st7789.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "pico/time.h"
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace st7789_cxx {
+
+// Clockwise quarter turns of the image on the glass
+enum class Rotation : uint8_t { R0, R90, R180, R270 };
+
+// Wiring: the SPI instance, pins and rate as constants. This one is the
+// wiring of ST7789_CONFIG_DEFAULT.
+struct DefaultWiring {
+    static spi_inst_t *spi() { return SPI_PORT; }
+    static constexpr uint pin_sck = PIN_SPI_SCK;
+    static constexpr uint pin_mosi = PIN_SPI_MOSI;
+    static constexpr uint pin_dc = PIN_DC;
+    static constexpr uint pin_cs = PIN_CS;
+    static constexpr uint pin_rst = PIN_RST;  // ST7789_NO_PIN: SWRESET only
+    static constexpr uint pin_blk = PIN_BLK;  // ST7789_NO_PIN: not wired
+    static constexpr uint32_t baud = (uint32_t)SPI_BAUD_RATE;
+};
+
+// Bus policies: how bytes get to the panel. Each has init() (returns the
+// SPI rate it got), command(), data(), pixels(), pixels_rect(),
+// pixels_async() (calls cb once the pixels are out) and wait().
+
+// Blocking SPI writes, the transport of st7789_send_pixels()
+template <typename W>
+struct SpiBlocking {
+    using Wiring = W;
+
+    static uint32_t init() {
+        gpio_init(W::pin_cs);
+        gpio_set_dir(W::pin_cs, GPIO_OUT);
+        gpio_put(W::pin_cs, 1); // Deselect
+        gpio_init(W::pin_dc);
+        gpio_set_dir(W::pin_dc, GPIO_OUT);
+        uint32_t baud = spi_init(W::spi(), W::baud);
+        gpio_set_function(W::pin_sck, GPIO_FUNC_SPI);
+        gpio_set_function(W::pin_mosi, GPIO_FUNC_SPI);
+        return baud;
+    }
+
+    static void command(uint8_t cmd) {
+        gpio_put(W::pin_dc, 0);
+        gpio_put(W::pin_cs, 0);
+        spi_write_blocking(W::spi(), &cmd, 1);
+        gpio_put(W::pin_cs, 1);
+    }
+
+    static void data(const uint8_t *data, size_t len) {
+        gpio_put(W::pin_dc, 1);
+        gpio_put(W::pin_cs, 0);
+        spi_write_blocking(W::spi(), data, len);
+        gpio_put(W::pin_cs, 1);
+    }
+
+    static void pixels(const uint16_t *pixels, size_t len) {
+        gpio_put(W::pin_cs, 0);
+        gpio_put(W::pin_dc, 1);
+        spi_write_blocking(W::spi(), (const uint8_t *)pixels, len * 2);
+        gpio_put(W::pin_cs, 1);
+    }
+
+    // CS stays low so the rows continue the same memory write
+    static void pixels_rect(const uint16_t *pixels, size_t w, size_t h, size_t stride) {
+        gpio_put(W::pin_cs, 0);
+        gpio_put(W::pin_dc, 1);
+        for (size_t y = 0; y < h; y++) {
+            spi_write_blocking(W::spi(), (const uint8_t *)(pixels + y * stride), w * 2);
+        }
+        gpio_put(W::pin_cs, 1);
+    }
+
+    static void pixels_async(const uint16_t *pixels, size_t len, void (*cb)(void *), void *ctx) {
+        SpiBlocking::pixels(pixels, len);
+        if (cb) cb(ctx);
+    }
+
+    static void wait() {}
+};
+
+// Pixels by DMA on a channel of its own, finished from the shared DMA_IRQ_1
+// handler like st7789_panel_send_pixels_async(); commands wait for it.
+// Only one panel per wiring.
+template <typename W>
+struct SpiDma {
+    using Wiring = W;
+    using Base = SpiBlocking<W>;
+
+    static inline int chan = -1;
+    static inline volatile bool busy;
+    static inline void (*done_cb)(void *);
+    static inline void *done_ctx;
+
+    static uint32_t init() {
+        uint32_t baud = Base::init();
+        if (chan < 0) {
+            chan = dma_claim_unused_channel(true);
+            dma_channel_config c = dma_channel_get_default_config(chan);
+            channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+            channel_config_set_read_increment(&c, true);
+            channel_config_set_write_increment(&c, false);
+            channel_config_set_dreq(&c, spi_get_dreq(W::spi(), true));
+            dma_channel_configure(chan, &c, &spi_get_hw(W::spi())->dr, NULL, 0, false);
+            irq_add_shared_handler(DMA_IRQ_1, irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+            irq_set_enabled(DMA_IRQ_1, true);
+            dma_channel_set_irq1_enabled(chan, true);
+        }
+        return baud;
+    }
+
+    static void wait() {
+        while (busy) {
+            tight_loop_contents();
+        }
+    }
+
+    static void command(uint8_t cmd) {
+        wait();
+        Base::command(cmd);
+    }
+
+    static void data(const uint8_t *data, size_t len) {
+        wait();
+        Base::data(data, len);
+    }
+
+    static void pixels(const uint16_t *pixels, size_t len) {
+        pixels_async(pixels, len, nullptr, nullptr);
+        wait();
+    }
+
+    static void pixels_rect(const uint16_t *pixels, size_t w, size_t h, size_t stride) {
+        wait();
+        Base::pixels_rect(pixels, w, h, stride);
+    }
+
+    static void pixels_async(const uint16_t *pixels, size_t len, void (*cb)(void *), void *ctx) {
+        wait();
+        done_cb = cb;
+        done_ctx = ctx;
+        busy = true;
+        gpio_put(W::pin_cs, 0);
+        gpio_put(W::pin_dc, 1);
+        dma_channel_transfer_from_buffer_now(chan, pixels, len * 2);
+    }
+
+    static void irq() {
+        if (!(dma_hw->ints1 & (1u << chan))) return;
+        dma_hw->ints1 = 1u << chan;
+
+        // The last bytes are still in the FIFO when the DMA is done, and the
+        // TX-only DMA leaves the RX FIFO full and overrun
+        spi_inst_t *spi = W::spi();
+        while (spi_is_busy(spi)) {
+            tight_loop_contents();
+        }
+        while (spi_is_readable(spi)) {
+            (void)spi_get_hw(spi)->dr;
+        }
+        spi_get_hw(spi)->icr = SPI_SSPICR_RORIC_BITS;
+        gpio_put(W::pin_cs, 1);
+
+        busy = false;
+        if (done_cb) done_cb(done_ctx);
+    }
+};
+
+// ColOffset/RowOffset: the glass in the controller's 240 x 320 memory, in
+// native orientation (e.g. 52, 40 for 135 x 240 modules). Bgr: panels with
+// red and blue swapped.
+template <typename Bus, uint16_t Width, uint16_t Height, Rotation Rot = Rotation::R0, uint16_t ColOffset = 0,
+          uint16_t RowOffset = 0, bool Bgr = false>
+class St7789 {
+public:
+    static_assert(ColOffset + Width <= 240 && RowOffset + Height <= 320, "glass outside the controller memory");
+
+    static constexpr bool swapped = Rot == Rotation::R90 || Rot == Rotation::R270;
+    static constexpr uint16_t width = swapped ? Height : Width;
+    static constexpr uint16_t height = swapped ? Width : Height;
+
+    // MY | MX | MV per rotation, as in the MADCTL notes of st7789.c
+    static constexpr uint8_t madctl = (Rot == Rotation::R0 ? 0x00 : Rot == Rotation::R90 ? 0x60
+                                       : Rot == Rotation::R180 ? 0xC0 : 0xA0) | (Bgr ? 0x08 : 0x00);
+    static constexpr uint8_t colmod = 0x55; // RGB565
+
+    // Window addresses for (0, 0): mirroring moves the glass to the other
+    // end of the memory, MV swaps columns and rows
+    static constexpr uint16_t x_offset = Rot == Rotation::R0 ? ColOffset
+                                       : Rot == Rotation::R90 ? RowOffset
+                                       : Rot == Rotation::R180 ? 240 - ColOffset - Width
+                                       : 320 - RowOffset - Height;
+    static constexpr uint16_t y_offset = Rot == Rotation::R0 ? RowOffset
+                                       : Rot == Rotation::R90 ? 240 - ColOffset - Width
+                                       : Rot == Rotation::R180 ? 320 - RowOffset - Height
+                                       : ColOffset;
+
+    // Init sequence as in st7789.c: command, parameter count, parameters;
+    // delay_flag in the count adds a delay in ms after the parameters
+    static constexpr uint8_t delay_flag = 0x80;
+    static constexpr std::array<uint8_t, 19> init_table = {
+        ST7789_SWRESET, delay_flag, 150,    // Software reset
+        ST7789_SLPOUT, delay_flag, 255,     // Sleep out, some displays need more than 5 ms
+        ST7789_MADCTL, 1, madctl,
+        ST7789_COLMOD, 1 | delay_flag, colmod, 10,
+        ST7789_NORON, delay_flag, 10,       // Normal display mode on
+        ST7789_DISPON, delay_flag, 100,     // Display on
+    };
+
+    static void init() {
+        if constexpr (Bus::Wiring::pin_rst != ST7789_NO_PIN) {
+            gpio_init(Bus::Wiring::pin_rst);
+            gpio_set_dir(Bus::Wiring::pin_rst, GPIO_OUT);
+        }
+        if constexpr (Bus::Wiring::pin_blk != ST7789_NO_PIN) {
+            gpio_init(Bus::Wiring::pin_blk);
+            gpio_set_dir(Bus::Wiring::pin_blk, GPIO_OUT);
+            gpio_put(Bus::Wiring::pin_blk, 0); // Off until the panel is on
+        }
+        baud_ = Bus::init();
+        if constexpr (Bus::Wiring::pin_rst != ST7789_NO_PIN) {
+            gpio_put(Bus::Wiring::pin_rst, 0);
+            sleep_ms(10);
+            gpio_put(Bus::Wiring::pin_rst, 1);
+            sleep_ms(120); // Wait for display to recover
+        }
+
+        for (size_t i = 0; i < init_table.size();) {
+            uint8_t cmd = init_table[i++];
+            uint8_t n = init_table[i] & ~delay_flag;
+            bool delay = (init_table[i++] & delay_flag) != 0;
+            Bus::command(cmd);
+            if (n) Bus::data(&init_table[i], n);
+            i += n;
+            if (delay) sleep_ms(init_table[i++]);
+        }
+
+        if constexpr (Bus::Wiring::pin_blk != ST7789_NO_PIN) gpio_put(Bus::Wiring::pin_blk, 1);
+    }
+
+    // CASET + RASET + RAMWR, in the rotated coordinates
+    static void set_window(uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end) {
+        x_start += x_offset;
+        x_end += x_offset;
+        y_start += y_offset;
+        y_end += y_offset;
+
+        Bus::command(ST7789_CASET);
+        const uint8_t caset[] = {(uint8_t)(x_start >> 8), (uint8_t)x_start, (uint8_t)(x_end >> 8), (uint8_t)x_end};
+        Bus::data(caset, sizeof(caset));
+        Bus::command(ST7789_RASET);
+        const uint8_t raset[] = {(uint8_t)(y_start >> 8), (uint8_t)y_start, (uint8_t)(y_end >> 8), (uint8_t)y_end};
+        Bus::data(raset, sizeof(raset));
+        Bus::command(ST7789_RAMWR);
+    }
+
+    static void send_pixels(const uint16_t *pixels, size_t len) { Bus::pixels(pixels, len); }
+    static void send_pixels_rect(const uint16_t *pixels, size_t w, size_t h, size_t stride) {
+        Bus::pixels_rect(pixels, w, h, stride);
+    }
+    // With SpiDma returns once the DMA is started; cb runs from its IRQ
+    static void send_pixels_async(const uint16_t *pixels, size_t len, void (*cb)(void *), void *ctx) {
+        Bus::pixels_async(pixels, len, cb, ctx);
+    }
+    static void wait() { Bus::wait(); }
+    static uint32_t baud() { return baud_; }
+
+private:
+    static inline uint32_t baud_;
+};
+
+} // namespace st7789_cxx
+
+#endif // ST7789_HPP
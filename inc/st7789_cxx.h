@@ -0,0 +1,51 @@
+#ifndef ST7789_CXX_H
+#define ST7789_CXX_H
+
+#include "st7789.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Set to 1 to drive the panel of ST7789_CONFIG_DEFAULT's wiring with the
+// compile-time C++ driver (st7789.hpp) through the C functions below,
+// instantiated in st7789_cxx.cpp; lv_port_disp then flushes through them.
+// The ports that need the C driver's sleep, reads, backlight or frame rate
+// control can't be used with it.
+#ifndef ST7789_CXX
+#define ST7789_CXX 0
+#endif
+
+// Transport: 0 blocking SPI, 1 DMA (sends return once started)
+#ifndef ST7789_CXX_BUS
+#define ST7789_CXX_BUS 0
+#endif
+
+// Clockwise quarter turns (0-3) of the ST7789_WIDTH x ST7789_HEIGHT glass
+#ifndef ST7789_CXX_ROTATION
+#define ST7789_CXX_ROTATION 0
+#endif
+
+// The drawn area after rotation
+#define ST7789_CXX_HOR_RES ((ST7789_CXX_ROTATION & 1) ? ST7789_HEIGHT : ST7789_WIDTH)
+#define ST7789_CXX_VER_RES ((ST7789_CXX_ROTATION & 1) ? ST7789_WIDTH : ST7789_HEIGHT)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*st7789_cxx_done_cb_t)(void *ctx);
+
+void st7789_cxx_init(void);
+void st7789_cxx_set_window(uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end);
+void st7789_cxx_send_pixels(const uint16_t *pixels, size_t len);
+void st7789_cxx_send_pixels_rect(const uint16_t *pixels, size_t w, size_t h, size_t stride);
+// cb runs once the pixels are out: at once on the blocking bus, from the
+// DMA IRQ on the DMA bus. The next command waits for it.
+void st7789_cxx_send_pixels_async(const uint16_t *pixels, size_t len, st7789_cxx_done_cb_t cb, void *ctx);
+void st7789_cxx_wait(void);
+uint32_t st7789_cxx_get_baud(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ST7789_CXX_H
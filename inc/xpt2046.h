@@ -12,6 +12,9 @@
 #define PIN_XPT_MISO 12
 #define PIN_XPT_CS  13
 #define PIN_XPT_IRQ  14  // Touch interrupt (pen down)
+// With SPI_BUS_SHARED (spi_bus.h) SCK/MOSI/MISO are the display's and the
+// XPT2046 is sampled at this rate while the pen is down
+#define XPT_SAMPLE_HZ 200
 
 // XPT2046 Control Bytes (12-bit conversion, differential reference)
 #define XPT2046_CMD_READ_X  0xD0 // Or 0xD1, 0xD2, 0xD3 for specific power/reference modes
@@ -35,5 +38,7 @@ void xpt2046_init(void);
 bool xpt2046_is_touched(void);
 bool xpt2046_get_touch_point(uint16_t *x, uint16_t *y); // Gets calibrated screen coordinates
 bool xpt2046_get_raw_touch_point(uint16_t *x, uint16_t *y, uint16_t *z); // Gets raw ADC values
+uint32_t xpt2046_pen_down_time_us(void); // time_us_32() of the last falling edge on PIN_XPT_IRQ
+void xpt2046_set_pen_down_cb(void (*cb)(void)); // Called from the GPIO IRQ on that edge, NULL to remove
 
 #endif // XPT2046_DRIVER_H
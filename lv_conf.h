@@ -38,7 +38,7 @@
 
 /* Adjust color mix functions rounding. GPUs might calculate color mix (blending) differently.
  * 0: round down, 64: round up from x.75, 128: round up from half, 192: round up from x.25, 254: round up */
-#define LV_COLOR_MIX_ROUND_OFS 0
+#define LV_COLOR_MIX_ROUND_OFS 0   /*lv_port_blend.c (LV_PORT_FAST_BLEND) relies on 0*/
 
 /*Images pixels with this color will not be drawn if they are chroma keyed)*/
 #define LV_COLOR_CHROMA_KEY lv_color_hex(0x00ff00)         /*pure green*/
@@ -47,8 +47,11 @@
    MEMORY SETTINGS
  *=========================*/
 
-/*1: use custom malloc/free, 0: use the built-in `lv_mem_alloc()` and `lv_mem_free()`*/
-#define LV_MEM_CUSTOM 0
+/*1: use custom malloc/free, 0: use the built-in `lv_mem_alloc()` and `lv_mem_free()`
+ *(sim/mem_soak.c builds LVGL's heap with -DLV_MEM_CUSTOM=0 to compare the two)*/
+#ifndef LV_MEM_CUSTOM
+#define LV_MEM_CUSTOM 1
+#endif
 #if LV_MEM_CUSTOM == 0
     /*Size of the memory available for `lv_mem_alloc()` in bytes (>= 2kB)*/
     #define LV_MEM_SIZE (48U * 1024U)          /*[bytes]*/
@@ -62,18 +65,21 @@
     #endif
 
 #else       /*LV_MEM_CUSTOM*/
-    #define LV_MEM_CUSTOM_INCLUDE <stdlib.h>   /*Header for the dynamic memory function*/
-    #define LV_MEM_CUSTOM_ALLOC   malloc
-    #define LV_MEM_CUSTOM_FREE    free
-    #define LV_MEM_CUSTOM_REALLOC realloc
+    /*TLSF + size-class heap of the port (src/lv_port_mem.c). The pool size is LV_PORT_MEM_SIZE, 48 kB by default.
+     *Use lv_port_mem_get_stats() instead of lv_mem_monitor()*/
+    #define LV_MEM_CUSTOM_INCLUDE "lv_port_mem.h"   /*Header for the dynamic memory function*/
+    #define LV_MEM_CUSTOM_ALLOC   lv_port_mem_alloc
+    #define LV_MEM_CUSTOM_FREE    lv_port_mem_free
+    #define LV_MEM_CUSTOM_REALLOC lv_port_mem_realloc
 #endif     /*LV_MEM_CUSTOM*/
 
 /*Number of the intermediate memory buffer used during rendering and other internal processing mechanisms.
  *You will see an error log message if there wasn't enough buffers. */
 #define LV_MEM_BUF_MAX_NUM 16
 
-/*Use the standard `memcpy` and `memset` instead of LVGL's own functions. (Might or might not be faster).*/
-#define LV_MEMCPY_MEMSET_STD 0
+/*Use the standard `memcpy` and `memset` instead of LVGL's own functions. (Might or might not be faster).
+ *On the RP2040 pico-sdk routes them to the boot ROM's word-wide routines*/
+#define LV_MEMCPY_MEMSET_STD 1
 
 /*====================
    HAL SETTINGS
@@ -87,10 +93,11 @@
 
 /*Use a custom tick source that tells the elapsed time in milliseconds.
  *It removes the need to manually update the tick with `lv_tick_inc()`)*/
-#define LV_TICK_CUSTOM 0
+#define LV_TICK_CUSTOM 1
 #if LV_TICK_CUSTOM
-    #define LV_TICK_CUSTOM_INCLUDE "Arduino.h"         /*Header for the system time function*/
-    #define LV_TICK_CUSTOM_SYS_TIME_EXPR (millis())    /*Expression evaluating to current system time in ms*/
+    /*The RP2040 64-bit microsecond timer, no repeating timer calling lv_tick_inc() needed*/
+    #define LV_TICK_CUSTOM_INCLUDE "pico/time.h"       /*Header for the system time function*/
+    #define LV_TICK_CUSTOM_SYS_TIME_EXPR ((uint32_t)(time_us_64() / 1000))    /*Expression evaluating to current system time in ms*/
     /*If using lvgl as ESP32 component*/
     // #define LV_TICK_CUSTOM_INCLUDE "esp_timer.h"
     // #define LV_TICK_CUSTOM_SYS_TIME_EXPR ((esp_timer_get_time() / 1000LL))
@@ -344,7 +351,9 @@
 /*Compiler prefix for a big array declaration in RAM*/
 #define LV_ATTRIBUTE_LARGE_RAM_ARRAY
 
-/*Place performance critical functions into a faster memory (e.g RAM)*/
+/*Place performance critical functions into a faster memory (e.g RAM)
+ *Left empty on purpose: with LV_PORT_FAST_MEM the LVGL functions that a profile shows to be hot are moved to SRAM
+ *by renaming their sections (tools/hot_funcs.py), which costs less SRAM than moving every LV_ATTRIBUTE_FAST_MEM function*/
 #define LV_ATTRIBUTE_FAST_MEM
 
 /*Prefix variables that are used in GPU accelerated operations, often these need to be placed in RAM sections that are DMA accessible*/
@@ -642,7 +651,7 @@
 #endif
 
 /*API for LittleFS (library needs to be added separately). Uses lfs_file_open, lfs_file_read, etc*/
-#define LV_USE_FS_LITTLEFS 0
+#define LV_USE_FS_LITTLEFS 0   /*LV_PORT_FS (lv_port_fs.h) registers its own LittleFS drive*/
 #if LV_USE_FS_LITTLEFS
     #define LV_FS_LITTLEFS_LETTER '\0'     /*Set an upper cased letter on which the drive will accessible (e.g. 'A')*/
     #define LV_FS_LITTLEFS_CACHE_SIZE 0    /*>0 to cache this number of bytes in lv_fs_read()*/
@@ -0,0 +1,675 @@
+// Reference-screen benchmark of the display stack on the host simulator.
+// Runs a fixed set of LVGL screens in virtual time and reports per frame:
+// render time (host CPU), SPI bytes and modelled bus time, invalidated area,
+// and the LVGL heap peak per screen. With --json the results go to a file
+// that tools/bench_gate.py compares against a baseline.
+//
+//     lvgl_bench [--ms 3000] [--json bench.json] [--png-dir DIR] [screen...]
+//     lvgl_bench --bands 8,16,32,64 [--buffers 1|2] [--ms 1000] [screen...]
+//     lvgl_bench --mem-trace mem_trace.txt [--ms 1000] [screen...]
+//
+// --bands sweeps the draw band height: the screens run once per height,
+// with the port's draw buffers split into bands of that many rows, and a
+// table of render and bus time per frame against band height and buffer
+// RAM is printed. Heights up to the DISP_BUF_LINES the port is built with
+// (make -C sim bench-bands builds it with 160).
+//
+// Everything but the render time is reproducible: the same tree gives the
+// same bytes, bus time and area on every machine.
+//
+// Built with -DLV_PORT_OVERDRAW=1 it also prints the overdraw summary and
+// the widgets painting over others per screen, and with --png-dir writes
+// the overdraw, invalidation and flush heatmaps next to the screenshots.
+//
+// --mem-trace writes every LVGL heap call of the run, from lv_init() on, to
+// a trace that sim/mem_soak.c replays (make -C sim mem-trace records
+// sim/mem_trace.txt). Blocks are numbered, a number is reused once freed.
+//
+// The fade and rotate screens draw through layers: build once with and
+// once without -DLV_PORT_DIRECT_LAYER=1 and compare render_us and
+// mem_peak. With it, the layer counts are printed per screen.
+
+#include "lvgl.h"
+#include "lv_port_disp.h"
+#include "lv_port_indev.h"
+#include "lv_port_layer.h"
+#include "lv_port_mem.h"
+#include "lv_port_overdraw.h"
+#include "st7789.h"
+#include "spi_bus.h"
+#include "port_log.h"
+#include "sim_png.h"
+#include "st7789_model.h"
+#include "xpt2046_model.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_WARMUP_MS 300  // First full draw of a screen, not measured
+#define BENCH_RUN_MS    3000 // Default measured time per screen
+
+typedef struct {
+    const char *name;
+    void (*create)(lv_obj_t *scr);
+} bench_screen_t;
+
+typedef struct {
+    uint32_t frames;
+    uint64_t area_px;
+    uint64_t render_ns; // Host CPU time in lv_timer_handler
+    uint64_t spi_bytes;
+    uint64_t bus_ns;
+    uint32_t mem_peak;
+    uint32_t flushes;
+} bench_result_t;
+
+static st7789_model_t panel;
+static xpt2046_model_t touch;
+static bench_result_t cur;
+static void (*monitor_orig)(lv_disp_drv_t *drv, uint32_t time, uint32_t px);
+static void (*flush_orig)(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p);
+
+// --- reference screens --------------------------------------------------------
+
+// Flat dashboard: static tiles, one value and a bar updated twice a second
+static lv_obj_t *dash_value;
+static lv_obj_t *dash_bar;
+
+static void dash_timer_cb(lv_timer_t *t) {
+    uint32_t n = (uint32_t)(uintptr_t)t->user_data;
+    t->user_data = (void *)(uintptr_t)(n + 1);
+    lv_label_set_text_fmt(dash_value, "%lu.%lu V", (unsigned long)(11 + n % 3), (unsigned long)(n * 7 % 10));
+    lv_bar_set_value(dash_bar, (int32_t)(n * 13 % 100), LV_ANIM_OFF);
+}
+
+static void screen_dashboard(lv_obj_t *scr) {
+    static const char *titles[] = {"Voltage", "Current", "Temp", "Speed"};
+    for (uint32_t i = 0; i < 4; i++) {
+        lv_obj_t *tile = lv_obj_create(scr);
+        lv_obj_set_size(tile, 110, 70);
+        lv_obj_set_pos(tile, 5 + (i % 2) * 120, 5 + (i / 2) * 80);
+        lv_obj_clear_flag(tile, LV_OBJ_FLAG_SCROLLABLE);
+        lv_obj_t *title = lv_label_create(tile);
+        lv_label_set_text(title, titles[i]);
+        lv_obj_align(title, LV_ALIGN_TOP_LEFT, 0, 0);
+        lv_obj_t *value = lv_label_create(tile);
+        lv_label_set_text(value, i == 0 ? "12.0 V" : "--");
+        lv_obj_align(value, LV_ALIGN_BOTTOM_RIGHT, 0, 0);
+        if (i == 0) dash_value = value;
+    }
+    dash_bar = lv_bar_create(scr);
+    lv_obj_set_size(dash_bar, 220, 16);
+    lv_obj_set_pos(dash_bar, 10, 175);
+    lv_obj_t *arc = lv_arc_create(scr);
+    lv_obj_set_size(arc, 110, 110);
+    lv_obj_align(arc, LV_ALIGN_BOTTOM_MID, 0, -10);
+    lv_arc_set_value(arc, 70);
+    lv_timer_create(dash_timer_cb, 500, NULL);
+}
+
+// Scrolling list: 40 entries scrolled 4 px per 16 ms, back and forth
+static lv_obj_t *list;
+static int32_t list_step = -4;
+
+static void list_timer_cb(lv_timer_t *t) {
+    (void)t;
+    if (list_step < 0 && lv_obj_get_scroll_bottom(list) <= 0) list_step = 4;
+    if (list_step > 0 && lv_obj_get_scroll_top(list) <= 0) list_step = -4;
+    lv_obj_scroll_by(list, 0, list_step, LV_ANIM_OFF);
+}
+
+static void screen_list(lv_obj_t *scr) {
+    list = lv_list_create(scr);
+    lv_obj_set_size(list, LV_PCT(100), LV_PCT(100));
+    for (uint32_t i = 0; i < 40; i++) {
+        char text[16];
+        lv_snprintf(text, sizeof(text), "Item %lu", (unsigned long)i);
+        lv_list_add_btn(list, LV_SYMBOL_FILE, text);
+    }
+    list_step = -4;
+    lv_timer_create(list_timer_cb, 16, NULL);
+}
+
+// Chart with streaming data: two line series, a point each per 50 ms
+static lv_obj_t *chart;
+static lv_chart_series_t *chart_ser[2];
+
+static void chart_timer_cb(lv_timer_t *t) {
+    uint32_t n = (uint32_t)(uintptr_t)t->user_data;
+    t->user_data = (void *)(uintptr_t)(n + 1);
+    lv_chart_set_next_value(chart, chart_ser[0], 50 + lv_trigo_sin((int16_t)(n * 9 % 360)) * 40 / LV_TRIGO_SIN_MAX);
+    lv_chart_set_next_value(chart, chart_ser[1], 50 + lv_trigo_sin((int16_t)(n * 23 % 360)) * 25 / LV_TRIGO_SIN_MAX);
+}
+
+static void screen_chart(lv_obj_t *scr) {
+    chart = lv_chart_create(scr);
+    lv_obj_set_size(chart, 220, 200);
+    lv_obj_center(chart);
+    lv_chart_set_type(chart, LV_CHART_TYPE_LINE);
+    lv_chart_set_point_count(chart, 100);
+    lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0, 100);
+    lv_obj_set_style_size(chart, 0, LV_PART_INDICATOR); // No point markers
+    chart_ser[0] = lv_chart_add_series(chart, lv_palette_main(LV_PALETTE_RED), LV_CHART_AXIS_PRIMARY_Y);
+    chart_ser[1] = lv_chart_add_series(chart, lv_palette_main(LV_PALETTE_BLUE), LV_CHART_AXIS_PRIMARY_Y);
+    lv_timer_create(chart_timer_cb, 50, NULL);
+}
+
+// Large-font numeric readout, counting up every 100 ms. Montserrat 48 if
+// it's enabled in lv_conf.h, else the default font zoomed 3x (which draws
+// through a transformed layer and so costs more render time)
+static lv_obj_t *readout;
+
+static void readout_timer_cb(lv_timer_t *t) {
+    uint32_t n = (uint32_t)(uintptr_t)t->user_data;
+    t->user_data = (void *)(uintptr_t)(n + 1);
+    lv_label_set_text_fmt(readout, "%04lu.%lu", (unsigned long)(n / 10 % 10000), (unsigned long)(n % 10));
+}
+
+static void screen_readout(lv_obj_t *scr) {
+    readout = lv_label_create(scr);
+#if LV_FONT_MONTSERRAT_48
+    lv_obj_set_style_text_font(readout, &lv_font_montserrat_48, 0);
+#else
+    lv_obj_set_style_transform_zoom(readout, 3 * LV_IMG_ZOOM_NONE, 0);
+#endif
+    lv_label_set_text(readout, "0000.0");
+    lv_obj_center(readout);
+    lv_timer_create(readout_timer_cb, 100, NULL);
+}
+
+// Full-screen animation: background colour cycling plus a moving box, so
+// every frame redraws the whole panel
+static void anim_bg_cb(void *obj, int32_t v) {
+    lv_obj_set_style_bg_color(obj, lv_color_mix(lv_palette_main(LV_PALETTE_BLUE), lv_palette_main(LV_PALETTE_ORANGE),
+                                                (uint8_t)v), 0);
+}
+
+static void anim_y_cb(void *obj, int32_t v) {
+    lv_obj_set_y(obj, (lv_coord_t)v);
+}
+
+static void screen_anim(lv_obj_t *scr) {
+    lv_anim_t a;
+    lv_anim_init(&a);
+    lv_anim_set_var(&a, scr);
+    lv_anim_set_exec_cb(&a, anim_bg_cb);
+    lv_anim_set_values(&a, 0, 255);
+    lv_anim_set_time(&a, 1000);
+    lv_anim_set_playback_time(&a, 1000);
+    lv_anim_set_repeat_count(&a, LV_ANIM_REPEAT_INFINITE);
+    lv_anim_start(&a);
+
+    lv_obj_t *box = lv_obj_create(scr);
+    lv_obj_set_size(box, 80, 80);
+    lv_obj_set_x(box, 80);
+    lv_anim_set_var(&a, box);
+    lv_anim_set_exec_cb(&a, anim_y_cb);
+    lv_anim_set_values(&a, 0, LV_VER_RES_MAX - 80);
+    lv_anim_set_time(&a, 700);
+    lv_anim_set_playback_time(&a, 700);
+    lv_anim_start(&a);
+}
+
+// A settings panel fading in and out over the dashboard-like background:
+// the panel and its children draw through an opacity layer every frame
+static void anim_opa_cb(void *obj, int32_t v) {
+    lv_obj_set_style_opa_layered(obj, (lv_opa_t)v, 0);
+}
+
+static lv_obj_t *panel_with_widgets(lv_obj_t *scr) {
+    lv_obj_t *p = lv_obj_create(scr);
+    lv_obj_set_size(p, 220, 220);
+    lv_obj_center(p);
+    lv_obj_clear_flag(p, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_t *title = lv_label_create(p);
+    lv_label_set_text(title, "Settings");
+    lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 0);
+    lv_obj_t *slider = lv_slider_create(p);
+    lv_obj_set_width(slider, 170);
+    lv_obj_align(slider, LV_ALIGN_TOP_MID, 0, 40);
+    lv_slider_set_value(slider, 60, LV_ANIM_OFF);
+    lv_obj_t *sw = lv_switch_create(p);
+    lv_obj_align(sw, LV_ALIGN_TOP_LEFT, 10, 80);
+    lv_obj_add_state(sw, LV_STATE_CHECKED);
+    lv_obj_t *btn = lv_btn_create(p);
+    lv_obj_set_size(btn, 170, 40);
+    lv_obj_align(btn, LV_ALIGN_BOTTOM_MID, 0, -10);
+    lv_obj_t *label = lv_label_create(btn);
+    lv_label_set_text(label, "Apply");
+    lv_obj_center(label);
+    return p;
+}
+
+static void screen_fade(lv_obj_t *scr) {
+    lv_obj_set_style_bg_color(scr, lv_palette_lighten(LV_PALETTE_BLUE_GREY, 3), 0);
+    for (uint32_t i = 0; i < 6; i++) {
+        lv_obj_t *l = lv_label_create(scr);
+        lv_label_set_text_fmt(l, "Background line %lu", (unsigned long)i);
+        lv_obj_set_pos(l, 10, 10 + (lv_coord_t)i * 50);
+    }
+    lv_obj_t *p = panel_with_widgets(scr);
+    lv_anim_t a;
+    lv_anim_init(&a);
+    lv_anim_set_var(&a, p);
+    lv_anim_set_exec_cb(&a, anim_opa_cb);
+    lv_anim_set_values(&a, LV_OPA_10, LV_OPA_90);
+    lv_anim_set_time(&a, 800);
+    lv_anim_set_playback_time(&a, 800);
+    lv_anim_set_repeat_count(&a, LV_ANIM_REPEAT_INFINITE);
+    lv_anim_start(&a);
+}
+
+// The same panel swinging +-10 degrees: a transformed layer, which needs
+// the whole panel in one buffer either way
+static void anim_angle_cb(void *obj, int32_t v) {
+    lv_obj_set_style_transform_angle(obj, (lv_coord_t)v, 0);
+}
+
+static void screen_rotate(lv_obj_t *scr) {
+    lv_obj_t *p = panel_with_widgets(scr);
+    lv_obj_set_size(p, 160, 160);
+    lv_obj_set_style_transform_pivot_x(p, 80, 0);
+    lv_obj_set_style_transform_pivot_y(p, 80, 0);
+    lv_anim_t a;
+    lv_anim_init(&a);
+    lv_anim_set_var(&a, p);
+    lv_anim_set_exec_cb(&a, anim_angle_cb);
+    lv_anim_set_values(&a, -100, 100);
+    lv_anim_set_time(&a, 1000);
+    lv_anim_set_playback_time(&a, 1000);
+    lv_anim_set_repeat_count(&a, LV_ANIM_REPEAT_INFINITE);
+    lv_anim_start(&a);
+}
+
+static const bench_screen_t screens[] = {
+    {"dashboard", screen_dashboard},
+    {"list", screen_list},
+    {"chart", screen_chart},
+    {"readout", screen_readout},
+    {"anim", screen_anim},
+    {"fade", screen_fade},
+    {"rotate", screen_rotate},
+};
+#define SCREEN_COUNT (sizeof(screens) / sizeof(screens[0]))
+
+// --- heap trace ----------------------------------------------------------------
+
+#if LV_MEM_CUSTOM
+#define TRACE_SLOTS 8192 // Live blocks, a power of two
+
+static FILE *trace_file;
+static const void *trace_ptr[TRACE_SLOTS]; // Open addressing on the pointer
+static uint32_t trace_id[TRACE_SLOTS];
+static uint32_t trace_free_ids[TRACE_SLOTS];
+static uint32_t trace_free_count, trace_next_id;
+
+static uint32_t trace_slot(const void *ptr) {
+    uint32_t i = (uint32_t)(((uintptr_t)ptr >> 3) * 2654435761u) & (TRACE_SLOTS - 1);
+    while (trace_ptr[i] && trace_ptr[i] != ptr) i = (i + 1) & (TRACE_SLOTS - 1);
+    return i;
+}
+
+static uint32_t trace_add(const void *ptr) {
+    uint32_t id = trace_free_count ? trace_free_ids[--trace_free_count] : trace_next_id++;
+    uint32_t i = trace_slot(ptr);
+    trace_ptr[i] = ptr;
+    trace_id[i] = id;
+    return id;
+}
+
+// Removes ptr and re-inserts the rest of its cluster so lookups still work
+static uint32_t trace_remove(const void *ptr) {
+    uint32_t i = trace_slot(ptr);
+    uint32_t id = trace_id[i];
+    trace_ptr[i] = NULL;
+    for (uint32_t j = (i + 1) & (TRACE_SLOTS - 1); trace_ptr[j]; j = (j + 1) & (TRACE_SLOTS - 1)) {
+        const void *p = trace_ptr[j];
+        uint32_t v = trace_id[j];
+        trace_ptr[j] = NULL;
+        uint32_t k = trace_slot(p);
+        trace_ptr[k] = p;
+        trace_id[k] = v;
+    }
+    return id;
+}
+
+// Failed calls are left out: LVGL halts on them
+static void trace_mem(char op, const void *old_ptr, const void *new_ptr, size_t size) {
+    if (op == 'f') {
+        uint32_t id = trace_remove(old_ptr);
+        trace_free_ids[trace_free_count++] = id;
+        fprintf(trace_file, "f %lu\n", (unsigned long)id);
+    } else if (op == 'a' || !old_ptr) {
+        if (new_ptr) fprintf(trace_file, "a %lu %lu\n", (unsigned long)trace_add(new_ptr), (unsigned long)size);
+    } else if (!new_ptr) {
+        if (size == 0) trace_mem('f', old_ptr, NULL, 0);
+    } else {
+        uint32_t id = trace_remove(old_ptr);
+        uint32_t i = trace_slot(new_ptr);
+        trace_ptr[i] = new_ptr;
+        trace_id[i] = id;
+        fprintf(trace_file, "r %lu %lu\n", (unsigned long)id, (unsigned long)size);
+    }
+}
+#endif
+
+// --- measurement -------------------------------------------------------------
+
+static void bench_monitor(lv_disp_drv_t *drv, uint32_t time, uint32_t px) {
+    cur.frames++;
+    cur.area_px += px;
+    if (monitor_orig) monitor_orig(drv, time, px);
+}
+
+static void bench_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p) {
+    cur.flushes++;
+    flush_orig(drv, area, color_p);
+}
+
+static uint64_t cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void run_ms(uint32_t ms) {
+    uint64_t end = time_us_64() + (uint64_t)ms * 1000;
+    while (time_us_64() < end) {
+        uint64_t t0 = cpu_ns();
+        uint32_t next = lv_timer_handler();
+        cur.render_ns += cpu_ns() - t0;
+        sleep_ms(next < 1 ? 1 : next > 5 ? 5 : next);
+    }
+    port_log_flush(0);
+}
+
+static uint32_t mem_peak(void) {
+#if LV_MEM_CUSTOM
+    lv_port_mem_stats_t s;
+    lv_port_mem_get_stats(&s);
+    return s.high_water_bytes;
+#else
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    return mon.max_used;
+#endif
+}
+
+static void bench_screen(const bench_screen_t *s, uint32_t run_ms_total, bench_result_t *out) {
+    lv_obj_t *old = lv_scr_act();
+    lv_obj_t *scr = lv_obj_create(NULL);
+    s->create(scr);
+    lv_scr_load(scr);
+    lv_obj_del(old); // Its update timer is already deleted, see delete_timers()
+    run_ms(BENCH_WARMUP_MS);
+
+    memset(&cur, 0, sizeof(cur));
+    sim_spi_reset_stats();
+    st7789_model_reset_stats(&panel);
+#if LV_MEM_CUSTOM
+    lv_port_mem_reset_high_water();
+#endif
+#if LV_PORT_OVERDRAW
+    lv_port_overdraw_reset();
+#endif
+#if LV_PORT_DIRECT_LAYER
+    lv_port_layer_reset_stats();
+#endif
+    run_ms(run_ms_total);
+
+    sim_spi_stats_t spi;
+    sim_spi_get_stats(spi_get_index(SPI_PORT), &spi);
+    cur.spi_bytes = spi.bytes;
+    cur.bus_ns = spi.busy_ns;
+    cur.mem_peak = mem_peak();
+    *out = cur;
+}
+
+static void delete_timers(void) {
+    // The screens' update timers refer to objects of the previous screen
+    lv_timer_t *t = lv_timer_get_next(NULL);
+    while (t) {
+        lv_timer_t *next = lv_timer_get_next(t);
+        if (t->timer_cb == dash_timer_cb || t->timer_cb == list_timer_cb || t->timer_cb == chart_timer_cb ||
+            t->timer_cb == readout_timer_cb) {
+            lv_timer_del(t);
+        }
+        t = next;
+    }
+    lv_anim_del_all();
+}
+
+// --- band sweep ----------------------------------------------------------------
+
+static void *band_buf1, *band_buf2; // The port's draw buffers
+static uint32_t band_max_px;        // and their size
+
+// Splits the port's draw buffers into bands of `lines` rows, with one or
+// two buffers. Returns false if they were built smaller.
+static bool set_band(uint32_t lines, uint32_t count) {
+    lv_disp_drv_t *drv = lv_disp_get_default()->driver;
+    lv_disp_draw_buf_t *db = drv->draw_buf;
+
+    if (!band_buf1) {
+        band_buf1 = db->buf1;
+        band_buf2 = db->buf2;
+        band_max_px = db->size;
+    }
+    uint32_t px = lines * (uint32_t)drv->hor_res;
+    if (lines == 0 || px > band_max_px || (count > 1 && !band_buf2)) return false;
+
+    while (db->flushing) sleep_ms(1); // Let the last DMA finish
+    lv_disp_draw_buf_init(db, band_buf1, count > 1 ? band_buf2 : NULL, px);
+    return true;
+}
+
+static void print_band_row(uint32_t lines, uint32_t bytes, const char *name, const bench_result_t *r, uint32_t ms) {
+    uint32_t frames = r->frames ? r->frames : 1;
+    double render_us = r->render_ns / 1000.0 / frames;
+    double bus_us = r->bus_ns / 1000.0 / frames;
+    printf("%5lu %7lu  %-10s %6lu %7.1f %9.1f %9.1f %8.1f %9.1f\n", (unsigned long)lines, (unsigned long)bytes, name,
+           (unsigned long)r->frames, r->frames * 1000.0 / ms, render_us, bus_us, (double)r->flushes / frames,
+           render_us + bus_us);
+}
+
+// Runs the selected screens at every band height in the comma-separated list
+static int band_sweep(const char *list, uint32_t count, uint32_t ms, const bool *selected, bool any) {
+    printf("%5s %7s  %-10s %6s %7s %9s %9s %8s %9s\n", "lines", "buf_B", "screen", "frames", "fps", "render_us",
+           "bus_us/fr", "flush/fr", "frame_us");
+    for (const char *p = list; *p;) {
+        char *end;
+        uint32_t lines = (uint32_t)strtoul(p, &end, 10);
+        if (end == p || !set_band(lines, count)) {
+            fprintf(stderr, "%lu lines x %lu buffers don't fit the draw buffers (%lu lines x %u)\n",
+                    (unsigned long)lines, (unsigned long)count,
+                    (unsigned long)(band_max_px / (uint32_t)lv_disp_get_hor_res(NULL)), band_buf2 ? 2 : 1);
+            return 2;
+        }
+        uint32_t bytes = lines * (uint32_t)lv_disp_get_hor_res(NULL) * (uint32_t)sizeof(lv_color_t) * count;
+        double sum_us = 0;
+        uint32_t n_run = 0;
+        for (size_t n = 0; n < SCREEN_COUNT; n++) {
+            if (any && !selected[n]) continue;
+            bench_result_t r;
+            delete_timers();
+            bench_screen(&screens[n], ms, &r);
+            print_band_row(lines, bytes, screens[n].name, &r, ms);
+            uint32_t frames = r.frames ? r.frames : 1;
+            sum_us += (r.render_ns + r.bus_ns) / 1000.0 / frames;
+            n_run++;
+        }
+        printf("%5lu %7lu  %-10s %6s %7s %9s %9s %8s %9.1f\n\n", (unsigned long)lines, (unsigned long)bytes, "mean", "",
+               "", "", "", "", n_run ? sum_us / n_run : 0.0);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return 0;
+}
+
+#if LV_PORT_OVERDRAW
+// Black -> blue -> red -> yellow -> white over 0..max
+static void heat_rgb(uint32_t v, uint32_t max, uint8_t *rgb) {
+    uint32_t t = max ? v * 1020 / max : 0;
+    rgb[0] = (uint8_t)(t < 255 ? 0 : t < 510 ? t - 255 : 255);
+    rgb[1] = (uint8_t)(t < 510 ? 0 : t < 765 ? t - 510 : 255);
+    rgb[2] = (uint8_t)(t < 255 ? t : t < 510 ? 510 - t : t < 765 ? 0 : t - 765);
+}
+
+static void write_heatmaps(const char *dir, const char *screen) {
+    static const char *const names[] = {"depth", "overdraw", "invalidated", "flushed"};
+    static uint8_t rgb[ST7789_HEIGHT][ST7789_WIDTH][3];
+    for (uint32_t m = 0; m < sizeof(names) / sizeof(names[0]); m++) {
+        uint32_t max = lv_port_overdraw_max((ovd_map_t)m);
+        for (uint32_t y = 0; y < ST7789_HEIGHT; y++) {
+            for (uint32_t x = 0; x < ST7789_WIDTH; x++) {
+                heat_rgb(lv_port_overdraw_value((ovd_map_t)m, x, y), max, rgb[y][x]);
+            }
+        }
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s_%s.png", dir, screen, names[m]);
+        sim_png_write(path, &rgb[0][0][0], ST7789_WIDTH, ST7789_HEIGHT);
+    }
+}
+#endif
+
+static void print_result(FILE *f, const char *name, const bench_result_t *r, uint32_t ms, bool json, bool last) {
+    uint32_t frames = r->frames ? r->frames : 1;
+    double fps = r->frames * 1000.0 / ms;
+    double bus_us = r->bus_ns / 1000.0 / frames;
+    if (json) {
+        fprintf(f,
+                "    \"%s\": {\"frames\": %lu, \"fps\": %.2f, \"render_us\": %.1f, \"bytes_per_frame\": %llu, "
+                "\"bus_us_per_frame\": %.1f, \"bus_fps_max\": %.1f, \"area_px_per_frame\": %llu, \"mem_peak\": %lu}%s\n",
+                name, (unsigned long)r->frames, fps, r->render_ns / 1000.0 / frames,
+                (unsigned long long)(r->spi_bytes / frames), bus_us, bus_us > 0 ? 1000000.0 / bus_us : 0.0,
+                (unsigned long long)(r->area_px / frames), (unsigned long)r->mem_peak, last ? "" : ",");
+    } else {
+        fprintf(f, "%-10s %6lu %7.1f %9.1f %9llu %9.1f %8.1f %9llu %8lu\n", name, (unsigned long)r->frames, fps,
+                r->render_ns / 1000.0 / frames, (unsigned long long)(r->spi_bytes / frames), bus_us,
+                bus_us > 0 ? 1000000.0 / bus_us : 0.0, (unsigned long long)(r->area_px / frames),
+                (unsigned long)r->mem_peak);
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t ms = BENCH_RUN_MS;
+    const char *json = NULL;
+    const char *png_dir = NULL;
+    const char *bands = NULL;
+    const char *mem_trace = NULL;
+    uint32_t buffers = 2;
+    bool selected[SCREEN_COUNT] = {false};
+    bool any = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--ms") && i + 1 < argc) {
+            ms = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--json") && i + 1 < argc) {
+            json = argv[++i];
+        } else if (!strcmp(argv[i], "--png-dir") && i + 1 < argc) {
+            png_dir = argv[++i];
+        } else if (!strcmp(argv[i], "--bands") && i + 1 < argc) {
+            bands = argv[++i];
+        } else if (!strcmp(argv[i], "--buffers") && i + 1 < argc) {
+            buffers = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--mem-trace") && i + 1 < argc) {
+            mem_trace = argv[++i];
+        } else {
+            size_t n = 0;
+            while (n < SCREEN_COUNT && strcmp(argv[i], screens[n].name)) n++;
+            if (n == SCREEN_COUNT) {
+                fprintf(stderr,
+                        "usage: %s [--ms N] [--json FILE] [--png-dir DIR] [--bands L,L,... [--buffers 1|2]] "
+                        "[--mem-trace FILE] [screen...]\nscreens:",
+                        argv[0]);
+                for (n = 0; n < SCREEN_COUNT; n++) fprintf(stderr, " %s", screens[n].name);
+                fprintf(stderr, "\n");
+                return 2;
+            }
+            selected[n] = any = true;
+        }
+    }
+    if (ms == 0) ms = BENCH_RUN_MS;
+    if (mem_trace) {
+#if LV_MEM_CUSTOM
+        trace_file = fopen(mem_trace, "w");
+        if (!trace_file) {
+            fprintf(stderr, "can't write %s\n", mem_trace);
+            return 1;
+        }
+        fprintf(trace_file, "# lvgl_bench --ms %lu, LVGL heap calls: a id size, r id size, f id\n", (unsigned long)ms);
+        lv_port_mem_set_trace_cb(trace_mem);
+#else
+        fprintf(stderr, "--mem-trace needs LV_MEM_CUSTOM 1\n");
+        return 2;
+#endif
+    }
+
+    st7789_model_attach(&panel, SPI_PORT, PIN_CS, PIN_DC);
+#if SPI_BUS_SHARED
+    xpt2046_model_attach(&touch, SPI_PORT, PIN_XPT_CS, PIN_XPT_IRQ);
+#else
+    xpt2046_model_attach(&touch, XPT_SPI_PORT, PIN_XPT_CS, PIN_XPT_IRQ);
+#endif
+
+    lv_init();
+    lv_port_disp_init();
+    lv_port_indev_init();
+    port_log_flush(0);
+    lv_disp_t *disp = lv_disp_get_default();
+    monitor_orig = disp->driver->monitor_cb;
+    disp->driver->monitor_cb = bench_monitor;
+    flush_orig = disp->driver->flush_cb;
+    disp->driver->flush_cb = bench_flush;
+
+    if (bands) return band_sweep(bands, buffers, ms, selected, any);
+
+    bench_result_t results[SCREEN_COUNT];
+    printf("%-10s %6s %7s %9s %9s %9s %8s %9s %8s\n", "screen", "frames", "fps", "render_us", "bytes/fr", "bus_us/fr",
+           "bus_fps", "area/fr", "mem_peak");
+    for (size_t n = 0; n < SCREEN_COUNT; n++) {
+        if (any && !selected[n]) continue;
+        delete_timers();
+        bench_screen(&screens[n], ms, &results[n]);
+        print_result(stdout, screens[n].name, &results[n], ms, false, false);
+        if (png_dir) {
+            char path[256];
+            snprintf(path, sizeof(path), "%s/%s.png", png_dir, screens[n].name);
+            st7789_model_write_png(&panel, path);
+        }
+#if LV_PORT_DIRECT_LAYER
+        lv_port_layer_print();
+#endif
+#if LV_PORT_OVERDRAW
+        lv_port_overdraw_print(8);
+        if (png_dir) write_heatmaps(png_dir, screens[n].name);
+#endif
+    }
+
+    if (json) {
+        FILE *f = fopen(json, "w");
+        if (!f) {
+            fprintf(stderr, "can't write %s\n", json);
+            return 1;
+        }
+        size_t last = SCREEN_COUNT;
+        for (size_t n = 0; n < SCREEN_COUNT; n++) {
+            if (!any || selected[n]) last = n;
+        }
+        fprintf(f, "{\n  \"run_ms\": %lu,\n  \"spi_baud\": %lu,\n  \"screens\": {\n", (unsigned long)ms,
+                (unsigned long)SPI_BAUD_RATE);
+        for (size_t n = 0; n < SCREEN_COUNT; n++) {
+            if (any && !selected[n]) continue;
+            print_result(f, screens[n].name, &results[n], ms, true, n == last);
+        }
+        fprintf(f, "  }\n}\n");
+        fclose(f);
+    }
+#if LV_MEM_CUSTOM
+    if (trace_file) {
+        lv_port_mem_set_trace_cb(NULL);
+        fclose(trace_file);
+    }
+#endif
+    return 0;
+}
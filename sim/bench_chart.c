@@ -0,0 +1,146 @@
+// Streaming chart against lv_chart on the host simulator: the same 220x200
+// plot with 100 points per series gets a new point per series at 100 Hz for
+// 1, 4 and 8 series. Prints per pushed point the SPI bytes, the modelled
+// bus time, the invalidated area and the render time (host CPU).
+//
+//     lvgl_bench_chart [--ms 2000]
+//
+// Build like the benchmark (README.md, "Host simulator") with
+// -DLV_PORT_STREAM_CHART=1 and sim/bench_chart.c in place of sim/bench.c.
+
+#include "lvgl.h"
+#include "lv_port_disp.h"
+#include "lv_port_schart.h"
+#include "st7789.h"
+#include "port_log.h"
+#include "st7789_model.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if !LV_PORT_STREAM_CHART
+#error "build with -DLV_PORT_STREAM_CHART=1"
+#endif
+
+#define CHART_W      220
+#define CHART_H      200
+#define CHART_POINTS 100
+#define PUSH_MS      10
+
+static st7789_model_t panel;
+static uint64_t area_px;
+static uint64_t render_ns;
+static uint32_t pushes;
+
+static lv_obj_t *chart;
+static lv_chart_series_t *lv_ser[SCHART_MAX_SERIES];
+static uint32_t series_count;
+static bool stream;
+
+static void monitor_cb(lv_disp_drv_t *drv, uint32_t time, uint32_t px) {
+    (void)drv;
+    (void)time;
+    area_px += px;
+}
+
+static uint64_t cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int16_t sample(uint32_t n, uint32_t s) {
+    return (int16_t)(50 + lv_trigo_sin((int16_t)((n * (5 + 4 * s)) % 360)) * 40 / LV_TRIGO_SIN_MAX);
+}
+
+static void push_timer_cb(lv_timer_t *t) {
+    (void)t;
+    int16_t v[SCHART_MAX_SERIES];
+    for (uint32_t s = 0; s < series_count; s++) v[s] = sample(pushes, s);
+    if (stream) {
+        lv_port_schart_push(chart, v);
+    } else {
+        for (uint32_t s = 0; s < series_count; s++) lv_chart_set_next_value(chart, lv_ser[s], v[s]);
+    }
+    pushes++;
+}
+
+static void create_chart(lv_obj_t *scr) {
+    static const lv_palette_t palette[SCHART_MAX_SERIES] = {
+        LV_PALETTE_RED, LV_PALETTE_BLUE, LV_PALETTE_GREEN, LV_PALETTE_ORANGE,
+        LV_PALETTE_PURPLE, LV_PALETTE_TEAL, LV_PALETTE_BROWN, LV_PALETTE_PINK,
+    };
+    if (stream) {
+        chart = lv_port_schart_create(scr, CHART_POINTS);
+        lv_port_schart_set_range(chart, 0, 100);
+        for (uint32_t s = 0; s < series_count; s++) lv_port_schart_add_series(chart, lv_palette_main(palette[s]));
+    } else {
+        chart = lv_chart_create(scr);
+        lv_chart_set_type(chart, LV_CHART_TYPE_LINE);
+        lv_chart_set_point_count(chart, CHART_POINTS);
+        lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0, 100);
+        lv_chart_set_div_line_count(chart, 0, 0);
+        lv_obj_set_style_size(chart, 0, LV_PART_INDICATOR);
+        for (uint32_t s = 0; s < series_count; s++) {
+            lv_ser[s] = lv_chart_add_series(chart, lv_palette_main(palette[s]), LV_CHART_AXIS_PRIMARY_Y);
+        }
+    }
+    lv_obj_set_size(chart, CHART_W, CHART_H);
+    lv_obj_center(chart);
+}
+
+static void run_ms(uint32_t ms, bool measure) {
+    uint64_t end = time_us_64() + (uint64_t)ms * 1000;
+    while (time_us_64() < end) {
+        uint64_t t0 = cpu_ns();
+        uint32_t next = lv_timer_handler();
+        if (measure) render_ns += cpu_ns() - t0;
+        sleep_ms(next < 1 ? 1 : next > 5 ? 5 : next);
+    }
+    port_log_flush(0);
+}
+
+int main(int argc, char **argv) {
+    uint32_t ms = 2000;
+    if (argc > 2 && !strcmp(argv[1], "--ms")) ms = (uint32_t)strtoul(argv[2], NULL, 0);
+
+    st7789_model_attach(&panel, SPI_PORT, PIN_CS, PIN_DC);
+    lv_init();
+    lv_port_disp_init();
+    port_log_flush(0);
+    lv_disp_get_default()->driver->monitor_cb = monitor_cb;
+
+    static const uint32_t counts[] = {1, 4, 8};
+    printf("%-9s %6s %7s %10s %9s %10s %10s\n", "chart", "series", "points", "bytes/pt", "bus_us/pt", "area/pt",
+           "render_us");
+    for (uint32_t k = 0; k < 2 * 3; k++) {
+        stream = k % 2;
+        series_count = counts[k / 2];
+
+        lv_obj_t *old = lv_scr_act();
+        lv_obj_t *scr = lv_obj_create(NULL);
+        create_chart(scr);
+        lv_scr_load(scr);
+        lv_obj_del(old);
+        lv_timer_t *timer = lv_timer_create(push_timer_cb, PUSH_MS, NULL);
+        pushes = 0;
+        run_ms(CHART_POINTS * PUSH_MS, false); // Fill the plot once
+
+        sim_spi_reset_stats();
+        st7789_model_reset_stats(&panel);
+        area_px = 0;
+        render_ns = 0;
+        uint32_t start = pushes;
+        run_ms(ms, true);
+        lv_timer_del(timer);
+
+        sim_spi_stats_t spi;
+        sim_spi_get_stats(spi_get_index(SPI_PORT), &spi);
+        uint32_t n = pushes - start ? pushes - start : 1;
+        printf("%-9s %6lu %7lu %10llu %9.1f %10llu %10.1f\n", stream ? "stream" : "lv_chart",
+               (unsigned long)series_count, (unsigned long)n, (unsigned long long)(spi.bytes / n),
+               spi.busy_ns / 1000.0 / n, (unsigned long long)(area_px / n), render_ns / 1000.0 / n);
+    }
+    return 0;
+}
@@ -0,0 +1,378 @@
+// Backlight on the host: the PWM levels and DMA fades of st7789.c, with
+// the fade DMA paced by the pacing slice's wrap in virtual time, and the
+// lv_port_backlight policy with stand-ins for its LVGL timer and the
+// display's inactive time, with the touch driver on the XPT2046 model.
+// Checks that every level is (p / 100)^2.2 of the PWM wrap; that a fade
+// writes one step per pacing period, linear in perceived brightness, and
+// ends at its target after its duration, also when it is longer than
+// ST7789_BL_FADE_MAX_STEPS steps; that a fade started mid-fade goes on from
+// the level reached and a level set mid-fade stops it. Then that the policy
+// dims after dim_after_ms and turns off after off_after_ms without input,
+// with its timer running only at those deadlines and paused when off; that
+// a pen-down fades back up from the touch IRQ before LVGL reads the touch,
+// except with the panel asleep; that taps keep it on; and that policies
+// without a dim or an off step skip it. Exits 1 on any mismatch. No LVGL.
+//
+//     gcc -O2 -DLV_PORT_BL_AUTODIM=1 -Isim/hal -Isim -Isim/nolvgl -Iinc -I. sim/bl_sim.c sim/st7789_model.c
+//         sim/xpt2046_model.c sim/sim_png.c sim/hal/sim_hal.c src/st7789.c src/xpt2046.c src/spi_bus.c
+//         src/port_log.c src/lv_port_backlight.c -o bl_sim -lm
+
+#include "lv_port_backlight.h"
+#include "st7789.h"
+#include "xpt2046.h"
+#include "port_log.h"
+#include "st7789_model.h"
+#include "xpt2046_model.h"
+#include "check.h"
+#include <math.h>
+#include <stdio.h>
+
+#if !LV_PORT_BL_AUTODIM
+#error "build with -DLV_PORT_BL_AUTODIM=1, see above"
+#endif
+
+#define MAX_CHANGES 16
+
+static st7789_model_t panel;
+static xpt2046_model_t touch;
+
+static uint16_t level(void) {
+    uint32_t cc = pwm_hw->slice[pwm_gpio_to_slice_num(PIN_BLK)].cc;
+    return (uint16_t)(pwm_gpio_to_channel(PIN_BLK) ? cc >> 16 : cc & 0xFFFF);
+}
+
+// PWM level for a percentage, unrounded
+static double gamma_level(double pct) {
+    return pow(pct / 100.0, 2.2) * ST7789_BL_PWM_WRAP;
+}
+
+static uint32_t tick(void) {
+    return (uint32_t)(time_us_64() / 1000);
+}
+
+// --- fades ------------------------------------------------------------------
+
+static uint32_t fade_steps(uint32_t duration_ms) {
+    uint32_t steps = duration_ms * ST7789_BL_FADE_HZ / 1000;
+    return steps > ST7789_BL_FADE_MAX_STEPS ? ST7789_BL_FADE_MAX_STEPS : steps;
+}
+
+// Follows a fade from from_pct just started, 1 ms at a time. Step k of
+// steps is written at k * duration / steps (give or take one step for the
+// pacing slice's rounding) and is the perceived level k / steps of the way.
+// Returns the ms at which the target level was first seen.
+static uint32_t follow_fade(const char *name, uint8_t from_pct, uint8_t to_pct, uint32_t duration_ms) {
+    uint32_t steps = fade_steps(duration_ms);
+    uint16_t target = (uint16_t)lround(gamma_level(to_pct));
+    uint32_t reached = UINT32_MAX;
+    uint32_t bad = 0;
+    uint16_t prev = level();
+
+    for (uint32_t t = 1; t <= duration_ms + duration_ms / 4 + 10; t++) {
+        sleep_ms(1);
+        uint16_t l = level();
+        uint64_t k = (uint64_t)t * steps / duration_ms;
+        if (k > steps) k = steps;
+        double lo = 1e9, hi = -1e9;
+        for (int64_t j = (int64_t)k - 1; j <= (int64_t)k + 1; j++) {
+            if (j < 0 || j > (int64_t)steps) continue;
+            double g = gamma_level(from_pct + (to_pct - from_pct) * (double)j / steps);
+            if (g < lo) lo = g;
+            if (g > hi) hi = g;
+        }
+        if (l + 2.0 < lo || l > hi + 2.0) bad++;
+        if (to_pct > from_pct ? l < prev : l > prev) bad++;
+        if (l == target && reached == UINT32_MAX) reached = t;
+        prev = l;
+    }
+
+    printf("%-22s %3u%% -> %3u%% in %5lu ms: %3lu steps, at target after %5lu ms\n", name, from_pct, to_pct,
+           (unsigned long)duration_ms, (unsigned long)steps, (unsigned long)reached);
+    if (bad) {
+        printf("  %lu samples off the ramp or going back\n", (unsigned long)bad);
+        errors++;
+    }
+    uint32_t step_ms = duration_ms / steps;
+    if (reached == UINT32_MAX || reached + step_ms + 1 < duration_ms || reached > duration_ms + step_ms + 1) {
+        fail("fade not at its target after its duration");
+    }
+    return reached;
+}
+
+static void check_fades(void) {
+    // Every level
+    uint16_t prev = 0;
+    for (uint8_t p = 0; p <= 100; p++) {
+        st7789_set_backlight(p);
+        if (fabs(level() - gamma_level(p)) > 1.0) {
+            printf("  %u%%: level %u, %.1f expected\n", p, level(), gamma_level(p));
+            errors++;
+        }
+        if (level() < prev) fail("levels not increasing");
+        if (st7789_get_backlight() != p) fail("level read back wrong");
+        prev = level();
+    }
+    if (level() != ST7789_BL_PWM_WRAP) fail("100 % not full duty");
+
+    st7789_set_backlight(0);
+    st7789_fade_backlight(100, 1000);
+    if (st7789_get_backlight() != 100) fail("fade target not read back");
+    follow_fade("up", 0, 100, 1000);
+    st7789_fade_backlight(15, 1000);
+    follow_fade("dim", 100, 15, 1000);
+    st7789_fade_backlight(0, 150);
+    follow_fade("off", 15, 0, 150);
+    st7789_fade_backlight(100, 5000);
+    follow_fade("up, stretched steps", 0, 100, 5000);
+
+    // Shorter than two steps: at once
+    st7789_fade_backlight(40, 5);
+    if (level() != lround(gamma_level(40))) fail("short fade not applied at once");
+
+    // Fading down from the middle of a fade up: no jump, no going back up
+    st7789_set_backlight(0);
+    st7789_fade_backlight(100, 1000);
+    sleep_ms(500);
+    uint16_t mid = level();
+    st7789_fade_backlight(0, 500);
+    sleep_ms(6);
+    printf("%-22s %u at the turn, %u one step later\n", "turn mid-fade", mid, level());
+    if (level() > mid || level() + 2 * (gamma_level(50) - gamma_level(49)) < mid) fail("fade turned with a jump");
+    sleep_ms(500);
+    if (level() != 0) fail("turned fade didn't end at 0");
+
+    // A level set mid-fade stops it
+    st7789_fade_backlight(100, 1000);
+    sleep_ms(300);
+    st7789_set_backlight(40);
+    sleep_ms(1000);
+    if (level() != lround(gamma_level(40))) fail("fade went on after a set level");
+}
+
+// --- LVGL stand-ins ---------------------------------------------------------
+
+static lv_timer_t bl_timer; // The only one lv_port_backlight creates
+static uint32_t timer_runs;
+static uint32_t last_input_ms; // What LVGL resets on a press
+
+lv_timer_t *lv_timer_create(lv_timer_cb_t timer_cb, uint32_t period, void *user_data) {
+    bl_timer.timer_cb = timer_cb;
+    bl_timer.period = period;
+    bl_timer.user_data = user_data;
+    bl_timer.last_run = tick();
+    return &bl_timer;
+}
+
+void lv_timer_set_period(lv_timer_t *timer, uint32_t period) {
+    timer->period = period;
+}
+
+void lv_timer_pause(lv_timer_t *timer) {
+    timer->paused = 1;
+}
+
+void lv_timer_resume(lv_timer_t *timer) {
+    timer->paused = 0;
+}
+
+void lv_timer_ready(lv_timer_t *timer) {
+    timer->last_run = tick() - timer->period - 1;
+}
+
+uint32_t lv_disp_get_inactive_time(const lv_disp_t *disp) {
+    (void)disp;
+    return tick() - last_input_ms;
+}
+
+static void timer_handler(void) {
+    if (bl_timer.timer_cb && !bl_timer.paused && tick() - bl_timer.last_run >= bl_timer.period) {
+        bl_timer.last_run = tick();
+        timer_runs++;
+        bl_timer.timer_cb(&bl_timer);
+    }
+}
+
+// --- policy -----------------------------------------------------------------
+
+typedef struct {
+    uint32_t at_ms;
+    lv_port_bl_state_t state;
+} change_t;
+
+static change_t changes[MAX_CHANGES];
+static uint32_t n_changes;
+static uint32_t next_read_ms;
+
+// The LVGL loop for ms: the touch read every LV_INDEV_DEF_READ_PERIOD,
+// then the timers. State changes are logged with their tick.
+static void run_ms(uint32_t ms) {
+    for (uint32_t end = tick() + ms; tick() < end;) {
+        lv_port_bl_state_t s = lv_port_bl_get_state();
+        if (tick() >= next_read_ms) {
+            bool pressed = xpt2046_is_touched();
+            if (pressed) last_input_ms = tick();
+            lv_port_bl_input(pressed);
+            next_read_ms = tick() + LV_INDEV_DEF_READ_PERIOD;
+        }
+        timer_handler();
+        if (lv_port_bl_get_state() != s && n_changes < MAX_CHANGES) {
+            changes[n_changes++] = (change_t){tick(), lv_port_bl_get_state()};
+        }
+        port_log_flush(0);
+        sleep_ms(1);
+    }
+}
+
+// Prints the changes logged since start_ms and checks them against the
+// expected states, each at or within a touch read period after its time
+static void expect_changes(const char *name, uint32_t start_ms, const change_t *expected, uint32_t count) {
+    static const char *const names[] = {"on", "dim", "off"};
+    printf("%-22s", name);
+    for (uint32_t i = 0; i < n_changes; i++) {
+        printf(" %s at %lu ms", names[changes[i].state], (unsigned long)(changes[i].at_ms - start_ms));
+    }
+    printf(n_changes ? "\n" : " no change\n");
+
+    if (n_changes != count) {
+        printf("  %lu changes, %lu expected\n", (unsigned long)n_changes, (unsigned long)count);
+        errors++;
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t at = changes[i].at_ms - start_ms;
+        if (changes[i].state != expected[i].state || at < expected[i].at_ms ||
+            at > expected[i].at_ms + LV_INDEV_DEF_READ_PERIOD) {
+            printf("  %s expected at %lu ms\n", names[expected[i].state], (unsigned long)expected[i].at_ms);
+            errors++;
+        }
+    }
+}
+
+// A tap on the model just after a touch read; returns the tick of the
+// pen-down. Checks that the IRQ alone has started the fade up before the
+// next read (or left the light alone: already on, or the panel asleep) and
+// that the light is at on_pct after fade_up_ms.
+static uint32_t tap(uint32_t hold_ms, bool irq_fades) {
+    lv_port_bl_policy_t p = LV_PORT_BL_POLICY_DEFAULT; // on_pct and fade_up_ms as in every policy here
+    run_ms(next_read_ms - tick() + 1);
+    uint64_t t0 = time_us_64();
+    static xpt2046_model_event_t script[2];
+    script[0] = (xpt2046_model_event_t){t0 + 1000, true, 2000, 2000, 600};
+    script[1] = (xpt2046_model_event_t){t0 + 1000 + (uint64_t)hold_ms * 1000, false, 0, 0, 0};
+    uint16_t before = level();
+    lv_port_bl_state_t state = lv_port_bl_get_state();
+    xpt2046_model_play(&touch, script, 2);
+    sleep_ms(1 + 1000 / ST7789_BL_FADE_HZ + 1);
+    if (irq_fades && level() <= before) fail("pen-down didn't start the fade up");
+    if (!irq_fades && level() != before) fail("pen-down changed the backlight");
+    if (lv_port_bl_get_state() != state) fail("state changed before the touch was read");
+    run_ms(p.fade_up_ms);
+    if (irq_fades && level() != lround(gamma_level(p.on_pct))) fail("not back on after fade_up_ms");
+    return (uint32_t)(t0 / 1000) + 1;
+}
+
+static void check_policy(void) {
+    lv_port_bl_policy_t p = LV_PORT_BL_POLICY_DEFAULT;
+
+    last_input_ms = tick();
+    next_read_ms = tick();
+    lv_port_bl_init();
+    if (level() != lround(gamma_level(p.on_pct))) fail("not on after init");
+
+    // Nothing touched: dim, then off, the timer only at the deadlines
+    uint32_t start = tick();
+    run_ms(p.off_after_ms + 5000);
+    const change_t idle[] = {{p.dim_after_ms, BL_STATE_DIM}, {p.off_after_ms, BL_STATE_OFF}};
+    expect_changes("no input", start, idle, 2);
+    if (level() != 0) fail("backlight not off");
+    if (!bl_timer.paused) fail("timer running while off");
+    printf("  %lu timer runs\n", (unsigned long)timer_runs);
+    if (timer_runs > 2) fail("timer ran between the deadlines");
+
+    // Off: the pen IRQ lights it, the next read takes the state back to on.
+    // The dim deadline counts from the last read of the press.
+    n_changes = 0;
+    start = tap(100, true);
+    run_ms(p.dim_after_ms + 2000);
+    const change_t from_off[] = {{0, BL_STATE_ON}, {last_input_ms - start + p.dim_after_ms, BL_STATE_DIM}};
+    expect_changes("tap while off", start, from_off, 2);
+
+    // Dim: the same from the dim level
+    n_changes = 0;
+    start = tap(100, true);
+    run_ms(1000);
+    const change_t from_dim[] = {{0, BL_STATE_ON}};
+    expect_changes("tap while dim", start, from_dim, 1);
+
+    // Taps closer than dim_after_ms keep it on
+    n_changes = 0;
+    start = tick();
+    for (uint32_t i = 0; i < 5; i++) {
+        run_ms(p.dim_after_ms * 2 / 3);
+        tap(60, false);
+    }
+    run_ms(p.dim_after_ms + 2000);
+    const change_t kept_on[] = {{last_input_ms - start + p.dim_after_ms, BL_STATE_DIM}};
+    expect_changes("taps every 20 s", start, kept_on, 1);
+
+    // Panel asleep: the IRQ leaves the light to the application, the read
+    // still counts as input
+    n_changes = 0;
+    st7789_sleep();
+    start = tap(60, false);
+    st7789_wake();
+    run_ms(1000);
+    const change_t asleep[] = {{0, BL_STATE_ON}};
+    expect_changes("tap while asleep", start, asleep, 1);
+
+    // Dim only, applied at once: dims at the new deadline and stays dim
+    // with the timer paused; a tap fades up from the dim level
+    p.dim_after_ms = 5000;
+    p.off_after_ms = 0;
+    n_changes = 0;
+    start = tick();
+    lv_port_bl_set_policy(&p);
+    run_ms(20000);
+    const change_t dim_only[] = {{last_input_ms - start + p.dim_after_ms, BL_STATE_DIM}};
+    expect_changes("dim only", start, dim_only, 1);
+    if (!bl_timer.paused) fail("timer running while dim for good");
+    n_changes = 0;
+    start = tap(60, true);
+    run_ms(p.dim_after_ms + 2000);
+    const change_t dim_only_tap[] = {{0, BL_STATE_ON}, {last_input_ms - start + p.dim_after_ms, BL_STATE_DIM}};
+    expect_changes("dim only, tap", start, dim_only_tap, 2);
+
+    // Off only, applied at once: without a dim step the light is on until
+    // off_after_ms, then straight from on to off, also after a tap
+    p.dim_after_ms = 0;
+    p.off_after_ms = 8000;
+    n_changes = 0;
+    start = tick();
+    lv_port_bl_set_policy(&p);
+    run_ms(p.off_after_ms);
+    const change_t off_only[] = {{0, BL_STATE_ON}, {last_input_ms - start + p.off_after_ms, BL_STATE_OFF}};
+    expect_changes("off only", start, off_only, 2);
+    n_changes = 0;
+    start = tap(60, true);
+    run_ms(20000);
+    const change_t off_only_tap[] = {{0, BL_STATE_ON}, {last_input_ms - start + p.off_after_ms, BL_STATE_OFF}};
+    expect_changes("off only, tap", start, off_only_tap, 2);
+    if (!bl_timer.paused) fail("timer running while off");
+}
+
+int main(void) {
+    st7789_model_attach(&panel, SPI_PORT, PIN_CS, PIN_DC);
+#if SPI_BUS_SHARED
+    xpt2046_model_attach(&touch, SPI_PORT, PIN_XPT_CS, PIN_XPT_IRQ);
+#else
+    xpt2046_model_attach(&touch, XPT_SPI_PORT, PIN_XPT_CS, PIN_XPT_IRQ);
+#endif
+    st7789_init();
+    xpt2046_init();
+    port_log_flush(0);
+
+    check_fades();
+    check_policy();
+
+    return check_result();
+}
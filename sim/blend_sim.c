@@ -0,0 +1,133 @@
+// Blend kernels against LVGL: every fill and copy, without and with a
+// mask, at every opacity the draw context passes on (LV_OPA_MIN + 1 up to
+// LV_OPA_COVER), blended once by lv_draw_sw_blend_basic() and once through
+// lv_port_blend's draw context onto the same background. Blend and clip
+// areas start 0 to 3 pixels in, so rows, sources and masks start and end
+// on every alignment. The background has flat runs (the cached path) and
+// noise, the mask every value and runs of 0 and 255 (the 4-byte paths).
+// Exits 1 if any pixel differs. Needs the LVGL 8.3 sources, see "Host
+// simulator" in README.md.
+
+#include "lvgl.h"
+#include "lv_port_blend.h"
+#include "check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !LV_PORT_FAST_BLEND
+#error "build with -DLV_PORT_FAST_BLEND=1"
+#endif
+
+#define W LV_HOR_RES_MAX
+#define H 8
+
+static lv_color_t bg[W * H], ref[W * H], out[W * H], src[W * H];
+static lv_opa_t mask[W * H];
+
+static void flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *px) {
+    (void)area;
+    (void)px;
+    lv_disp_flush_ready(drv);
+}
+
+static void make_data(void) {
+    srand(1);
+    for (int32_t y = 0; y < H; y++) {
+        for (int32_t x = 0; x < W; x++) {
+            int32_t i = y * W + x;
+            // Flat runs of 16 on even rows, noise (black and white included) on odd ones
+            if (y & 1) bg[i].full = (uint16_t)(x == 7 ? 0x0000 : x == 9 ? 0xFFFF : rand());
+            else bg[i] = lv_color_make(y * 32, x & ~15, 0x80);
+            src[i].full = (uint16_t)rand();
+            // Runs of 0 and 255 around a ramp through every value
+            int32_t m = (x - 40 - y * 3) * 2 + y;
+            mask[i] = m < 0 ? 0 : (m > 255 ? 255 : m);
+        }
+    }
+}
+
+typedef struct {
+    const char *name;
+    bool src;
+    bool mask;
+} blend_case_t;
+
+static const blend_case_t cases[] = {
+    { "fill",      false, false },
+    { "fill mask", false, true  },
+    { "copy",      true,  false },
+    { "copy mask", true,  true  },
+};
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    lv_init();
+
+    static lv_color_t draw_buf_px[W * 10];
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_disp_drv_t drv;
+    lv_disp_draw_buf_init(&draw_buf, draw_buf_px, NULL, W * 10);
+    lv_disp_drv_init(&drv);
+    drv.hor_res = LV_HOR_RES_MAX;
+    drv.ver_res = LV_VER_RES_MAX;
+    drv.flush_cb = flush_cb;
+    drv.draw_buf = &draw_buf;
+    lv_disp_t *disp = lv_disp_drv_register(&drv);
+    _lv_refr_set_disp_refreshing(disp);
+
+    lv_draw_sw_ctx_t port_ctx, ref_ctx;
+    lv_port_blend_ctx_init(&drv, &port_ctx.base_draw);
+    lv_draw_sw_init_ctx(&drv, &ref_ctx.base_draw);
+    make_data();
+
+    lv_area_t buf_area = { 0, 0, W - 1, H - 1 };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        uint32_t blends = 0, wrong = 0;
+        for (int32_t bx = 0; bx < 4; bx++) {
+            for (int32_t cx = 0; cx < 4; cx++) {
+                lv_area_t blend_area = { bx, 0, W - 1 - cx, H - 1 };
+                lv_area_t clip_area = { bx + cx, 0, W - 1 - bx, H - 1 };
+                for (uint32_t opa = LV_OPA_MIN + 1; opa <= LV_OPA_COVER; opa++) {
+                    lv_draw_sw_blend_dsc_t dsc;
+                    memset(&dsc, 0, sizeof(dsc));
+                    dsc.blend_area = &blend_area;
+                    dsc.src_buf = cases[c].src ? src : NULL;
+                    dsc.color = lv_color_make(0x20, 0xC0, 0x60);
+                    dsc.mask_buf = cases[c].mask ? mask : NULL;
+                    dsc.mask_res = cases[c].mask ? LV_DRAW_MASK_RES_CHANGED : LV_DRAW_MASK_RES_FULL_COVER;
+                    dsc.mask_area = &blend_area;
+                    dsc.opa = (lv_opa_t)opa;
+                    dsc.blend_mode = LV_BLEND_MODE_NORMAL;
+
+                    memcpy(ref, bg, sizeof(bg));
+                    memcpy(out, bg, sizeof(bg));
+                    ref_ctx.base_draw.buf = ref;
+                    ref_ctx.base_draw.buf_area = &buf_area;
+                    ref_ctx.base_draw.clip_area = &clip_area;
+                    port_ctx.base_draw.buf = out;
+                    port_ctx.base_draw.buf_area = &buf_area;
+                    port_ctx.base_draw.clip_area = &clip_area;
+                    lv_draw_sw_blend_basic(&ref_ctx.base_draw, &dsc);
+                    port_ctx.blend(&port_ctx.base_draw, &dsc);
+                    blends++;
+
+                    for (int32_t i = 0; i < W * H; i++) {
+                        if (ref[i].full == out[i].full) continue;
+                        if (!wrong) {
+                            printf("  %s, opa %lu, at %ld,%ld: bg %04x -> lvgl %04x, port %04x\n", cases[c].name,
+                                   (unsigned long)opa, (long)(i % W), (long)(i / W), bg[i].full, ref[i].full,
+                                   out[i].full);
+                        }
+                        wrong++;
+                    }
+                }
+            }
+        }
+        printf("%-10s %5lu blends, %lu pixels differ\n", cases[c].name, (unsigned long)blends, (unsigned long)wrong);
+        if (wrong) fail("port blend differs from LVGL");
+    }
+
+    return check_result();
+}
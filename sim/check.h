@@ -0,0 +1,22 @@
+#ifndef SIM_CHECK_H
+#define SIM_CHECK_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Shared by the simulator's test programs, one per executable: checks call
+// fail() or bump errors, main() ends with return check_result()
+static uint32_t errors;
+
+static inline void fail(const char *what) {
+    printf("  %s\n", what);
+    errors++;
+}
+
+// Prints the verdict the Makefile's check targets look for
+static inline int check_result(void) {
+    printf(errors ? "FAILED\n" : "ok\n");
+    return errors ? 1 : 0;
+}
+
+#endif // SIM_CHECK_H
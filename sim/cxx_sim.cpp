@@ -0,0 +1,300 @@
+// Compile-time C++ driver (st7789.hpp) against the C driver on the host.
+// The default panel is set up and flushed in bands once by st7789_init() /
+// st7789_set_window() / st7789_send_pixels() and once by the st7789_cxx.h
+// shim; checks that the panel gets the same commands at the same virtual
+// times, the same bytes and the same frame, and times both (host CPU per
+// frame, the shim may not be more than 15 % slower). Then on a second SPI:
+// that each rotation of a 240 x 240 and a 135 x 240 glass puts every pixel
+// where the rotated image has it and nothing outside the glass, and that
+// the DMA bus returns before a band is out, calls back once per band and
+// draws the same frame as blocking sends. Exits 1 on any mismatch. No LVGL.
+//
+//     g++ -O2 -DST7789_CXX=1 -Isim/hal -Isim -Isim/nolvgl -Iinc -I. -c sim/cxx_sim.cpp src/st7789_cxx.cpp
+//     gcc -O2 -DST7789_CXX=1 -Isim/hal -Isim -Isim/nolvgl -Iinc -I. sim/st7789_model.c sim/sim_png.c
+//         sim/hal/sim_hal.c src/st7789.c src/spi_bus.c src/port_log.c cxx_sim.o st7789_cxx.o -lstdc++ -o cxx_sim
+//     ./cxx_sim
+
+#include "st7789.hpp"
+#include "st7789_cxx.h"
+extern "C" {
+#include "port_log.h"
+#include "st7789_model.h"
+#include "check.h"
+}
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if !ST7789_CXX || ST7789_CXX_BUS || ST7789_CXX_ROTATION || !ST7789_SINGLE_PANEL
+#error "build with -DST7789_CXX=1 and the default bus, rotation and ST7789_SINGLE_PANEL, see above"
+#endif
+
+#define W      ST7789_WIDTH
+#define H      ST7789_HEIGHT
+#define BAND   40 // Rows per band, as lv_port_disp flushes
+#define FRAMES 20 // Per timing run
+
+// Panel B's wiring, on spi1
+struct TestWiring {
+    static spi_inst_t *spi() { return spi1; }
+    static constexpr uint pin_sck = 26;
+    static constexpr uint pin_mosi = 27;
+    static constexpr uint pin_dc = 15;
+    static constexpr uint pin_cs = 28;
+    static constexpr uint pin_rst = ST7789_NO_PIN;
+    static constexpr uint pin_blk = ST7789_NO_PIN;
+    static constexpr uint32_t baud = (uint32_t)SPI_BAUD_RATE;
+};
+
+using st7789_cxx::Rotation;
+using st7789_cxx::SpiBlocking;
+using st7789_cxx::SpiDma;
+using st7789_cxx::St7789;
+
+// One driver's pass over the default panel
+struct Run {
+    uint8_t cmds[ST7789_MODEL_LOG];
+    uint64_t cmd_us[ST7789_MODEL_LOG]; // Since the start of the init
+    uint32_t ncmds;
+    uint64_t frame_us;                 // Virtual time of one frame
+    uint64_t bytes;                    // SPI bytes of one frame
+    uint32_t wrong;
+};
+
+static st7789_model_t model_a, model_b;
+static uint16_t frame[H][W]; // In the byte order sent
+static uint16_t pixels[W * H];
+
+static uint16_t swap16(uint16_t c) {
+    return (uint16_t)((c >> 8) | (c << 8));
+}
+
+static void fill(uint32_t seed) {
+    for (uint32_t y = 0; y < H; y++) {
+        for (uint32_t x = 0; x < W; x++) frame[y][x] = swap16((uint16_t)((x * 7 + y * 13 + seed) * 0x9E37u));
+    }
+}
+
+static uint32_t wrong_pixels(const st7789_model_t *m) {
+    uint32_t wrong = 0;
+    for (uint32_t y = 0; y < H; y++) {
+        for (uint32_t x = 0; x < W; x++) {
+            if (st7789_model_pixel(m, x, y) != swap16(frame[y][x])) wrong++;
+        }
+    }
+    return wrong;
+}
+
+static double cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// The C driver or the shim on the default panel
+struct CDriver {
+    static void init() { st7789_init(); }
+    static void set_window(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) { st7789_set_window(x1, y1, x2, y2); }
+    static void send_pixels(const uint16_t *px, size_t n) { st7789_send_pixels(px, n); }
+};
+
+struct Shim {
+    static void init() { st7789_cxx_init(); }
+    static void set_window(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
+        st7789_cxx_set_window(x1, y1, x2, y2);
+    }
+    static void send_pixels(const uint16_t *px, size_t n) { st7789_cxx_send_pixels(px, n); }
+};
+
+template <typename D>
+static void flush_frame(void) {
+    for (uint32_t y = 0; y < H; y += BAND) {
+        D::set_window(0, y, W - 1, y + BAND - 1);
+        D::send_pixels(frame[y], W * BAND);
+    }
+}
+
+template <typename D>
+static void run_default(Run *r) {
+    memset(model_a.fb, 0, sizeof(model_a.fb));
+    st7789_model_reset_stats(&model_a);
+    uint64_t t0 = time_us_64();
+    D::init();
+    port_log_flush(0);
+    r->ncmds = model_a.nlog;
+    for (uint32_t i = 0; i < r->ncmds; i++) {
+        r->cmds[i] = model_a.log[i].cmd;
+        r->cmd_us[i] = model_a.log[i].t_us - t0;
+    }
+
+    fill(1);
+    sim_spi_reset_stats();
+    uint64_t t1 = time_us_64();
+    flush_frame<D>();
+    sim_spi_stats_t s;
+    sim_spi_get_stats(0, &s);
+    r->frame_us = time_us_64() - t1;
+    r->bytes = s.bytes;
+    r->wrong = wrong_pixels(&model_a);
+}
+
+template <typename D>
+static double time_frames(void) {
+    double t = cpu_ns();
+    for (uint32_t i = 0; i < FRAMES; i++) flush_frame<D>();
+    return (cpu_ns() - t) / FRAMES;
+}
+
+static void check_default(void) {
+    printf("default panel, C driver and shim\n");
+    static Run c, cxx;
+    run_default<CDriver>(&c);
+    run_default<Shim>(&cxx);
+    printf("  init: %lu commands, %llu us / %lu commands, %llu us\n", (unsigned long)c.ncmds,
+           (unsigned long long)c.cmd_us[c.ncmds - 1], (unsigned long)cxx.ncmds,
+           (unsigned long long)cxx.cmd_us[cxx.ncmds - 1]);
+    printf("  frame: %llu bytes in %llu us / %llu bytes in %llu us, %lu / %lu pixels wrong\n",
+           (unsigned long long)c.bytes, (unsigned long long)c.frame_us, (unsigned long long)cxx.bytes,
+           (unsigned long long)cxx.frame_us, (unsigned long)c.wrong, (unsigned long)cxx.wrong);
+    if (c.ncmds != cxx.ncmds) fail("different init sequence");
+    for (uint32_t i = 0; i < c.ncmds && i < cxx.ncmds; i++) {
+        if (c.cmds[i] != cxx.cmds[i] || c.cmd_us[i] != cxx.cmd_us[i]) {
+            printf("  command %lu: %02x at %llu us / %02x at %llu us\n", (unsigned long)i, c.cmds[i],
+                   (unsigned long long)c.cmd_us[i], cxx.cmds[i], (unsigned long long)cxx.cmd_us[i]);
+            fail("different init sequence");
+            break;
+        }
+    }
+    if (c.wrong || cxx.wrong) fail("panel shows something else");
+    if (c.bytes != cxx.bytes || c.frame_us != cxx.frame_us) fail("frame sent differently");
+    if (model_a.stats.timing_errors) fail(model_a.timing_error);
+
+    // Interleaved, best of seven, against the noise of the host
+    double best_c = 1e30, best_cxx = 1e30;
+    for (uint32_t i = 0; i < 7; i++) {
+        double t = time_frames<CDriver>();
+        if (t < best_c) best_c = t;
+        t = time_frames<Shim>();
+        if (t < best_cxx) best_cxx = t;
+    }
+    printf("  host CPU per frame: C %.0f us, shim %.0f us (%+.1f %%)\n", best_c / 1000, best_cxx / 1000,
+           (best_cxx / best_c - 1) * 100);
+    if (best_cxx > best_c * 1.15) fail("shim slower than the C driver");
+}
+
+// Where logical pixel (x, y) of a rotated nw x nh glass at (cx, ry) ends
+// up in native memory: clockwise quarter turns
+static void native_xy(Rotation rot, uint32_t nw, uint32_t nh, uint32_t cx, uint32_t ry, uint32_t x, uint32_t y,
+                      uint32_t *col, uint32_t *row) {
+    switch (rot) {
+    case Rotation::R0:   *col = cx + x;          *row = ry + y;          break;
+    case Rotation::R90:  *col = cx + nw - 1 - y; *row = ry + x;          break;
+    case Rotation::R180: *col = cx + nw - 1 - x; *row = ry + nh - 1 - y; break;
+    case Rotation::R270: *col = cx + y;          *row = ry + nh - 1 - x; break;
+    }
+}
+
+template <uint16_t NW, uint16_t NH, uint16_t CX, uint16_t RY, Rotation Rot>
+static void check_rotation(const char *name) {
+    using Panel = St7789<SpiBlocking<TestWiring>, NW, NH, Rot, CX, RY>;
+    memset(model_b.fb, 0, sizeof(model_b.fb));
+    Panel::init();
+
+    // Logical pixel i is i + 1, as the panel shows it
+    uint32_t n = (uint32_t)Panel::width * Panel::height;
+    for (uint32_t i = 0; i < n; i++) pixels[i] = swap16((uint16_t)(i + 1));
+    Panel::set_window(0, 0, Panel::width - 1, Panel::height - 1);
+    Panel::send_pixels(pixels, n);
+
+    uint32_t wrong = 0, outside = 0;
+    for (uint32_t y = 0; y < Panel::height; y++) {
+        for (uint32_t x = 0; x < Panel::width; x++) {
+            uint32_t col, row;
+            native_xy(Rot, NW, NH, CX, RY, x, y, &col, &row);
+            if (model_b.fb[row][col] != (uint16_t)(y * Panel::width + x + 1)) wrong++;
+        }
+    }
+    for (uint32_t row = 0; row < ST7789_MODEL_HEIGHT; row++) {
+        for (uint32_t col = 0; col < ST7789_MODEL_WIDTH; col++) {
+            bool in = col >= CX && col < CX + NW && row >= RY && row < RY + NH;
+            if (!in && model_b.fb[row][col]) outside++;
+        }
+    }
+    printf("  %-22s MADCTL %02x, offsets %3u,%3u: %lu wrong, %lu outside\n", name, Panel::madctl,
+           Panel::x_offset, Panel::y_offset, (unsigned long)wrong, (unsigned long)outside);
+    if (wrong || outside) fail("rotated image misplaced");
+}
+
+static uint32_t bands_done;
+
+static void on_done(void *ctx) {
+    (*(uint32_t *)ctx)++;
+}
+
+static void check_dma(void) {
+    printf("DMA bus\n");
+    using Panel = St7789<SpiDma<TestWiring>, W, H>;
+    using Blocking = St7789<SpiBlocking<TestWiring>, W, H>;
+    Panel::init();
+    fill(2);
+
+    // Blocking first, for the time a frame takes on the wire
+    memset(model_b.fb, 0, sizeof(model_b.fb));
+    uint64_t t = time_us_64();
+    for (uint32_t y = 0; y < H; y += BAND) {
+        Blocking::set_window(0, y, W - 1, y + BAND - 1);
+        Blocking::send_pixels(frame[y], W * BAND);
+    }
+    uint64_t blocking_us = time_us_64() - t;
+
+    memset(model_b.fb, 0, sizeof(model_b.fb));
+    sim_spi_reset_stats();
+    uint64_t band_us = (uint64_t)W * BAND * 2 * 8 * 1000000 / Panel::baud();
+    uint64_t longest_us = 0;
+    bands_done = 0;
+    t = time_us_64();
+    for (uint32_t y = 0; y < H; y += BAND) {
+        Panel::set_window(0, y, W - 1, y + BAND - 1); // Waits for the previous band
+        uint64_t t0 = time_us_64();
+        Panel::send_pixels_async(frame[y], W * BAND, on_done, &bands_done);
+        if (time_us_64() - t0 > longest_us) longest_us = time_us_64() - t0;
+    }
+    Panel::wait();
+    uint64_t dma_us = time_us_64() - t;
+    sim_spi_stats_t s;
+    sim_spi_get_stats(1, &s);
+    uint32_t wrong = wrong_pixels(&model_b);
+    printf("  %lu bands of %llu us on the wire, longest send call %llu us, %lu callbacks\n",
+           (unsigned long)(H / BAND), (unsigned long long)band_us, (unsigned long long)longest_us,
+           (unsigned long)bands_done);
+    printf("  frame %llu us (blocking %llu us), %lu pixels wrong, %lu collisions\n", (unsigned long long)dma_us,
+           (unsigned long long)blocking_us, (unsigned long)wrong, (unsigned long)s.collisions);
+    if (longest_us * 2 > band_us) fail("send waited for the band");
+    if (bands_done != H / BAND) fail("wrong number of callbacks");
+    if (wrong) fail("panel shows something else");
+    if (s.collisions) fail("CPU wrote during a DMA transfer");
+    if (dma_us > blocking_us) fail("DMA frame slower than blocking");
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    st7789_model_attach(&model_a, SPI_PORT, PIN_CS, PIN_DC);
+    st7789_model_attach(&model_b, spi1, TestWiring::pin_cs, TestWiring::pin_dc);
+
+    check_default();
+
+    printf("rotations\n");
+    check_rotation<240, 240, 0, 0, Rotation::R0>("240 x 240, 0");
+    check_rotation<240, 240, 0, 0, Rotation::R90>("240 x 240, 90");
+    check_rotation<240, 240, 0, 0, Rotation::R180>("240 x 240, 180");
+    check_rotation<240, 240, 0, 0, Rotation::R270>("240 x 240, 270");
+    check_rotation<135, 240, 52, 40, Rotation::R0>("135 x 240 at 52,40, 0");
+    check_rotation<135, 240, 52, 40, Rotation::R90>("135 x 240 at 52,40, 90");
+    check_rotation<135, 240, 52, 40, Rotation::R180>("135 x 240 at 52,40, 180");
+    check_rotation<135, 240, 52, 40, Rotation::R270>("135 x 240 at 52,40, 270");
+
+    check_dma();
+
+    return check_result();
+}
@@ -0,0 +1,49 @@
+// The default panel's init and flush path, through the C driver or with
+// ST7789_CXX through the st7789_cxx.h shim, for the code size comparison
+// of `make -C sim size-cxx`: both are linked with --gc-sections and
+// tools/size_diff.py compares what the two link maps keep of st7789*.
+// Runs one frame on the panel model and exits 1 if it isn't shown.
+
+#include "st7789.h"
+#include "st7789_cxx.h"
+#include "port_log.h"
+#include "st7789_model.h"
+#include <stdio.h>
+
+#define W    ST7789_WIDTH
+#define H    ST7789_HEIGHT
+#define BAND 40
+
+static st7789_model_t model;
+static uint16_t band[W * BAND];
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    st7789_model_attach(&model, SPI_PORT, PIN_CS, PIN_DC);
+    for (uint32_t i = 0; i < W * BAND; i++) band[i] = (uint16_t)(i * 0x9E37u);
+
+#if ST7789_CXX
+    st7789_cxx_init();
+    for (uint32_t y = 0; y < H; y += BAND) {
+        st7789_cxx_set_window(0, y, W - 1, y + BAND - 1);
+        st7789_cxx_send_pixels(band, W * BAND);
+    }
+    st7789_cxx_set_window(0, 0, 9, 9);
+    st7789_cxx_send_pixels_rect(band, 10, 10, W);
+#else
+    st7789_init();
+    for (uint32_t y = 0; y < H; y += BAND) {
+        st7789_set_window(0, y, W - 1, y + BAND - 1);
+        st7789_send_pixels(band, W * BAND);
+    }
+    st7789_set_window(0, 0, 9, 9);
+    st7789_send_pixels_rect(band, 10, 10, W);
+#endif
+    port_log_flush(0);
+
+    uint16_t c = band[W * 9 + 9];
+    bool ok = model.stats.pixels == W * H + 100 && st7789_model_pixel(&model, 9, 9) == (uint16_t)((c >> 8) | (c << 8));
+    printf(ok ? "ok\n" : "FAILED\n");
+    return ok ? 0 : 1;
+}
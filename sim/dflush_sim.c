@@ -0,0 +1,192 @@
+// Differential flush on the host: frames go through lv_port_dflush_send()
+// band by band, as lv_port_disp flushes them, to the panel model. Checks
+// that the panel shows every frame, that an unchanged frame sends nothing,
+// that changed rows go out as one window per run of rows with the same
+// segment span and nothing else, that an area the rounder didn't widen is
+// sent whole and its segments are sent again next time, and that
+// lv_port_dflush_forget() and _invalidate() repair a panel damaged behind
+// the port's back. Exits 1 on any mismatch. No LVGL.
+//
+//     gcc -O2 -DLV_PORT_DIFF_FLUSH=1 -Isim/hal -Isim -Isim/nolvgl -Iinc -I. sim/dflush_sim.c sim/st7789_model.c
+//         sim/sim_png.c sim/hal/sim_hal.c src/st7789.c src/spi_bus.c src/port_log.c src/lv_port_dflush.c -o dflush_sim
+//     ./dflush_sim
+
+#include "lv_port_dflush.h"
+#include "port_log.h"
+#include "st7789_model.h"
+#include "check.h"
+#include <stdio.h>
+#include <string.h>
+
+#if !LV_PORT_DIFF_FLUSH
+#error "build with -DLV_PORT_DIFF_FLUSH=1, see above"
+#endif
+
+#define W    ST7789_WIDTH
+#define H    ST7789_HEIGHT
+#define BAND 40 // Rows per flushed band
+
+static st7789_model_t model;
+static uint16_t frame[H][W]; // In the byte order sent
+
+static void fill(uint32_t seed) {
+    for (uint32_t y = 0; y < H; y++) {
+        for (uint32_t x = 0; x < W; x++) {
+            uint16_t c = (uint16_t)((x * 7 + y * 13 + seed) * 0x9E37u);
+            frame[y][x] = (uint16_t)((c >> 8) | (c << 8));
+        }
+    }
+}
+
+static void set(uint32_t x, uint32_t y, uint16_t c) {
+    frame[y][x] = (uint16_t)((c >> 8) | (c << 8));
+}
+
+static uint32_t wrong_pixels(void) {
+    uint32_t wrong = 0;
+    for (uint32_t y = 0; y < H; y++) {
+        for (uint32_t x = 0; x < W; x++) {
+            uint16_t c = frame[y][x];
+            if (st7789_model_pixel(&model, x, y) != (uint16_t)((c >> 8) | (c << 8))) wrong++;
+        }
+    }
+    return wrong;
+}
+
+// Flushes frame[] in bands as LVGL would with full-width areas, returns the
+// pixels the model received
+static uint64_t flush_frame(void) {
+    static uint16_t band[BAND * W]; // LVGL's draw buffer
+    st7789_model_reset_stats(&model);
+    for (int32_t y = 0; y < H; y += BAND) {
+        lv_area_t a = {0, (lv_coord_t)y, W - 1, (lv_coord_t)(y + BAND - 1)};
+        memcpy(band, frame[y], sizeof(band));
+        lv_port_dflush_send(&a, band, y + BAND >= H);
+    }
+    return model.stats.pixels;
+}
+
+static void expect(const char *what, uint64_t pixels, uint64_t expect_pixels, uint32_t windows,
+                   uint32_t expect_windows) {
+    uint32_t wrong = wrong_pixels();
+    printf("  %s: %llu pixels in %lu windows, %lu wrong\n", what, (unsigned long long)pixels,
+           (unsigned long)windows, (unsigned long)wrong);
+    if (wrong) fail("panel shows something else");
+    if (pixels != expect_pixels) fail("wrong pixel count");
+    if (windows != expect_windows) fail("wrong window count");
+}
+
+static uint32_t windows_since(const lv_port_dflush_stats_t *before) {
+    lv_port_dflush_stats_t now;
+    lv_port_dflush_get_stats(&now);
+    return now.windows - before->windows;
+}
+
+static void check_round(void) {
+    printf("rounder\n");
+    lv_area_t a = {61, 5, 130, 9};
+    lv_port_dflush_round(&a);
+    if (a.x1 != 60 || a.x2 != 179 || a.y1 != 5 || a.y2 != 9) fail("not widened to segments");
+    lv_area_t b = {0, 0, W - 1, 0};
+    lv_port_dflush_round(&b);
+    if (b.x1 != 0 || b.x2 != W - 1) fail("aligned area changed");
+}
+
+static void check_diff(void) {
+    lv_port_dflush_stats_t s, before;
+
+    printf("first frame\n");
+    fill(1);
+    lv_port_dflush_get_stats(&before);
+    uint64_t px = flush_frame();
+    lv_port_dflush_get_stats(&s);
+    expect("all sent", px, W * H, windows_since(&before), H / BAND);
+    if (s.last_frame_sent != W * H * 2 || s.last_frame_rendered != W * H * 2) fail("frame stats");
+
+    printf("same frame\n");
+    lv_port_dflush_get_stats(&before);
+    px = flush_frame();
+    lv_port_dflush_get_stats(&s);
+    expect("nothing sent", px, 0, windows_since(&before), 0);
+    if (s.last_frame_sent != 0 || s.frames != before.frames + 1) fail("frame stats");
+
+    // Rows 100-101 in segment 1 (one window of 2 rows), row 150 in
+    // segment 3 and row 151 in segments 0 and 3 (one window each, the
+    // span changes). Row 200 at the last pixel of segment 2 and the first
+    // of 3 (both, one window).
+    printf("a few pixels changed\n");
+    set(70, 100, 0x1234);
+    set(119, 101, 0x2345);
+    set(200, 150, 0x3456);
+    set(0, 151, 0x4567);
+    set(239, 151, 0x5678);
+    set(179, 200, 0x6789);
+    set(180, 200, 0x789A);
+    lv_port_dflush_get_stats(&before);
+    px = flush_frame();
+    expect("changed segments", px, 2 * 60 + 60 + 4 * 60 + 2 * 60, windows_since(&before), 4);
+}
+
+static void check_unaligned(void) {
+    printf("area not rounded\n");
+    lv_port_dflush_stats_t before;
+    // A red block over parts of segments 0 and 1 of rows 5-6, e.g. from a
+    // second rounder, sent whole
+    static uint16_t red[20 * 2];
+    for (uint32_t i = 0; i < 20 * 2; i++) red[i] = 0x00F8; // As sent
+    lv_area_t a = {50, 5, 69, 6};
+    lv_port_dflush_get_stats(&before);
+    st7789_model_reset_stats(&model);
+    size_t sent = lv_port_dflush_send(&a, red, true);
+    printf("  whole area: %llu pixels in %lu windows\n", (unsigned long long)model.stats.pixels,
+           (unsigned long)windows_since(&before));
+    if (sent != sizeof(red) || model.stats.pixels != 20 * 2 || windows_since(&before) != 1) fail("not sent whole");
+    if (st7789_model_pixel(&model, 50, 5) != 0xF800 || st7789_model_pixel(&model, 69, 6) != 0xF800) fail("not drawn");
+
+    // The next frame is the one hashed before the block; the partly covered
+    // segments have no hash any more and go out again, nothing else
+    lv_port_dflush_get_stats(&before);
+    uint64_t px = flush_frame();
+    expect("segments 0-1 of rows 5-6 again", px, 2 * 120, windows_since(&before), 1);
+    lv_port_dflush_get_stats(&before);
+    px = flush_frame();
+    expect("then nothing", px, 0, windows_since(&before), 0);
+}
+
+static void check_forget(void) {
+    lv_port_dflush_stats_t before;
+
+    // As lv_port_readback does for a bad segment: the redrawn area matches
+    // its hash and would not be sent without forgetting it
+    printf("forget a damaged area\n");
+    st7789_model_corrupt(&model, 130, 200, 1, 10, 0x0421);
+    uint64_t px = flush_frame();
+    if (px != 0 || wrong_pixels() != 10) fail("damage not left alone by a plain flush");
+    lv_area_t a = {130, 200, 130, 209};
+    lv_port_dflush_forget(&a);
+    lv_port_dflush_get_stats(&before);
+    px = flush_frame();
+    expect("segment 2 of rows 200-209", px, 10 * 60, windows_since(&before), 1);
+
+    printf("invalidate after writing outside the port\n");
+    st7789_model_corrupt(&model, 0, 0, W, H, 0x8000);
+    lv_port_dflush_invalidate();
+    lv_port_dflush_get_stats(&before);
+    px = flush_frame();
+    expect("all sent", px, W * H, windows_since(&before), H / BAND);
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    st7789_model_attach(&model, spi0, PIN_CS, PIN_DC);
+    st7789_init();
+    port_log_flush(0);
+
+    check_round();
+    check_diff();
+    check_unaligned();
+    check_forget();
+
+    return check_result();
+}
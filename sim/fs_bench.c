@@ -0,0 +1,253 @@
+// LittleFS partition on the host: builds and lists flash images for the
+// asset partition and benchmarks reads through port_lfs against plain
+// LittleFS reads and a raw copy of the flash.
+//
+//     gcc -O2 -DLV_PORT_FS=1 -Isim/hal -Iinc -Ilittlefs sim/fs_bench.c src/port_lfs.c src/port_log.c
+//         sim/hal/sim_hal.c littlefs/lfs.c littlefs/lfs_util.c -o fs_bench
+//     ./fs_bench fs.bin --add assets/*.bin   # Image for picotool, see README.md
+//     ./fs_bench fs.bin --list
+//     ./fs_bench fs.bin --bench
+//
+// The image holds the PORT_LFS_SIZE bytes of the partition; a missing file
+// is an erased partition, formatted on first use.
+//
+// Host MB/s only compares the code paths. The flash column models the
+// RP2040 side from the block device reads the pattern caused: each read
+// costs FLASH_CALL_NS (XIP transaction and LittleFS lookup) plus its bytes
+// at FLASH_MB_S, about the quad SPI rate with the flash clock at 125 MHz / 2.
+
+#include "port_lfs.h"
+#include "hardware/flash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_FILE      "/bench.bin"
+#define BENCH_FILE_SIZE (64u * 1024u)
+#define BENCH_MIN_NS    200000000ull // Host time per measurement
+#define FLASH_MB_S      30.0
+#define FLASH_CALL_NS   1500.0
+
+typedef struct {
+    const char *name;
+    uint32_t chunk;
+    bool random;
+} pattern_t;
+
+static const pattern_t patterns[] = {
+    {"4 B sequential", 4, false},           // Headers, font tables
+    {"32 B random", 32, true},              // Glyph bitmaps
+    {"480 B rows", 480, false},             // RGB565 image line by line
+    {"4 kB sequential", 4096, false},
+    {"whole file", BENCH_FILE_SIZE, false},
+};
+
+static uint8_t buf[BENCH_FILE_SIZE];
+
+static uint64_t host_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t lcg(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+// One pass over the file; returns a checksum so nothing is optimised away
+static uint32_t pass_port(const pattern_t *p) {
+    port_lfs_file_t *f = port_lfs_open(BENCH_FILE, LFS_O_RDONLY);
+    uint32_t sum = 0;
+    uint32_t rng = 1;
+    for (uint32_t done = 0; done < BENCH_FILE_SIZE; done += p->chunk) {
+        uint32_t n = BENCH_FILE_SIZE - done < p->chunk ? BENCH_FILE_SIZE - done : p->chunk;
+        if (p->random) port_lfs_seek(f, lcg(&rng) % (BENCH_FILE_SIZE - n));
+        port_lfs_read(f, buf, n);
+        sum += buf[0];
+    }
+    port_lfs_close(f);
+    return sum;
+}
+
+static uint32_t pass_lfs(const pattern_t *p) {
+    lfs_file_t file;
+    uint8_t cache[PORT_LFS_PROG];
+    struct lfs_file_config fcfg = {.buffer = cache};
+    lfs_file_opencfg(port_lfs(), &file, BENCH_FILE, LFS_O_RDONLY, &fcfg);
+    uint32_t sum = 0;
+    uint32_t rng = 1;
+    for (uint32_t done = 0; done < BENCH_FILE_SIZE; done += p->chunk) {
+        uint32_t n = BENCH_FILE_SIZE - done < p->chunk ? BENCH_FILE_SIZE - done : p->chunk;
+        if (p->random) lfs_file_seek(port_lfs(), &file, (lfs_soff_t)(lcg(&rng) % (BENCH_FILE_SIZE - n)), LFS_SEEK_SET);
+        lfs_file_read(port_lfs(), &file, buf, n);
+        sum += buf[0];
+    }
+    lfs_file_close(port_lfs(), &file);
+    return sum;
+}
+
+static uint32_t pass_raw(const pattern_t *p) {
+    (void)p;
+    memcpy(buf, (const void *)(XIP_NOCACHE_NOALLOC_BASE + PORT_LFS_OFFSET), BENCH_FILE_SIZE);
+    return buf[0];
+}
+
+static void measure(const char *method, const pattern_t *p, uint32_t (*pass)(const pattern_t *)) {
+    // Flash reads of a single pass
+    port_lfs_reset_stats();
+    pass(p);
+    port_lfs_stats_t s;
+    port_lfs_get_stats(&s);
+    if (pass == pass_raw) {
+        s.bd_reads = 1;
+        s.bd_read_bytes = BENCH_FILE_SIZE;
+    }
+
+    volatile uint32_t sink = 0;
+    uint32_t passes = 0;
+    uint64_t t0 = host_ns();
+    uint64_t dt;
+    do {
+        sink += pass(p);
+        passes++;
+        dt = host_ns() - t0;
+    } while (dt < BENCH_MIN_NS);
+    (void)sink;
+
+    double host_mb_s = (double)BENCH_FILE_SIZE * passes / dt * 1e3;
+    double flash_ns = s.bd_reads * FLASH_CALL_NS + s.bd_read_bytes * 1e3 / FLASH_MB_S;
+    printf("  %-16s %-7s %9.1f %8lu %9.2f %9.1f\n", p->name, method, host_mb_s, (unsigned long)s.bd_reads,
+           (double)s.bd_read_bytes / BENCH_FILE_SIZE, BENCH_FILE_SIZE * 1e3 / flash_ns);
+}
+
+static bool make_bench_file(void) {
+    uint32_t rng = 7;
+    for (uint32_t i = 0; i < BENCH_FILE_SIZE; i++) buf[i] = (uint8_t)lcg(&rng);
+    port_lfs_file_t *f = port_lfs_open(BENCH_FILE, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC);
+    if (!f) return false;
+    int32_t n = port_lfs_write(f, buf, BENCH_FILE_SIZE);
+    return port_lfs_close(f) == 0 && n == (int32_t)BENCH_FILE_SIZE;
+}
+
+// Checks that cached reads return what plain LittleFS reads return
+static bool verify(void) {
+    static uint8_t ref[BENCH_FILE_SIZE];
+    lfs_file_t file;
+    uint8_t cache[PORT_LFS_PROG];
+    struct lfs_file_config fcfg = {.buffer = cache};
+    lfs_file_opencfg(port_lfs(), &file, BENCH_FILE, LFS_O_RDONLY, &fcfg);
+    lfs_file_read(port_lfs(), &file, ref, BENCH_FILE_SIZE);
+    lfs_file_close(port_lfs(), &file);
+
+    port_lfs_file_t *f = port_lfs_open(BENCH_FILE, LFS_O_RDONLY);
+    uint32_t rng = 3;
+    bool ok = true;
+    for (uint32_t i = 0; i < 2000 && ok; i++) {
+        uint32_t len = 1 + lcg(&rng) % 5000;
+        uint32_t pos = lcg(&rng) % BENCH_FILE_SIZE;
+        port_lfs_seek(f, pos);
+        int32_t n = port_lfs_read(f, buf, len);
+        uint32_t expect = BENCH_FILE_SIZE - pos < len ? BENCH_FILE_SIZE - pos : len;
+        ok = n == (int32_t)expect && memcmp(buf, ref + pos, expect) == 0 && port_lfs_tell(f) == pos + expect;
+        if (!ok) printf("verify: read %lu at %lu returned %ld\n", (unsigned long)len, (unsigned long)pos, (long)n);
+    }
+    port_lfs_close(f);
+    return ok;
+}
+
+static int bench(void) {
+    if (!make_bench_file()) {
+        printf("can't write %s\n", BENCH_FILE);
+        return 1;
+    }
+    if (!verify()) return 1;
+
+    printf("Reads of a %lu kB file, read cache %u B, flash modelled at %.0f MB/s + %.1f us per read\n",
+           (unsigned long)(BENCH_FILE_SIZE / 1024), PORT_LFS_RA_SIZE, FLASH_MB_S, FLASH_CALL_NS / 1000);
+    printf("  %-16s %-7s %9s %8s %9s %9s\n", "pattern", "method", "host MB/s", "fl reads", "fl B/B", "fl MB/s");
+    for (uint32_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        measure("lfs", &patterns[i], pass_lfs);
+        measure("cached", &patterns[i], pass_port);
+    }
+    measure("raw", &patterns[4], pass_raw);
+    return lfs_remove(port_lfs(), BENCH_FILE) == 0 ? 0 : 1;
+}
+
+static int add_file(const char *path) {
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        printf("%s: can't open\n", path);
+        return 1;
+    }
+    const char *base = strrchr(path, '/');
+    char name[LFS_NAME_MAX + 2];
+    snprintf(name, sizeof(name), "/%s", base ? base + 1 : path);
+
+    port_lfs_file_t *f = port_lfs_open(name, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC);
+    int rc = f ? 0 : 1;
+    size_t n;
+    uint32_t total = 0;
+    while (f && (n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (port_lfs_write(f, buf, (uint32_t)n) != (int32_t)n) {
+            rc = 1;
+            break;
+        }
+        total += (uint32_t)n;
+    }
+    if (f && port_lfs_close(f) != 0) rc = 1;
+    fclose(in);
+    printf("%s %s (%lu bytes)\n", rc ? "failed:" : "added", name, (unsigned long)total);
+    return rc;
+}
+
+static void list(void) {
+    lfs_dir_t dir;
+    struct lfs_info info;
+    lfs_dir_open(port_lfs(), &dir, "/");
+    while (lfs_dir_read(port_lfs(), &dir, &info) > 0) {
+        if (info.type == LFS_TYPE_REG) printf("%8lu  %s\n", (unsigned long)info.size, info.name);
+    }
+    lfs_dir_close(port_lfs(), &dir);
+    lfs_ssize_t used = lfs_fs_size(port_lfs());
+    printf("%lu of %lu blocks used\n", (unsigned long)(used < 0 ? 0 : used),
+           (unsigned long)(PORT_LFS_SIZE / PORT_LFS_BLOCK));
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        printf("usage: %s IMAGE [--add FILE...] [--list] [--bench]\n", argv[0]);
+        return 2;
+    }
+    const char *image = argv[1];
+    if (!sim_flash_load(image, PORT_LFS_OFFSET, PORT_LFS_SIZE)) {
+        printf("%s: not a %lu-byte image\n", image, (unsigned long)PORT_LFS_SIZE);
+        return 1;
+    }
+    if (port_lfs_mount(true) != 0) return 1;
+
+    int rc = 0;
+    bool changed = false;
+    for (int i = 2; i < argc && rc == 0; i++) {
+        if (strcmp(argv[i], "--add") == 0) {
+            while (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                rc |= add_file(argv[++i]);
+                changed = true;
+            }
+        } else if (strcmp(argv[i], "--list") == 0) {
+            list();
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            rc |= bench(); // Leaves the image as it was
+        } else {
+            printf("unknown option %s\n", argv[i]);
+            rc = 2;
+        }
+    }
+    port_lfs_unmount();
+    if (changed && !sim_flash_save(image, PORT_LFS_OFFSET, PORT_LFS_SIZE)) {
+        printf("%s: can't write\n", image);
+        rc = 1;
+    }
+    return rc;
+}
@@ -0,0 +1,269 @@
+// Refresh-rate governor on the host: lv_port_gov.c with stand-ins for the
+// LVGL timers and animation count, in virtual time, on the panel model.
+// Scripted traces of invalidations (one per refresh, at the level's refresh
+// period), running animations and pen state are played 1 ms at a time.
+// Checks that a static screen and a small once-a-second update stay idle
+// with the window timer paused; that an animation raises the level after
+// one window, a pen-down or a screen load at once; that each comes back
+// down only after policy.idle_windows quiet windows, and bursts closer than
+// that don't make it flap; that at every level the refresh period and the
+// panel's FRCTRL2 rate are the policy's; that a new policy applies to the
+// current level at once; and that the stats add up.
+// Exits 1 on any mismatch. No LVGL.
+//
+//     gcc -O2 -DLV_PORT_REFRESH_GOV=1 -Isim/hal -Isim -Isim/nolvgl -Iinc -I. sim/gov_sim.c sim/st7789_model.c
+//         sim/sim_png.c sim/hal/sim_hal.c src/st7789.c src/spi_bus.c src/port_log.c src/lv_port_gov.c -o gov_sim
+
+#include "lv_port_gov.h"
+#include "st7789.h"
+#include "port_log.h"
+#include "st7789_model.h"
+#include "check.h"
+#include <stdio.h>
+
+#if !LV_PORT_REFRESH_GOV
+#error "build with -DLV_PORT_REFRESH_GOV=1, see above"
+#endif
+
+#define MAX_CHANGES 16
+
+static st7789_model_t panel;
+
+// --- LVGL stand-ins ---------------------------------------------------------
+
+static lv_timer_t refr_timer = {.period = LV_DISP_DEF_REFR_PERIOD};
+static lv_disp_t disp = {.refr_timer = &refr_timer};
+static lv_timer_t gov_timer; // The only one lv_port_gov creates
+static uint16_t anims;
+
+uint32_t lv_tick_get(void) {
+    return (uint32_t)(time_us_64() / 1000);
+}
+
+uint16_t lv_anim_count_running(void) {
+    return anims;
+}
+
+lv_timer_t *lv_timer_create(lv_timer_cb_t timer_cb, uint32_t period, void *user_data) {
+    gov_timer.timer_cb = timer_cb;
+    gov_timer.period = period;
+    gov_timer.user_data = user_data;
+    gov_timer.last_run = lv_tick_get();
+    return &gov_timer;
+}
+
+void lv_timer_set_cb(lv_timer_t *timer, lv_timer_cb_t timer_cb) {
+    timer->timer_cb = timer_cb;
+}
+
+void lv_timer_set_period(lv_timer_t *timer, uint32_t period) {
+    timer->period = period;
+}
+
+void lv_timer_reset(lv_timer_t *timer) {
+    timer->last_run = lv_tick_get();
+}
+
+void lv_timer_pause(lv_timer_t *timer) {
+    timer->paused = 1;
+}
+
+void lv_timer_resume(lv_timer_t *timer) {
+    timer->paused = 0;
+}
+
+void lv_timer_ready(lv_timer_t *timer) {
+    timer->last_run = lv_tick_get() - timer->period - 1;
+}
+
+uint32_t lv_timer_handler(void) {
+    if (gov_timer.timer_cb && !gov_timer.paused && lv_tick_get() - gov_timer.last_run >= gov_timer.period) {
+        gov_timer.last_run = lv_tick_get();
+        gov_timer.timer_cb(&gov_timer);
+    }
+    return 1;
+}
+
+// --- traces -----------------------------------------------------------------
+
+typedef struct {
+    uint32_t ms;
+    uint16_t anims;  // Running
+    bool pressed;    // Pen state, read every LV_INDEV_DEF_READ_PERIOD
+    uint32_t px;     // Invalidated per refresh, 0: nothing redrawn
+    uint32_t px_at;  // Invalidated once at the start, a screen load
+} segment_t;
+
+typedef struct {
+    uint32_t at_ms;  // From the start of the trace
+    lv_port_gov_level_t level;
+} change_t;
+
+static change_t changes[MAX_CHANGES];
+static uint32_t n_changes;
+
+static void invalidate(uint32_t px) {
+    lv_coord_t w = (lv_coord_t)(px < ST7789_WIDTH ? px : ST7789_WIDTH);
+    lv_area_t area = {0, 0, (lv_coord_t)(w - 1), (lv_coord_t)(px / w - 1)};
+    lv_port_gov_invalidate(&area);
+}
+
+// The refresh period and the panel rate of the level, FRCTRL2 read back as
+// fps = 10 MHz / ((320 + 24) * (250 + 16 * RTNA))
+static void check_rates(lv_port_gov_level_t level) {
+    lv_port_gov_policy_t p;
+    lv_port_gov_get_policy(&p);
+    const lv_port_gov_rate_t *r = &p.rate[level];
+    uint32_t fps = 10000000u / (344u * (250u + 16u * (panel.frctrl2 & 0x1F)));
+    if (refr_timer.period != r->refr_period_ms) fail("refresh period not the level's");
+    if (fps * 100 < r->panel_hz * 95u || fps * 100 > r->panel_hz * 105u) {
+        printf("  panel at %lu Hz, %u expected\n", (unsigned long)fps, r->panel_hz);
+        errors++;
+    }
+}
+
+static void play(const char *name, const segment_t *seg, uint32_t count) {
+    lv_port_gov_level_t level = lv_port_gov_get_level();
+    uint32_t t = 0;
+    n_changes = 0;
+
+    for (uint32_t i = 0; i < count; i++, seg++) {
+        uint32_t next_refr = t, next_read = t;
+        if (seg->px_at) invalidate(seg->px_at);
+        for (uint32_t end = t + seg->ms; t < end; t++) {
+            anims = seg->anims;
+            if (seg->px && t >= next_refr) {
+                invalidate(seg->px);
+                next_refr = t + refr_timer.period;
+            }
+            if (t >= next_read) {
+                lv_port_gov_input(seg->pressed);
+                next_read = t + LV_INDEV_DEF_READ_PERIOD;
+            }
+            lv_timer_handler();
+            port_log_flush(0);
+
+            if (lv_port_gov_get_level() != level) {
+                level = lv_port_gov_get_level();
+                if (n_changes < MAX_CHANGES) changes[n_changes++] = (change_t){t, level};
+                check_rates(level);
+            }
+            sleep_ms(1);
+        }
+    }
+    anims = 0;
+
+    printf("%-14s", name);
+    for (uint32_t i = 0; i < n_changes; i++) {
+        printf(" %s at %lu ms", changes[i].level == GOV_LEVEL_ACTIVE ? "up" : "down",
+               (unsigned long)changes[i].at_ms);
+    }
+    printf(n_changes ? "\n" : " no change\n");
+}
+
+// One transition up in [up_from, up_to] and back down in [down_from, down_to]
+static void expect_up_down(uint32_t up_from, uint32_t up_to, uint32_t down_from, uint32_t down_to) {
+    if (n_changes != 2) {
+        printf("  %lu transitions, 2 expected\n", (unsigned long)n_changes);
+        errors++;
+        return;
+    }
+    if (changes[0].level != GOV_LEVEL_ACTIVE || changes[0].at_ms < up_from || changes[0].at_ms > up_to) {
+        printf("  up at %lu ms, expected in %lu..%lu\n", (unsigned long)changes[0].at_ms, (unsigned long)up_from,
+               (unsigned long)up_to);
+        errors++;
+    }
+    if (changes[1].level != GOV_LEVEL_IDLE || changes[1].at_ms < down_from || changes[1].at_ms > down_to) {
+        printf("  down at %lu ms, expected in %lu..%lu\n", (unsigned long)changes[1].at_ms,
+               (unsigned long)down_from, (unsigned long)down_to);
+        errors++;
+    }
+}
+
+// Back at the idle level, or never left it
+static void expect_idle(bool changed) {
+    if (!changed && n_changes) fail("level changed");
+    if (lv_port_gov_get_level() != GOV_LEVEL_IDLE) fail("not idle");
+    if (!gov_timer.paused) fail("window timer running while idle");
+    check_rates(GOV_LEVEL_IDLE);
+}
+
+int main(void) {
+    lv_port_gov_policy_t p;
+    lv_port_gov_get_policy(&p);
+    // Quiet windows end the active level from the window the activity
+    // stopped in
+    uint32_t down = p.idle_windows * GOV_WINDOW_MS;
+
+    st7789_model_attach(&panel, SPI_PORT, PIN_CS, PIN_DC);
+    st7789_init();
+    port_log_flush(0);
+    lv_port_gov_init(&disp);
+    uint32_t start_ms = lv_tick_get();
+
+    static const segment_t still[] = {{2000}};
+    play("static", still, 1);
+    expect_idle(false);
+
+    // A clock: 40 x 10 px once a second
+    static const segment_t clock[] = {{1, 0, false, 0, 400}, {999}, {1, 0, false, 0, 400}, {999}, {1, 0, false, 0, 400},
+                                      {999}};
+    play("clock", clock, 6);
+    expect_idle(false);
+
+    // An animation redrawing 400 px per frame: picked up at the end of the
+    // window its first frame started
+    static const segment_t anim[] = {{600, 1, false, 400}, {2000}};
+    play("animation", anim, 2);
+    expect_up_down(GOV_WINDOW_MS - 1, GOV_WINDOW_MS + 1, 600 + down - GOV_WINDOW_MS, 600 + down + GOV_WINDOW_MS);
+    expect_idle(true);
+
+    // A tap redrawing a button: up on the pen-down, before any window
+    static const segment_t tap[] = {{300, 0, true, 3000}, {2000}};
+    play("tap", tap, 2);
+    expect_up_down(0, 0, 300 + down - GOV_WINDOW_MS, 300 + down + GOV_WINDOW_MS);
+    expect_idle(true);
+
+    // A new screen: a full-screen invalidation is taken at once
+    static const segment_t load[] = {{1, 0, false, 0, ST7789_WIDTH * ST7789_HEIGHT}, {2000}};
+    play("screen load", load, 2);
+    expect_up_down(0, 0, down - GOV_WINDOW_MS, down + GOV_WINDOW_MS);
+    expect_idle(true);
+
+    // Taps every 600 ms, less than the hysteresis apart: no flapping
+    static const segment_t bursts[] = {{100, 0, true, 3000}, {500}, {100, 0, true, 3000}, {500},
+                                       {100, 0, true, 3000}, {500}, {100, 0, true, 3000}, {2000}};
+    play("bursts", bursts, 8);
+    expect_up_down(0, 0, 1900 + down - GOV_WINDOW_MS, 1900 + down + GOV_WINDOW_MS);
+    expect_idle(true);
+
+    lv_port_gov_stats_t s;
+    lv_port_gov_get_stats(&s);
+    if (s.transitions != 8) fail("transitions not counted");
+    if (s.ms_in[GOV_LEVEL_IDLE] + s.ms_in[GOV_LEVEL_ACTIVE] != lv_tick_get() - start_ms) {
+        fail("time per level doesn't add up");
+    }
+    printf("%lu transitions, %lu ms idle, %lu ms active\n", (unsigned long)s.transitions,
+           (unsigned long)s.ms_in[GOV_LEVEL_IDLE], (unsigned long)s.ms_in[GOV_LEVEL_ACTIVE]);
+
+    // Another policy: its idle rates at once, animations ignored, a shorter
+    // hysteresis
+    p = (lv_port_gov_policy_t){
+        .rate = {[GOV_LEVEL_IDLE] = {100, 39}, [GOV_LEVEL_ACTIVE] = {10, 100}},
+        .active_px = 2000,
+        .idle_windows = 3,
+        .anim_is_active = false,
+    };
+    lv_port_gov_set_policy(&p);
+    check_rates(GOV_LEVEL_IDLE);
+    down = p.idle_windows * GOV_WINDOW_MS;
+
+    play("animation", anim, 2);
+    expect_idle(false);
+
+    play("tap", tap, 2);
+    expect_up_down(0, 0, 300 + down - GOV_WINDOW_MS, 300 + down + GOV_WINDOW_MS);
+    expect_idle(true);
+
+    return check_result();
+}
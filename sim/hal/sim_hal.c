@@ -0,0 +1,655 @@
+#include "sim_hal.h"
+#include <stdio.h>
+#include <string.h>
+
+// --- platform ---------------------------------------------------------------
+
+uint sim_core_num;
+
+// --- time and interrupts ----------------------------------------------------
+
+static uint64_t now_ns;
+static uint32_t irq_off_depth; // save_and_disable_interrupts nesting
+static bool in_irq;
+static bool irq_pending[SIM_IRQ_COUNT];
+static bool irq_enabled[SIM_IRQ_COUNT];
+
+#define MAX_IRQ_HANDLERS 4
+static irq_handler_t irq_handlers[SIM_IRQ_COUNT][MAX_IRQ_HANDLERS];
+
+static repeating_timer_t *timers; // Active repeating timers, unordered
+static bool event_fired;          // For best_effort_wfe_or_timeout
+
+static int next_dma_done(uint64_t until_ns);
+static void run_dma_handlers(uint num);
+static uint64_t dma_done_ns(uint channel);
+static void dma_done(uint channel);
+
+uint64_t sim_now_ns(void) {
+    return now_ns;
+}
+
+static void run_handlers(uint num) {
+    in_irq = true;
+    for (uint i = 0; i < MAX_IRQ_HANDLERS && irq_handlers[num][i]; i++) {
+        irq_handlers[num][i]();
+    }
+    in_irq = false;
+}
+
+static void run_pending_irqs(void) {
+    if (in_irq || irq_off_depth) return;
+    for (uint num = 0; num < SIM_IRQ_COUNT; num++) {
+        if (!irq_pending[num] || !irq_enabled[num]) continue;
+        irq_pending[num] = false;
+        if (num == DMA_IRQ_0 || num == DMA_IRQ_1) {
+            run_dma_handlers(num);
+        } else {
+            run_handlers(num);
+        }
+        event_fired = true;
+    }
+}
+
+void sim_raise_irq(uint num) {
+    irq_pending[num] = true;
+    run_pending_irqs();
+}
+
+static repeating_timer_t *next_due_timer(uint64_t until_us) {
+    repeating_timer_t *due = NULL;
+    for (repeating_timer_t *t = timers; t; t = t->next) {
+        if (t->active && t->next_us <= until_us && (!due || t->next_us < due->next_us)) due = t;
+    }
+    return due;
+}
+
+static void unlink_timer(repeating_timer_t *timer) {
+    for (repeating_timer_t **pp = &timers; *pp; pp = &(*pp)->next) {
+        if (*pp == timer) {
+            *pp = timer->next;
+            return;
+        }
+    }
+}
+
+// Timer callbacks run as the alarm IRQ would: not nested in another IRQ and
+// not while interrupts are off (they then run late, at the next advance).
+// Runs at most max of them; returns how many ran.
+static uint32_t run_due_timers(uint64_t until_us, uint32_t max) {
+    if (in_irq || irq_off_depth) return 0;
+    repeating_timer_t *t;
+    uint32_t ran = 0;
+    while (ran < max && (t = next_due_timer(until_us)) != NULL) {
+        ran++;
+        uint64_t due_ns = t->next_us * 1000;
+        if (due_ns > now_ns) now_ns = due_ns;
+        in_irq = true;
+        bool again = t->callback(t);
+        in_irq = false;
+        event_fired = true;
+        if (again && t->active) {
+            uint64_t period = (uint64_t)(t->delay_us < 0 ? -t->delay_us : t->delay_us);
+            t->next_us = (t->delay_us < 0 ? now_ns / 1000 : t->next_us) + (period ? period : 1);
+        } else {
+            t->active = false;
+            unlink_timer(t);
+        }
+        run_pending_irqs();
+    }
+    return ran;
+}
+
+// Timers and DMA ends in the order they are due. A timer or its IRQ may
+// start a DMA transfer that ends before the next one, so they go one by one.
+void sim_advance_ns(uint64_t ns) {
+    uint64_t end = now_ns + ns;
+    for (;;) {
+        int ch = next_dma_done(end);
+        uint64_t until = ch < 0 ? end : dma_done_ns(ch);
+        if (run_due_timers(until / 1000, 1)) continue;
+        if (ch < 0) break;
+        if (until > now_ns) now_ns = until;
+        dma_done(ch);
+    }
+    if (end > now_ns) now_ns = end;
+    run_pending_irqs();
+}
+
+void sim_advance_to_us(uint64_t t_us) {
+    if (t_us * 1000 > now_ns) sim_advance_ns(t_us * 1000 - now_ns);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout) {
+    event_fired = false;
+    while (!event_fired && time_us_64() < timeout) {
+        repeating_timer_t *t = next_due_timer(timeout);
+        uint64_t next = t ? t->next_us : timeout;
+        int ch = next_dma_done(next * 1000);
+        if (ch >= 0) next = (dma_done_ns(ch) + 999) / 1000;
+        sim_advance_to_us(next);
+    }
+    return time_us_64() >= timeout;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t cb, void *user_data,
+                            repeating_timer_t *out) {
+    uint64_t period = (uint64_t)(delay_us < 0 ? -delay_us : delay_us);
+    out->delay_us = delay_us;
+    out->next_us = time_us_64() + (period ? period : 1);
+    out->callback = cb;
+    out->user_data = user_data;
+    if (!out->active) {
+        out->next = timers;
+        timers = out;
+    }
+    out->active = true;
+    return true;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer) {
+    if (!timer->active) return false;
+    timer->active = false;
+    unlink_timer(timer);
+    return true;
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    return irq_off_depth++;
+}
+
+void restore_interrupts(uint32_t status) {
+    irq_off_depth = status;
+    if (irq_off_depth == 0) {
+        run_due_timers(now_ns / 1000, UINT32_MAX);
+        run_pending_irqs();
+    }
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    irq_enabled[num] = enabled;
+    if (enabled) run_pending_irqs();
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    memset(irq_handlers[num], 0, sizeof(irq_handlers[num]));
+    irq_handlers[num][0] = handler;
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority) {
+    (void)order_priority;
+    for (uint i = 0; i < MAX_IRQ_HANDLERS; i++) {
+        if (!irq_handlers[num][i]) {
+            irq_handlers[num][i] = handler;
+            return;
+        }
+    }
+    fprintf(stderr, "sim: too many handlers on IRQ %u\n", num);
+}
+
+// --- gpio -------------------------------------------------------------------
+
+static struct {
+    bool out;
+    bool level;
+    bool driven;      // Level set by a model
+    bool pull_up;
+    uint32_t irq_mask;
+    uint32_t events;
+    sim_gpio_watch_t watch;
+    void *watch_ctx;
+} pins[NUM_BANK0_GPIOS];
+static irq_handler_t gpio_raw_handlers[NUM_BANK0_GPIOS];
+
+void gpio_init(uint pin) {
+    pins[pin].out = false;
+    if (!pins[pin].driven) pins[pin].level = false;
+}
+
+void gpio_set_dir(uint pin, bool out) {
+    pins[pin].out = out;
+}
+
+void gpio_put(uint pin, bool value) {
+    pins[pin].level = value;
+    if (pins[pin].watch) pins[pin].watch(pins[pin].watch_ctx, pin, value);
+}
+
+bool gpio_get(uint pin) {
+    return pins[pin].level;
+}
+
+void gpio_pull_up(uint pin) {
+    pins[pin].pull_up = true;
+    if (!pins[pin].driven && !pins[pin].out) pins[pin].level = true;
+}
+
+void gpio_set_function(uint pin, enum gpio_function fn) {
+    (void)pin;
+    (void)fn;
+}
+
+void gpio_set_irq_enabled(uint pin, uint32_t events, bool enabled) {
+    if (enabled) {
+        pins[pin].irq_mask |= events;
+    } else {
+        pins[pin].irq_mask &= ~events;
+    }
+}
+
+static void gpio_bank_irq(void);
+
+void gpio_add_raw_irq_handler(uint pin, irq_handler_t handler) {
+    static bool bank_handler_added;
+    if (!bank_handler_added) {
+        irq_add_shared_handler(IO_IRQ_BANK0, gpio_bank_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        bank_handler_added = true;
+    }
+    gpio_raw_handlers[pin] = handler;
+}
+
+uint32_t gpio_get_irq_event_mask(uint pin) {
+    return pins[pin].events & pins[pin].irq_mask;
+}
+
+void gpio_acknowledge_irq(uint pin, uint32_t events) {
+    pins[pin].events &= ~events;
+}
+
+static void gpio_bank_irq(void) {
+    for (uint pin = 0; pin < NUM_BANK0_GPIOS; pin++) {
+        if ((pins[pin].events & pins[pin].irq_mask) && gpio_raw_handlers[pin]) gpio_raw_handlers[pin]();
+    }
+}
+
+void sim_gpio_drive(uint pin, bool value) {
+    bool old = pins[pin].level;
+    pins[pin].driven = true;
+    pins[pin].level = value;
+    if (old == value) return;
+    uint32_t ev = value ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    if (pins[pin].irq_mask & ev) {
+        pins[pin].events |= ev;
+        sim_raise_irq(IO_IRQ_BANK0);
+    }
+}
+
+void sim_gpio_watch(uint pin, sim_gpio_watch_t cb, void *ctx) {
+    pins[pin].watch = cb;
+    pins[pin].watch_ctx = ctx;
+}
+
+// --- spi --------------------------------------------------------------------
+
+spi_inst_t sim_spi[2] = {{.index = 0}, {.index = 1}};
+
+#define MAX_SPI_DEVICES 4
+static struct {
+    uint cs_pin;
+    sim_spi_xfer_t xfer;
+    void *ctx;
+} spi_devices[2][MAX_SPI_DEVICES];
+static uint spi_device_count[2];
+static sim_spi_stats_t spi_stats[2];
+static uint64_t spi_dma_until_ns[2]; // End of the DMA transfer clocking out
+
+uint32_t sim_clk_peri_hz = 125000000u;
+
+// The divider search of pico-sdk's spi_set_baudrate
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate) {
+    uint32_t peri_hz = sim_clk_peri_hz;
+    uint32_t prescale, postdiv;
+    for (prescale = 2; prescale <= 254; prescale += 2) {
+        if (peri_hz < (prescale + 2) * 256 * (uint64_t)baudrate) break;
+    }
+    for (postdiv = 256; postdiv > 1; --postdiv) {
+        if (peri_hz / (prescale * (postdiv - 1)) > baudrate) break;
+    }
+    spi_stats[spi->index].baud = peri_hz / (prescale * postdiv);
+    return spi_stats[spi->index].baud;
+}
+
+uint spi_init(spi_inst_t *spi, uint baudrate) {
+    return spi_set_baudrate(spi, baudrate);
+}
+
+void sim_spi_attach(spi_inst_t *spi, uint cs_pin, sim_spi_xfer_t xfer, void *ctx) {
+    uint i = spi_device_count[spi->index]++;
+    spi_devices[spi->index][i].cs_pin = cs_pin;
+    spi_devices[spi->index][i].xfer = xfer;
+    spi_devices[spi->index][i].ctx = ctx;
+}
+
+// Hands the byte to the selected devices and returns how long it takes
+static uint64_t spi_shift_byte(spi_inst_t *spi, uint8_t mosi, uint8_t *miso) {
+    uint idx = spi->index;
+    *miso = 0xFF;
+    for (uint i = 0; i < spi_device_count[idx]; i++) {
+        if (!gpio_get(spi_devices[idx][i].cs_pin)) *miso = spi_devices[idx][i].xfer(spi_devices[idx][i].ctx, mosi);
+    }
+    uint64_t ns = 8ull * 1000000000ull / (spi_stats[idx].baud ? spi_stats[idx].baud : 1);
+    spi_stats[idx].bytes++;
+    spi_stats[idx].clocks += 8;
+    spi_stats[idx].busy_ns += ns;
+    return ns;
+}
+
+// A byte from the CPU
+static uint8_t spi_clock_byte(spi_inst_t *spi, uint8_t mosi) {
+    uint8_t miso;
+    if (spi_dma_until_ns[spi->index] > now_ns) spi_stats[spi->index].collisions++;
+    now_ns += spi_shift_byte(spi, mosi, &miso); // Timers fire between calls, not mid-byte
+    return miso;
+}
+
+bool spi_is_busy(const spi_inst_t *spi) {
+    return spi_dma_until_ns[spi->index] > now_ns;
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        spi_clock_byte(spi, src[i]);
+    }
+    sim_advance_ns(0);
+    return (int)len;
+}
+
+int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = spi_clock_byte(spi, src[i]);
+    }
+    sim_advance_ns(0);
+    return (int)len;
+}
+
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = spi_clock_byte(spi, repeated_tx_data);
+    }
+    sim_advance_ns(0);
+    return (int)len;
+}
+
+void sim_spi_get_stats(uint index, sim_spi_stats_t *stats) {
+    *stats = spi_stats[index];
+}
+
+void sim_spi_reset_stats(void) {
+    for (uint i = 0; i < 2; i++) {
+        uint32_t baud = spi_stats[i].baud;
+        memset(&spi_stats[i], 0, sizeof(spi_stats[i]));
+        spi_stats[i].baud = baud;
+    }
+}
+
+// --- dma --------------------------------------------------------------------
+
+#define NUM_DMA_CHANNELS 12
+
+#define CFG_SIZE(c)     ((c)->ctrl & 3)
+#define CFG_READ_INC    (1u << 2)
+#define CFG_WRITE_INC   (1u << 3)
+#define CFG_TREQ_SHIFT  15
+#define CFG_TREQ(c)     (((c)->ctrl >> CFG_TREQ_SHIFT) & 0x3F)
+#define TREQ_PERMANENT  0x3F
+#define DREQ_PWM_WRAP0  24
+
+static dma_hw_t dma_regs;
+dma_hw_t *const dma_hw = &dma_regs;
+
+static struct {
+    bool claimed;
+    dma_channel_config cfg;
+    volatile void *write_addr;
+    bool irq0, irq1;
+    bool running;    // To an SPI, until done_ns; paced, until the next beat at done_ns
+    uint64_t done_ns;
+    const volatile uint8_t *src; // Paced: next item, items left and time between them
+    uint32_t left;
+    uint64_t beat_ns;
+} dma_ch[NUM_DMA_CHANNELS];
+
+static uint64_t dma_done_ns(uint channel) {
+    return dma_ch[channel].done_ns;
+}
+
+// The running transfer that ends first, by until_ns; -1: none
+static int next_dma_done(uint64_t until_ns) {
+    int next = -1;
+    for (int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (dma_ch[ch].running && dma_ch[ch].done_ns <= until_ns &&
+            (next < 0 || dma_ch[ch].done_ns < dma_ch[next].done_ns)) {
+            next = ch;
+        }
+    }
+    return next;
+}
+
+// INTS0/INTS1 are write-1-to-clear on the chip, a plain store here. The
+// handlers see one channel's bit at a time and the bit is cleared after
+// them, so an acknowledge of one channel can't wipe another's.
+static uint32_t dma_ints_pending[2];
+
+static void run_dma_handlers(uint num) {
+    volatile uint32_t *ints = num == DMA_IRQ_0 ? &dma_regs.ints0 : &dma_regs.ints1;
+    uint32_t *pending = &dma_ints_pending[num == DMA_IRQ_1];
+    while (*pending) {
+        uint32_t bit = *pending & -*pending;
+        *pending &= ~bit;
+        *ints = bit;
+        run_handlers(num);
+        *ints = 0;
+    }
+}
+
+static void dma_write(uint channel, const volatile uint8_t *src);
+
+static void dma_done(uint channel) {
+    if (dma_ch[channel].left) {
+        // A paced transfer: one item per beat, done after the last
+        dma_write(channel, dma_ch[channel].src);
+        if (dma_ch[channel].cfg.ctrl & CFG_READ_INC) dma_ch[channel].src += 1u << CFG_SIZE(&dma_ch[channel].cfg);
+        if (--dma_ch[channel].left) {
+            dma_ch[channel].done_ns += dma_ch[channel].beat_ns;
+            return;
+        }
+    }
+    dma_ch[channel].running = false;
+    if (dma_ch[channel].irq0) {
+        dma_ints_pending[0] |= 1u << channel;
+        sim_raise_irq(DMA_IRQ_0);
+    }
+    if (dma_ch[channel].irq1) {
+        dma_ints_pending[1] |= 1u << channel;
+        sim_raise_irq(DMA_IRQ_1);
+    }
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (!dma_ch[ch].claimed) {
+            dma_ch[ch].claimed = true;
+            return ch;
+        }
+    }
+    if (required) fprintf(stderr, "sim: no free DMA channel\n");
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    dma_channel_config c = {CFG_READ_INC | DMA_SIZE_32 | TREQ_PERMANENT << CFG_TREQ_SHIFT};
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    c->ctrl = (c->ctrl & ~3u) | size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    c->ctrl = incr ? c->ctrl | CFG_READ_INC : c->ctrl & ~CFG_READ_INC;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    c->ctrl = incr ? c->ctrl | CFG_WRITE_INC : c->ctrl & ~CFG_WRITE_INC;
+}
+
+// Only PWM wraps pace a transfer; one to an SPI goes at the SPI rate
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+    c->ctrl = (c->ctrl & ~(0x3Fu << CFG_TREQ_SHIFT)) | (dreq & 0x3F) << CFG_TREQ_SHIFT;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger) {
+    dma_ch[channel].cfg = *config;
+    dma_ch[channel].write_addr = write_addr;
+    if (trigger) dma_channel_transfer_from_buffer_now(channel, read_addr, transfer_count);
+}
+
+static spi_inst_t *spi_of_dr(volatile void *addr) {
+    for (uint i = 0; i < 2; i++) {
+        if (addr == &sim_spi[i].hw.dr) return &sim_spi[i];
+    }
+    return NULL;
+}
+
+// One item to a peripheral or memory
+static void dma_write(uint channel, const volatile uint8_t *src) {
+    uint32_t size = 1u << CFG_SIZE(&dma_ch[channel].cfg);
+    uint32_t v = 0;
+    memcpy(&v, (const void *)src, size);
+    if (size == 2) {
+        // Narrow writes to a peripheral are replicated across the word
+        *(volatile uint32_t *)dma_ch[channel].write_addr = v | (v << 16);
+    } else {
+        memcpy((void *)dma_ch[channel].write_addr, &v, size);
+    }
+}
+
+// Wrap period of a PWM slice, (top + 1) * div / clk_sys
+static uint64_t pwm_wrap_ns(uint slice) {
+    uint64_t div16 = pwm_hw->slice[slice].div ? pwm_hw->slice[slice].div : 16;
+    return ((uint64_t)pwm_hw->slice[slice].top + 1) * div16 * 1000000000u / 16 / clock_get_hz(clk_sys);
+}
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t count) {
+    const dma_channel_config *c = &dma_ch[channel].cfg;
+    uint32_t size = 1u << CFG_SIZE(c);
+    const volatile uint8_t *src = read_addr;
+    spi_inst_t *spi = spi_of_dr(dma_ch[channel].write_addr);
+    uint64_t ns = 0;
+
+    uint treq = CFG_TREQ(c);
+    if (!spi && count && treq >= DREQ_PWM_WRAP0 && treq < DREQ_PWM_WRAP0 + 8) {
+        // The first item goes at the slice's next wrap, taken as a full period away
+        dma_ch[channel].src = src;
+        dma_ch[channel].left = count;
+        dma_ch[channel].beat_ns = pwm_wrap_ns(treq - DREQ_PWM_WRAP0);
+        dma_ch[channel].done_ns = now_ns + dma_ch[channel].beat_ns;
+        dma_ch[channel].running = true;
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (spi) {
+            uint8_t miso;
+            ns += spi_shift_byte(spi, *src, &miso);
+        } else {
+            dma_write(channel, src);
+        }
+        if (c->ctrl & CFG_READ_INC) src += size;
+    }
+
+    if (spi) {
+        // Clocks out after anything still in flight on this SPI
+        uint64_t *until = &spi_dma_until_ns[spi->index];
+        *until = (*until > now_ns ? *until : now_ns) + ns;
+        dma_ch[channel].done_ns = *until;
+        dma_ch[channel].running = true;
+        return;
+    }
+    dma_done(channel);
+}
+
+void dma_channel_abort(uint channel) {
+    dma_ch[channel].running = false;
+    dma_ch[channel].left = 0;
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) {
+    dma_ch[channel].irq0 = enabled;
+}
+
+void dma_channel_set_irq1_enabled(uint channel, bool enabled) {
+    dma_ch[channel].irq1 = enabled;
+}
+
+// --- pwm --------------------------------------------------------------------
+
+static pwm_hw_t pwm_regs;
+pwm_hw_t *const pwm_hw = &pwm_regs;
+
+void pwm_init(uint slice, pwm_config *c, bool start) {
+    (void)start;
+    pwm_regs.slice[slice].div = c->div;
+    pwm_regs.slice[slice].top = c->top;
+}
+
+void pwm_set_gpio_level(uint pin, uint16_t level) {
+    volatile uint32_t *cc = &pwm_regs.slice[pwm_gpio_to_slice_num(pin)].cc;
+    if (pwm_gpio_to_channel(pin)) {
+        *cc = (*cc & 0xFFFF) | ((uint32_t)level << 16);
+    } else {
+        *cc = (*cc & 0xFFFF0000u) | level;
+    }
+}
+
+
+// --- flash ------------------------------------------------------------------
+
+#define SIM_FLASH_ERASE_NS   45000000u // Per 4 kB sector
+#define SIM_FLASH_PROGRAM_NS 400000u   // Per 256-byte page
+
+uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    if (flash_offs % FLASH_SECTOR_SIZE || count % FLASH_SECTOR_SIZE || flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        fprintf(stderr, "sim: bad flash erase %08x +%zu\n", (unsigned)flash_offs, count);
+        return;
+    }
+    memset(sim_flash + flash_offs, 0xFF, count);
+    sim_advance_ns((uint64_t)(count / FLASH_SECTOR_SIZE) * SIM_FLASH_ERASE_NS);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+    if (flash_offs % FLASH_PAGE_SIZE || count % FLASH_PAGE_SIZE || flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        fprintf(stderr, "sim: bad flash program %08x +%zu\n", (unsigned)flash_offs, count);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) sim_flash[flash_offs + i] &= data[i];
+    sim_advance_ns((uint64_t)(count / FLASH_PAGE_SIZE) * SIM_FLASH_PROGRAM_NS);
+}
+
+bool sim_flash_load(const char *path, uint32_t offset, uint32_t size) {
+    memset(sim_flash + offset, 0xFF, size);
+    FILE *f = fopen(path, "rb");
+    if (!f) return true;
+    size_t n = fread(sim_flash + offset, 1, size, f);
+    fclose(f);
+    return n == size;
+}
+
+bool sim_flash_save(const char *path, uint32_t offset, uint32_t size) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    size_t n = fwrite(sim_flash + offset, 1, size, f);
+    return fclose(f) == 0 && n == size;
+}
+
+// --- stdio ------------------------------------------------------------------
+
+FILE *sim_raw_out;
+
+int putchar_raw(int c) {
+    return fputc(c, sim_raw_out ? sim_raw_out : stdout);
+}
@@ -0,0 +1,296 @@
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+// Stand-in for the parts of pico-sdk the drivers and ports use, for the host
+// simulator build (see "Host simulator" in README.md).
+// Everything runs on one thread in virtual time: SPI bytes, sleeps and busy
+// waits advance the clock, repeating timers, GPIO edges and the end of DMA
+// transfers to an SPI call their handlers from sim_advance_ns() when
+// interrupts are enabled. DMA to an SPI hands the bytes to the device at
+// once but takes their time on that SPI in the background, so transfers on
+// two SPIs overlap. DMA paced by a PWM slice's wrap writes one item per wrap
+// period of that slice; other DMA transfers complete at once.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned int uint;
+
+// --- platform ---------------------------------------------------------------
+
+#define NUM_CORES 2
+#define __not_in_flash_func(func) func
+#define __time_critical_func(func) func
+
+extern uint sim_core_num; // What get_core_num() returns, 0 unless a test plays core1
+static inline uint get_core_num(void) { return sim_core_num; }
+static inline void __dmb(void) {}
+static inline void __sev(void) {}
+static inline void __wfe(void) {}
+static inline void __wfi(void) {}
+
+// --- time -------------------------------------------------------------------
+
+typedef uint64_t absolute_time_t;
+
+uint64_t sim_now_ns(void);
+void sim_advance_ns(uint64_t ns); // Fires due timers/edges unless in an IRQ or with IRQs off
+void sim_advance_to_us(uint64_t t_us);
+
+static inline uint64_t time_us_64(void) { return sim_now_ns() / 1000; }
+static inline uint32_t time_us_32(void) { return (uint32_t)time_us_64(); }
+static inline absolute_time_t get_absolute_time(void) { return time_us_64(); }
+static inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000); }
+static inline uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+static inline absolute_time_t from_us_since_boot(uint64_t us) { return us; }
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) { return t + us; }
+static inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) { return t + (uint64_t)ms * 1000; }
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) { return time_us_64() + (uint64_t)ms * 1000; }
+static inline absolute_time_t make_timeout_time_us(uint64_t us) { return time_us_64() + us; }
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) { return (int64_t)(to - from); }
+static inline bool time_reached(absolute_time_t t) { return time_us_64() >= t; }
+
+static inline void sleep_until(absolute_time_t t) { if (t > time_us_64()) sim_advance_to_us(t); }
+static inline void sleep_us(uint64_t us) { sim_advance_ns(us * 1000); }
+static inline void sleep_ms(uint32_t ms) { sim_advance_ns((uint64_t)ms * 1000000); }
+static inline void busy_wait_us_32(uint32_t us) { sim_advance_ns((uint64_t)us * 1000); }
+static inline void busy_wait_us(uint64_t us) { sim_advance_ns(us * 1000); }
+static inline void tight_loop_contents(void) { sim_advance_ns(100); }
+
+// Returns at the timeout or after the next timer/edge fired
+bool best_effort_wfe_or_timeout(absolute_time_t timeout);
+
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+struct repeating_timer {
+    int64_t delay_us;
+    uint64_t next_us;
+    repeating_timer_callback_t callback;
+    void *user_data;
+    bool active;
+    repeating_timer_t *next;
+};
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t cb, void *user_data, repeating_timer_t *out);
+static inline bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t cb, void *user_data,
+                                          repeating_timer_t *out) {
+    return add_repeating_timer_us((int64_t)delay_ms * 1000, cb, user_data, out);
+}
+bool cancel_repeating_timer(repeating_timer_t *timer);
+
+// --- sync -------------------------------------------------------------------
+
+typedef volatile uint32_t spin_lock_t;
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+static inline uint spin_lock_claim_unused(bool required) { (void)required; return 0; }
+static inline spin_lock_t *spin_lock_init(uint n) { static spin_lock_t locks[32]; return &locks[n & 31]; }
+static inline uint32_t spin_lock_blocking(spin_lock_t *lock) { (void)lock; return save_and_disable_interrupts(); }
+static inline void spin_unlock(spin_lock_t *lock, uint32_t saved) { (void)lock; restore_interrupts(saved); }
+
+// --- irq --------------------------------------------------------------------
+
+typedef void (*irq_handler_t)(void);
+
+enum { TIMER_IRQ_0 = 0, TIMER_IRQ_1, TIMER_IRQ_2, TIMER_IRQ_3, DMA_IRQ_0 = 11, DMA_IRQ_1 = 12, IO_IRQ_BANK0 = 13,
+       SIM_IRQ_COUNT = 32 };
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+void irq_set_enabled(uint num, bool enabled);
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority);
+static inline void irq_set_priority(uint num, uint8_t prio) { (void)num; (void)prio; }
+void sim_raise_irq(uint num);
+
+// --- gpio -------------------------------------------------------------------
+
+#define NUM_BANK0_GPIOS 30
+#define GPIO_OUT 1
+#define GPIO_IN  0
+
+enum gpio_function { GPIO_FUNC_SPI = 1, GPIO_FUNC_UART = 2, GPIO_FUNC_I2C = 3, GPIO_FUNC_PWM = 4, GPIO_FUNC_SIO = 5,
+                     GPIO_FUNC_PIO0 = 6, GPIO_FUNC_NULL = 0x1f };
+enum gpio_irq_level { GPIO_IRQ_LEVEL_LOW = 1, GPIO_IRQ_LEVEL_HIGH = 2, GPIO_IRQ_EDGE_FALL = 4, GPIO_IRQ_EDGE_RISE = 8 };
+
+void gpio_init(uint pin);
+void gpio_set_dir(uint pin, bool out);
+void gpio_put(uint pin, bool value);
+bool gpio_get(uint pin);
+void gpio_pull_up(uint pin);
+void gpio_set_function(uint pin, enum gpio_function fn);
+void gpio_set_irq_enabled(uint pin, uint32_t events, bool enabled);
+void gpio_add_raw_irq_handler(uint pin, irq_handler_t handler);
+uint32_t gpio_get_irq_event_mask(uint pin);
+void gpio_acknowledge_irq(uint pin, uint32_t events);
+
+// Level driven by a model into an input pin, raises IO_IRQ_BANK0 on enabled edges
+void sim_gpio_drive(uint pin, bool value);
+// Called on every gpio_put of an output pin
+typedef void (*sim_gpio_watch_t)(void *ctx, uint pin, bool value);
+void sim_gpio_watch(uint pin, sim_gpio_watch_t cb, void *ctx);
+
+// --- spi --------------------------------------------------------------------
+
+typedef struct {
+    volatile uint32_t dr;
+    volatile uint32_t icr;
+} spi_hw_t;
+
+typedef struct spi_inst {
+    spi_hw_t hw;
+    uint index;
+} spi_inst_t;
+
+extern spi_inst_t sim_spi[2];
+#define spi0 (&sim_spi[0])
+#define spi1 (&sim_spi[1])
+
+typedef enum { SPI_CPOL_0 = 0, SPI_CPOL_1 = 1 } spi_cpol_t;
+typedef enum { SPI_CPHA_0 = 0, SPI_CPHA_1 = 1 } spi_cpha_t;
+typedef enum { SPI_LSB_FIRST = 0, SPI_MSB_FIRST = 1 } spi_order_t;
+#define SPI_SSPICR_RORIC_BITS 0x1
+
+uint spi_init(spi_inst_t *spi, uint baudrate);
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate);
+static inline void spi_set_format(spi_inst_t *spi, uint bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order) {
+    (void)spi; (void)bits; (void)cpol; (void)cpha; (void)order;
+}
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len);
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len);
+static inline uint spi_get_index(const spi_inst_t *spi) { return spi->index; }
+static inline spi_hw_t *spi_get_hw(spi_inst_t *spi) { return &spi->hw; }
+bool spi_is_busy(const spi_inst_t *spi); // A DMA transfer is still clocking out
+static inline bool spi_is_readable(const spi_inst_t *spi) { (void)spi; return false; }
+static inline uint spi_get_dreq(spi_inst_t *spi, bool is_tx) { return spi->index * 2 + (is_tx ? 16 : 17); }
+
+// A device on a simulated bus sees the bytes clocked while its CS is low
+typedef uint8_t (*sim_spi_xfer_t)(void *ctx, uint8_t mosi);
+void sim_spi_attach(spi_inst_t *spi, uint cs_pin, sim_spi_xfer_t xfer, void *ctx);
+
+typedef struct {
+    uint64_t bytes;
+    uint64_t clocks;  // SCK cycles
+    uint64_t busy_ns;    // Time the bus was clocking
+    uint32_t baud;       // Current, as set by the divider
+    uint32_t collisions; // CPU writes while a DMA transfer was clocking out (garbled on hardware)
+} sim_spi_stats_t;
+void sim_spi_get_stats(uint index, sim_spi_stats_t *stats);
+void sim_spi_reset_stats(void);
+
+// --- dma --------------------------------------------------------------------
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct {
+    uint32_t ctrl;
+} dma_channel_config;
+
+typedef struct {
+    volatile uint32_t ints0;
+    volatile uint32_t ints1;
+} dma_hw_t;
+extern dma_hw_t *const dma_hw;
+
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count);
+void dma_channel_abort(uint channel);
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+void dma_channel_set_irq1_enabled(uint channel, bool enabled);
+
+// --- pwm / clocks -----------------------------------------------------------
+
+typedef struct {
+    uint32_t div;
+    uint32_t top;
+} pwm_config;
+
+typedef struct {
+    struct {
+        volatile uint32_t div; // 8.4 fixed point
+        volatile uint32_t cc;
+        volatile uint32_t top;
+    } slice[8];
+} pwm_hw_t;
+extern pwm_hw_t *const pwm_hw;
+
+static inline uint pwm_gpio_to_slice_num(uint pin) { return (pin >> 1) & 7; }
+static inline uint pwm_gpio_to_channel(uint pin) { return pin & 1; }
+static inline pwm_config pwm_get_default_config(void) { pwm_config c = {16, 0xffff}; return c; }
+static inline void pwm_config_set_wrap(pwm_config *c, uint16_t wrap) { c->top = wrap; }
+static inline void pwm_config_set_clkdiv_int(pwm_config *c, uint32_t div) { c->div = div * 16; }
+static inline uint pwm_get_dreq(uint slice) { return 24 + slice; }
+void pwm_init(uint slice, pwm_config *c, bool start);
+static inline void pwm_set_enabled(uint slice, bool enabled) { (void)slice; (void)enabled; }
+void pwm_set_gpio_level(uint pin, uint16_t level);
+
+// --- flash ------------------------------------------------------------------
+
+// The whole flash is an array; XIP reads are plain reads of it. Erase and
+// program keep NOR semantics (program only clears bits) and advance the
+// clock by typical W25Q16 times.
+#define PICO_OK 0
+#define PICO_FLASH_SIZE_BYTES (2u * 1024u * 1024u)
+#define FLASH_PAGE_SIZE   256u
+#define FLASH_SECTOR_SIZE 4096u
+
+extern uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE                 ((uintptr_t)sim_flash)
+#define XIP_NOCACHE_NOALLOC_BASE ((uintptr_t)sim_flash)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+static inline int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms) {
+    (void)enter_exit_timeout_ms;
+    func(param);
+    return PICO_OK;
+}
+
+// Flash contents from/to a file holding size bytes from offset. A missing
+// file loads as erased flash.
+bool sim_flash_load(const char *path, uint32_t offset, uint32_t size);
+bool sim_flash_save(const char *path, uint32_t offset, uint32_t size);
+
+// clk_sys 125 MHz, pll_usb 48 MHz; clk_peri can be switched between them
+// and sets the SPI rates
+enum clock_index { clk_gpout0 = 0, clk_ref = 4, clk_sys = 5, clk_peri = 6, clk_usb = 7 };
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS        0x0
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB 0x2
+extern uint32_t sim_clk_peri_hz;
+static inline uint32_t clock_get_hz(enum clock_index clk) {
+    return clk == clk_ref ? 12000000u : clk == clk_usb ? 48000000u : clk == clk_peri ? sim_clk_peri_hz : 125000000u;
+}
+static inline bool clock_configure(enum clock_index clk, uint32_t src, uint32_t auxsrc, uint32_t src_freq,
+                                   uint32_t freq) {
+    (void)src;
+    (void)auxsrc;
+    if (clk == clk_peri) sim_clk_peri_hz = freq;
+    return freq <= src_freq;
+}
+
+// --- stdio ------------------------------------------------------------------
+
+// putchar_raw() writes to sim_raw_out, stdout while it is NULL, so a test
+// can capture binary output such as the profiler stream
+extern FILE *sim_raw_out;
+int putchar_raw(int c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_HAL_H
@@ -0,0 +1,150 @@
+// Touch-to-photon tracing on the host: the LVGL ports built with
+// -DLV_PORT_LATENCY_TRACE=1 on the panel and touch models, in virtual time.
+// Injects synthetic taps on a button at varying phases against the refresh
+// and prints lv_port_latency_print(), as on the target. Checks that every
+// tap is traced, that the stages add up to the total, that taps on the bare
+// screen are dropped, that taps played on the XPT2046 model are traced from
+// the pen-down edge, and that a trace whose area is never sent is given up
+// after LAT_TRACE_STALL_MS so the next tap is traced again.
+// Exits 1 on any mismatch. Needs the LVGL 8.3 sources, see "Host simulator"
+// in README.md.
+
+#include "lvgl.h"
+#include "lv_port_disp.h"
+#include "lv_port_indev.h"
+#include "lv_port_latency.h"
+#include "st7789.h"
+#include "xpt2046.h"
+#include "spi_bus.h"
+#include "port_log.h"
+#include "st7789_model.h"
+#include "xpt2046_model.h"
+#include "check.h"
+#include <stdio.h>
+
+#if !LV_PORT_LATENCY_TRACE
+#error "build with -DLV_PORT_LATENCY_TRACE=1"
+#endif
+
+#define TAPS    20
+#define BG_TAPS 5
+#define HW_TAPS 5
+
+static st7789_model_t panel;
+static xpt2046_model_t touch;
+
+// Raw reading for a screen point, the inverse of xpt2046_get_touch_point()
+static uint16_t raw_x(int32_t x) {
+    return (uint16_t)(XPT2046_MIN_RAW_X + (LV_HOR_RES_MAX - x) * (XPT2046_MAX_RAW_X - XPT2046_MIN_RAW_X) / LV_HOR_RES_MAX);
+}
+
+static uint16_t raw_y(int32_t y) {
+    return (uint16_t)(XPT2046_MIN_RAW_Y + y * (XPT2046_MAX_RAW_Y - XPT2046_MIN_RAW_Y) / LV_VER_RES_MAX);
+}
+
+static void run_ms(uint32_t ms) {
+    uint64_t end = time_us_64() + (uint64_t)ms * 1000;
+    while (time_us_64() < end) {
+        lv_timer_handler();
+        sleep_ms(5);
+    }
+    port_log_flush(0);
+}
+
+static void check_stages(const lat_stats_t *s) {
+    uint64_t sum = 0;
+    for (int i = 0; i < LAT_STAGE_TOTAL; i++) sum += s->stage[i].sum_us;
+    if (sum != s->stage[LAT_STAGE_TOTAL].sum_us) fail("stages don't add up to the total");
+    if (s->stage[LAT_STAGE_FLUSH].min_us == 0) fail("a trace finished without flush time");
+    if (s->stage[LAT_STAGE_TOTAL].max_us >= LAT_TRACE_TIMEOUT_MS * 1000) fail("a tap took longer than the timeout");
+}
+
+int main(void) {
+    lat_stats_t s;
+
+    st7789_model_attach(&panel, SPI_PORT, PIN_CS, PIN_DC);
+#if SPI_BUS_SHARED
+    xpt2046_model_attach(&touch, SPI_PORT, PIN_XPT_CS, PIN_XPT_IRQ);
+#else
+    xpt2046_model_attach(&touch, XPT_SPI_PORT, PIN_XPT_CS, PIN_XPT_IRQ);
+#endif
+
+    lv_init();
+    lv_port_disp_init();
+    lv_port_indev_init();
+
+    lv_obj_t *btn = lv_btn_create(lv_scr_act());
+    lv_obj_set_size(btn, 120, 50);
+    lv_obj_center(btn);
+    lv_obj_t *label = lv_label_create(btn);
+    lv_label_set_text(label, "Button");
+    lv_obj_center(label);
+    run_ms(200);
+    lv_port_latency_reset();
+
+    // Synthetic taps on the button, 250 ms apart plus 7 ms per tap so they
+    // land at every phase of the refresh period. Press and release each
+    // change the button's style, so each tap gives up to two traces.
+    printf("synthetic taps\n");
+    for (uint32_t i = 0; i < TAPS; i++) {
+        lv_port_latency_inject(LV_HOR_RES_MAX / 2, LV_VER_RES_MAX / 2, 60);
+        run_ms(250 + 7 * i);
+    }
+    lv_port_latency_print();
+    lv_port_latency_get_stats(&s);
+    if (s.interactions < TAPS) fail("not every tap was traced");
+    if (s.dropped || s.stalled) fail("button taps dropped");
+    check_stages(&s);
+    uint32_t traced = s.interactions;
+
+    // Taps on the bare screen invalidate nothing
+    printf("taps on the background\n");
+    for (uint32_t i = 0; i < BG_TAPS; i++) {
+        lv_port_latency_inject(10, LV_VER_RES_MAX - 10, 60);
+        run_ms(400);
+    }
+    lv_port_latency_get_stats(&s);
+    if (s.interactions != traced) fail("background taps traced");
+    if (s.dropped < BG_TAPS) fail("background taps not dropped");
+    uint32_t dropped = s.dropped;
+
+    // Taps played on the touch model go through PEN_IRQ and the read timer
+    printf("taps on the XPT2046 model\n");
+    for (uint32_t i = 0; i < HW_TAPS; i++) {
+        uint64_t t0 = time_us_64();
+        const xpt2046_model_event_t script[] = {
+            {t0 + 3000 + 5000 * i, true, raw_x(LV_HOR_RES_MAX / 2), raw_y(LV_VER_RES_MAX / 2), 600},
+            {t0 + 80000 + 5000 * i, false, 0, 0, 0},
+        };
+        xpt2046_model_play(&touch, script, 2);
+        run_ms(300);
+    }
+    lv_port_latency_get_stats(&s);
+    if (s.interactions < traced + HW_TAPS) fail("model taps not traced");
+    if (s.dropped != dropped) fail("model taps dropped");
+    check_stages(&s);
+    traced = s.interactions;
+
+    // A sample whose area is invalidated but never sent, as if its object
+    // were deleted before the refresh. The read timer keeps polling; the
+    // trace must be given up after LAT_TRACE_STALL_MS for the next tap.
+    printf("stalled trace\n");
+    lv_indev_data_t data = {.point = {LV_HOR_RES_MAX / 2, LV_VER_RES_MAX / 2}, .state = LV_INDEV_STATE_REL};
+    lv_port_latency_input(&data);
+    data.state = LV_INDEV_STATE_PR;
+    lv_port_latency_input(&data);
+    lv_area_t lost = {100, 300, 139, 309};
+    lv_port_latency_invalidate(&lost);
+    run_ms(LAT_TRACE_STALL_MS / 2);
+    lv_port_latency_get_stats(&s);
+    if (s.stalled) fail("trace given up too early");
+    run_ms(LAT_TRACE_STALL_MS / 2 + 100);
+    lv_port_latency_inject(LV_HOR_RES_MAX / 2, LV_VER_RES_MAX / 2, 60);
+    run_ms(250);
+    lv_port_latency_get_stats(&s);
+    if (s.stalled != 1) fail("stalled trace not given up");
+    if (s.interactions <= traced) fail("no tap traced after the stalled trace");
+
+    lv_port_latency_print();
+    return check_result();
+}
@@ -0,0 +1,161 @@
+// Deferred logging on the host: both cores and a timer IRQ log interleaved,
+// and the flushed output must keep each core's records in order with rising
+// timestamps. A core that logs more than PORT_LOG_RING records before a
+// flush keeps the oldest and reports the rest as dropped; flushes in parts
+// lose nothing; PORT_LOGW_EVERY lets one record through per period. Built
+// at PORT_LOG_LEVEL_WARN: the INFO/DEBUG calls below take an argument from
+// a function that is never defined, so if they compiled to any code this
+// program wouldn't link. Exits 1 on any mismatch. No LVGL.
+//
+//     gcc -O2 -DPORT_LOG_LEVEL=2 -Isim/hal -Isim -Iinc sim/log_sim.c sim/hal/sim_hal.c src/port_log.c -o log_sim
+//     ./log_sim
+
+#include "port_log.h"
+#include "check.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#if PORT_LOG_LEVEL != PORT_LOG_LEVEL_WARN
+#error "build with -DPORT_LOG_LEVEL=2, see above"
+#endif
+
+#define MAX_LINES 1024
+
+uint32_t log_sim_not_linked(void); // Never defined
+
+static char lines[MAX_LINES][96];
+static uint32_t nlines;
+static uint32_t irq_seq;
+
+// Runs port_log_flush(max) with stdout going to a file, the lines end up in lines[]
+static uint32_t flush_captured(uint32_t max) {
+    FILE *f = tmpfile();
+    fflush(stdout);
+    int saved = dup(1);
+    dup2(fileno(f), 1);
+    uint32_t printed = port_log_flush(max);
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+
+    rewind(f);
+    nlines = 0;
+    while (nlines < MAX_LINES && fgets(lines[nlines], sizeof(lines[0]), f)) nlines++;
+    fclose(f);
+    return printed;
+}
+
+static void log_on(uint core, uint32_t seq) {
+    sim_core_num = core;
+    PORT_LOGW("seq %u from core%u\n", seq, core);
+    sim_core_num = 0;
+}
+
+static bool irq_log(repeating_timer_t *rt) {
+    (void)rt;
+    PORT_LOGE("irq %u\n", irq_seq++);
+    return true;
+}
+
+// Per source (core0, core1, irq) the numbers must run 0, 1, 2... and each
+// core's timestamps must not go back
+static void check_order(uint32_t expect_core0, uint32_t expect_core1, uint32_t expect_irq) {
+    uint32_t next[3] = {0, 0, 0};
+    unsigned long last_t[2] = {0, 0};
+    for (uint32_t i = 0; i < nlines; i++) {
+        char level;
+        unsigned long core, t;
+        unsigned seq, from;
+        if (sscanf(lines[i], "[%c%lu %lu] ", &level, &core, &t) != 3 || core > 1) {
+            fail("unparsable line");
+            continue;
+        }
+        if (t < last_t[core]) fail("timestamps go back");
+        last_t[core] = t;
+
+        const char *msg = strchr(lines[i], ']') + 2;
+        uint32_t src;
+        if (sscanf(msg, "seq %u from core%u", &seq, &from) == 2) {
+            if (from != core || level != 'W') fail("record on the wrong core or level");
+            src = from;
+        } else if (sscanf(msg, "irq %u", &seq) == 1) {
+            if (core != 0 || level != 'E') fail("IRQ record on the wrong core or level");
+            src = 2;
+        } else {
+            fail("unexpected line");
+            continue;
+        }
+        if (seq != next[src]) fail("records out of order");
+        next[src] = seq + 1;
+    }
+    printf("  core0 %u, core1 %u, irq %u records\n", next[0], next[1], next[2]);
+    if (next[0] != expect_core0 || next[1] != expect_core1 || next[2] != expect_irq) fail("records missing");
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+
+    // Both cores and an IRQ, less than a ring each between flushes
+    printf("interleaved cores and IRQ\n");
+    repeating_timer_t timer;
+    add_repeating_timer_us(700, irq_log, NULL, &timer);
+    for (uint32_t i = 0; i < 40; i++) {
+        log_on(i % 3 ? 0 : 1, i % 3 ? i - i / 3 - 1 : i / 3);
+        sleep_us(250);
+    }
+    cancel_repeating_timer(&timer);
+    uint32_t irqs = irq_seq;
+    if (flush_captured(0) != 40 + irqs) fail("flush count");
+    check_order(26, 14, irqs);
+
+    // Overflow on core1 keeps the first PORT_LOG_RING, core0 unaffected
+    printf("core1 overflow\n");
+    uint32_t dropped = port_log_dropped();
+    for (uint32_t i = 0; i < PORT_LOG_RING + 10; i++) log_on(1, i);
+    log_on(0, 0);
+    if (port_log_dropped() - dropped != 10) fail("dropped count");
+    if (flush_captured(0) != PORT_LOG_RING + 1) fail("flush count");
+    // Reported before core1's records, after core0's
+    uint32_t at = 0;
+    while (at < nlines && !strstr(lines[at], "core1: 10 records dropped")) at++;
+    if (at != 1) fail("drop not reported before core1's records");
+    if (at < nlines) {
+        memmove(lines + at, lines + at + 1, (nlines - at - 1) * sizeof(lines[0]));
+        nlines--;
+    }
+    check_order(1, PORT_LOG_RING, 0);
+
+    // Flushing in parts loses nothing and keeps the order
+    printf("flush in parts of 7\n");
+    for (uint32_t i = 0; i < 30; i++) log_on(i & 1, i / 2);
+    static char all[MAX_LINES][96];
+    uint32_t n = 0, got;
+    while ((got = flush_captured(7)) != 0) {
+        if (got > 7) fail("flush printed more than asked");
+        for (uint32_t i = 0; i < nlines && n < MAX_LINES; i++) memcpy(all[n++], lines[i], sizeof(lines[0]));
+    }
+    memcpy(lines, all, n * sizeof(lines[0]));
+    nlines = n;
+    check_order(15, 15, 0);
+
+    // Rate limit: every 10 ms for 1 s, one per 100 ms gets through
+    printf("PORT_LOGW_EVERY(100)\n");
+    for (uint32_t i = 0; i < 100; i++) {
+        PORT_LOGW_EVERY(100, "seq %u from core%u\n", i / 10, 0);
+        sleep_ms(10);
+    }
+    flush_captured(0);
+    check_order(10, 0, 0);
+
+    // Levels above PORT_LOG_LEVEL: nothing stored and, see above, no code
+    printf("disabled levels\n");
+    PORT_LOGI("%u\n", log_sim_not_linked());
+    PORT_LOGD("%u\n", log_sim_not_linked());
+    PORT_LOGI_EVERY(1, "%u\n", log_sim_not_linked());
+    PORT_LOGD_EVERY(1, "%u\n", log_sim_not_linked());
+    if (flush_captured(0) != 0) fail("disabled level logged");
+
+    return check_result();
+}
@@ -0,0 +1,140 @@
+// Host run of the ST7789 and XPT2046 drivers against the panel and touch
+// models: flushes test frames the way lv_port_disp does, checks the frame
+// memory, reports bus bytes and time, plays a touch and writes the panel
+// contents to a PNG. No LVGL needed, see "Host simulator" in README.md.
+
+#include "st7789.h"
+#include "xpt2046.h"
+#include "spi_bus.h"
+#include "port_log.h"
+#include "st7789_model.h"
+#include "xpt2046_model.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BAND_LINES 40
+
+static st7789_model_t panel;
+static xpt2046_model_t touch;
+static uint16_t frame[ST7789_HEIGHT][ST7789_WIDTH]; // RGB565 as the panel shows it
+static uint16_t band[ST7789_WIDTH * BAND_LINES];    // Byte-swapped, as with LV_COLOR_16_SWAP
+
+static uint16_t swap16(uint16_t c) {
+    return (uint16_t)((c >> 8) | (c << 8));
+}
+
+static void draw_pattern(uint32_t seed) {
+    for (uint32_t y = 0; y < ST7789_HEIGHT; y++) {
+        for (uint32_t x = 0; x < ST7789_WIDTH; x++) {
+            uint32_t r = (x + seed) * 31 / ST7789_WIDTH % 32;
+            uint32_t g = y * 63 / ST7789_HEIGHT;
+            uint32_t b = ((x / 20 + y / 20 + seed) & 1) ? 31 : 0;
+            frame[y][x] = (uint16_t)((r << 11) | (g << 5) | b);
+        }
+    }
+}
+
+// Bands of BAND_LINES, window + pixels per band like disp_flush
+static void flush_frame(void) {
+    for (uint32_t y = 0; y < ST7789_HEIGHT; y += BAND_LINES) {
+        uint32_t h = ST7789_HEIGHT - y < BAND_LINES ? ST7789_HEIGHT - y : BAND_LINES;
+        for (uint32_t i = 0; i < h * ST7789_WIDTH; i++) {
+            band[i] = swap16(frame[y + i / ST7789_WIDTH][i % ST7789_WIDTH]);
+        }
+        st7789_set_window(0, y, ST7789_WIDTH - 1, y + h - 1);
+        st7789_send_pixels(band, h * ST7789_WIDTH);
+    }
+}
+
+static uint32_t compare_frame(void) {
+    uint32_t diff = 0;
+    for (uint32_t y = 0; y < ST7789_HEIGHT; y++) {
+        for (uint32_t x = 0; x < ST7789_WIDTH; x++) {
+            if (st7789_model_pixel(&panel, x, y) != frame[y][x]) diff++;
+        }
+    }
+    return diff;
+}
+
+static void report(const char *what, uint64_t t0_us) {
+    sim_spi_stats_t s;
+    sim_spi_get_stats(spi_get_index(SPI_PORT), &s);
+    uint64_t dt = time_us_64() - t0_us;
+    printf("%-22s %8llu us  %8llu bytes  %5.1f%% pixel data  %lu windows\n", what, (unsigned long long)dt,
+           (unsigned long long)s.bytes, s.bytes ? 100.0 * panel.stats.pixel_bytes / s.bytes : 0.0,
+           (unsigned long)panel.stats.windows);
+}
+
+int main(int argc, char **argv) {
+    const char *png = argc > 1 ? argv[1] : "panel.png";
+    uint32_t errors = 0;
+
+    st7789_model_attach(&panel, SPI_PORT, PIN_CS, PIN_DC);
+#if SPI_BUS_SHARED
+    xpt2046_model_attach(&touch, SPI_PORT, PIN_XPT_CS, PIN_XPT_IRQ);
+#else
+    xpt2046_model_attach(&touch, XPT_SPI_PORT, PIN_XPT_CS, PIN_XPT_IRQ);
+#endif
+
+    st7789_init();
+    xpt2046_init();
+    port_log_flush(0);
+    sim_spi_stats_t s;
+    sim_spi_get_stats(spi_get_index(SPI_PORT), &s);
+    printf("init done at %llu ms, SPI %lu Hz, MADCTL %02x COLMOD %02x\n",
+           (unsigned long long)(time_us_64() / 1000), (unsigned long)s.baud, panel.madctl, panel.colmod);
+
+    // Full frames
+    for (uint32_t n = 0; n < 2; n++) {
+        draw_pattern(n * 7);
+        sim_spi_reset_stats();
+        st7789_model_reset_stats(&panel);
+        uint64_t t0 = time_us_64();
+        flush_frame();
+        report(n ? "full frame (2nd)" : "full frame", t0);
+        uint32_t diff = compare_frame();
+        if (diff) printf("  %lu pixels differ\n", (unsigned long)diff);
+        errors += diff;
+    }
+
+    // A sub-rectangle out of a wider buffer (rows with a stride, one RAMWR)
+    sim_spi_reset_stats();
+    st7789_model_reset_stats(&panel);
+    uint64_t t0 = time_us_64();
+    for (uint32_t y = 0; y < 40; y++) {
+        for (uint32_t x = 0; x < 60; x++) frame[100 + y][90 + x] = 0xF800;
+    }
+    for (uint32_t i = 0; i < ST7789_WIDTH * 40; i++) band[i] = swap16(frame[100 + i / ST7789_WIDTH][i % ST7789_WIDTH]);
+    st7789_set_window(90, 100, 149, 139);
+    st7789_send_pixels_rect(band + 90, 60, 40, ST7789_WIDTH);
+    report("60x40 rect", t0);
+    uint32_t diff = compare_frame();
+    if (diff) printf("  %lu pixels differ\n", (unsigned long)diff);
+    errors += diff;
+
+    // Touch: a press in the middle of the calibrated range, held 50 ms
+    uint64_t now = time_us_64();
+    const xpt2046_model_event_t script[] = {
+        {now + 1000, true, 2050, 1950, 600},
+        {now + 51000, false, 0, 0, 0},
+    };
+    xpt2046_model_play(&touch, script, 2);
+    uint32_t samples = 0;
+    uint16_t tx = 0, ty = 0;
+    while (time_us_64() < now + 60000) {
+        if (xpt2046_get_touch_point(&tx, &ty)) samples++;
+        sleep_ms(5);
+    }
+    printf("touch: %lu samples in 60 ms, last at (%u, %u), %lu conversions\n", (unsigned long)samples, tx, ty,
+           (unsigned long)touch.conversions);
+    if (samples == 0) errors++;
+    port_log_flush(0);
+
+    if (!st7789_model_write_png(&panel, png)) {
+        printf("can't write %s\n", png);
+        errors++;
+    } else {
+        printf("panel contents written to %s\n", png);
+    }
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+// Host run of the LVGL ports on the panel and touch models: a screen with a
+// button, a scripted tap on it, LVGL driven in virtual time. Prints the SPI
+// and panel counters per phase and writes the panel contents to a PNG.
+// Needs the LVGL 8.3 sources, see "Host simulator" in README.md.
+
+#include "lvgl.h"
+#include "lv_port_disp.h"
+#include "lv_port_indev.h"
+#include "st7789.h"
+#include "xpt2046.h"
+#include "spi_bus.h"
+#include "port_log.h"
+#include "st7789_model.h"
+#include "xpt2046_model.h"
+#include <stdio.h>
+
+static st7789_model_t panel;
+static xpt2046_model_t touch;
+static uint32_t clicks;
+
+static void btn_event_cb(lv_event_t *e) {
+    if (lv_event_get_code(e) == LV_EVENT_CLICKED) clicks++;
+}
+
+// Raw reading for a screen point, the inverse of xpt2046_get_touch_point()
+static uint16_t raw_x(int32_t x) {
+    return (uint16_t)(XPT2046_MIN_RAW_X + (LV_HOR_RES_MAX - x) * (XPT2046_MAX_RAW_X - XPT2046_MIN_RAW_X) / LV_HOR_RES_MAX);
+}
+
+static uint16_t raw_y(int32_t y) {
+    return (uint16_t)(XPT2046_MIN_RAW_Y + y * (XPT2046_MAX_RAW_Y - XPT2046_MIN_RAW_Y) / LV_VER_RES_MAX);
+}
+
+static void run_ms(uint32_t ms) {
+    uint64_t end = time_us_64() + (uint64_t)ms * 1000;
+    while (time_us_64() < end) {
+        lv_timer_handler();
+        sleep_ms(5);
+    }
+    port_log_flush(0);
+}
+
+static void report(const char *what, uint64_t t0_us) {
+    sim_spi_stats_t s;
+    sim_spi_get_stats(spi_get_index(SPI_PORT), &s);
+    printf("%-16s %7llu ms  SPI busy %7llu us  %8llu bytes  %6llu pixels  %4lu windows\n", what,
+           (unsigned long long)((time_us_64() - t0_us) / 1000), (unsigned long long)(s.busy_ns / 1000),
+           (unsigned long long)s.bytes, (unsigned long long)panel.stats.pixels, (unsigned long)panel.stats.windows);
+    sim_spi_reset_stats();
+    st7789_model_reset_stats(&panel);
+}
+
+int main(int argc, char **argv) {
+    const char *png = argc > 1 ? argv[1] : "lvgl.png";
+
+    st7789_model_attach(&panel, SPI_PORT, PIN_CS, PIN_DC);
+#if SPI_BUS_SHARED
+    xpt2046_model_attach(&touch, SPI_PORT, PIN_XPT_CS, PIN_XPT_IRQ);
+#else
+    xpt2046_model_attach(&touch, XPT_SPI_PORT, PIN_XPT_CS, PIN_XPT_IRQ);
+#endif
+
+    lv_init();
+    lv_port_disp_init();
+    lv_port_indev_init();
+    port_log_flush(0);
+
+    uint64_t t0 = time_us_64();
+    lv_obj_t *btn = lv_btn_create(lv_scr_act());
+    lv_obj_set_size(btn, 120, 50);
+    lv_obj_center(btn);
+    lv_obj_add_event_cb(btn, btn_event_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_t *label = lv_label_create(btn);
+    lv_label_set_text(label, "Button");
+    lv_obj_center(label);
+    run_ms(100);
+    report("first screen", t0);
+
+    // Tap the middle of the button for 80 ms
+    t0 = time_us_64();
+    const xpt2046_model_event_t script[] = {
+        {t0 + 10000, true, raw_x(LV_HOR_RES_MAX / 2), raw_y(LV_VER_RES_MAX / 2), 600},
+        {t0 + 90000, false, 0, 0, 0},
+    };
+    xpt2046_model_play(&touch, script, 2);
+    run_ms(400);
+    report("tap", t0);
+
+    t0 = time_us_64();
+    run_ms(1000);
+    report("idle 1 s", t0);
+
+    printf("clicks: %lu\n", (unsigned long)clicks);
+    if (!st7789_model_write_png(&panel, png)) {
+        printf("can't write %s\n", png);
+        return 1;
+    }
+    printf("panel contents written to %s\n", png);
+    return clicks == 1 ? 0 : 1;
+}
@@ -0,0 +1,402 @@
+// LVGL heap soak: replays an allocation trace recorded from LVGL, or runs a
+// long random workload, on lv_port_mem and, with SOAK_LV_MEM, on LVGL's own
+// lv_mem over a pool of the same size.
+//
+// The trace (lvgl_bench --mem-trace, make -C sim mem-trace records
+// sim/mem_trace.txt) is every heap call of the reference screens from
+// lv_init() on, switching screens; it is replayed runs times, what it left
+// allocated freed between runs. The random workload is sized like LVGL's
+// (mostly small styles, events and object parts, some object and label
+// buffers, a few image and draw buffers).
+//
+// Each block is filled with a pattern that is checked before it is freed or
+// reallocated. Prints host ns per call (average and worst), failed
+// allocations, peak use and fragmentation per heap, and checks that
+// lv_port_mem's counters come back to empty once everything is freed, that
+// its free space is then one block, and that it doesn't fail a trace it was
+// recorded on. Exits 1 if a block is corrupted or not pointer-aligned, or a
+// check fails.
+//
+// lv_port_mem alone, no LVGL:
+//
+//     gcc -O2 -Isim/hal -Iinc sim/mem_soak.c src/lv_port_mem.c src/port_log.c sim/hal/sim_hal.c -o mem_soak
+//     ./mem_soak [ops]
+//     ./mem_soak --trace sim/mem_trace.txt [runs]
+//
+// Against lv_mem, with lv_mem.c and lv_tlsf.c built for LV_MEM_CUSTOM 0 in
+// place of the ones in the LVGL library (make -C sim mem_soak_lvgl):
+//
+//     gcc -O2 -DSOAK_LV_MEM=1 -DLV_MEM_CUSTOM=0 -Isim/hal -Iinc -I. -Ilvgl -DLV_CONF_INCLUDE_SIMPLE sim/mem_soak.c
+//         src/lv_port_mem.c src/port_log.c sim/hal/sim_hal.c lvgl/src/misc/lv_mem.c lvgl/src/misc/lv_tlsf.c
+//         liblvgl.a -o mem_soak_lvgl
+
+#include "lv_port_mem.h"
+#include "check.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef SOAK_LV_MEM
+#define SOAK_LV_MEM 0
+#endif
+
+#if SOAK_LV_MEM
+#include "lvgl.h"
+#if LV_MEM_CUSTOM
+#error "build with -DLV_MEM_CUSTOM=0, see above"
+#endif
+#endif
+
+#define LIVE_MAX     120     // Slots; about 70 blocks, 60 % of the pool, are alive
+#define DEFAULT_OPS  2000000 // Per heap
+#define SAMPLE_EVERY 10000   // Ops between fragmentation samples
+#define DEFAULT_RUNS 20      // Of a trace, per heap
+
+typedef struct {
+    uint32_t free_bytes;
+    uint32_t largest_free;
+    uint32_t peak_used;
+} heap_stats_t;
+
+typedef struct {
+    const char *name;
+    void *(*alloc)(size_t size);
+    void (*free)(void *ptr);
+    void *(*realloc)(void *ptr, size_t size);
+    void (*stats)(heap_stats_t *out);
+} heap_t;
+
+typedef struct {
+    uint8_t *ptr;
+    uint32_t size;
+    uint8_t seed;
+} block_t;
+
+typedef struct {
+    uint64_t calls, ns, worst_ns;
+    uint32_t fails, fails_large;
+    uint32_t peak_used;
+    uint32_t min_largest_free; // Worst sample over the run
+    uint32_t end_free, end_largest;
+} result_t;
+
+static block_t live[LIVE_MAX];
+
+static uint64_t host_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rng(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// 60 % 4-64 bytes, 30 % up to 512, 9 % up to 4 kB, 1 % up to 12 kB
+static uint32_t random_size(uint32_t *state) {
+    uint32_t r = rng(state) % 100;
+    uint32_t v = rng(state);
+    if (r < 60) return 4 + v % 61;
+    if (r < 90) return 65 + v % 448;
+    if (r < 99) return 513 + v % 3584;
+    return 4097 + v % 8192;
+}
+
+// --- heaps ------------------------------------------------------------------
+
+static void port_stats(heap_stats_t *out) {
+    lv_port_mem_stats_t s;
+    lv_port_mem_get_stats(&s);
+    out->free_bytes = s.free_bytes;
+    out->largest_free = s.largest_free;
+    out->peak_used = s.high_water_bytes;
+}
+
+#if SOAK_LV_MEM
+static void lvgl_stats(heap_stats_t *out) {
+    lv_mem_monitor_t m;
+    lv_mem_monitor(&m);
+    out->free_bytes = m.free_size;
+    out->largest_free = m.free_biggest_size;
+    out->peak_used = m.max_used;
+}
+#endif
+
+static const heap_t heaps[] = {
+    {"lv_port_mem", lv_port_mem_alloc, lv_port_mem_free, lv_port_mem_realloc, port_stats},
+#if SOAK_LV_MEM
+    {"lv_mem", lv_mem_alloc, lv_mem_free, lv_mem_realloc, lvgl_stats},
+#endif
+};
+#define HEAP_COUNT (sizeof(heaps) / sizeof(heaps[0]))
+
+// --- soak -------------------------------------------------------------------
+
+static void fill(const block_t *b) {
+    for (uint32_t i = 0; i < b->size; i++) b->ptr[i] = (uint8_t)(b->seed + i * 31);
+}
+
+static bool intact(const block_t *b, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        if (b->ptr[i] != (uint8_t)(b->seed + i * 31)) return false;
+    }
+    return true;
+}
+
+static void check(const heap_t *h, const block_t *b, uint32_t len) {
+    if (!intact(b, len)) {
+        printf("  %s: %u-byte block at %p corrupted\n", h->name, (unsigned)b->size, (void *)b->ptr);
+        errors++;
+    }
+}
+
+static void check_aligned(const heap_t *h, const void *p) {
+    if ((uintptr_t)p % sizeof(void *)) {
+        printf("  %s: %p not aligned to %u\n", h->name, p, (unsigned)sizeof(void *));
+        errors++;
+    }
+}
+
+static void timed(result_t *r, uint64_t start) {
+    uint64_t ns = host_ns() - start;
+    r->calls++;
+    r->ns += ns;
+    if (ns > r->worst_ns) r->worst_ns = ns;
+}
+
+static void failed(result_t *r, uint32_t size) {
+    r->fails++;
+    if (size > 4096) r->fails_large++;
+}
+
+static void do_alloc(const heap_t *h, block_t *b, uint32_t size, uint8_t seed, result_t *r) {
+    uint64_t start = host_ns();
+    b->ptr = h->alloc(size);
+    timed(r, start);
+    if (!b->ptr) {
+        failed(r, size);
+        return;
+    }
+    check_aligned(h, b->ptr);
+    b->size = size;
+    b->seed = seed;
+    fill(b);
+}
+
+static void do_free(const heap_t *h, block_t *b, result_t *r) {
+    check(h, b, b->size);
+    uint64_t start = host_ns();
+    h->free(b->ptr);
+    timed(r, start);
+    b->ptr = NULL;
+}
+
+static void do_realloc(const heap_t *h, block_t *b, uint32_t size, result_t *r) {
+    uint64_t start = host_ns();
+    uint8_t *p = h->realloc(b->ptr, size);
+    timed(r, start);
+    if (!p) {
+        failed(r, size); // The old block stays valid
+        return;
+    }
+    check_aligned(h, p);
+    b->ptr = p;
+    check(h, b, size < b->size ? size : b->size);
+    b->size = size;
+    fill(b);
+}
+
+static void sample(const heap_t *h, result_t *r) {
+    heap_stats_t s;
+    h->stats(&s);
+    if (s.largest_free < r->min_largest_free) r->min_largest_free = s.largest_free;
+}
+
+static void begin(result_t *r) {
+    memset(r, 0, sizeof(*r));
+    r->min_largest_free = UINT32_MAX;
+}
+
+static void free_all(const heap_t *h, block_t *blocks, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (!blocks[i].ptr) continue;
+        check(h, &blocks[i], blocks[i].size);
+        h->free(blocks[i].ptr);
+        blocks[i].ptr = NULL;
+    }
+}
+
+// Frees what is left and takes the end figures
+static void end(const heap_t *h, block_t *blocks, uint32_t count, result_t *r) {
+    heap_stats_t s;
+    h->stats(&s);
+    r->peak_used = s.peak_used;
+    free_all(h, blocks, count);
+    h->stats(&s);
+    r->end_free = s.free_bytes;
+    r->end_largest = s.largest_free;
+}
+
+static void soak(const heap_t *h, uint32_t ops, result_t *r) {
+    uint32_t state = 0x12345678u;
+
+    memset(live, 0, sizeof(live));
+    begin(r);
+
+    for (uint32_t op = 0; op < ops; op++) {
+        block_t *b = &live[rng(&state) % LIVE_MAX];
+        uint32_t size = random_size(&state);
+
+        if (!b->ptr) {
+            do_alloc(h, b, size, (uint8_t)op, r);
+        } else if (rng(&state) % 10 < 7) {
+            do_free(h, b, r);
+        } else {
+            do_realloc(h, b, size, r);
+        }
+        if (op % SAMPLE_EVERY == 0) sample(h, r);
+    }
+    end(h, live, LIVE_MAX, r);
+}
+
+// --- trace replay -----------------------------------------------------------
+
+typedef struct {
+    char op; // 'a', 'r' or 'f', see lv_port_mem_set_trace_cb()
+    uint32_t id;
+    uint32_t size;
+} trace_op_t;
+
+static trace_op_t *trace;
+static uint32_t trace_len, trace_ids;
+
+// Lines "a id size", "r id size", "f id"; # starts a comment
+static bool load_trace(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    uint32_t cap = 0;
+    char line[64];
+    while (fgets(line, sizeof(line), f)) {
+        trace_op_t t = {0};
+        unsigned long id, size = 0;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%c %lu %lu", &t.op, &id, &size) < 2 || !strchr("arf", t.op)) {
+            printf("%s: bad line %s", path, line);
+            fclose(f);
+            return false;
+        }
+        if (trace_len == cap) {
+            cap = cap ? cap * 2 : 4096;
+            trace = realloc(trace, cap * sizeof(*trace));
+        }
+        t.id = (uint32_t)id;
+        t.size = (uint32_t)size;
+        trace[trace_len++] = t;
+        if (t.id >= trace_ids) trace_ids = t.id + 1;
+    }
+    fclose(f);
+    return trace_len > 0;
+}
+
+// The trace runs times over, what it leaves allocated freed between runs.
+// A block whose allocation failed is allocated again at its next realloc,
+// its free skipped.
+static void replay(const heap_t *h, uint32_t runs, result_t *r) {
+    block_t *blocks = calloc(trace_ids, sizeof(block_t));
+    begin(r);
+
+    for (uint32_t run = 0; run < runs; run++) {
+        for (uint32_t i = 0; i < trace_len; i++) {
+            const trace_op_t *t = &trace[i];
+            block_t *b = &blocks[t->id];
+            if (t->op == 'a' || (t->op == 'r' && !b->ptr)) {
+                if (b->ptr) {
+                    printf("  trace: block %lu allocated twice\n", (unsigned long)t->id);
+                    errors++;
+                    do_free(h, b, r);
+                }
+                do_alloc(h, b, t->size ? t->size : 1, (uint8_t)i, r);
+            } else if (t->op == 'r') {
+                do_realloc(h, b, t->size, r);
+            } else if (b->ptr) {
+                do_free(h, b, r);
+            }
+            if (i % SAMPLE_EVERY == 0) sample(h, r);
+        }
+        if (run + 1 < runs) free_all(h, blocks, trace_ids);
+    }
+    end(h, blocks, trace_ids, r);
+    free(blocks);
+}
+
+int main(int argc, char **argv) {
+    const char *trace_path = NULL;
+    uint32_t ops = DEFAULT_OPS, runs = DEFAULT_RUNS;
+    result_t results[HEAP_COUNT];
+
+    if (argc > 2 && !strcmp(argv[1], "--trace")) {
+        trace_path = argv[2];
+        if (argc > 3) runs = (uint32_t)strtoul(argv[3], NULL, 0);
+        if (!load_trace(trace_path)) {
+            printf("can't read a trace from %s\n", trace_path);
+            return 2;
+        }
+    } else if (argc > 1) {
+        ops = (uint32_t)strtoul(argv[1], NULL, 0);
+    }
+
+#if SOAK_LV_MEM
+    lv_mem_init();
+#endif
+
+    if (trace_path) {
+        printf("%s: %lu calls, up to %lu blocks, %lu runs per heap, %u-byte pools\n", trace_path,
+               (unsigned long)trace_len, (unsigned long)trace_ids, (unsigned long)runs, (unsigned)LV_PORT_MEM_SIZE);
+    } else {
+        printf("%u ops per heap, up to %u blocks alive, %u-byte pools\n", (unsigned)ops, LIVE_MAX,
+               (unsigned)LV_PORT_MEM_SIZE);
+    }
+    printf("%-12s %8s %9s %8s %8s %10s %12s %14s\n", "heap", "ns/call", "worst ns", "fails", ">4kB", "peak used",
+           "min largest", "free after all");
+    for (uint32_t i = 0; i < HEAP_COUNT; i++) {
+        result_t *r = &results[i];
+        if (trace_path) {
+            replay(&heaps[i], runs, r);
+        } else {
+            soak(&heaps[i], ops, r);
+        }
+        printf("%-12s %8.1f %9llu %8u %8u %10u %12u %7u/%-6u\n", heaps[i].name, r->calls ? (double)r->ns / r->calls : 0,
+               (unsigned long long)r->worst_ns, (unsigned)r->fails, (unsigned)r->fails_large, (unsigned)r->peak_used,
+               (unsigned)r->min_largest_free, (unsigned)r->end_largest, (unsigned)r->end_free);
+    }
+
+    // Everything freed: no slot in use, nothing but the empty slab pages
+    // missing from the pool, and the free part in one piece
+    lv_port_mem_stats_t s;
+    lv_port_mem_get_stats(&s);
+    if (s.alloc_count != s.free_count) fail("lv_port_mem: allocs and frees don't match");
+    if (s.slab_slots_used) fail("lv_port_mem: slab slots still used");
+    if (s.used_bytes > s.slab_bytes) fail("lv_port_mem: bytes still used outside the slabs");
+    if (s.free_bytes + s.used_bytes + 16 * sizeof(size_t) < s.total_bytes) fail("lv_port_mem: pool bytes lost");
+    if (results[0].end_largest + results[0].end_free / 50 < results[0].end_free) {
+        fail("lv_port_mem: free space split after everything was freed");
+    }
+    if (trace_path && results[0].fails) fail("lv_port_mem failed calls of a trace it was recorded on");
+    if (!trace_path && !results[0].fails_large) fail("the workload never filled lv_port_mem's pool");
+
+    // A layer buffer of half the pool fits the empty heap, with the empty
+    // slab pages given back for it
+    void *big = lv_port_mem_alloc(LV_PORT_MEM_SIZE / 2);
+    void *rest = lv_port_mem_alloc(s.total_bytes - LV_PORT_MEM_SIZE / 2 - LV_PORT_MEM_SIZE / 8);
+    if (!big || !rest) fail("lv_port_mem: most of the empty pool can't be allocated");
+    lv_port_mem_free(big);
+    lv_port_mem_free(rest);
+
+    return check_result();
+}
@@ -0,0 +1,122 @@
+// Host stress run of port_msgq: several producer threads post sequenced
+// records as fast as they can while the main thread consumes them. Checks
+// that every record arrives exactly once and in order per producer, and
+// reports throughput, post latency and how often producers found the
+// queue full.
+//
+//     gcc -O2 -pthread -Iinc sim/msgq_stress.c src/port_msgq.c -o msgq_stress
+//     ./msgq_stress [producers] [records per producer] [slots]
+
+#include "port_msgq.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define MAX_PRODUCERS 16
+#define LAT_BUCKETS   24 // Powers of two of nanoseconds
+
+typedef struct {
+    uint32_t producer;
+    uint32_t seq;
+    uint64_t t_ns;
+    uint32_t payload[4]; // Roughly the size of an LVGL update message
+} rec_t;
+
+static port_msgq_t q;
+static uint32_t records;
+static volatile int go;
+static uint64_t full_retries[MAX_PRODUCERS];
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void *producer(void *arg) {
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    while (!__atomic_load_n(&go, __ATOMIC_ACQUIRE)) sched_yield();
+    rec_t r = {.producer = id};
+    for (uint32_t i = 0; i < records; i++) {
+        r.seq = i;
+        r.payload[0] = id ^ i;
+        r.t_ns = now_ns();
+        while (!port_msgq_post(&q, &r)) {
+            full_retries[id]++;
+            sched_yield();
+            r.t_ns = now_ns(); // Latency from the post that got in
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    uint32_t producers = argc > 1 ? (uint32_t)atoi(argv[1]) : 4;
+    records = argc > 2 ? (uint32_t)atoi(argv[2]) : 1000000;
+    uint32_t slots = argc > 3 ? (uint32_t)atoi(argv[3]) : 64;
+    if (producers < 1 || producers > MAX_PRODUCERS || slots < 2 || (slots & (slots - 1))) {
+        fprintf(stderr, "producers 1..%d, slots a power of 2\n", MAX_PRODUCERS);
+        return 2;
+    }
+
+    uint32_t *buf = calloc(PORT_MSGQ_BUF_WORDS(slots, sizeof(rec_t)), 4);
+    port_msgq_init(&q, buf, slots, sizeof(rec_t));
+
+    pthread_t th[MAX_PRODUCERS];
+    for (uint32_t p = 0; p < producers; p++) pthread_create(&th[p], NULL, producer, (void *)(uintptr_t)p);
+
+    uint32_t next_seq[MAX_PRODUCERS] = {0};
+    uint64_t hist[LAT_BUCKETS] = {0};
+    uint64_t lat_sum = 0;
+    uint64_t lat_max = 0;
+    uint64_t total = (uint64_t)producers * records;
+    uint64_t received = 0;
+    uint64_t errors = 0;
+
+    uint64_t t0 = now_ns();
+    __atomic_store_n(&go, 1, __ATOMIC_RELEASE);
+    rec_t r;
+    while (received < total) {
+        if (!port_msgq_pop(&q, &r)) {
+            sched_yield(); // Lets the producers run on a single CPU too
+            continue;
+        }
+        uint64_t lat = now_ns() - r.t_ns;
+        if (r.producer >= producers || r.seq != next_seq[r.producer] || r.payload[0] != (r.producer ^ r.seq)) {
+            if (errors++ < 10) {
+                printf("bad record: producer %u seq %u, expected seq %u\n", r.producer, r.seq,
+                       r.producer < producers ? next_seq[r.producer] : 0);
+            }
+            if (r.producer < producers) next_seq[r.producer] = r.seq;
+        }
+        if (r.producer < producers) next_seq[r.producer]++;
+        received++;
+        lat_sum += lat;
+        if (lat > lat_max) lat_max = lat;
+        uint32_t b = 0;
+        while (b < LAT_BUCKETS - 1 && (lat >> (b + 1))) b++;
+        hist[b]++;
+    }
+    uint64_t dt = now_ns() - t0;
+    for (uint32_t p = 0; p < producers; p++) pthread_join(th[p], NULL);
+
+    uint64_t retries = 0;
+    for (uint32_t p = 0; p < producers; p++) retries += full_retries[p];
+    printf("%u producers x %u records through %u slots: %.2f s, %.2f M records/s\n", producers, records, slots,
+           dt / 1e9, received * 1e3 / dt);
+    printf("latency post -> pop: avg %llu ns, max %llu ns; queue full %llu times\n",
+           (unsigned long long)(lat_sum / received), (unsigned long long)lat_max, (unsigned long long)retries);
+    uint64_t acc = 0;
+    for (uint32_t b = 0; b < LAT_BUCKETS; b++) {
+        if (!hist[b]) continue;
+        acc += hist[b];
+        printf("  < %8llu ns %10llu  %6.2f%%\n", 2ull << b, (unsigned long long)hist[b], acc * 100.0 / received);
+    }
+    if (port_msgq_count(&q) != 0) errors++;
+    printf("%s: %llu records, %llu errors\n", errors ? "FAIL" : "ok", (unsigned long long)received,
+           (unsigned long long)errors);
+    free(buf);
+    return errors ? 1 : 0;
+}
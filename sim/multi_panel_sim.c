@@ -0,0 +1,213 @@
+// Two panels at once on the host: panel A on spi0 (the default wiring),
+// panel B on spi1 and panel C on spi0 next to A (own CS and DC), each on a
+// panel model. Checks that async sends on A and B run in parallel and both
+// frames arrive, that each completion callback runs once from the DMA IRQ
+// with its own context, that a band pipeline like lv_port_disp's
+// panel_flush (set the window, send async, render the next band) draws
+// both panels, that commands to C wait for A's DMA on the shared SPI, and
+// that a third async panel falls back to blocking sends. Exits 1 on any
+// mismatch. No LVGL.
+//
+//     gcc -O2 -DST7789_SINGLE_PANEL=0 -Isim/hal -Isim -Isim/nolvgl -Iinc -I. sim/multi_panel_sim.c
+//         sim/st7789_model.c sim/sim_png.c sim/hal/sim_hal.c src/st7789.c src/spi_bus.c src/port_log.c -o multi_panel_sim
+//     ./multi_panel_sim
+
+#include "st7789.h"
+#include "port_log.h"
+#include "st7789_model.h"
+#include "check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ST7789_SINGLE_PANEL
+#error "build with -DST7789_SINGLE_PANEL=0, see above"
+#endif
+
+#define W    ST7789_WIDTH
+#define H    ST7789_HEIGHT
+#define BAND 40 // Rows per band in the pipeline
+
+static st7789_model_t model_a, model_b, model_c;
+static st7789_t panel_b, panel_c;
+#define panel_a st7789_default_panel
+
+static const st7789_config_t cfg_b = {
+    .spi = spi1, .baud = SPI_BAUD_RATE,
+    .pin_sck = 26, .pin_mosi = 27, .pin_miso = ST7789_NO_PIN, .pin_dc = 15, .pin_cs = 28,
+    .pin_rst = ST7789_NO_PIN, .pin_blk = ST7789_NO_PIN,
+    .width = W, .height = H, .madctl = 0x00, .colmod = 0x55,
+};
+static const st7789_config_t cfg_c = {
+    .spi = spi0, .baud = SPI_BAUD_RATE,
+    .pin_sck = PIN_SPI_SCK, .pin_mosi = PIN_SPI_MOSI, .pin_miso = ST7789_NO_PIN, .pin_dc = 6, .pin_cs = 5,
+    .pin_rst = ST7789_NO_PIN, .pin_blk = ST7789_NO_PIN,
+    .width = W, .height = H, .madctl = 0x00, .colmod = 0x55,
+};
+
+static uint16_t frame_a[H][W], frame_b[H][W]; // In the byte order sent
+
+// Completion callbacks: panel, context and time, in the order they ran
+static struct {
+    st7789_t *panel;
+    void *ctx;
+    uint64_t t_us;
+} dones[64];
+static uint32_t ndone;
+
+static void on_done(st7789_t *panel, void *ctx) {
+    if (ndone < 64) {
+        dones[ndone].panel = panel;
+        dones[ndone].ctx = ctx;
+        dones[ndone].t_us = time_us_64();
+        ndone++;
+    }
+}
+
+// st7789_panel_wait() that gives up: a lost DMA IRQ would hang every later
+// command to the panel
+static void wait(st7789_t *p) {
+    uint64_t end = time_us_64() + 100000;
+    while (p->busy && time_us_64() < end) tight_loop_contents();
+    if (p->busy) {
+        printf("  send never finished\nFAILED\n");
+        exit(1);
+    }
+    st7789_panel_wait(p);
+}
+
+static void fill(uint16_t f[H][W], uint32_t seed) {
+    for (uint32_t y = 0; y < H; y++) {
+        for (uint32_t x = 0; x < W; x++) {
+            uint16_t c = (uint16_t)((x * 7 + y * 13 + seed) * 0x9E37u);
+            f[y][x] = (uint16_t)((c >> 8) | (c << 8));
+        }
+    }
+}
+
+static bool shows(const st7789_model_t *m, uint16_t f[H][W]) {
+    for (uint32_t y = 0; y < H; y++) {
+        for (uint32_t x = 0; x < W; x++) {
+            uint16_t c = f[y][x];
+            if (st7789_model_pixel(m, x, y) != (uint16_t)((c >> 8) | (c << 8))) return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t collisions(uint index) {
+    sim_spi_stats_t s;
+    sim_spi_get_stats(index, &s);
+    return s.collisions;
+}
+
+static void check_parallel(void) {
+    printf("full frames on A and B at once\n");
+    fill(frame_a, 1);
+    fill(frame_b, 2);
+    ndone = 0;
+    uint64_t t0 = time_us_64();
+    st7789_panel_set_window(&panel_a, 0, 0, W - 1, H - 1);
+    st7789_panel_send_pixels_async(&panel_a, &frame_a[0][0], W * H, on_done, frame_a);
+    st7789_panel_set_window(&panel_b, 0, 0, W - 1, H - 1);
+    st7789_panel_send_pixels_async(&panel_b, &frame_b[0][0], W * H, on_done, frame_b);
+    if (!panel_a.busy || !panel_b.busy) fail("not both in flight");
+    wait(&panel_a);
+    wait(&panel_b);
+    uint64_t dt = time_us_64() - t0;
+    uint64_t one = (uint64_t)W * H * 16 * 1000000 / st7789_panel_get_baud(&panel_a);
+
+    printf("  both in %llu us, one frame takes %llu us\n", (unsigned long long)dt, (unsigned long long)one);
+    if (dt > one + one / 10) fail("not in parallel");
+    if (!shows(&model_a, frame_a) || !shows(&model_b, frame_b)) fail("frame differs");
+    if (ndone != 2 || dones[0].panel != &panel_a || dones[0].ctx != frame_a || dones[1].panel != &panel_b ||
+        dones[1].ctx != frame_b) {
+        fail("callbacks wrong");
+    }
+}
+
+// As lv_port_disp's panel_flush: the window waits for the previous band,
+// the next band is rendered while this one goes out
+static void check_bands(void) {
+    printf("bands on A and B, interleaved\n");
+    static uint16_t band_a[2][BAND][W], band_b[2][BAND][W];
+    fill(frame_a, 3);
+    fill(frame_b, 4);
+    ndone = 0;
+    for (uint32_t y = 0, i = 0; y < H; y += BAND, i ^= 1) {
+        // Rendering: the other buffer may still be going out
+        memcpy(band_a[i], frame_a[y], sizeof(band_a[i]));
+        memcpy(band_b[i], frame_b[y], sizeof(band_b[i]));
+        st7789_panel_set_window(&panel_a, 0, y, W - 1, y + BAND - 1);
+        st7789_panel_send_pixels_async(&panel_a, &band_a[i][0][0], W * BAND, on_done, band_a[i]);
+        st7789_panel_set_window(&panel_b, 0, y, W - 1, y + BAND - 1);
+        st7789_panel_send_pixels_async(&panel_b, &band_b[i][0][0], W * BAND, on_done, band_b[i]);
+        sleep_us(300); // Render time
+    }
+    wait(&panel_a);
+    wait(&panel_b);
+
+    if (!shows(&model_a, frame_a) || !shows(&model_b, frame_b)) fail("frame differs");
+    uint32_t a = 0, b = 0;
+    for (uint32_t i = 0; i < ndone; i++) {
+        if (dones[i].panel == &panel_a && dones[i].ctx == band_a[a & 1]) a++;
+        if (dones[i].panel == &panel_b && dones[i].ctx == band_b[b & 1]) b++;
+    }
+    printf("  %u + %u bands done\n", a, b);
+    if (a != H / BAND || b != H / BAND || ndone != a + b) fail("callbacks wrong");
+}
+
+static void check_shared_spi(void) {
+    printf("C on A's SPI while A sends\n");
+    static uint16_t rect[20 * 10];
+    for (uint32_t i = 0; i < 20 * 10; i++) rect[i] = 0x1F00; // Blue, as sent
+    fill(frame_a, 5);
+    ndone = 0;
+    sim_spi_reset_stats();
+    st7789_model_reset_stats(&model_c);
+    st7789_panel_set_window(&panel_a, 0, 0, W - 1, H - 1);
+    st7789_panel_send_pixels_async(&panel_a, &frame_a[0][0], W * H, on_done, NULL);
+    st7789_panel_set_window(&panel_c, 10, 10, 29, 19); // Has to wait for A
+    st7789_panel_send_pixels(&panel_c, rect, 20 * 10);
+
+    if (ndone != 1 || model_c.nlog == 0 || model_c.log[0].t_us < dones[0].t_us) fail("C didn't wait for A");
+    if (collisions(0)) fail("CPU bytes during A's DMA");
+    if (!shows(&model_a, frame_a)) fail("A's frame differs");
+    if (st7789_model_pixel(&model_c, 10, 10) != 0x001F || st7789_model_pixel(&model_c, 29, 19) != 0x001F ||
+        st7789_model_pixel(&model_c, 30, 19) == 0x001F) {
+        fail("C's rect wrong");
+    }
+}
+
+static void check_third_async(void) {
+    printf("third async panel\n");
+    static uint16_t rect[8 * 8];
+    for (uint32_t i = 0; i < 8 * 8; i++) rect[i] = 0xE007; // Green, as sent
+    ndone = 0;
+    st7789_panel_set_window(&panel_c, 0, 0, 7, 7);
+    st7789_panel_send_pixels_async(&panel_c, rect, 8 * 8, on_done, rect);
+    port_log_flush(0); // "more than 2 async panels"
+    if (panel_c.dma_chan >= 0 || panel_c.busy) fail("got a DMA channel");
+    if (ndone != 1 || dones[0].ctx != rect) fail("callback wrong");
+    if (st7789_model_pixel(&model_c, 7, 7) != 0x07E0) fail("rect not drawn");
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    st7789_model_attach(&model_a, spi0, PIN_CS, PIN_DC);
+    st7789_model_attach(&model_b, spi1, cfg_b.pin_cs, cfg_b.pin_dc);
+    st7789_model_attach(&model_c, spi0, cfg_c.pin_cs, cfg_c.pin_dc);
+    st7789_init();
+    st7789_panel_init(&panel_b, &cfg_b);
+    st7789_panel_init(&panel_c, &cfg_c);
+    port_log_flush(0);
+
+    check_parallel();
+    check_bands();
+    check_shared_spi();
+    check_third_async();
+    if (collisions(0) || collisions(1)) fail("CPU bytes during a DMA transfer");
+
+    return check_result();
+}
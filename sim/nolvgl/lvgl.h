@@ -0,0 +1,86 @@
+// Host simulator without LVGL: xpt2046.c only needs the resolution,
+// lv_port_dflush.c the area type (as in LVGL 8.3 without LV_USE_LARGE_COORD),
+// lv_port_prof.c the timers it wraps, lv_port_sched.c the timer fields and
+// the touch state it looks at, lv_port_gov.c and lv_port_backlight.c the
+// timer each creates. A test using the timers defines the lv_timer, lv_tick,
+// lv_anim and lv_disp functions below.
+#ifndef SIM_NOLVGL_H
+#define SIM_NOLVGL_H
+
+#include "lv_conf.h"
+#include <stdint.h>
+
+typedef int16_t lv_coord_t;
+
+typedef struct {
+    lv_coord_t x1;
+    lv_coord_t y1;
+    lv_coord_t x2;
+    lv_coord_t y2;
+} lv_area_t;
+
+static inline lv_coord_t lv_area_get_width(const lv_area_t *area) {
+    return (lv_coord_t)(area->x2 - area->x1 + 1);
+}
+
+static inline lv_coord_t lv_area_get_height(const lv_area_t *area) {
+    return (lv_coord_t)(area->y2 - area->y1 + 1);
+}
+
+static inline uint32_t lv_area_get_size(const lv_area_t *area) {
+    return (uint32_t)lv_area_get_width(area) * (uint32_t)lv_area_get_height(area);
+}
+
+#define LV_NO_TIMER_READY 0xFFFFFFFF
+
+typedef struct _lv_obj_t lv_obj_t;
+
+typedef struct _lv_timer_t lv_timer_t;
+typedef void (*lv_timer_cb_t)(lv_timer_t *timer);
+
+struct _lv_timer_t {
+    uint32_t period;
+    uint32_t last_run;
+    lv_timer_cb_t timer_cb;
+    void *user_data;
+    uint32_t paused : 1;
+};
+
+typedef struct {
+    lv_timer_t *refr_timer;
+} lv_disp_t;
+
+typedef struct {
+    lv_timer_t *read_timer;
+} lv_indev_drv_t;
+
+typedef enum {
+    LV_INDEV_STATE_RELEASED = 0,
+    LV_INDEV_STATE_PRESSED
+} lv_indev_state_t;
+
+typedef struct {
+    lv_indev_drv_t *driver;
+    struct {
+        lv_indev_state_t state;
+        union {
+            struct {
+                lv_obj_t *scroll_obj;
+            } pointer;
+        } types;
+    } proc;
+} lv_indev_t;
+
+lv_timer_t *lv_timer_create(lv_timer_cb_t timer_cb, uint32_t period, void *user_data);
+void lv_timer_set_cb(lv_timer_t *timer, lv_timer_cb_t timer_cb);
+void lv_timer_set_period(lv_timer_t *timer, uint32_t period);
+void lv_timer_reset(lv_timer_t *timer);
+void lv_timer_pause(lv_timer_t *timer);
+void lv_timer_resume(lv_timer_t *timer);
+void lv_timer_ready(lv_timer_t *timer);
+uint32_t lv_timer_handler(void);
+uint32_t lv_tick_get(void);
+uint16_t lv_anim_count_running(void);
+uint32_t lv_disp_get_inactive_time(const lv_disp_t *disp);
+
+#endif // SIM_NOLVGL_H
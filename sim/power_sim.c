@@ -0,0 +1,131 @@
+// Panel sleep/wake on the host: runs st7789_sleep()/st7789_wake() against
+// the panel model, checks the commands each sends and their order, that
+// the model saw no datasheet timing violation (see st7789_model.h), that
+// wake only waits as long as needed and that the frame memory survives.
+// Exits 1 on any mismatch. No LVGL.
+//
+//     gcc -O2 -Isim/hal -Isim -Isim/nolvgl -Iinc -I. sim/power_sim.c sim/st7789_model.c sim/sim_png.c
+//         sim/hal/sim_hal.c src/st7789.c src/spi_bus.c src/port_log.c -o power_sim
+//     ./power_sim
+
+#include "st7789.h"
+#include "port_log.h"
+#include "st7789_model.h"
+#include "check.h"
+#include <stdio.h>
+#include <string.h>
+
+static st7789_model_t panel;
+static uint16_t frame[ST7789_HEIGHT][ST7789_WIDTH]; // RGB565 as the panel shows it
+static uint16_t row[ST7789_WIDTH];
+
+static void flush_frame(uint32_t seed) {
+    for (uint32_t y = 0; y < ST7789_HEIGHT; y++) {
+        for (uint32_t x = 0; x < ST7789_WIDTH; x++) {
+            frame[y][x] = (uint16_t)((x + y * 3 + seed) * 0x9E37u);
+            row[x] = (uint16_t)((frame[y][x] >> 8) | (frame[y][x] << 8));
+        }
+        st7789_set_window(0, y, ST7789_WIDTH - 1, y);
+        st7789_send_pixels(row, ST7789_WIDTH);
+    }
+}
+
+static bool shows_frame(void) {
+    for (uint32_t y = 0; y < ST7789_HEIGHT; y++) {
+        for (uint32_t x = 0; x < ST7789_WIDTH; x++) {
+            if (st7789_model_pixel(&panel, x, y) != frame[y][x]) return false;
+        }
+    }
+    return true;
+}
+
+static bool shows_black(void) {
+    for (uint32_t y = 0; y < ST7789_HEIGHT; y++) {
+        for (uint32_t x = 0; x < ST7789_WIDTH; x++) {
+            if (st7789_model_pixel(&panel, x, y)) return false;
+        }
+    }
+    return true;
+}
+
+// Runs op and checks the commands it sent; returns how long it took in us
+static uint64_t expect_cmds(const char *what, void (*op)(void), const uint8_t *cmds, uint32_t n) {
+    st7789_model_reset_stats(&panel);
+    uint64_t t0 = time_us_64();
+    op();
+    uint64_t dt = time_us_64() - t0;
+
+    printf("%-28s %6llu us:", what, (unsigned long long)dt);
+    for (uint32_t i = 0; i < panel.nlog; i++) {
+        printf(" %02x@%llu", panel.log[i].cmd, (unsigned long long)(panel.log[i].t_us - t0));
+    }
+    printf("\n");
+    if (panel.nlog != n) {
+        fail("wrong number of commands");
+    } else {
+        for (uint32_t i = 0; i < n; i++) {
+            if (panel.log[i].cmd != cmds[i]) fail("wrong command order");
+        }
+    }
+    if (panel.stats.timing_errors) fail(panel.timing_error);
+    return dt;
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    static const uint8_t sleep_cmds[] = {ST7789_DISPOFF, ST7789_SLPIN};
+    static const uint8_t wake_cmds[] = {ST7789_SLPOUT, ST7789_DISPON};
+
+    st7789_model_attach(&panel, SPI_PORT, PIN_CS, PIN_DC);
+    st7789_init();
+    port_log_flush(0);
+    if (panel.stats.timing_errors) fail(panel.timing_error);
+    flush_frame(1);
+    if (!shows_frame()) fail("frame not shown after init");
+
+    // Right after init: SLPOUT was 255 ms ago, no wait
+    uint64_t dt = expect_cmds("sleep after init", st7789_sleep, sleep_cmds, 2);
+    if (dt > 1000) fail("sleep waited");
+    if (!st7789_is_sleeping() || !shows_black()) fail("panel not dark in sleep");
+
+    // At once: SLPOUT only 120 ms after SLPIN, DISPON 5 ms after SLPOUT
+    dt = expect_cmds("wake right after sleep", st7789_wake, wake_cmds, 2);
+    if (dt < 125000) fail("wake didn't wait 120 ms + 5 ms");
+    if (panel.log[1].t_us - panel.log[0].t_us < 5000) fail("DISPON within 5 ms of SLPOUT");
+    if (st7789_is_sleeping() || !shows_frame()) fail("frame memory lost over sleep");
+
+    // At once again: SLPIN only 120 ms after SLPOUT
+    dt = expect_cmds("sleep right after wake", st7789_sleep, sleep_cmds, 2);
+    if (dt < 115000) fail("sleep didn't wait for 120 ms after SLPOUT");
+
+    // After a long sleep only the 5 ms before DISPON remain
+    sleep_ms(2000);
+    dt = expect_cmds("wake after 2 s", st7789_wake, wake_cmds, 2);
+    if (dt < 5000 || dt > 6000) fail("wake took other than 5 ms");
+
+    // Repeated calls send nothing
+    expect_cmds("wake while awake", st7789_wake, NULL, 0);
+    sleep_ms(200);
+    expect_cmds("sleep", st7789_sleep, sleep_cmds, 2);
+    expect_cmds("sleep while asleep", st7789_sleep, NULL, 0);
+    sleep_ms(500);
+    expect_cmds("wake", st7789_wake, wake_cmds, 2);
+
+    // Drawing after wake works, nothing was written while asleep
+    st7789_model_reset_stats(&panel);
+    flush_frame(2);
+    if (!shows_frame() || panel.stats.writes_asleep) fail("frame not drawn after wake");
+    if (panel.stats.timing_errors) fail(panel.timing_error);
+
+    // The model notices a wake sent too early
+    sleep_ms(200);
+    st7789_write_cmd(ST7789_SLPIN);
+    st7789_write_cmd(ST7789_SLPOUT);
+    printf("%-28s %lu timing errors (%s)\n", "SLPIN + SLPOUT at once", (unsigned long)panel.stats.timing_errors,
+           panel.timing_error ? panel.timing_error : "none");
+    if (panel.stats.timing_errors != 2) fail("the model missed the violations");
+
+    port_log_flush(0);
+    return check_result();
+}
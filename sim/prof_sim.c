@@ -0,0 +1,335 @@
+// Profiler stream round trip on the host: lv_port_prof.c records scripted
+// frames through stand-ins for the LVGL timers it wraps, in virtual time,
+// and streams them into a capture file between lines of text, after records
+// encoded by hand with edge values (0, varint length steps, UINT32_MAX), a
+// false sync, a corrupted record and before a truncated one. It then runs
+// tools/prof_decode.py on the capture and checks that its CSVs hold exactly
+// the records sent, field by field, that overflowing the rings is reported
+// as dropped records, and that no encoded record exceeds the 64-byte buffer.
+// Exits 1 on any mismatch. No LVGL; needs python3.
+//
+//     gcc -O2 -DLV_PORT_PROFILER=1 -Isim/hal -Isim -Isim/nolvgl -Iinc -I. sim/prof_sim.c sim/st7789_model.c
+//         sim/xpt2046_model.c sim/sim_png.c sim/hal/sim_hal.c src/st7789.c src/xpt2046.c src/spi_bus.c
+//         src/port_log.c src/lv_port_prof.c -o prof_sim
+//     ./prof_sim tools/prof_decode.py
+
+#include "lv_port_prof.h"
+#include "sim_hal.h"
+#include "check.h"
+#include <stdio.h>
+#include <string.h>
+
+#if !LV_PORT_PROFILER
+#error "build with -DLV_PORT_PROFILER=1, see above"
+#endif
+
+#define CAPTURE   "prof.bin"
+#define FRAME_CSV "prof_frames.csv"
+#define BAND_CSV  "prof_bands.csv"
+
+#define MAX_FRAMES 128
+#define MAX_BANDS  512
+
+// --- expected records -------------------------------------------------------
+
+static prof_frame_t exp_frames[MAX_FRAMES];
+static prof_band_t exp_bands[MAX_BANDS];
+static uint32_t n_frames, n_bands;
+static uint32_t exp_frames_dropped, exp_bands_dropped;
+
+// --- LVGL stand-ins ---------------------------------------------------------
+
+// What the next lv_timer_handler() call does, in us
+typedef struct {
+    uint32_t input;
+    uint32_t bands; // 0: nothing to redraw
+    uint32_t render, flush, tail;
+} call_t;
+
+static call_t call;
+
+// Accumulated by the script for the frame being drawn, and the ring fill
+// the port should see
+static prof_frame_t acc;
+static uint32_t frame_seq, frames_pending, bands_pending;
+static uint32_t frame_end_us;
+
+static void advance_us(uint32_t us) {
+    sim_advance_ns((uint64_t)us * 1000);
+}
+
+static void read_cb(lv_timer_t *t) {
+    (void)t;
+    advance_us(call.input);
+}
+
+static void refr_cb(lv_timer_t *t) {
+    (void)t;
+    for (uint32_t i = 0; i < call.bands; i++) {
+        lv_area_t area = {0, (lv_coord_t)(i * 40), 239, (lv_coord_t)(i * 40 + 39)};
+        uint32_t bytes = 240 * 40 * 2;
+        uint32_t render = call.render + i;
+        uint32_t flush = call.flush + 3 * i;
+
+        advance_us(render);
+        lv_port_prof_flush_begin(&area);
+        advance_us(flush);
+        lv_port_prof_flush_end(bytes);
+
+        if (bands_pending < PROF_BAND_RING) {
+            exp_bands[n_bands++] = (prof_band_t){frame_seq, area.y1, area.y2, render, flush};
+            bands_pending++;
+        } else {
+            exp_bands_dropped++;
+        }
+        acc.render_us += render;
+        acc.flush_us += flush;
+        acc.bytes += bytes;
+        acc.areas++;
+        acc.bands++;
+    }
+    advance_us(call.tail);
+    acc.render_us += call.tail;
+}
+
+static lv_timer_t refr_timer = {.timer_cb = refr_cb};
+static lv_timer_t read_timer = {.timer_cb = read_cb};
+static lv_disp_t disp = {.refr_timer = &refr_timer};
+static lv_indev_drv_t indev_drv = {.read_timer = &read_timer};
+static lv_indev_t indev = {.driver = &indev_drv};
+
+void lv_timer_set_cb(lv_timer_t *timer, lv_timer_cb_t timer_cb) {
+    timer->timer_cb = timer_cb;
+}
+
+uint32_t lv_timer_handler(void) {
+    advance_us(3);
+    read_timer.timer_cb(&read_timer);
+    advance_us(2);
+    refr_timer.timer_cb(&refr_timer);
+    advance_us(1);
+    return 5;
+}
+
+// One main loop iteration: idle_us asleep, then the handler doing c
+static void loop(uint32_t idle_us, call_t c, bool first) {
+    advance_us(idle_us);
+    call = c;
+    uint32_t start = time_us_32();
+    lv_port_prof_timer_handler();
+    uint32_t end = time_us_32();
+
+    if (!first) acc.idle_us += idle_us; // The port counts idle from the first exit on
+    acc.handler_us += end - start;
+    acc.input_us += c.input;
+    if (!c.bands) return;
+
+    acc.seq = frame_seq++;
+    acc.refresh_us = acc.render_us + acc.flush_us;
+    acc.interval_us = end - frame_end_us;
+    frame_end_us = end;
+    if (frames_pending < PROF_FRAME_RING) {
+        exp_frames[n_frames++] = acc;
+        frames_pending++;
+    } else {
+        exp_frames_dropped++;
+    }
+    memset(&acc, 0, sizeof(acc));
+}
+
+static void stream(void) {
+    lv_port_prof_stream();
+    frames_pending = 0;
+    bands_pending = 0;
+}
+
+// --- capture ----------------------------------------------------------------
+
+static uint8_t buf[64 + 16]; // Room to notice an encoder writing past 64
+
+static void put_record(FILE *f, size_t len) {
+    if (len > 64) fail("encoded record longer than 64 bytes");
+    fwrite(buf, 1, len, f);
+}
+
+// Records encoded directly, with the varint length steps and the extremes
+static void hand_records(FILE *f) {
+    static const uint32_t v[] = {0, 1, 127, 128, 16383, 16384, 2097151, 2097152, 268435455, 268435456, UINT32_MAX};
+    const uint32_t nv = sizeof(v) / sizeof(v[0]);
+
+    for (uint32_t i = 0; i < nv; i++) {
+        prof_frame_t fr = {
+            v[i], v[(i + 1) % nv], v[(i + 2) % nv], v[(i + 3) % nv], v[(i + 4) % nv], v[(i + 5) % nv],
+            v[(i + 6) % nv], v[(i + 7) % nv], v[(i + 8) % nv], (uint16_t)v[(i + 9) % nv], (uint16_t)v[(i + 10) % nv],
+        };
+        prof_band_t b = {v[i], (uint16_t)v[(i + 3) % nv], (uint16_t)v[(i + 7) % nv], v[(i + 5) % nv], v[(i + 9) % nv]};
+
+        // In the port's stream order: bands before their frame
+        put_record(f, lv_port_prof_encode_band(&b, buf));
+        exp_bands[n_bands++] = b;
+        put_record(f, lv_port_prof_encode_frame(&fr, buf));
+        exp_frames[n_frames++] = fr;
+    }
+}
+
+static bool write_capture(void) {
+    FILE *f = fopen(CAPTURE, "wb");
+    if (!f) return false;
+
+    fprintf(f, "boot: profiler test\r\n");
+    hand_records(f);
+
+    // A false sync in text, and a record with a payload bit flipped
+    fputs("text with \xa5\x5a\x01\x02 inside\n", f);
+    prof_frame_t bad = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    size_t len = lv_port_prof_encode_frame(&bad, buf);
+    buf[6] ^= 0x10;
+    fwrite(buf, 1, len, f);
+
+    // Recorded frames, streamed after every second one
+    sim_raw_out = f;
+    advance_us(1000);
+    lv_port_prof_init(&disp, &indev);
+    frame_end_us = time_us_32();
+    for (uint32_t i = 0; i < 12; i++) {
+        loop(400 + i, (call_t){20 + i, 0, 0, 0, 0}, i == 0); // Input only, no frame
+        loop(300, (call_t){15, 1 + i % 6, 900 + 10 * i, 2500, 7}, false);
+        if (i % 2) {
+            stream();
+            fprintf(f, "frame %u\n", (unsigned)i);
+        }
+    }
+
+    // Overflow both rings before streaming: 40 frames of 3 bands
+    for (uint32_t i = 0; i < 40; i++) loop(200, (call_t){10, 3, 600, 1800, 4}, false);
+    stream();
+    fprintf(f, "after overflow\n");
+
+    // The drop counters restart after being reported
+    loop(250, (call_t){12, 2, 700, 1900, 5}, false);
+    stream();
+    sim_raw_out = NULL;
+
+    // A record cut short at the end of the capture
+    len = lv_port_prof_encode_frame(&bad, buf);
+    fwrite(buf, 1, len - 3, f);
+    return fclose(f) == 0;
+}
+
+// --- decoder output ---------------------------------------------------------
+
+// fgets without the line end (the csv module writes CR LF)
+static bool read_line(char *line, int size, FILE *f) {
+    if (!fgets(line, size, f)) return false;
+    line[strcspn(line, "\r\n")] = 0;
+    return true;
+}
+
+static void check_frames(void) {
+    FILE *f = fopen(FRAME_CSV, "r");
+    if (!f) {
+        fail("no " FRAME_CSV);
+        return;
+    }
+    char line[256];
+    uint32_t n = 0;
+    if (!read_line(line, sizeof(line), f) ||
+        strcmp(line, "seq,interval_us,handler_us,input_us,refresh_us,render_us,flush_us,idle_us,bytes,areas,bands")) {
+        fail(FRAME_CSV ": bad header");
+    }
+    while (read_line(line, sizeof(line), f)) {
+        unsigned long x[11];
+        if (sscanf(line, "%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu", &x[0], &x[1], &x[2], &x[3], &x[4], &x[5],
+                   &x[6], &x[7], &x[8], &x[9], &x[10]) != 11) {
+            fail(FRAME_CSV ": unparsable row");
+            break;
+        }
+        if (n >= n_frames) {
+            n++;
+            continue;
+        }
+        const prof_frame_t *e = &exp_frames[n];
+        unsigned long want[11] = {e->seq,    e->interval_us, e->handler_us, e->input_us, e->refresh_us, e->render_us,
+                                  e->flush_us, e->idle_us,   e->bytes,      e->areas,    e->bands};
+        if (memcmp(x, want, sizeof(x))) {
+            printf("  frame %u: got", (unsigned)n);
+            for (int i = 0; i < 11; i++) printf(" %lu", x[i]);
+            printf(", want");
+            for (int i = 0; i < 11; i++) printf(" %lu", want[i]);
+            printf("\n");
+            errors++;
+        }
+        n++;
+    }
+    fclose(f);
+    if (n != n_frames) {
+        printf("  %u frames decoded, %u sent\n", (unsigned)n, (unsigned)n_frames);
+        errors++;
+    }
+}
+
+static void check_bands(void) {
+    FILE *f = fopen(BAND_CSV, "r");
+    if (!f) {
+        fail("no " BAND_CSV);
+        return;
+    }
+    char line[256];
+    uint32_t n = 0;
+    if (!read_line(line, sizeof(line), f) || strcmp(line, "seq,y1,y2,render_us,flush_us")) fail(BAND_CSV ": bad header");
+    while (read_line(line, sizeof(line), f)) {
+        unsigned long x[5];
+        if (sscanf(line, "%lu,%lu,%lu,%lu,%lu", &x[0], &x[1], &x[2], &x[3], &x[4]) != 5) {
+            fail(BAND_CSV ": unparsable row");
+            break;
+        }
+        if (n < n_bands) {
+            const prof_band_t *e = &exp_bands[n];
+            unsigned long want[5] = {e->seq, e->y1, e->y2, e->render_us, e->flush_us};
+            if (memcmp(x, want, sizeof(x))) {
+                printf("  band %u: got %lu %lu %lu %lu %lu, want %lu %lu %lu %lu %lu\n", (unsigned)n, x[0], x[1], x[2],
+                       x[3], x[4], want[0], want[1], want[2], want[3], want[4]);
+                errors++;
+            }
+        }
+        n++;
+    }
+    fclose(f);
+    if (n != n_bands) {
+        printf("  %u bands decoded, %u sent\n", (unsigned)n, (unsigned)n_bands);
+        errors++;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("usage: %s path/to/prof_decode.py\n", argv[0]);
+        return 2;
+    }
+
+    printf("encode and record\n");
+    if (!write_capture()) fail("can't write " CAPTURE);
+    if (!exp_frames_dropped || !exp_bands_dropped) fail("the script didn't overflow the rings");
+
+    printf("decode\n");
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "python3 %s " CAPTURE " --csv " FRAME_CSV " --bands-csv " BAND_CSV, argv[1]);
+    FILE *p = popen(cmd, "r");
+    if (!p) {
+        fail("can't run the decoder");
+    } else {
+        char line[256], want[128];
+        bool dropped = false;
+        snprintf(want, sizeof(want), "dropped %u frames / %u bands", (unsigned)exp_frames_dropped,
+                 (unsigned)exp_bands_dropped);
+        while (fgets(line, sizeof(line), p)) dropped |= strstr(line, want) != NULL;
+        if (pclose(p) != 0) fail("decoder failed");
+        if (!dropped) fail("decoder didn't report the dropped records");
+    }
+    check_frames();
+    check_bands();
+
+    printf("%u frames, %u bands, %u/%u dropped\n", (unsigned)n_frames, (unsigned)n_bands,
+           (unsigned)exp_frames_dropped, (unsigned)exp_bands_dropped);
+    return check_result();
+}
@@ -0,0 +1,349 @@
+// Tickless scheduler on the host: lv_port_sched.c drives stand-ins for the
+// LVGL timers (the due rule and time-till-next of LVGL 8.3's
+// lv_timer_handler()) in virtual time, with the touch driver on the XPT2046
+// model. Checks that no timer starts later than its due time or the end of
+// the handler pass before it, idle or behind long refreshes; that an idle
+// screen sleeps from one deadline to the next without extra wakes, skipped
+// runs or touch polling; that a pen-down wakes the loop at the edge and
+// polling goes on until the release and the scroll throw after it are over;
+// that lv_port_sched_wake() from an IRQ or from a timer callback makes the
+// next step return true at once; and that with no timer pending the sleep
+// ends after SCHED_MAX_SLEEP_MS. Exits 1 on any mismatch. No LVGL.
+//
+//     gcc -O2 -DLV_PORT_TICKLESS=1 -Isim/hal -Isim -Isim/nolvgl -Iinc -I. sim/sched_sim.c sim/st7789_model.c
+//         sim/xpt2046_model.c sim/sim_png.c sim/hal/sim_hal.c src/st7789.c src/xpt2046.c src/spi_bus.c
+//         src/port_log.c src/lv_port_sched.c -o sched_sim
+
+#include "lv_port_sched.h"
+#include "st7789.h"
+#include "xpt2046.h"
+#include "port_log.h"
+#include "st7789_model.h"
+#include "xpt2046_model.h"
+#include "sim_hal.h"
+#include "check.h"
+#include <stdio.h>
+
+#if !LV_PORT_TICKLESS
+#error "build with -DLV_PORT_TICKLESS=1, see above"
+#endif
+
+#define IDLE_MS     5000
+#define BUSY_MS     3000
+#define BUSY_REFR_US 12000 // A refresh rendering and flushing most of the screen
+#define TAPS        4
+#define PRESS_MS    200
+#define THROW_READS 5      // Reads a scroll throw goes on after the release
+#define MSGS        20
+#define MSG_US      45000
+
+static st7789_model_t panel;
+static xpt2046_model_t touch;
+
+// --- LVGL stand-ins ---------------------------------------------------------
+
+typedef struct {
+    lv_timer_t t;           // First, the callbacks get this
+    const char *name;
+    uint32_t work_us;       // Virtual time each run takes
+    uint64_t ready_us;      // Made ready by lv_timer_ready() at
+    uint32_t runs;
+    uint32_t late;          // Started after both its due time and the previous pass
+    uint32_t wait_max_us;   // Due -> run
+} stand_in_t;
+
+static void refr_cb(lv_timer_t *t);
+static void read_cb(lv_timer_t *t);
+static void app_cb(lv_timer_t *t);
+
+static stand_in_t refr = {{LV_DISP_DEF_REFR_PERIOD, 0, refr_cb}, "refr"};
+static stand_in_t poll = {{LV_INDEV_DEF_READ_PERIOD, 0, read_cb}, "read"};
+static stand_in_t app_7 = {{7, 0, app_cb}, "app 7 ms"};
+static stand_in_t app_100 = {{100, 0, app_cb}, "app 100 ms"};
+static stand_in_t app_250 = {{250, 0, app_cb}, "app 250 ms"};
+
+// In creation order, as in LVGL's timer list
+static stand_in_t *const timers[] = {&refr, &poll, &app_7, &app_100, &app_250};
+#define TIMER_COUNT (sizeof(timers) / sizeof(timers[0]))
+
+static lv_indev_drv_t indev_drv = {.read_timer = &poll.t};
+static lv_indev_t indev = {.driver = &indev_drv};
+
+static uint64_t pass_end_us;
+static uint32_t pass_max_us;
+
+static uint32_t tick(void) {
+    return (uint32_t)(time_us_64() / 1000);
+}
+
+static uint32_t remaining(const lv_timer_t *t) {
+    uint32_t elapsed = tick() - t->last_run;
+    return elapsed >= t->period ? 0 : t->period - elapsed;
+}
+
+void lv_timer_set_cb(lv_timer_t *timer, lv_timer_cb_t timer_cb) {
+    timer->timer_cb = timer_cb;
+}
+
+void lv_timer_pause(lv_timer_t *timer) {
+    timer->paused = 1;
+}
+
+void lv_timer_resume(lv_timer_t *timer) {
+    timer->paused = 0;
+}
+
+void lv_timer_ready(lv_timer_t *timer) {
+    timer->last_run = tick() - timer->period - 1;
+    ((stand_in_t *)timer)->ready_us = time_us_64();
+}
+
+uint32_t lv_timer_handler(void) {
+    uint64_t start = time_us_64();
+    uint64_t prev_end = pass_end_us;
+
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) {
+        stand_in_t *s = timers[i];
+        if (s->t.paused || remaining(&s->t)) continue;
+
+        uint64_t due = (uint64_t)(s->t.last_run + s->t.period) * 1000;
+        if (s->ready_us > due) due = s->ready_us;
+        // Only the work of this pass and of the one before may delay it
+        if (start > due && start > prev_end) s->late++;
+        uint64_t wait = time_us_64() - due;
+        if (wait > s->wait_max_us) s->wait_max_us = (uint32_t)wait;
+
+        s->t.last_run = tick();
+        s->runs++;
+        s->t.timer_cb(&s->t);
+        if (s->work_us) sim_advance_ns((uint64_t)s->work_us * 1000);
+    }
+
+    uint32_t next = LV_NO_TIMER_READY;
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) {
+        if (timers[i]->t.paused) continue;
+        uint32_t r = remaining(&timers[i]->t);
+        if (r < next) next = r;
+    }
+
+    pass_end_us = time_us_64();
+    if (pass_end_us - start > pass_max_us) pass_max_us = (uint32_t)(pass_end_us - start);
+    return next;
+}
+
+static void refr_cb(lv_timer_t *t) {
+    (void)t;
+}
+
+// What LVGL's pointer processing leaves in proc: pressed while the pen is
+// down, then a scroll throw for THROW_READS more reads
+static uint32_t throw_left;
+static uint32_t reads_released;
+static int scroll_target;
+
+static void read_cb(lv_timer_t *t) {
+    (void)t;
+    if (xpt2046_is_touched()) {
+        indev.proc.state = LV_INDEV_STATE_PRESSED;
+        return;
+    }
+    reads_released++;
+    if (indev.proc.state == LV_INDEV_STATE_PRESSED) {
+        indev.proc.state = LV_INDEV_STATE_RELEASED;
+        indev.proc.types.pointer.scroll_obj = (lv_obj_t *)&scroll_target;
+        throw_left = THROW_READS;
+    } else if (throw_left && --throw_left == 0) {
+        indev.proc.types.pointer.scroll_obj = NULL;
+    }
+}
+
+// --- wakes ------------------------------------------------------------------
+
+static uint64_t wake_us;     // Last lv_port_sched_wake() call
+static uint32_t wakes;
+static uint32_t msg_returns;
+static uint32_t msg_delay_max_us;
+static bool wake_from_timer; // app_250 calls lv_port_sched_wake() too
+
+static void wake(void) {
+    wake_us = time_us_64();
+    wakes++;
+    lv_port_sched_wake();
+}
+
+static void app_cb(lv_timer_t *t) {
+    if (t == &app_250.t && wake_from_timer) wake();
+}
+
+static uint32_t msgs_left;
+
+static bool msg_irq(repeating_timer_t *rt) {
+    (void)rt;
+    wake();
+    return --msgs_left > 0;
+}
+
+// --- run --------------------------------------------------------------------
+
+static void run_ms(uint32_t ms) {
+    uint64_t end = time_us_64() + (uint64_t)ms * 1000;
+    while (time_us_64() < end) {
+        if (lv_port_sched_step()) {
+            uint32_t delay = (uint32_t)(time_us_64() - wake_us);
+            if (delay > msg_delay_max_us) msg_delay_max_us = delay;
+            msg_returns++;
+        }
+    }
+    port_log_flush(0);
+}
+
+static void reset(void) {
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) {
+        stand_in_t *s = timers[i];
+        s->runs = s->late = s->wait_max_us = 0;
+    }
+    pass_max_us = 0;
+    lv_port_sched_reset_stats();
+}
+
+static void print_timers(void) {
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) {
+        stand_in_t *s = timers[i];
+        printf("  %-10s %5lu runs, waited max %5lu us, %lu late\n", s->name, (unsigned long)s->runs,
+               (unsigned long)s->wait_max_us, (unsigned long)s->late);
+    }
+}
+
+static void check_deadlines(void) {
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) {
+        if (timers[i]->late) {
+            printf("  %s ran late\n", timers[i]->name);
+            errors++;
+        }
+    }
+}
+
+int main(void) {
+    lv_port_sched_stats_t s;
+
+    st7789_model_attach(&panel, SPI_PORT, PIN_CS, PIN_DC);
+#if SPI_BUS_SHARED
+    xpt2046_model_attach(&touch, SPI_PORT, PIN_XPT_CS, PIN_XPT_IRQ);
+#else
+    xpt2046_model_attach(&touch, XPT_SPI_PORT, PIN_XPT_CS, PIN_XPT_IRQ);
+#endif
+    st7789_init();
+    xpt2046_init();
+
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) timers[i]->t.last_run = tick();
+    lv_port_sched_set_indev(&indev);
+    run_ms(300);
+
+    // Nothing changes on screen: every wake is a deadline
+    printf("idle\n");
+    reset();
+    run_ms(IDLE_MS);
+    lv_port_sched_print();
+    print_timers();
+    lv_port_sched_get_stats(&s);
+    check_deadlines();
+    uint32_t runs = 0;
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) {
+        stand_in_t *t = timers[i];
+        runs += t->runs;
+        if (t != &poll && t->runs + 1 < IDLE_MS / t->t.period) {
+            printf("  %s skipped runs\n", t->name);
+            errors++;
+        }
+        if (t->wait_max_us) {
+            printf("  %s waited past its due time\n", t->name);
+            errors++;
+        }
+    }
+    if (poll.runs) fail("touch polled while idle");
+    if (s.steps > runs + 1) fail("wakes without a timer due");
+    if (s.wake_touch || s.wake_msg) fail("idle wakes not from a timer");
+    if (s.timer_late_max_us) fail("scheduler woke after a deadline");
+    if (s.sleep_us * 100 < s.total_us * 99) fail("idle screen not asleep");
+
+    // Long refreshes: the other timers wait behind them, no longer
+    printf("busy\n");
+    refr.work_us = BUSY_REFR_US;
+    app_7.work_us = 1000;
+    reset();
+    run_ms(BUSY_MS);
+    lv_port_sched_print();
+    print_timers();
+    printf("  longest pass %lu us\n", (unsigned long)pass_max_us);
+    check_deadlines();
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) {
+        if (timers[i]->wait_max_us > 2 * pass_max_us) {
+            printf("  %s waited more than two passes\n", timers[i]->name);
+            errors++;
+        }
+    }
+    refr.work_us = 0;
+    app_7.work_us = 0;
+
+    // Taps on the model: the pen edge wakes the loop and resumes polling
+    printf("taps\n");
+    reset();
+    for (uint32_t i = 0; i < TAPS; i++) {
+        uint64_t t0 = time_us_64();
+        const xpt2046_model_event_t script[] = {
+            {t0 + 10000 + 3100 * i, true, 2000, 2000, 600},
+            {t0 + 10000 + 3100 * i + PRESS_MS * 1000, false, 0, 0, 0},
+        };
+        uint32_t read_runs = poll.runs;
+        reads_released = 0;
+        xpt2046_model_play(&touch, script, 2);
+        run_ms(PRESS_MS + 500);
+        uint32_t pressed_reads = poll.runs - read_runs - reads_released;
+        if (pressed_reads + 1 < PRESS_MS / LV_INDEV_DEF_READ_PERIOD) fail("touch not polled while pressed");
+        if (reads_released != THROW_READS + 1) {
+            printf("  %lu reads after the release, %u expected\n", (unsigned long)reads_released, THROW_READS + 1);
+            errors++;
+        }
+        if (!poll.t.paused) fail("touch polling not paused after the throw");
+    }
+    lv_port_sched_print();
+    print_timers();
+    lv_port_sched_get_stats(&s);
+    check_deadlines();
+    if (s.wake_touch != TAPS) fail("not one touch wake per tap");
+    if (s.touch_wake_max_us) fail("touch wake after the pen edge");
+
+    // lv_port_sched_wake() from an IRQ while asleep and from a timer
+    // callback while awake
+    printf("messages\n");
+    reset();
+    repeating_timer_t msg_timer;
+    msgs_left = MSGS;
+    wakes = msg_returns = msg_delay_max_us = 0;
+    wake_from_timer = true;
+    add_repeating_timer_us(-MSG_US, msg_irq, NULL, &msg_timer);
+    run_ms(MSGS * MSG_US / 1000 + 300);
+    wake_from_timer = false;
+    lv_port_sched_print();
+    printf("  %lu wakes, %lu returns, max delay %lu us\n", (unsigned long)wakes, (unsigned long)msg_returns,
+           (unsigned long)msg_delay_max_us);
+    lv_port_sched_get_stats(&s);
+    check_deadlines();
+    if (wakes <= MSGS) fail("no wake from the timer callback");
+    if (msg_returns != wakes || s.wake_msg != wakes) fail("a wake was lost");
+    if (msg_delay_max_us) fail("step returned after the wake");
+
+    // No timer pending
+    printf("nothing pending\n");
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) lv_timer_pause(&timers[i]->t);
+    reset();
+    uint64_t t0 = time_us_64();
+    lv_port_sched_step();
+    uint64_t slept = time_us_64() - t0;
+    printf("  slept %llu us\n", (unsigned long long)slept);
+    if (slept > SCHED_MAX_SLEEP_MS * 1000 || slept + 1000 <= SCHED_MAX_SLEEP_MS * 1000) {
+        fail("sleep not capped at SCHED_MAX_SLEEP_MS");
+    }
+
+    return check_result();
+}
@@ -0,0 +1,185 @@
+// Screen cache eviction on the host display: five registered screens of
+// four build steps each. Checks that beyond the alive limit the least
+// recently shown screen goes, that the memory budget evicts too, that the
+// active screen, the one animated out, the one still to be loaded and the
+// one being built are never evicted, and that an allocation failing for
+// lack of heap gets the reserve without any screen being deleted inside
+// the allocator; the idle timer evicts afterwards and takes the reserve
+// again. Exits 1 on any mismatch. Needs the LVGL 8.3 sources, see "Host
+// simulator" in README.md.
+
+#include "lvgl.h"
+#include "lv_port_disp.h"
+#include "lv_port_mem.h"
+#include "lv_port_scrcache.h"
+#include "port_log.h"
+#include "st7789_model.h"
+#include "check.h"
+#include <stdio.h>
+
+#if !LV_PORT_SCREEN_CACHE || !LV_MEM_CUSTOM
+#error "build with -DLV_PORT_SCREEN_CACHE=1 and LV_MEM_CUSTOM 1 in lv_conf.h"
+#endif
+
+#define SCREENS 5
+#define STEPS   4
+
+static st7789_model_t panel;
+static int32_t ids[SCREENS];
+static const char *names[SCREENS] = { "A", "B", "C", "D", "E" };
+static uint32_t deleted_during_alloc;
+static bool in_alloc;
+
+static void run_ms(uint32_t ms) {
+    uint64_t end = time_us_64() + (uint64_t)ms * 1000;
+    while (time_us_64() < end) {
+        lv_timer_handler();
+        sleep_ms(5);
+    }
+    port_log_flush(0);
+}
+
+static void deleted_cb(lv_event_t *e) {
+    (void)e;
+    if (in_alloc) deleted_during_alloc++;
+}
+
+static bool build(lv_obj_t *scr, uint32_t step) {
+    if (step == 0) lv_obj_add_event_cb(scr, deleted_cb, LV_EVENT_DELETE, NULL);
+    for (uint32_t i = 0; i < 8; i++) {
+        lv_obj_t *label = lv_label_create(scr);
+        lv_label_set_text_fmt(label, "row %lu", (unsigned long)(step * 8 + i));
+        lv_obj_set_pos(label, 10, (lv_coord_t)((step * 8 + i) * 9));
+    }
+    return step + 1 == STEPS;
+}
+
+static bool alive(uint32_t i) {
+    lv_port_scrcache_stats_t s;
+    lv_port_scrcache_get_stats(ids[i], &s);
+    return s.alive;
+}
+
+// Alive screens as a string like "AC-E" ('-' for deleted ones)
+static const char *alive_set(void) {
+    static char buf[SCREENS + 1];
+    for (uint32_t i = 0; i < SCREENS; i++) buf[i] = alive(i) ? names[i][0] : '-';
+    buf[SCREENS] = 0;
+    return buf;
+}
+
+static void expect_alive(const char *what, const char *expect) {
+    const char *got = alive_set();
+    printf("  %-34s %s\n", what, got);
+    for (uint32_t i = 0; i < SCREENS; i++) {
+        if (got[i] != expect[i]) {
+            fail("wrong screens alive");
+            return;
+        }
+    }
+}
+
+static void check_lru(void) {
+    printf("alive limit\n");
+    lv_port_scrcache_set_limits(3, 1024 * 1024);
+    for (uint32_t i = 0; i < 4; i++) {
+        lv_port_scrcache_show(ids[i], LV_SCR_LOAD_ANIM_NONE, 0);
+        run_ms(20);
+    }
+    expect_alive("A B C D shown", "-BCD-");
+    lv_port_scrcache_show(ids[1], LV_SCR_LOAD_ANIM_NONE, 0); // B is recent now
+    run_ms(20);
+    lv_port_scrcache_show(ids[4], LV_SCR_LOAD_ANIM_NONE, 0);
+    run_ms(20);
+    expect_alive("then B, E", "-B-DE");
+
+    printf("memory budget\n");
+    lv_port_scrcache_stats_t s;
+    lv_port_scrcache_get_stats(ids[4], &s);
+    lv_port_scrcache_set_limits(3, s.mem_bytes + s.mem_bytes / 2);
+    expect_alive("room for one and a half", "----E");
+}
+
+static void check_in_use(void) {
+    printf("screens in use\n");
+    lv_port_scrcache_set_limits(3, 1024 * 1024);
+    lv_port_scrcache_show(ids[0], LV_SCR_LOAD_ANIM_NONE, 0);
+    run_ms(20);
+
+    // Before the animation starts B is only scr_to_act, A still active
+    lv_port_scrcache_show(ids[1], LV_SCR_LOAD_ANIM_MOVE_LEFT, 300);
+    lv_port_scrcache_set_limits(1, 1024 * 1024);
+    expect_alive("B to be loaded, A active", "AB---");
+
+    // During it A is prev_scr
+    run_ms(100);
+    lv_port_scrcache_set_limits(1, 1024 * 1024);
+    expect_alive("A animated out", "AB---");
+
+    run_ms(400);
+    lv_port_scrcache_set_limits(1, 1024 * 1024);
+    expect_alive("animation over", "-B---");
+
+    // A prefetched screen being built survives its own room-making
+    lv_port_scrcache_prefetch(ids[2]);
+    run_ms(100);
+    expect_alive("C prefetched with room for one", "-BC--");
+}
+
+static void check_oom(void) {
+    printf("out of heap\n");
+    lv_port_scrcache_set_limits(3, 1024 * 1024);
+    for (uint32_t i = 0; i < 3; i++) {
+        lv_port_scrcache_show(ids[i], LV_SCR_LOAD_ANIM_NONE, 0);
+        run_ms(20);
+    }
+    expect_alive("A B C", "ABC--");
+
+    // Fill the heap so the next allocation can't be served
+    static void *fill[512];
+    uint32_t n = 0;
+    lv_port_mem_stats_t ms;
+    lv_port_mem_get_stats(&ms);
+    uint32_t fails = ms.fail_count;
+    for (size_t size = 4096; size >= 256; size /= 2) {
+        for (;;) {
+            lv_port_mem_get_stats(&ms);
+            if (ms.largest_free < size + size / 8 + 64 || n == 512) break; // Room after TLSF rounding
+            fill[n++] = lv_mem_alloc(size);
+        }
+    }
+
+    in_alloc = true;
+    void *p = lv_mem_alloc(SCRCACHE_OOM_RESERVE / 2);
+    in_alloc = false;
+    lv_port_mem_get_stats(&ms);
+    printf("  %u blocks filled, allocation %s, %lu deleted inside\n", n, p ? "served" : "failed",
+           (unsigned long)deleted_during_alloc);
+    if (!p) fail("reserve not lent");
+    if (deleted_during_alloc) fail("screen deleted inside the allocator");
+    if (ms.fail_count != fails) fail("allocation counted as failed");
+    expect_alive("right after", "ABC--");
+
+    run_ms(50);
+    expect_alive("after the idle timer", "-BC--");
+    lv_mem_free(p);
+    while (n) lv_mem_free(fill[--n]);
+    port_log_flush(0);
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    st7789_model_attach(&panel, SPI_PORT, PIN_CS, PIN_DC);
+    lv_init();
+    lv_port_disp_init();
+    for (uint32_t i = 0; i < SCREENS; i++) ids[i] = lv_port_scrcache_register(names[i], build);
+    port_log_flush(0);
+
+    check_lru();
+    check_in_use();
+    check_oom();
+    lv_port_scrcache_print();
+
+    return check_result();
+}
@@ -0,0 +1,101 @@
+#include "sim_png.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t crc_table[256];
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t len) {
+    if (!crc_table[1]) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crc_table[n] = c;
+        }
+    }
+    for (size_t i = 0; i < len; i++) crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void write_chunk(FILE *f, const char *type, const uint8_t *data, uint32_t len) {
+    uint8_t hdr[8];
+    put_be32(hdr, len);
+    memcpy(hdr + 4, type, 4);
+    fwrite(hdr, 1, 8, f);
+    if (len) fwrite(data, 1, len, f);
+    uint32_t crc = crc32_update(0xFFFFFFFFu, hdr + 4, 4);
+    crc = crc32_update(crc, data, len) ^ 0xFFFFFFFFu;
+    uint8_t tail[4];
+    put_be32(tail, crc);
+    fwrite(tail, 1, 4, f);
+}
+
+bool sim_png_write(const char *path, const uint8_t *rgb, uint32_t w, uint32_t h) {
+    static const uint8_t sig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    uint32_t row = 1 + w * 3;
+    uint32_t raw_len = row * h;
+    uint32_t blocks = (raw_len + 65534) / 65535;
+    uint32_t z_len = 2 + raw_len + blocks * 5 + 4;
+    uint8_t *z = malloc(z_len);
+    uint8_t *raw = malloc(raw_len);
+    FILE *f = fopen(path, "wb");
+    if (!z || !raw || !f) {
+        free(z);
+        free(raw);
+        if (f) fclose(f);
+        return false;
+    }
+
+    for (uint32_t y = 0; y < h; y++) {
+        raw[y * row] = 0; // Filter: none
+        memcpy(&raw[y * row + 1], &rgb[y * w * 3], w * 3);
+    }
+
+    // zlib stream of stored blocks + Adler-32
+    uint8_t *p = z;
+    *p++ = 0x78;
+    *p++ = 0x01;
+    uint32_t a = 1, b = 0;
+    for (uint32_t off = 0; off < raw_len;) {
+        uint32_t n = raw_len - off < 65535 ? raw_len - off : 65535;
+        *p++ = off + n == raw_len; // BFINAL, BTYPE 00
+        *p++ = (uint8_t)n;
+        *p++ = (uint8_t)(n >> 8);
+        *p++ = (uint8_t)~n;
+        *p++ = (uint8_t)(~n >> 8);
+        memcpy(p, &raw[off], n);
+        for (uint32_t i = 0; i < n; i++) {
+            a = (a + raw[off + i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        p += n;
+        off += n;
+    }
+    put_be32(p, (b << 16) | a);
+
+    uint8_t ihdr[13];
+    put_be32(ihdr, w);
+    put_be32(ihdr + 4, h);
+    ihdr[8] = 8;  // Bit depth
+    ihdr[9] = 2;  // Truecolour
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+
+    fwrite(sig, 1, sizeof(sig), f);
+    write_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+    write_chunk(f, "IDAT", z, z_len);
+    write_chunk(f, "IEND", NULL, 0);
+    bool ok = ferror(f) == 0;
+    fclose(f);
+    free(z);
+    free(raw);
+    return ok;
+}
@@ -0,0 +1,11 @@
+#ifndef SIM_PNG_H
+#define SIM_PNG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Writes 8-bit RGB rows as a PNG with stored (uncompressed) deflate blocks,
+// so the simulator needs no zlib/libpng
+bool sim_png_write(const char *path, const uint8_t *rgb, uint32_t w, uint32_t h);
+
+#endif // SIM_PNG_H
@@ -0,0 +1,264 @@
+// Shared SPI bus on the host: a recording display and touch device on one
+// SPI, driven through spi_bus. Checks that a submit on an idle bus runs at
+// once, that transactions queued during a stream run in the gaps by
+// priority and then submission order, at most SPI_BUS_GAP_TXNS per gap,
+// that resume() runs after each gap with the display selected at its rate
+// again, that the streamed rows arrive intact, that a full queue rejects
+// submits, that work queued during the last burst runs before the stream
+// returns, and that a 1 kHz touch sampler during a full frame waits at most
+// about one burst. Exits 1 on any mismatch. No LVGL.
+//
+//     gcc -O2 -DSPI_BUS_SHARED=1 -Isim/hal -Isim -Isim/nolvgl -Iinc -I. sim/spi_bus_sim.c sim/hal/sim_hal.c
+//         src/spi_bus.c src/port_log.c -o spi_bus_sim
+//     ./spi_bus_sim
+
+#include "spi_bus.h"
+#include "check.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BUS         spi0
+#define CS_DISPLAY  20
+#define CS_TOUCH    21
+#define DISP_BAUD   62500000
+#define TOUCH_BAUD  2000000 // Asked for, the divider gives touch_baud
+#define FRAME_BYTES (240 * 320 * 2)
+#define MAX_TXNS    256
+
+static uint8_t frame[FRAME_BYTES];
+static uint8_t seen[FRAME_BYTES]; // Display data bytes as clocked
+static uint32_t nseen;
+static bool in_resume;
+static uint32_t resumes, bad_resumes;
+static bool touch_last; // Last byte on the bus went to the touch device
+static uint32_t touch_baud;
+static uint32_t wrong_baud;
+
+// Per completed transaction: its id and how many display bytes preceded it
+static struct {
+    uint8_t id;
+    uint32_t at;
+} done[MAX_TXNS];
+static uint32_t ndone;
+
+static uint32_t bus_baud(void) {
+    sim_spi_stats_t s;
+    sim_spi_get_stats(spi_get_index(BUS), &s);
+    return s.baud;
+}
+
+static uint8_t display_xfer(void *ctx, uint8_t mosi) {
+    (void)ctx;
+    if (bus_baud() != DISP_BAUD) wrong_baud++;
+    if (in_resume) {
+        resumes++;
+        if (!touch_last) bad_resumes++; // Only after a gap
+    } else if (nseen < FRAME_BYTES) {
+        seen[nseen++] = mosi;
+    }
+    touch_last = false;
+    return 0xFF;
+}
+
+static uint8_t touch_xfer(void *ctx, uint8_t mosi) {
+    (void)ctx;
+    if (bus_baud() != touch_baud) wrong_baud++;
+    touch_last = true;
+    return (uint8_t)~mosi;
+}
+
+// Stands in for the panel's WRMEMC
+static void resume(void) {
+    static const uint8_t cmd = 0x3C;
+    in_resume = true;
+    spi_write_blocking(BUS, &cmd, 1);
+    in_resume = false;
+}
+
+static void txn_done(const uint8_t *rx, size_t len, void *ctx) {
+    const uint8_t *tx = ctx;
+    for (size_t i = 0; i < len; i++) {
+        if (rx[i] != (uint8_t)~tx[i]) {
+            fail("wrong bytes clocked in");
+            break;
+        }
+    }
+    if (ndone < MAX_TXNS) {
+        done[ndone].id = tx[0];
+        done[ndone].at = nseen;
+        ndone++;
+    }
+}
+
+static const uint8_t txn_tx[8][3] = {{0, 1, 2}, {1, 1, 2}, {2, 1, 2}, {3, 1, 2},
+                                     {4, 1, 2}, {5, 1, 2}, {6, 1, 2}, {7, 1, 2}};
+
+static bool submit(uint8_t id, spi_bus_prio_t prio) {
+    return spi_bus_submit(SPI_BUS_DEV_TOUCH, prio, txn_tx[id], sizeof(txn_tx[id]), txn_done, (void *)txn_tx[id]);
+}
+
+static void reset(void) {
+    nseen = 0;
+    ndone = 0;
+    resumes = bad_resumes = 0;
+    wrong_baud = 0;
+}
+
+// Streams h rows of row_bytes from frame, stride apart, and checks they arrived
+static void stream_and_check(size_t row_bytes, size_t h, size_t stride) {
+    spi_bus_stream(SPI_BUS_DEV_DISPLAY, frame, row_bytes, h, stride, resume);
+    bool intact = nseen == row_bytes * h;
+    for (size_t y = 0; intact && y < h; y++) {
+        intact = !memcmp(seen + y * row_bytes, frame + y * stride, row_bytes);
+    }
+    if (!intact) fail("streamed rows differ");
+}
+
+// --- a submit on an idle bus ---------------------------------------------------
+
+static void check_idle(void) {
+    printf("idle submit\n");
+    reset();
+    if (!submit(0, SPI_BUS_PRIO_LOW)) fail("rejected");
+    if (ndone != 1) fail("didn't run at once");
+}
+
+// --- priority and order in the gaps -------------------------------------------
+
+static repeating_timer_t timer;
+static bool queue_full_seen;
+
+static bool submit_four(repeating_timer_t *rt) {
+    (void)rt;
+    submit(1, SPI_BUS_PRIO_LOW);
+    submit(2, SPI_BUS_PRIO_HIGH);
+    submit(3, SPI_BUS_PRIO_LOW);
+    submit(4, SPI_BUS_PRIO_HIGH);
+    queue_full_seen = !submit(5, SPI_BUS_PRIO_HIGH);
+    return false;
+}
+
+static void check_gaps(void) {
+    printf("four queued during a stream\n");
+    static const uint8_t expect[] = {2, 4, 1, 3}; // High first, then submission order
+    reset();
+    spi_bus_stats_t before, after;
+    spi_bus_get_stats(&before);
+    add_repeating_timer_us(20, submit_four, NULL, &timer);
+    stream_and_check(480, 64, 512); // 30 KB, 30 bursts
+    spi_bus_get_stats(&after);
+
+    printf("  ran:");
+    for (uint32_t i = 0; i < ndone; i++) printf(" %u@%lu", done[i].id, (unsigned long)done[i].at);
+    printf(", %lu gaps, %lu resumes\n", (unsigned long)(after.gaps - before.gaps), (unsigned long)resumes);
+
+    if (!queue_full_seen || after.queue_full != before.queue_full + 1) fail("fifth submit not rejected");
+    if (ndone != 4) {
+        fail("not all ran");
+        return;
+    }
+    for (uint32_t i = 0; i < 4; i++) {
+        if (done[i].id != expect[i]) fail("wrong order");
+    }
+    // SPI_BUS_GAP_TXNS per gap, the stream goes on in between
+    for (uint32_t i = SPI_BUS_GAP_TXNS; i < 4; i++) {
+        if (done[i].at == done[i - SPI_BUS_GAP_TXNS].at) fail("more than SPI_BUS_GAP_TXNS in a gap");
+    }
+    if (done[3].at >= nseen) fail("waited for the end of the stream");
+    if (after.gaps - before.gaps != (4 + SPI_BUS_GAP_TXNS - 1) / SPI_BUS_GAP_TXNS) fail("gap count");
+    if (resumes != after.gaps - before.gaps || bad_resumes) fail("resume not once after each gap");
+    if (wrong_baud) fail("byte at the other device's rate");
+}
+
+// --- queued during the last burst ------------------------------------------------
+
+static void chain_done(const uint8_t *rx, size_t len, void *ctx) {
+    txn_done(rx, len, ctx);
+    submit(7, SPI_BUS_PRIO_LOW); // The stream still holds the bus
+}
+
+static bool submit_chain(repeating_timer_t *rt) {
+    (void)rt;
+    spi_bus_submit(SPI_BUS_DEV_TOUCH, SPI_BUS_PRIO_HIGH, txn_tx[6], 3, chain_done, (void *)txn_tx[6]);
+    return false;
+}
+
+static void check_release(void) {
+    printf("queued during the last burst\n");
+    reset();
+    // Two bursts of 131 us: 6 is queued during the second and last one and
+    // queues 7 when it runs; both must run when the stream releases the
+    // bus, before it returns
+    add_repeating_timer_us(200, submit_chain, NULL, &timer);
+    spi_bus_stream(SPI_BUS_DEV_DISPLAY, frame, 2 * SPI_BUS_BURST, 1, 0, resume);
+    printf("  ran:");
+    for (uint32_t i = 0; i < ndone; i++) printf(" %u@%lu", done[i].id, (unsigned long)done[i].at);
+    printf("\n");
+    if (ndone != 2 || done[0].id != 6 || done[1].id != 7) {
+        fail("not run before the stream returned");
+    } else if (done[0].at != 2 * SPI_BUS_BURST || done[1].at != 2 * SPI_BUS_BURST) {
+        fail("ran at the wrong place");
+    }
+}
+
+// --- touch sampling during a full frame -------------------------------------------
+
+static uint32_t samples, sample_rejects;
+
+static bool sample_tick(repeating_timer_t *rt) {
+    (void)rt;
+    if (submit(0, SPI_BUS_PRIO_HIGH)) samples++;
+    else sample_rejects++;
+    return true;
+}
+
+static void check_fairness(void) {
+    printf("1 kHz touch sampling during a frame\n");
+    reset();
+    spi_bus_stats_t before, after;
+    spi_bus_get_stats(&before);
+    sim_spi_reset_stats();
+    uint64_t t0 = time_us_64();
+    add_repeating_timer_us(-1000, sample_tick, NULL, &timer);
+    stream_and_check(480, 320, 480);
+    cancel_repeating_timer(&timer);
+    uint64_t dt = time_us_64() - t0;
+    spi_bus_get_stats(&after);
+    sim_spi_stats_t bus;
+    sim_spi_get_stats(spi_get_index(BUS), &bus);
+
+    double frame_us = FRAME_BYTES * 8.0 / DISP_BAUD * 1e6;
+    double burst_us = SPI_BUS_BURST * 8.0 / DISP_BAUD * 1e6;
+    double txn_us = 3 * 8.0 / touch_baud * 1e6;
+    printf("  frame %llu us (%.0f us of pixels), %lu samples, wait max %lu us (burst %.0f us)\n",
+           (unsigned long long)dt, frame_us, (unsigned long)samples, (unsigned long)after.txn_wait_max_us, burst_us);
+
+    // A tick runs up to a burst late and the next one is 1 ms after it
+    if (samples < (uint32_t)(frame_us / (1000 + burst_us)) || ndone != samples) fail("samples missing");
+    if (sample_rejects) fail("queue full at 1 kHz");
+    if (after.txn_wait_max_us > burst_us + SPI_BUS_GAP_TXNS * txn_us + 5) fail("a sample waited beyond a burst");
+    // The frame only pays for the samples and their resumes
+    if (dt > frame_us + samples * (txn_us + 2) + 20) fail("frame stalled");
+    if (resumes != after.gaps - before.gaps || bad_resumes || wrong_baud) fail("resume or rate wrong");
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    for (uint32_t i = 0; i < FRAME_BYTES; i++) frame[i] = (uint8_t)(i * 131 + (i >> 9));
+
+    spi_bus_init(BUS, 2, 3, 4);
+    spi_bus_add_device(SPI_BUS_DEV_DISPLAY, CS_DISPLAY, DISP_BAUD);
+    spi_bus_add_device(SPI_BUS_DEV_TOUCH, CS_TOUCH, TOUCH_BAUD);
+    sim_spi_attach(BUS, CS_DISPLAY, display_xfer, NULL);
+    sim_spi_attach(BUS, CS_TOUCH, touch_xfer, NULL);
+    if (spi_bus_set_baud(SPI_BUS_DEV_DISPLAY, DISP_BAUD) != DISP_BAUD) fail("display rate not exact");
+    touch_baud = spi_bus_set_baud(SPI_BUS_DEV_TOUCH, TOUCH_BAUD);
+
+    check_idle();
+    check_gaps();
+    check_release();
+    check_fairness();
+
+    return check_result();
+}
@@ -0,0 +1,164 @@
+// SPI clock tuning on the host: runs the rate search against synthetic
+// links with known limits (hard cut-offs, a marginal band, none working,
+// none failing) and checks the pick keeps its margin, then tunes the panel
+// model with a link limit, checks the stored rate is reused and that a
+// worse link makes it tune again.
+// Exits 1 on any mismatch. No LVGL.
+//
+//     gcc -O2 -DSPI_CLOCK_TUNE=1 -Isim/hal -Isim -Isim/nolvgl -Iinc -I. sim/spi_tune_sim.c sim/st7789_model.c
+//         sim/sim_png.c sim/hal/sim_hal.c src/st7789.c src/spi_bus.c src/port_log.c src/spi_tune.c -o spi_tune_sim
+//     ./spi_tune_sim
+
+#include "st7789.h"
+#include "hardware/flash.h"
+#include "port_log.h"
+#include "spi_tune.h"
+#include "st7789_model.h"
+#include "check.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MHZ(x) ((uint32_t)((x) * 1000000.0))
+
+static st7789_model_t panel;
+
+// Fails above limit; between marginal and limit fails fail_pct of the patterns
+typedef struct {
+    const char *name;
+    uint32_t limit;
+    uint32_t marginal;
+    uint32_t fail_pct;
+    uint32_t expect; // 0: no rate may pass
+} link_t;
+
+static const link_t links[] = {
+    {"everything passes", UINT32_MAX, UINT32_MAX, 0, 31250000}, // 62.5 passes too, but its limit is unknown
+    {"good to 40 MHz", MHZ(40), MHZ(40), 0, 31250000},
+    {"good to 30 MHz", MHZ(30), MHZ(30), 0, 24000000},    // 31.25 fails, pll_usb's 24 MHz is below the margin
+    {"marginal 20-35 MHz", MHZ(35), MHZ(20), 30, 15625000}, // Passes there sometimes, must not be picked
+    {"good to 11 MHz", MHZ(11), MHZ(11), 0, 10416666},
+    {"nothing passes", 0, 0, 0, 0},
+};
+
+static uint32_t rng = 1;
+
+static bool synthetic_probe(const spi_tune_rate_t *rate, uint32_t pass, void *ctx) {
+    const link_t *l = ctx;
+    (void)pass;
+    if (rate->baud > l->limit) return false;
+    if (rate->baud <= l->marginal) return true;
+    rng = rng * 1103515245u + 12345u;
+    return (rng >> 16) % 100 >= l->fail_pct;
+}
+
+static void check_rates(const spi_tune_rate_t *rates, uint32_t n) {
+    static const uint32_t expect[] = {62500000, 31250000, 24000000, 20833333,
+                                      15625000, 12500000, 12000000, 10416666};
+    bool ok = n == sizeof(expect) / sizeof(expect[0]);
+    for (uint32_t i = 0; ok && i < n; i++) ok = rates[i].baud == expect[i];
+    printf("%lu rates:", (unsigned long)n);
+    for (uint32_t i = 0; i < n; i++) {
+        printf(" %.2f%s", rates[i].baud / 1e6, rates[i].peri == SPI_TUNE_PERI_PLL_USB ? "u" : "");
+    }
+    printf(ok ? "\n" : "  WRONG\n");
+    if (!ok) errors++;
+}
+
+static void check_search(const spi_tune_rate_t *rates, uint32_t n) {
+    for (uint32_t i = 0; i < sizeof(links) / sizeof(links[0]); i++) {
+        const link_t *l = &links[i];
+        spi_tune_result_t res;
+        bool ok = spi_tune_search(rates, n, synthetic_probe, (void *)l, &res);
+        bool good = l->expect ? ok && res.rate.baud == l->expect : !ok;
+        // Whatever is picked is clear of every failing rate by the margin
+        if (ok && res.fail_min &&
+            (uint64_t)res.rate.baud * 100 > (uint64_t)res.fail_min * (100 - SPI_TUNE_MARGIN_PCT)) {
+            good = false;
+        }
+        printf("%-20s -> %6.2f MHz, %2lu rates tried, %3lu patterns, slowest failing %.2f MHz%s\n", l->name,
+               ok ? res.rate.baud / 1e6 : 0.0, (unsigned long)res.rates_tried, (unsigned long)res.probes,
+               res.fail_min / 1e6, good ? "" : "  WRONG");
+        if (!good) errors++;
+    }
+}
+
+// When the fastest rate tried passes, the pick still keeps the margin below
+// it; from 24 MHz down that skips 20.83 MHz. Alone, a passing rate is kept.
+static void check_top(const spi_tune_rate_t *rates, uint32_t n) {
+    static const link_t good = {"from 24 MHz", UINT32_MAX, UINT32_MAX, 0, 15625000};
+    spi_tune_result_t res;
+    bool ok = spi_tune_search(rates + 2, n - 2, synthetic_probe, (void *)&good, &res);
+    bool good_pick = ok && res.rate.baud == good.expect && res.fail_min == 0 &&
+                     (uint64_t)res.rate.baud * 100 <= (uint64_t)rates[2].baud * (100 - SPI_TUNE_MARGIN_PCT);
+    printf("%-20s -> %6.2f MHz, %2lu rates tried%s\n", good.name, ok ? res.rate.baud / 1e6 : 0.0,
+           (unsigned long)res.rates_tried, good_pick ? "" : "  WRONG");
+    if (!good_pick) errors++;
+
+    ok = spi_tune_search(rates + n - 1, 1, synthetic_probe, (void *)&good, &res);
+    bool good_last = ok && res.rate.baud == rates[n - 1].baud;
+    printf("%-20s -> %6.2f MHz%s\n", "only the slowest", ok ? res.rate.baud / 1e6 : 0.0, good_last ? "" : "  WRONG");
+    if (!good_last) errors++;
+}
+
+// Tunes the model panel, expects the rate and whether it came from the flash
+static void check_panel(const char *what, uint32_t expect, bool stored) {
+    sim_spi_reset_stats();
+    uint64_t t0 = time_us_64();
+    uint32_t baud = spi_tune_panel(&st7789_default_panel, false);
+    spi_tune_result_t res;
+    spi_tune_get_result(&res);
+    bool good = baud == expect && res.stored == stored && st7789_get_baud() == baud;
+    printf("%-20s -> %6.2f MHz, clk_peri %.0f MHz, %3lu patterns, %7llu us%s\n", what, baud / 1e6,
+           clock_get_hz(clk_peri) / 1e6, (unsigned long)res.probes, (unsigned long long)(time_us_64() - t0),
+           good ? "" : "  WRONG");
+    if (!good) errors++;
+    port_log_flush(0);
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    uint32_t peri_hz[] = {125000000, 48000000};
+    spi_tune_rate_t rates[SPI_TUNE_MAX_RATES];
+    uint32_t n = spi_tune_rates(peri_hz, 2, SPI_TUNE_MIN_BAUD, SPI_TUNE_MAX_BAUD, rates, SPI_TUNE_MAX_RATES);
+    check_rates(rates, n);
+    check_search(rates, n);
+    check_top(rates, n);
+
+    // A list cut short keeps the fastest rates
+    spi_tune_rate_t few[4];
+    if (spi_tune_rates(peri_hz, 2, SPI_TUNE_MIN_BAUD, SPI_TUNE_MAX_BAUD, few, 4) != 4 ||
+        memcmp(few, rates, sizeof(few))) {
+        printf("short rate list differs\n");
+        errors++;
+    }
+
+    st7789_model_attach(&panel, SPI_PORT, PIN_CS, PIN_DC);
+    st7789_init();
+    port_log_flush(0);
+    memset(sim_flash + SPI_TUNE_FLASH_OFFSET, 0xFF, FLASH_SECTOR_SIZE);
+
+    panel.link_max_baud = MHZ(40);
+    check_panel("first start, 40 MHz", 31250000, false);
+    uint32_t link_errors = panel.stats.link_errors;
+    check_panel("next start", 31250000, true);
+    if (panel.stats.link_errors != link_errors) errors++; // The stored rate is below the limit
+
+    panel.link_max_baud = MHZ(28); // Longer wires
+    check_panel("link down to 28 MHz", 24000000, false);
+    if (clock_get_hz(clk_peri) != 48000000) errors++;
+    check_panel("next start", 24000000, true);
+
+    // The panel works at the tuned rate
+    static uint16_t px[ST7789_WIDTH], back[ST7789_WIDTH];
+    for (uint32_t i = 0; i < ST7789_WIDTH; i++) px[i] = (uint16_t)(i * 0x0123);
+    st7789_set_window(0, 7, ST7789_WIDTH - 1, 7);
+    st7789_send_pixels(px, ST7789_WIDTH);
+    if (!st7789_read_rect(0, 7, ST7789_WIDTH - 1, 7, back) || memcmp(px, back, sizeof(px))) {
+        printf("pixels differ at the tuned rate\n");
+        errors++;
+    }
+    if (st7789_get_baud() != 24000000) errors++; // Restored after the read
+
+    return check_result();
+}
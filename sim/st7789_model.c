@@ -0,0 +1,247 @@
+#include "st7789_model.h"
+#include "sim_png.h"
+#include <string.h>
+
+// MADCTL bits
+#define MY 0x80
+#define MX 0x40
+#define MV 0x20
+
+static void reset_pointer(st7789_model_t *m) {
+    m->cx = m->xs;
+    m->cy = m->ys;
+    m->npix = 0;
+}
+
+// Frame memory cell under the pointer, NULL outside the memory
+static uint16_t *pointer_cell(st7789_model_t *m) {
+    uint32_t x = m->cx, y = m->cy;
+    if (m->madctl & MV) {
+        uint32_t t = x;
+        x = y;
+        y = t;
+    }
+    if (m->madctl & MX) x = ST7789_MODEL_WIDTH - 1 - x;
+    if (m->madctl & MY) y = ST7789_MODEL_HEIGHT - 1 - y;
+    return x < ST7789_MODEL_WIDTH && y < ST7789_MODEL_HEIGHT ? &m->fb[y][x] : NULL;
+}
+
+static void advance_pointer(st7789_model_t *m) {
+    if (m->cx++ >= m->xe) {
+        m->cx = m->xs;
+        if (m->cy++ >= m->ye) m->cy = m->ys;
+    }
+}
+
+static void store_pixel(st7789_model_t *m, uint16_t rgb565) {
+    uint16_t *cell = pointer_cell(m);
+    if (m->sleeping) {
+        m->stats.writes_asleep++;
+    } else if (cell) {
+        *cell = rgb565;
+    }
+    m->stats.pixels++;
+    advance_pointer(m);
+}
+
+// A cable or wiring that doesn't carry the clock: bit errors, more often
+// than any real link so one test pattern sees them
+static uint8_t link(st7789_model_t *m, uint8_t b) {
+    if (!m->link_max_baud) return b;
+    sim_spi_stats_t s;
+    sim_spi_get_stats(m->spi_index, &s);
+    if (s.baud <= m->link_max_baud || ++m->link_bytes % 64) return b;
+    m->stats.link_errors++;
+    return (uint8_t)(b ^ (1u << (m->link_bytes / 64 % 8)));
+}
+
+static void pixel_byte(st7789_model_t *m, uint8_t b) {
+    b = link(m, b);
+    m->stats.pixel_bytes++;
+    m->pix[m->npix++] = b;
+    if (m->colmod == 0x66) {
+        // 18 bit: one byte per channel, upper 6 bits used
+        if (m->npix < 3) return;
+        store_pixel(m, (uint16_t)(((m->pix[0] >> 3) << 11) | ((m->pix[1] >> 2) << 5) | (m->pix[2] >> 3)));
+    } else {
+        if (m->npix < 2) return;
+        store_pixel(m, (uint16_t)((m->pix[0] << 8) | m->pix[1]));
+    }
+    m->npix = 0;
+}
+
+// RAMRD: a dummy byte, then R, G, B per pixel, 6 bits each in the upper
+// bits whatever COLMOD is; 5-bit red and blue are widened like the panel
+// does (MSB copied into the LSB)
+static uint8_t read_pixel_byte(st7789_model_t *m) {
+    if (m->nread++ == 0) return 0xFF;
+    uint16_t *cell = pointer_cell(m);
+    uint16_t c = cell ? *cell : 0;
+    uint32_t r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+    uint8_t out[3] = {
+        (uint8_t)(((r << 1) | (r >> 4)) << 2),
+        (uint8_t)(g << 2),
+        (uint8_t)(((b << 1) | (b >> 4)) << 2),
+    };
+    uint8_t v = out[m->npix++];
+    if (m->npix == 3) {
+        m->npix = 0;
+        m->stats.pixels_read++;
+        advance_pointer(m);
+    }
+    return v;
+}
+
+// RDDID: one dummy clock, then the 24-bit ID MSB first
+static uint8_t read_id_byte(st7789_model_t *m) {
+    uint32_t stream = (uint32_t)ST7789_MODEL_ID << 7;
+    uint32_t i = m->nread++;
+    return i < 4 ? (uint8_t)(stream >> (24 - 8 * i)) : 0xFF;
+}
+
+#define NEVER UINT64_MAX
+
+static bool within(uint64_t now, uint64_t t, uint64_t us) {
+    return t != NEVER && now < t + us;
+}
+
+static void timing_error(st7789_model_t *m, const char *what) {
+    m->stats.timing_errors++;
+    m->timing_error = what;
+}
+
+// Sleep in/out timing of the datasheet (section 9.1, SLPIN / SLPOUT / SWRESET)
+static void check_timing(st7789_model_t *m, uint8_t cmd) {
+    uint64_t now = time_us_64();
+    if (now < m->hold_us) timing_error(m, "command within 5 ms of SWRESET, SLPIN or SLPOUT");
+    if (cmd == 0x11 && within(now, m->slpin_us, 120000)) timing_error(m, "SLPOUT within 120 ms of SLPIN");
+    if (cmd == 0x11 && within(now, m->swreset_us, 120000)) timing_error(m, "SLPOUT within 120 ms of SWRESET");
+    if (cmd == 0x10 && within(now, m->slpout_us, 120000)) timing_error(m, "SLPIN within 120 ms of SLPOUT");
+
+    if (cmd == 0x01) m->swreset_us = now;
+    if (cmd == 0x10) m->slpin_us = now;
+    if (cmd == 0x11) m->slpout_us = now;
+    if (cmd == 0x01 || cmd == 0x10 || cmd == 0x11) m->hold_us = now + 5000;
+
+    st7789_model_cmd_t *e = &m->log[m->nlog++ % ST7789_MODEL_LOG];
+    e->t_us = now;
+    e->cmd = cmd;
+}
+
+static void command(st7789_model_t *m, uint8_t cmd) {
+    check_timing(m, cmd);
+    m->stats.cmd_bytes++;
+    m->cmd = cmd;
+    m->nparam = 0;
+    m->nread = 0;
+    switch (cmd) {
+    case 0x01: // SWRESET
+        m->madctl = 0;
+        m->colmod = 0x66;
+        m->sleeping = true;
+        m->display_on = false;
+        break;
+    case 0x10: m->sleeping = true; break;       // SLPIN
+    case 0x11: m->sleeping = false; break;      // SLPOUT
+    case 0x28: m->display_on = false; break;    // DISPOFF
+    case 0x29: m->display_on = true; break;     // DISPON
+    case 0x2C: // RAMWR
+        m->stats.ramwr++;
+        reset_pointer(m);
+        break;
+    case 0x3C: // WRMEMC: continues at the pointer
+        m->stats.wrmemc++;
+        m->npix = 0;
+        break;
+    case 0x2E: // RAMRD
+        m->stats.ramrd++;
+        reset_pointer(m);
+        break;
+    default:
+        break;
+    }
+}
+
+// Data phase byte; returns what the panel drives on MISO meanwhile
+static uint8_t parameter(st7789_model_t *m, uint8_t b) {
+    if (m->cmd == 0x2C || m->cmd == 0x3C) {
+        pixel_byte(m, b);
+        return 0;
+    }
+    if (m->cmd == 0x2E) return read_pixel_byte(m);
+    if (m->cmd == 0x04) return read_id_byte(m);
+    m->stats.param_bytes++;
+    if (m->nparam < sizeof(m->param)) m->param[m->nparam] = b;
+    m->nparam++;
+
+    switch (m->cmd) {
+    case 0x2A: // CASET
+        if (m->nparam == 4) {
+            m->xs = (uint16_t)((m->param[0] << 8) | m->param[1]);
+            m->xe = (uint16_t)((m->param[2] << 8) | m->param[3]);
+        }
+        break;
+    case 0x2B: // RASET
+        if (m->nparam == 4) {
+            m->ys = (uint16_t)((m->param[0] << 8) | m->param[1]);
+            m->ye = (uint16_t)((m->param[2] << 8) | m->param[3]);
+            m->stats.windows++;
+        }
+        break;
+    case 0x36: m->madctl = b; break;  // MADCTL
+    case 0x3A: m->colmod = b; break;  // COLMOD
+    case 0xC6: m->frctrl2 = b; break; // FRCTRL2
+    default:
+        break;
+    }
+    return 0;
+}
+
+static uint8_t model_xfer(void *ctx, uint8_t mosi) {
+    st7789_model_t *m = ctx;
+    if (gpio_get(m->dc_pin)) return parameter(m, mosi);
+    command(m, mosi);
+    return 0;
+}
+
+void st7789_model_attach(st7789_model_t *m, spi_inst_t *spi, uint cs_pin, uint dc_pin) {
+    memset(m, 0, sizeof(*m));
+    m->dc_pin = dc_pin;
+    m->spi_index = spi_get_index(spi);
+    m->colmod = 0x66;
+    m->sleeping = true;
+    m->xe = ST7789_MODEL_WIDTH - 1;
+    m->ye = ST7789_MODEL_HEIGHT - 1;
+    m->swreset_us = m->slpin_us = m->slpout_us = NEVER;
+    sim_spi_attach(spi, cs_pin, model_xfer, m);
+}
+
+void st7789_model_reset_stats(st7789_model_t *m) {
+    memset(&m->stats, 0, sizeof(m->stats));
+    m->nlog = 0;
+    m->timing_error = NULL;
+}
+
+uint16_t st7789_model_pixel(const st7789_model_t *m, uint x, uint y) {
+    if (m->sleeping || !m->display_on) return 0;
+    return m->fb[y][x];
+}
+
+bool st7789_model_write_png(const st7789_model_t *m, const char *path) {
+    static uint8_t rgb[ST7789_MODEL_HEIGHT][ST7789_MODEL_WIDTH][3];
+    for (uint y = 0; y < ST7789_MODEL_HEIGHT; y++) {
+        for (uint x = 0; x < ST7789_MODEL_WIDTH; x++) {
+            uint16_t c = st7789_model_pixel(m, x, y);
+            rgb[y][x][0] = (uint8_t)(((c >> 11) & 0x1F) * 255 / 31);
+            rgb[y][x][1] = (uint8_t)(((c >> 5) & 0x3F) * 255 / 63);
+            rgb[y][x][2] = (uint8_t)((c & 0x1F) * 255 / 31);
+        }
+    }
+    return sim_png_write(path, &rgb[0][0][0], ST7789_MODEL_WIDTH, ST7789_MODEL_HEIGHT);
+}
+
+void st7789_model_corrupt(st7789_model_t *m, uint x, uint y, uint w, uint h, uint16_t mask) {
+    for (uint j = y; j < y + h && j < ST7789_MODEL_HEIGHT; j++) {
+        for (uint i = x; i < x + w && i < ST7789_MODEL_WIDTH; i++) m->fb[j][i] ^= mask;
+    }
+}
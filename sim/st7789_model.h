@@ -0,0 +1,78 @@
+#ifndef ST7789_MODEL_H
+#define ST7789_MODEL_H
+
+#include "hardware/spi.h"
+
+// Behavioural ST7789 on a simulated SPI bus: decodes the commands the driver
+// sends (CASET/RASET/RAMWR/WRMEMC/MADCTL/COLMOD, sleep and display on/off,
+// FRCTRL2) into a 240 x 320 frame memory and counts the traffic. RDDID and
+// RAMRD answer on MISO in the serial read format of the datasheet (a dummy
+// clock before the 24 ID bits, a dummy byte before 18-bit pixels).
+//
+// The sleep timing of the datasheet is checked: 5 ms after SWRESET, SLPIN
+// and SLPOUT before the next command, 120 ms from SWRESET or SLPIN to
+// SLPOUT and from SLPOUT to SLPIN. Each command that comes too early counts
+// in timing_errors; the last commands are kept with their times in log.
+
+#define ST7789_MODEL_WIDTH 240
+#define ST7789_MODEL_HEIGHT 320
+#define ST7789_MODEL_ID     0x858552 // RDDID of the ST7789V
+#define ST7789_MODEL_LOG    64       // Commands kept in the log
+
+typedef struct {
+    uint64_t t_us;
+    uint8_t cmd;
+} st7789_model_cmd_t;
+
+typedef struct {
+    uint64_t cmd_bytes;
+    uint64_t param_bytes;
+    uint64_t pixel_bytes;
+    uint64_t pixels;
+    uint32_t ramwr;          // RAMWR commands
+    uint32_t wrmemc;         // WRMEMC commands
+    uint32_t windows;        // CASET + RASET pairs
+    uint32_t ramrd;          // RAMRD commands
+    uint64_t pixels_read;
+    uint32_t link_errors;    // Pixel bytes damaged by link_max_baud
+    uint32_t writes_asleep;  // Pixels written in sleep mode (the panel ignores them)
+    uint32_t timing_errors;  // Commands sent before the datasheet allows
+} st7789_model_stats_t;
+
+typedef struct {
+    uint dc_pin;
+    uint spi_index;
+    uint32_t link_max_baud;   // Above it every 64th pixel byte arrives with a bit flipped, 0: no limit
+    uint32_t link_bytes;
+    uint8_t cmd;
+    uint32_t nparam;
+    uint8_t param[4];
+    uint16_t xs, xe, ys, ye;  // Window, in MADCTL space
+    uint16_t cx, cy;          // Write pointer
+    uint8_t madctl;
+    uint8_t colmod;
+    uint8_t frctrl2;
+    bool sleeping;
+    bool display_on;
+    uint8_t pix[3];
+    uint32_t npix;
+    uint32_t nread;           // Bytes clocked out since RDDID/RAMRD
+    uint64_t swreset_us, slpin_us, slpout_us; // Last ones, UINT64_MAX: none yet
+    uint64_t hold_us;         // No command before
+    const char *timing_error; // The last one
+    st7789_model_cmd_t log[ST7789_MODEL_LOG];
+    uint32_t nlog;            // Commands logged, log[nlog % ST7789_MODEL_LOG] is the oldest
+    uint16_t fb[ST7789_MODEL_HEIGHT][ST7789_MODEL_WIDTH]; // RGB565, native orientation
+    st7789_model_stats_t stats;
+} st7789_model_t;
+
+void st7789_model_attach(st7789_model_t *m, spi_inst_t *spi, uint cs_pin, uint dc_pin);
+void st7789_model_reset_stats(st7789_model_t *m); // Also empties the log
+// What the panel shows: black while asleep or with the display off
+uint16_t st7789_model_pixel(const st7789_model_t *m, uint x, uint y);
+bool st7789_model_write_png(const st7789_model_t *m, const char *path);
+// Damages the frame memory like an ESD hit: XORs mask into the pixels of
+// the rectangle (native orientation)
+void st7789_model_corrupt(st7789_model_t *m, uint x, uint y, uint w, uint h, uint16_t mask);
+
+#endif // ST7789_MODEL_H
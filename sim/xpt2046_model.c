@@ -0,0 +1,89 @@
+#include "xpt2046_model.h"
+#include <string.h>
+
+static uint16_t convert(xpt2046_model_t *m, uint8_t cmd) {
+    m->conversions++;
+    switch ((cmd >> 4) & 7) { // A2..A0
+    case 5: return m->pressed ? m->x : 0;       // X+
+    case 1: return m->pressed ? m->y : 0;       // Y+
+    case 3: return m->pressed ? m->z1 : 0;      // Z1
+    case 4: return m->pressed ? m->z2 : 4095;   // Z2
+    default: return 0;
+    }
+}
+
+static uint8_t model_xfer(void *ctx, uint8_t mosi) {
+    xpt2046_model_t *m = ctx;
+    uint8_t out = 0;
+    switch (m->phase) {
+    case 0:
+        if (mosi & 0x80) { // Start bit
+            m->result = (uint16_t)(convert(m, mosi) << 3);
+            m->phase = 1;
+        }
+        break;
+    case 1:
+        out = (uint8_t)(m->result >> 8);
+        m->phase = 2;
+        break;
+    default:
+        out = (uint8_t)m->result;
+        m->phase = 0;
+        break;
+    }
+    return out;
+}
+
+static void cs_watch(void *ctx, uint pin, bool value) {
+    (void)pin;
+    xpt2046_model_t *m = ctx;
+    if (value) m->phase = 0; // Deselect ends a conversion
+}
+
+void xpt2046_model_press(xpt2046_model_t *m, uint16_t raw_x, uint16_t raw_y, uint16_t z1) {
+    m->x = raw_x;
+    m->y = raw_y;
+    m->z1 = z1;
+    m->z2 = (uint16_t)(4095 - z1);
+    m->pressed = true;
+    sim_gpio_drive(m->irq_pin, false);
+}
+
+void xpt2046_model_release(xpt2046_model_t *m) {
+    m->pressed = false;
+    sim_gpio_drive(m->irq_pin, true);
+}
+
+static bool script_tick(repeating_timer_t *t) {
+    xpt2046_model_t *m = t->user_data;
+    uint64_t now = time_us_64();
+    while (m->script_pos < m->script_len && m->script[m->script_pos].t_us <= now) {
+        const xpt2046_model_event_t *e = &m->script[m->script_pos++];
+        if (e->pressed) {
+            xpt2046_model_press(m, e->x, e->y, e->z1);
+        } else {
+            xpt2046_model_release(m);
+        }
+    }
+    if (m->script_pos >= m->script_len) return false;
+    t->delay_us = -(int64_t)(m->script[m->script_pos].t_us - now); // Next event, from now
+    return true;
+}
+
+void xpt2046_model_play(xpt2046_model_t *m, const xpt2046_model_event_t *events, uint32_t count) {
+    m->script = events;
+    m->script_len = count;
+    m->script_pos = 0;
+    if (!count) return;
+    uint64_t now = time_us_64();
+    int64_t delay = events[0].t_us > now ? (int64_t)(events[0].t_us - now) : 1;
+    add_repeating_timer_us(delay, script_tick, m, &m->script_timer);
+}
+
+void xpt2046_model_attach(xpt2046_model_t *m, spi_inst_t *spi, uint cs_pin, uint irq_pin) {
+    memset(m, 0, sizeof(*m));
+    m->irq_pin = irq_pin;
+    sim_gpio_drive(irq_pin, true); // Pen up
+    sim_gpio_watch(cs_pin, cs_watch, m);
+    sim_spi_attach(spi, cs_pin, model_xfer, m);
+}
@@ -0,0 +1,36 @@
+#ifndef XPT2046_MODEL_H
+#define XPT2046_MODEL_H
+
+#include "hardware/spi.h"
+
+// Scriptable XPT2046 on a simulated SPI bus: answers X/Y/Z1/Z2 conversions
+// with the current touch and drives PENIRQ. Touches are set directly or
+// from a script of timed events played as virtual time advances.
+
+typedef struct {
+    uint64_t t_us;      // Event time, virtual
+    bool pressed;
+    uint16_t x, y;      // Raw 12-bit ADC values
+    uint16_t z1;
+} xpt2046_model_event_t;
+
+typedef struct {
+    uint irq_pin;
+    bool pressed;
+    uint16_t x, y, z1, z2;
+    uint8_t phase;      // 0: waiting for a command, 1-2: data bytes
+    uint16_t result;
+    uint32_t conversions;
+    const xpt2046_model_event_t *script;
+    uint32_t script_len;
+    uint32_t script_pos;
+    repeating_timer_t script_timer;
+} xpt2046_model_t;
+
+void xpt2046_model_attach(xpt2046_model_t *m, spi_inst_t *spi, uint cs_pin, uint irq_pin);
+void xpt2046_model_press(xpt2046_model_t *m, uint16_t raw_x, uint16_t raw_y, uint16_t z1);
+void xpt2046_model_release(xpt2046_model_t *m);
+// Plays events (ascending t_us) as virtual time passes; the array must stay valid
+void xpt2046_model_play(xpt2046_model_t *m, const xpt2046_model_event_t *events, uint32_t count);
+
+#endif // XPT2046_MODEL_H
@@ -0,0 +1,99 @@
+#include "lv_port_backlight.h"
+
+#if LV_PORT_BL_AUTODIM
+
+#include "st7789.h"
+#include "xpt2046.h"
+#include "port_log.h"
+
+#define BL_MIN_PERIOD_MS 50
+
+static lv_port_bl_policy_t policy = LV_PORT_BL_POLICY_DEFAULT;
+static lv_port_bl_state_t state = BL_STATE_ON;
+static lv_timer_t *bl_timer;
+
+// Touch IRQ: light first, LVGL catches up at the next read
+static void bl_pen_down(void) {
+    if (st7789_is_sleeping()) return; // Waking the panel is up to the application
+    if (st7789_get_backlight() != policy.on_pct) {
+        st7789_fade_backlight(policy.on_pct, policy.fade_up_ms);
+    }
+}
+
+static void set_state(lv_port_bl_state_t new_state) {
+    if (new_state == state) return;
+    state = new_state;
+
+    switch (state) {
+    case BL_STATE_ON:
+        if (st7789_get_backlight() != policy.on_pct) st7789_fade_backlight(policy.on_pct, policy.fade_up_ms);
+        break;
+    case BL_STATE_DIM:
+        st7789_fade_backlight(policy.dim_pct, policy.fade_down_ms);
+        break;
+    case BL_STATE_OFF:
+        st7789_fade_backlight(0, policy.fade_down_ms);
+        break;
+    }
+    PORT_LOGD("backlight: state %u\n", state);
+}
+
+// State for the time without input, and the ms until the next change
+// (0: none, i.e. off or never dimming)
+static lv_port_bl_state_t next_state(uint32_t inactive_ms, uint32_t *wait_ms) {
+    uint32_t dim_at = policy.dim_after_ms;
+    uint32_t off_at = policy.off_after_ms;
+
+    if (off_at && inactive_ms >= off_at) {
+        *wait_ms = 0;
+        return BL_STATE_OFF;
+    }
+    if (dim_at && inactive_ms >= dim_at) {
+        *wait_ms = off_at ? off_at - inactive_ms : 0;
+        return BL_STATE_DIM;
+    }
+    uint32_t next_at = dim_at ? dim_at : off_at;
+    *wait_ms = next_at ? next_at - inactive_ms : 0;
+    return BL_STATE_ON;
+}
+
+static void bl_timer_cb(lv_timer_t *timer) {
+    uint32_t wait_ms;
+    set_state(next_state(lv_disp_get_inactive_time(NULL), &wait_ms));
+
+    if (wait_ms == 0) {
+        lv_timer_pause(timer); // Off (or never dimming): lv_port_bl_input() restarts it
+    } else {
+        lv_timer_set_period(timer, wait_ms < BL_MIN_PERIOD_MS ? BL_MIN_PERIOD_MS : wait_ms);
+    }
+}
+
+void lv_port_bl_init(void) {
+    bl_timer = lv_timer_create(bl_timer_cb, policy.dim_after_ms ? policy.dim_after_ms : BL_MIN_PERIOD_MS, NULL);
+    st7789_set_backlight(policy.on_pct);
+    xpt2046_set_pen_down_cb(bl_pen_down);
+}
+
+void lv_port_bl_set_policy(const lv_port_bl_policy_t *p) {
+    policy = *p;
+    if (bl_timer) {
+        lv_timer_resume(bl_timer);
+        lv_timer_ready(bl_timer); // Re-evaluate with the new times
+    }
+}
+
+lv_port_bl_state_t lv_port_bl_get_state(void) {
+    return state;
+}
+
+void lv_port_bl_input(bool pressed) {
+    if (!pressed) return;
+    // LVGL resets the inactive time on this press; start counting from it
+    set_state(BL_STATE_ON);
+    if (bl_timer && bl_timer->paused) {
+        lv_timer_resume(bl_timer);
+        lv_timer_ready(bl_timer);
+    }
+}
+
+#endif // LV_PORT_BL_AUTODIM
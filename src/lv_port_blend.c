@@ -0,0 +1,407 @@
+#include "lv_port_blend.h"
+
+#if LV_PORT_FAST_BLEND
+
+#include "port_fast_mem.h"
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include <stdio.h>
+#include <string.h>
+
+#if LV_COLOR_DEPTH != 16 || !LV_COLOR_16_SWAP || LV_COLOR_MIX_ROUND_OFS != 0
+#error "lv_port_blend needs LV_COLOR_DEPTH 16, LV_COLOR_16_SWAP 1 and LV_COLOR_MIX_ROUND_OFS 0"
+#endif
+
+// Buffer pixel <-> RGB565 (LV_COLOR_16_SWAP keeps them big-endian for SPI)
+static inline uint32_t swap16(uint32_t c) {
+    return ((c << 8) | (c >> 8)) & 0xFFFF;
+}
+
+// Same for the two pixels of a word at once
+static inline uint32_t swap2(uint32_t w) {
+    return ((w & 0x00FF00FFu) << 8) | ((w >> 8) & 0x00FF00FFu);
+}
+
+// lv_color_mix(fg, bg, mix) as LVGL 8.3 does it with LV_COLOR_16_SWAP:
+// (fg * mix + bg * (255 - mix)) / 255 per channel, rounded down. Red and
+// blue go through one multiply as the two 16-bit lanes of a word; a lane
+// never exceeds 31 * 255, so nothing carries from one to the other.
+typedef struct {
+    uint32_t rb;  // (red << 16 | blue) * mix
+    uint32_t g;   // green * mix
+    uint32_t inv; // 255 - mix
+} fg_t;
+
+// RGB565 -> red << 16 | blue
+static inline uint32_t lanes(uint32_t c) {
+    return (c & 0x1F) | ((c >> 11) << 16);
+}
+
+// c RGB565
+static inline fg_t premult(uint32_t c, lv_opa_t mix) {
+    fg_t f = { lanes(c) * mix, ((c >> 5) & 0x3F) * mix, 255u - mix };
+    return f;
+}
+
+// bg RGB565, returns RGB565. x / 255 is (x + 1 + (x >> 8)) >> 8, exact up
+// to 65534 and the same as LV_UDIV255 below 16066.
+static inline uint32_t mix565(fg_t f, uint32_t bg) {
+    uint32_t rb = f.rb + lanes(bg) * f.inv;
+    uint32_t g = f.g + ((bg >> 5) & 0x3F) * f.inv;
+    rb = ((rb + 0x00010001u + ((rb >> 8) & 0x00FF00FFu)) >> 8) & 0x001F001Fu;
+    g = (g + 1 + (g >> 8)) >> 8;
+    return ((rb >> 5) & 0xF800) | (g << 5) | (rb & 0x1F);
+}
+
+// One buffer pixel
+static inline uint16_t mix_px(fg_t f, uint16_t bg) {
+    return (uint16_t)swap16(mix565(f, swap16(bg)));
+}
+
+// Two buffer pixels (one word)
+static inline uint32_t mix_word(fg_t lo, fg_t hi, uint32_t bg) {
+    bg = swap2(bg);
+    return swap2(mix565(lo, bg & 0xFFFF) | (mix565(hi, bg >> 16) << 16));
+}
+
+// Mask and layer opacity combined like lv_draw_sw_blend_basic() does
+static inline lv_opa_t mask_opa(lv_opa_t m, lv_opa_t opa) {
+    if (opa >= LV_OPA_MAX) return m;
+    return m >= LV_OPA_MAX ? opa : (lv_opa_t)(((uint32_t)m * opa) >> 8);
+}
+
+static void PORT_FAST_FUNC(fill_cover)(uint16_t *d, int32_t stride, int32_t w, int32_t h, uint16_t c) {
+    if (stride == w) { // Whole rows, one run
+        w *= h;
+        h = 1;
+    }
+
+    if ((c >> 8) == (c & 0xFF)) { // Black, white, ... : ROM memset
+        for (; h > 0; h--, d += stride) {
+            memset(d, c & 0xFF, (size_t)w * 2);
+        }
+        return;
+    }
+
+    uint32_t c2 = c | ((uint32_t)c << 16);
+    for (; h > 0; h--, d += stride) {
+        uint16_t *p = d;
+        int32_t n = w;
+        if (((uintptr_t)p & 2) && n) {
+            *p++ = c;
+            n--;
+        }
+        uint32_t *p32 = (uint32_t *)p;
+        for (; n >= 8; n -= 8, p32 += 4) {
+            p32[0] = c2;
+            p32[1] = c2;
+            p32[2] = c2;
+            p32[3] = c2;
+        }
+        for (; n >= 2; n -= 2) {
+            *p32++ = c2;
+        }
+        if (n) *(uint16_t *)p32 = c;
+    }
+}
+
+static void PORT_FAST_FUNC(fill_opa)(uint16_t *d, int32_t stride, int32_t w, int32_t h, uint16_t c, lv_opa_t opa) {
+    fg_t fg = premult(swap16(c), opa);
+
+    // Backgrounds are mostly flat, so the last pair is often the next one
+    uint32_t last_bg = 0;
+    uint32_t last_res = mix_word(fg, fg, 0);
+
+    for (; h > 0; h--, d += stride) {
+        uint16_t *p = d;
+        int32_t n = w;
+        if (((uintptr_t)p & 2) && n) {
+            *p = mix_px(fg, *p);
+            p++;
+            n--;
+        }
+        uint32_t *p32 = (uint32_t *)p;
+        for (; n >= 2; n -= 2, p32++) {
+            uint32_t bg = *p32;
+            if (bg != last_bg) {
+                last_bg = bg;
+                last_res = mix_word(fg, fg, bg);
+            }
+            *p32 = last_res;
+        }
+        if (n) {
+            p = (uint16_t *)p32;
+            *p = mix_px(fg, *p);
+        }
+    }
+}
+
+static void PORT_FAST_FUNC(fill_mask)(uint16_t *d, int32_t stride, int32_t w, int32_t h, uint16_t c, lv_opa_t opa,
+                                      const lv_opa_t *mask, int32_t mask_stride) {
+    uint32_t fg = swap16(c);
+    uint32_t c2 = c | ((uint32_t)c << 16);
+    bool cover = opa >= LV_OPA_MAX;
+
+    for (; h > 0; h--, d += stride, mask += mask_stride) {
+        int32_t x = 0;
+        while (x < w) {
+            // Most of a mask is fully out or fully in: check 4 bytes at once
+            if (((uintptr_t)(mask + x) & 3) == 0 && x + 4 <= w) {
+                uint32_t m32 = *(const uint32_t *)(mask + x);
+                if (m32 == 0) {
+                    x += 4;
+                    continue;
+                }
+                if (m32 == 0xFFFFFFFFu && cover) {
+                    if (((uintptr_t)(d + x) & 2) == 0) {
+                        ((uint32_t *)(d + x))[0] = c2;
+                        ((uint32_t *)(d + x))[1] = c2;
+                    } else {
+                        d[x] = c;
+                        d[x + 1] = c;
+                        d[x + 2] = c;
+                        d[x + 3] = c;
+                    }
+                    x += 4;
+                    continue;
+                }
+            }
+            lv_opa_t m = mask[x];
+            if (m) d[x] = mix_px(premult(fg, mask_opa(m, opa)), d[x]);
+            x++;
+        }
+    }
+}
+
+static void PORT_FAST_FUNC(copy_cover)(uint16_t *d, int32_t stride, const uint16_t *s, int32_t src_stride,
+                                       int32_t w, int32_t h) {
+    if (stride == w && src_stride == w) {
+        w *= h;
+        h = 1;
+    }
+    for (; h > 0; h--, d += stride, s += src_stride) {
+        memcpy(d, s, (size_t)w * 2);
+    }
+}
+
+static void PORT_FAST_FUNC(copy_opa)(uint16_t *d, int32_t stride, const uint16_t *s, int32_t src_stride,
+                                     int32_t w, int32_t h, lv_opa_t opa) {
+    for (; h > 0; h--, d += stride, s += src_stride) {
+        uint16_t *p = d;
+        const uint16_t *q = s;
+        int32_t n = w;
+        if (((uintptr_t)p & 2) && n) {
+            *p = mix_px(premult(swap16(*q), opa), *p);
+            p++;
+            q++;
+            n--;
+        }
+        uint32_t *p32 = (uint32_t *)p;
+        if (((uintptr_t)q & 2) == 0) {
+            for (; n >= 2; n -= 2, p32++, q += 2) {
+                uint32_t f = swap2(*(const uint32_t *)q);
+                *p32 = mix_word(premult(f & 0xFFFF, opa), premult(f >> 16, opa), *p32);
+            }
+        } else {
+            for (; n >= 2; n -= 2, p32++, q += 2) {
+                uint32_t f = swap2(q[0] | ((uint32_t)q[1] << 16));
+                *p32 = mix_word(premult(f & 0xFFFF, opa), premult(f >> 16, opa), *p32);
+            }
+        }
+        if (n) {
+            p = (uint16_t *)p32;
+            *p = mix_px(premult(swap16(*q), opa), *p);
+        }
+    }
+}
+
+static void PORT_FAST_FUNC(copy_mask)(uint16_t *d, int32_t stride, const uint16_t *s, int32_t src_stride,
+                                      int32_t w, int32_t h, lv_opa_t opa, const lv_opa_t *mask, int32_t mask_stride) {
+    bool cover = opa >= LV_OPA_MAX;
+
+    for (; h > 0; h--, d += stride, s += src_stride, mask += mask_stride) {
+        int32_t x = 0;
+        while (x < w) {
+            if (((uintptr_t)(mask + x) & 3) == 0 && x + 4 <= w) {
+                uint32_t m32 = *(const uint32_t *)(mask + x);
+                if (m32 == 0) {
+                    x += 4;
+                    continue;
+                }
+                if (m32 == 0xFFFFFFFFu && cover) {
+                    d[x] = s[x];
+                    d[x + 1] = s[x + 1];
+                    d[x + 2] = s[x + 2];
+                    d[x + 3] = s[x + 3];
+                    x += 4;
+                    continue;
+                }
+            }
+            lv_opa_t m = mask[x];
+            if (m) d[x] = mix_px(premult(swap16(s[x]), mask_opa(m, opa)), d[x]);
+            x++;
+        }
+    }
+}
+
+static void PORT_FAST_FUNC(port_blend)(lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc) {
+    lv_disp_t *disp = _lv_refr_get_disp_refreshing();
+    if (dsc->blend_mode != LV_BLEND_MODE_NORMAL || disp->driver->set_px_cb || disp->driver->screen_transp) {
+        lv_draw_sw_blend_basic(draw_ctx, dsc);
+        return;
+    }
+
+    const lv_opa_t *mask = dsc->mask_buf;
+    if (mask && dsc->mask_res == LV_DRAW_MASK_RES_TRANSP) return;
+    if (dsc->mask_res == LV_DRAW_MASK_RES_FULL_COVER) mask = NULL;
+
+    lv_area_t area;
+    if (!_lv_area_intersect(&area, dsc->blend_area, draw_ctx->clip_area)) return;
+
+    int32_t w = lv_area_get_width(&area);
+    int32_t h = lv_area_get_height(&area);
+    int32_t stride = lv_area_get_width(draw_ctx->buf_area);
+    uint16_t *d = (uint16_t *)draw_ctx->buf + stride * (area.y1 - draw_ctx->buf_area->y1) +
+                  (area.x1 - draw_ctx->buf_area->x1);
+
+    int32_t mask_stride = 0;
+    if (mask) {
+        mask_stride = lv_area_get_width(dsc->mask_area);
+        mask += mask_stride * (area.y1 - dsc->mask_area->y1) + (area.x1 - dsc->mask_area->x1);
+    }
+
+    lv_opa_t opa = dsc->opa;
+    if (dsc->src_buf == NULL) {
+        uint16_t c = dsc->color.full;
+        if (mask) fill_mask(d, stride, w, h, c, opa, mask, mask_stride);
+        else if (opa >= LV_OPA_MAX) fill_cover(d, stride, w, h, c);
+        else fill_opa(d, stride, w, h, c, opa);
+    } else {
+        int32_t src_stride = lv_area_get_width(dsc->blend_area);
+        const uint16_t *s = (const uint16_t *)dsc->src_buf + src_stride * (area.y1 - dsc->blend_area->y1) +
+                            (area.x1 - dsc->blend_area->x1);
+        if (mask) copy_mask(d, stride, s, src_stride, w, h, opa, mask, mask_stride);
+        else if (opa >= LV_OPA_MAX) copy_cover(d, stride, s, src_stride, w, h);
+        else copy_opa(d, stride, s, src_stride, w, h, opa);
+    }
+}
+
+void lv_port_blend_ctx_init(lv_disp_drv_t *drv, lv_draw_ctx_t *draw_ctx) {
+    lv_draw_sw_init_ctx(drv, draw_ctx);
+    ((lv_draw_sw_ctx_t *)draw_ctx)->blend = port_blend;
+}
+
+typedef void (*blend_fn_t)(lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc);
+
+typedef struct {
+    const char *name;
+    bool src;
+    bool mask;
+    lv_opa_t opa;
+} bench_case_t;
+
+static const bench_case_t bench_cases[] = {
+    { "fill",          false, false, LV_OPA_COVER },
+    { "fill opa",      false, false, LV_OPA_60 },
+    { "fill mask",     false, true,  LV_OPA_COVER },
+    { "fill mask+opa", false, true,  LV_OPA_60 },
+    { "copy",          true,  false, LV_OPA_COVER },
+    { "copy opa",      true,  false, LV_OPA_60 },
+    { "copy mask",     true,  true,  LV_OPA_COVER },
+    { "copy mask+opa", true,  true,  LV_OPA_60 },
+};
+
+// Background in runs of 16 pixels, like gradients and flat widgets
+static void bench_background(uint16_t *buf) {
+    for (int32_t y = 0; y < BLEND_BENCH_H; y++) {
+        for (int32_t x = 0; x < BLEND_BENCH_W; x++) {
+            buf[y * BLEND_BENCH_W + x] = lv_color_make(y * 16, x & ~15, 0x80).full;
+        }
+    }
+}
+
+static uint32_t bench_run(blend_fn_t blend, lv_draw_ctx_t *ctx, const lv_draw_sw_blend_dsc_t *dsc) {
+    uint32_t total_us = 0;
+    for (int i = 0; i < BLEND_BENCH_REPS; i++) {
+        bench_background(ctx->buf);
+        uint32_t t0 = time_us_32();
+        blend(ctx, dsc);
+        total_us += time_us_32() - t0;
+    }
+    return total_us;
+}
+
+void lv_port_blend_bench(void) {
+    const size_t px = BLEND_BENCH_W * BLEND_BENCH_H;
+    uint16_t *ref = lv_mem_alloc(px * 2);
+    uint16_t *out = lv_mem_alloc(px * 2);
+    uint16_t *src = lv_mem_alloc(px * 2);
+    lv_opa_t *mask = lv_mem_alloc(px);
+    if (!ref || !out || !src || !mask) {
+        printf("Blend bench: out of LVGL heap\n");
+        goto done;
+    }
+
+    for (int32_t y = 0; y < BLEND_BENCH_H; y++) {
+        for (int32_t x = 0; x < BLEND_BENCH_W; x++) {
+            src[y * BLEND_BENCH_W + x] = lv_color_make(x, x * y, 255 - x).full;
+            // Anti-aliased edges between fully transparent and opaque parts
+            int32_t m = (x - 40 - y * 4) * 24;
+            mask[y * BLEND_BENCH_W + x] = m < 0 ? 0 : (m > 255 ? 255 : m);
+        }
+    }
+
+    // One pixel in from the sides so rows start and end unaligned
+    lv_area_t buf_area = { 0, 0, BLEND_BENCH_W - 1, BLEND_BENCH_H - 1 };
+    lv_area_t clip_area = { 1, 0, BLEND_BENCH_W - 2, BLEND_BENCH_H - 1 };
+    lv_draw_sw_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.base_draw.buf_area = &buf_area;
+    ctx.base_draw.clip_area = &clip_area;
+
+    lv_disp_t *prev = _lv_refr_get_disp_refreshing();
+    _lv_refr_set_disp_refreshing(lv_disp_get_default());
+
+    uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+    uint32_t n = (uint32_t)lv_area_get_size(&clip_area) * BLEND_BENCH_REPS;
+    printf("Blend bench, %dx%d, cycles/pixel:\n", BLEND_BENCH_W, BLEND_BENCH_H);
+    printf("  %-14s %8s %8s %6s\n", "", "lvgl", "port", "diff");
+
+    for (size_t i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++) {
+        const bench_case_t *bc = &bench_cases[i];
+        lv_draw_sw_blend_dsc_t dsc;
+        memset(&dsc, 0, sizeof(dsc));
+        dsc.blend_area = &buf_area;
+        dsc.src_buf = bc->src ? (const lv_color_t *)src : NULL;
+        dsc.color = lv_color_make(0x20, 0xC0, 0x60);
+        dsc.mask_buf = bc->mask ? mask : NULL;
+        dsc.mask_res = bc->mask ? LV_DRAW_MASK_RES_CHANGED : LV_DRAW_MASK_RES_FULL_COVER;
+        dsc.mask_area = &buf_area;
+        dsc.opa = bc->opa;
+        dsc.blend_mode = LV_BLEND_MODE_NORMAL;
+
+        ctx.base_draw.buf = ref;
+        uint32_t lvgl_cyc = bench_run(lv_draw_sw_blend_basic, &ctx.base_draw, &dsc) * mhz;
+        ctx.base_draw.buf = out;
+        uint32_t port_cyc = bench_run(port_blend, &ctx.base_draw, &dsc) * mhz;
+
+        uint32_t diff = 0;
+        for (size_t p = 0; p < px; p++) {
+            if (ref[p] != out[p]) diff++;
+        }
+        printf("  %-14s %5lu.%02lu %5lu.%02lu %6lu\n", bc->name,
+               (unsigned long)(lvgl_cyc / n), (unsigned long)(lvgl_cyc * 100 / n % 100),
+               (unsigned long)(port_cyc / n), (unsigned long)(port_cyc * 100 / n % 100),
+               (unsigned long)diff);
+    }
+
+    _lv_refr_set_disp_refreshing(prev);
+
+done:
+    lv_mem_free(ref);
+    lv_mem_free(out);
+    lv_mem_free(src);
+    lv_mem_free(mask);
+}
+
+#endif // LV_PORT_FAST_BLEND
@@ -0,0 +1,133 @@
+#include "lv_port_dflush.h"
+
+#if LV_PORT_DIFF_FLUSH
+
+#include "port_fast_mem.h"
+#include <string.h>
+
+#if (ST7789_WIDTH % DFLUSH_SEG_W) != 0 || (DFLUSH_SEG_W % 2) != 0
+#error "DFLUSH_SEG_W must be even and divide ST7789_WIDTH"
+#endif
+
+#define SEG_COUNT (ST7789_HEIGHT * DFLUSH_SEGS)
+
+static uint32_t seg_hash[SEG_COUNT];
+static uint32_t seg_valid[(SEG_COUNT + 31) / 32]; // Hash known for the panel content
+static lv_port_dflush_stats_t stats;
+static uint32_t frame_rendered;
+static uint32_t frame_sent;
+
+// FNV-1a over 32-bit words: each step is a bijection of the state, so a
+// single changed word always changes the hash
+static inline uint32_t hash_segment(const uint16_t *p) {
+    uint32_t h = 0x811C9DC5u;
+    for (int i = 0; i < DFLUSH_SEG_W; i += 2) {
+        h = (h ^ (p[i] | ((uint32_t)p[i + 1] << 16))) * 0x01000193u;
+    }
+    return h;
+}
+
+static inline bool seg_is_valid(uint32_t i) {
+    return (seg_valid[i >> 5] >> (i & 31)) & 1;
+}
+
+void lv_port_dflush_round(lv_area_t *area) {
+    area->x1 -= area->x1 % DFLUSH_SEG_W;
+    area->x2 += DFLUSH_SEG_W - 1 - area->x2 % DFLUSH_SEG_W;
+}
+
+static size_t send_rect(const lv_area_t *area, const uint16_t *pixels, int32_t y0, int32_t y1, int32_t s0, int32_t s1) {
+    int32_t w = lv_area_get_width(area);
+    int32_t x0 = s0 * DFLUSH_SEG_W;
+    int32_t rect_w = (s1 - s0 + 1) * DFLUSH_SEG_W;
+    int32_t rect_h = y1 - y0 + 1;
+
+    st7789_set_window(x0, y0, x0 + rect_w - 1, y1);
+    st7789_send_pixels_rect(pixels + (y0 - area->y1) * w + (x0 - area->x1), rect_w, rect_h, w);
+    stats.windows++;
+    return (size_t)rect_w * rect_h * 2;
+}
+
+size_t PORT_FAST_FUNC(lv_port_dflush_send)(const lv_area_t *area, const uint16_t *pixels, bool last) {
+    int32_t w = lv_area_get_width(area);
+    size_t rendered = (size_t)w * lv_area_get_height(area) * 2;
+    size_t sent = 0;
+
+    if (area->x1 % DFLUSH_SEG_W || (area->x2 + 1) % DFLUSH_SEG_W) {
+        // Not rounded (e.g. another rounder in front): send all, and the
+        // partly covered segments no longer match their hashes
+        for (int32_t y = area->y1; y <= area->y2; y++) {
+            for (int32_t s = area->x1 / DFLUSH_SEG_W; s <= area->x2 / DFLUSH_SEG_W; s++) {
+                uint32_t i = y * DFLUSH_SEGS + s;
+                seg_valid[i >> 5] &= ~(1u << (i & 31));
+            }
+        }
+        st7789_set_window(area->x1, area->y1, area->x2, area->y2);
+        st7789_send_pixels(pixels, (size_t)w * lv_area_get_height(area));
+        stats.windows++;
+        sent = rendered;
+    } else {
+        int32_t first = area->x1 / DFLUSH_SEG_W;
+        int32_t last_seg = area->x2 / DFLUSH_SEG_W;
+        int32_t run_y0 = -1, run_s0 = 0, run_s1 = 0; // Pending rows with the same span
+
+        for (int32_t y = area->y1; y <= area->y2; y++) {
+            const uint16_t *row = pixels + (y - area->y1) * w;
+            int32_t c0 = -1, c1 = -1;
+
+            for (int32_t s = first; s <= last_seg; s++) {
+                uint32_t h = hash_segment(row + (s - first) * DFLUSH_SEG_W);
+                uint32_t i = y * DFLUSH_SEGS + s;
+                if (!seg_is_valid(i) || seg_hash[i] != h) {
+                    seg_hash[i] = h;
+                    seg_valid[i >> 5] |= 1u << (i & 31);
+                    if (c0 < 0) c0 = s;
+                    c1 = s;
+                }
+            }
+
+            if (run_y0 >= 0 && (c0 != run_s0 || c1 != run_s1)) {
+                sent += send_rect(area, pixels, run_y0, y - 1, run_s0, run_s1);
+                run_y0 = -1;
+            }
+            if (c0 >= 0 && run_y0 < 0) {
+                run_y0 = y;
+                run_s0 = c0;
+                run_s1 = c1;
+            }
+        }
+        if (run_y0 >= 0) sent += send_rect(area, pixels, run_y0, area->y2, run_s0, run_s1);
+    }
+
+    stats.bytes_rendered += rendered;
+    stats.bytes_sent += sent;
+    frame_rendered += rendered;
+    frame_sent += sent;
+    if (last) {
+        stats.frames++;
+        stats.last_frame_rendered = frame_rendered;
+        stats.last_frame_sent = frame_sent;
+        frame_rendered = 0;
+        frame_sent = 0;
+    }
+    return sent;
+}
+
+void lv_port_dflush_invalidate(void) {
+    memset(seg_valid, 0, sizeof(seg_valid));
+}
+
+void lv_port_dflush_forget(const lv_area_t *area) {
+    for (int32_t y = area->y1; y <= area->y2; y++) {
+        for (int32_t s = area->x1 / DFLUSH_SEG_W; s <= area->x2 / DFLUSH_SEG_W; s++) {
+            uint32_t i = y * DFLUSH_SEGS + s;
+            seg_valid[i >> 5] &= ~(1u << (i & 31));
+        }
+    }
+}
+
+void lv_port_dflush_get_stats(lv_port_dflush_stats_t *out) {
+    memcpy(out, &stats, sizeof(stats));
+}
+
+#endif // LV_PORT_DIFF_FLUSH
@@ -1,13 +1,41 @@
 #include "lv_port_disp.h"
 #include "st7789.h" // Path to your ST7789 driver
-#include "pico/stdlib.h" // For printf
-#include "stdio.h" // For printf, if needed
+#include "st7789_cxx.h"
+#include "lv_port_backlight.h"
+#include "lv_port_blend.h"
+#include "lv_port_dflush.h"
+#include "lv_port_gov.h"
+#include "lv_port_latency.h"
+#include "lv_port_layer.h"
+#include "lv_port_msgq.h"
+#include "lv_port_overdraw.h"
+#include "lv_port_power.h"
+#include "lv_port_prof.h"
+#include "lv_port_readback.h"
+#include "pico/stdlib.h"
+#include "port_log.h"
+#include "port_fast_mem.h"
+#include "spi_tune.h"
 
+#if ST7789_CXX && (LV_PORT_DIFF_FLUSH || LV_PORT_READBACK || LV_PORT_BL_AUTODIM || LV_PORT_PANEL_SLEEP || \
+                   LV_PORT_REFRESH_GOV || SPI_CLOCK_TUNE || SPI_BUS_SHARED)
+#error "ST7789_CXX: these ports need the C driver's default panel (writes, reads, sleep, backlight, frame rate)"
+#endif
+#if ST7789_CXX && LV_PORT_PROFILER
+// Its render time is the refresh minus the flushes, which only holds while
+// a band is sent before the next one is rendered
+#error "ST7789_CXX: LV_PORT_PROFILER needs the C driver's blocking flush"
+#endif
 
 // Define the display width and height from LVGL's perspective
 // These should match LV_HOR_RES_MAX and LV_VER_RES_MAX in lv_conf.h
+#if ST7789_CXX
+#define DISP_HOR_RES    ST7789_CXX_HOR_RES // After ST7789_CXX_ROTATION
+#define DISP_VER_RES    ST7789_CXX_VER_RES
+#else
 #define DISP_HOR_RES    ST7789_WIDTH
 #define DISP_VER_RES    ST7789_HEIGHT
+#endif
 
 // Display buffer size:
 // Option 1: Full frame buffer (requires DISP_HOR_RES * DISP_VER_RES * LV_COLOR_DEPTH/8 bytes of RAM)
@@ -15,23 +43,69 @@
 //
 // Option 2: Partial buffer (e.g., 1/10th of the screen)
 // This is more memory-efficient.
-#define DISP_BUF_SIZE (DISP_HOR_RES * 32) // Buffer for 32 lines
+//
+// tools/ram_budget.py sizes the band from the link map and writes
+// DISP_BUF_LINES/DISP_BUF_COUNT into disp_buf_config.h; without it 2 x 32 lines.
+#if defined(__has_include)
+#if __has_include("disp_buf_config.h")
+#include "disp_buf_config.h"
+#endif
+#endif
+#ifndef DISP_BUF_LINES
+#define DISP_BUF_LINES 32
+#endif
+#ifndef DISP_BUF_COUNT
+#define DISP_BUF_COUNT 2
+#endif
+#define DISP_BUF_SIZE (DISP_HOR_RES * DISP_BUF_LINES)
 
 static lv_disp_draw_buf_t disp_buf;
 static lv_color_t buf_1[DISP_BUF_SIZE];
-#if DISP_BUF_SIZE < (DISP_HOR_RES * DISP_VER_RES)
+#if DISP_BUF_COUNT > 1 && DISP_BUF_SIZE < (DISP_HOR_RES * DISP_VER_RES)
 static lv_color_t buf_2[DISP_BUF_SIZE]; // Use two buffers if not full frame
 #else
 // No second buffer needed for full frame
 #endif
 
+static lv_disp_t *disp; // Returned by lv_disp_drv_register
+
+#if !ST7789_SINGLE_PANEL
+// Further panels, see lv_port_disp_add_panel()
+typedef struct {
+    lv_disp_drv_t drv;
+    lv_disp_draw_buf_t draw_buf;
+} panel_disp_t;
+
+static panel_disp_t panel_disps[ST7789_MAX_PANELS];
+static uint32_t panel_disp_count;
+#endif
+
 static void disp_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p);
+#if !ST7789_SINGLE_PANEL
+static void panel_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p);
+#endif
+#if ST7789_CXX
+static void cxx_flush_done(void *ctx);
+#endif
+#if LV_PORT_LATENCY_TRACE || LV_PORT_REFRESH_GOV || LV_PORT_DIFF_FLUSH || LV_PORT_OVERDRAW || LV_PORT_READBACK
+static void disp_rounder(lv_disp_drv_t *disp_drv, lv_area_t *area);
+#endif
+#if LV_PORT_LATENCY_TRACE || LV_PORT_OVERDRAW
+static void disp_monitor(lv_disp_drv_t *disp_drv, uint32_t time, uint32_t px);
+#endif
 
 void lv_port_disp_init(void) {
+#if ST7789_CXX
+    st7789_cxx_init();
+#else
     st7789_init(); // Initialize your ST7789 driver
+#endif
+#if SPI_CLOCK_TUNE
+    spi_tune_panel(&st7789_default_panel, false);
+#endif
 
     lv_disp_draw_buf_init(&disp_buf, buf_1, 
-#if DISP_BUF_SIZE < (DISP_HOR_RES * DISP_VER_RES)
+#if DISP_BUF_COUNT > 1 && DISP_BUF_SIZE < (DISP_HOR_RES * DISP_VER_RES)
                         buf_2, 
 #else
                         NULL,
@@ -49,12 +123,91 @@ void lv_port_disp_init(void) {
                                   // Set to 0 if you want LVGL to only update changed areas (more efficient)
     // disp_drv.rounder_cb = disp_rounder; // Optional: if your hardware requires specific alignments
     // disp_drv.set_px_cb = disp_set_px; // Optional: for direct pixel setting (slower)
+#if LV_PORT_LATENCY_TRACE || LV_PORT_REFRESH_GOV || LV_PORT_DIFF_FLUSH || LV_PORT_OVERDRAW || LV_PORT_READBACK
+    // Besides the segment alignment (differential flush, readback) the
+    // rounder doesn't round anything, it's the only per-area hook LVGL
+    // calls on invalidation
+    disp_drv.rounder_cb = disp_rounder;
+#endif
+#if LV_PORT_LATENCY_TRACE || LV_PORT_OVERDRAW
+    disp_drv.monitor_cb = disp_monitor;
+#endif
+#if LV_PORT_FAST_BLEND
+    disp_drv.draw_ctx_init = lv_port_blend_ctx_init; // Same context size as the SW one
+#endif
+#if LV_PORT_OVERDRAW
+    disp_drv.draw_ctx_init = lv_port_overdraw_ctx_init; // Counts the writes of the blend set up above
+#endif
+#if LV_PORT_DIRECT_LAYER
+    disp_drv.draw_ctx_init = lv_port_layer_ctx_init; // Sets up the two above itself
+#endif
 
-    lv_disp_drv_register(&disp_drv);
-    printf("LVGL Display Port Initialized\n");
+    disp = lv_disp_drv_register(&disp_drv);
+#if LV_PORT_PROFILER
+    lv_port_prof_init(disp, NULL);
+#endif
+#if LV_PORT_REFRESH_GOV
+    lv_port_gov_init(disp);
+#endif
+#if LV_PORT_PANEL_SLEEP
+    lv_port_power_init(disp); // After the profiler, so its timing stops while asleep
+#endif
+#if LV_PORT_MSGQ
+    lv_port_msgq_init();
+#endif
+#if LV_PORT_READBACK
+    lv_port_readback_init(disp);
+#endif
+    PORT_LOGI("LVGL Display Port Initialized\n");
+}
+
+#if !ST7789_SINGLE_PANEL
+lv_disp_t *lv_port_disp_add_panel(st7789_t *panel, lv_color_t *buf_1, lv_color_t *buf_2, uint32_t buf_px) {
+    if (panel_disp_count == ST7789_MAX_PANELS) {
+        PORT_LOGE("lv_port_disp: no room for another panel\n");
+        return NULL;
+    }
+    panel_disp_t *pd = &panel_disps[panel_disp_count++];
+
+    lv_disp_draw_buf_init(&pd->draw_buf, buf_1, buf_2, buf_px);
+    lv_disp_drv_init(&pd->drv);
+    pd->drv.hor_res = panel->cfg.width;
+    pd->drv.ver_res = panel->cfg.height;
+    pd->drv.flush_cb = panel_flush;
+    pd->drv.draw_buf = &pd->draw_buf;
+    pd->drv.user_data = panel;
+#if LV_PORT_FAST_BLEND
+    pd->drv.draw_ctx_init = lv_port_blend_ctx_init;
+#endif
+    return lv_disp_drv_register(&pd->drv);
 }
+#endif
+
+static void PORT_FAST_FUNC(disp_flush)(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p) {
+#if LV_PORT_PROFILER
+    lv_port_prof_flush_begin(area);
+#endif
+#if LV_PORT_LATENCY_TRACE && !ST7789_CXX
+    lv_port_latency_flush_begin(area);
+#endif
+#if LV_PORT_OVERDRAW
+    lv_port_overdraw_flush(area);
+#endif
 
-static void disp_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p) {
+#if LV_PORT_DIFF_FLUSH
+    // Only the rows that differ from what the panel already shows
+    size_t sent = lv_port_dflush_send(area, (const uint16_t *)color_p, lv_disp_flush_is_last(disp_drv));
+#elif ST7789_CXX
+    // On the DMA bus this returns once the band is started and LVGL renders
+    // the next one meanwhile; the callback tells LVGL when it's out
+    size_t len = lv_area_get_size(area);
+    st7789_cxx_set_window(area->x1, area->y1, area->x2, area->y2); // Waits for the previous band
+#if LV_PORT_LATENCY_TRACE
+    lv_port_latency_flush_begin(area); // Once the previous band's end is recorded
+#endif
+    st7789_cxx_send_pixels_async((const uint16_t *)color_p, len, cxx_flush_done, disp_drv);
+    size_t sent = len * 2;
+#else
     int32_t x1 = area->x1;
     int32_t y1 = area->y1;
     int32_t x2 = area->x2;
@@ -69,11 +222,89 @@ static void disp_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_
     // Send pixel data to ST7789
     // color_p is already in the correct format (RGB565 with potential byte swap from lv_conf.h)
     st7789_send_pixels((const uint16_t *)color_p, len);
+    size_t sent = len * Bpp;
+#endif
 
+#if LV_PORT_READBACK
+    port_readback_record(area->x1, area->y1, area->x2, area->y2, (const uint16_t *)color_p);
+#endif
+#if LV_PORT_LATENCY_TRACE && !ST7789_CXX
+    lv_port_latency_flush_end();
+#endif
+#if LV_PORT_PROFILER
+    lv_port_prof_flush_end(sent);
+#endif
+    (void)sent;
+
+#if !ST7789_CXX
     // IMPORTANT: Inform LVGL that flushing is done
     lv_disp_flush_ready(disp_drv);
+#endif
+}
+
+#if ST7789_CXX
+static void cxx_flush_done(void *ctx) {
+#if LV_PORT_LATENCY_TRACE
+    lv_port_latency_flush_end(); // The band is out: its photon time
+#endif
+    lv_disp_flush_ready((lv_disp_drv_t *)ctx); // At once or from the DMA IRQ
+}
+#endif
+
+#if !ST7789_SINGLE_PANEL
+static void panel_flush_done(st7789_t *panel, void *ctx) {
+    (void)panel;
+    lv_disp_flush_ready((lv_disp_drv_t *)ctx); // From the DMA IRQ
 }
 
+// Returns once the DMA is started, LVGL renders the next band meanwhile
+static void PORT_FAST_FUNC(panel_flush)(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p) {
+    st7789_t *panel = disp_drv->user_data;
+    st7789_panel_set_window(panel, area->x1, area->y1, area->x2, area->y2); // Waits for the previous band
+    st7789_panel_send_pixels_async(panel, (const uint16_t *)color_p, lv_area_get_size(area), panel_flush_done,
+                                   disp_drv);
+}
+#endif
+
+#if LV_PORT_LATENCY_TRACE || LV_PORT_REFRESH_GOV || LV_PORT_DIFF_FLUSH || LV_PORT_OVERDRAW || LV_PORT_READBACK
+static void disp_rounder(lv_disp_drv_t *disp_drv, lv_area_t *area) {
+    (void)disp_drv;
+#if LV_PORT_DIFF_FLUSH
+    lv_port_dflush_round(area);
+#elif LV_PORT_READBACK
+    // Whole segments, so each one flushed gets a CRC
+    area->x1 -= area->x1 % READBACK_SEG_W;
+    area->x2 += READBACK_SEG_W - 1 - area->x2 % READBACK_SEG_W;
+#endif
+    // LVGL also calls the rounder while rendering to probe the band height,
+    // only the calls from _lv_inv_area are invalidations
+    if (disp == NULL || disp->rendering_in_progress) return;
+#if LV_PORT_LATENCY_TRACE
+    lv_port_latency_invalidate(area);
+#endif
+#if LV_PORT_REFRESH_GOV
+    lv_port_gov_invalidate(area);
+#endif
+#if LV_PORT_OVERDRAW
+    lv_port_overdraw_invalidate(area);
+#endif
+}
+#endif
+
+#if LV_PORT_LATENCY_TRACE || LV_PORT_OVERDRAW
+static void disp_monitor(lv_disp_drv_t *disp_drv, uint32_t time, uint32_t px) {
+    (void)disp_drv;
+    (void)time;
+    (void)px;
+#if LV_PORT_LATENCY_TRACE
+    lv_port_latency_refresh_done();
+#endif
+#if LV_PORT_OVERDRAW
+    lv_port_overdraw_refresh_done();
+#endif
+}
+#endif
+
 /* Optional rounder function if your hardware has specific alignment requirements for transfers */
 // static void disp_rounder(lv_disp_drv_t * disp_drv, lv_area_t * area)
 // {
@@ -0,0 +1,147 @@
+#include "lv_port_fs.h"
+
+#if LV_PORT_FS
+
+#include <stdio.h>
+#include <string.h>
+
+static lfs_dir_t dir;
+static bool dir_used;
+
+static lv_fs_res_t lfs_res(int err) {
+    switch (err) {
+    case LFS_ERR_OK:
+        return LV_FS_RES_OK;
+    case LFS_ERR_NOENT:
+        return LV_FS_RES_NOT_EX;
+    case LFS_ERR_NOSPC:
+        return LV_FS_RES_FULL;
+    case LFS_ERR_NOMEM:
+        return LV_FS_RES_OUT_OF_MEM;
+    case LFS_ERR_IO:
+    case LFS_ERR_CORRUPT:
+        return LV_FS_RES_HW_ERR;
+    case LFS_ERR_INVAL:
+        return LV_FS_RES_INV_PARAM;
+    default:
+        return LV_FS_RES_FS_ERR;
+    }
+}
+
+static void *fs_open(lv_fs_drv_t *drv, const char *path, lv_fs_mode_t mode) {
+    (void)drv;
+    int flags;
+    if (mode == (LV_FS_MODE_WR | LV_FS_MODE_RD)) {
+        flags = LFS_O_RDWR | LFS_O_CREAT;
+    } else if (mode == LV_FS_MODE_WR) {
+        flags = LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC;
+    } else {
+        flags = LFS_O_RDONLY;
+    }
+    return port_lfs_open(path, flags);
+}
+
+static lv_fs_res_t fs_close(lv_fs_drv_t *drv, void *file_p) {
+    (void)drv;
+    return lfs_res(port_lfs_close(file_p));
+}
+
+static lv_fs_res_t fs_read(lv_fs_drv_t *drv, void *file_p, void *buf, uint32_t btr, uint32_t *br) {
+    (void)drv;
+    int32_t n = port_lfs_read(file_p, buf, btr);
+    *br = n > 0 ? (uint32_t)n : 0;
+    return n < 0 ? lfs_res(n) : LV_FS_RES_OK;
+}
+
+static lv_fs_res_t fs_write(lv_fs_drv_t *drv, void *file_p, const void *buf, uint32_t btw, uint32_t *bw) {
+    (void)drv;
+    int32_t n = port_lfs_write(file_p, buf, btw);
+    *bw = n > 0 ? (uint32_t)n : 0;
+    return n < 0 ? lfs_res(n) : LV_FS_RES_OK;
+}
+
+static lv_fs_res_t fs_seek(lv_fs_drv_t *drv, void *file_p, uint32_t pos, lv_fs_whence_t whence) {
+    (void)drv;
+    port_lfs_file_t *f = file_p;
+    if (whence == LV_FS_SEEK_CUR) {
+        pos += port_lfs_tell(f);
+    } else if (whence == LV_FS_SEEK_END) {
+        pos += port_lfs_size(f);
+    }
+    port_lfs_seek(f, pos);
+    return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t fs_tell(lv_fs_drv_t *drv, void *file_p, uint32_t *pos_p) {
+    (void)drv;
+    *pos_p = port_lfs_tell(file_p);
+    return LV_FS_RES_OK;
+}
+
+// One directory open at a time, like the other LVGL drivers without malloc
+static void *fs_dir_open(lv_fs_drv_t *drv, const char *path) {
+    (void)drv;
+    if (dir_used || lfs_dir_open(port_lfs(), &dir, path) < 0) return NULL;
+    dir_used = true;
+    return &dir;
+}
+
+// Directories come back as "/name", the end as ""
+static lv_fs_res_t fs_dir_read(lv_fs_drv_t *drv, void *rddir_p, char *fn) {
+    (void)drv;
+    struct lfs_info info;
+    for (;;) {
+        int r = lfs_dir_read(port_lfs(), rddir_p, &info);
+        if (r < 0) return lfs_res(r);
+        if (r == 0) {
+            fn[0] = '\0';
+            return LV_FS_RES_OK;
+        }
+        if (strcmp(info.name, ".") != 0 && strcmp(info.name, "..") != 0) break;
+    }
+    if (info.type == LFS_TYPE_DIR) {
+        fn[0] = '/';
+        strcpy(fn + 1, info.name);
+    } else {
+        strcpy(fn, info.name);
+    }
+    return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t fs_dir_close(lv_fs_drv_t *drv, void *rddir_p) {
+    (void)drv;
+    dir_used = false;
+    return lfs_res(lfs_dir_close(port_lfs(), rddir_p));
+}
+
+bool lv_port_fs_init(void) {
+    if (port_lfs_mount(true) != LFS_ERR_OK) return false;
+
+    static lv_fs_drv_t drv;
+    lv_fs_drv_init(&drv);
+    drv.letter = LV_PORT_FS_LETTER;
+    drv.cache_size = 0; // port_lfs caches per file
+    drv.open_cb = fs_open;
+    drv.close_cb = fs_close;
+    drv.read_cb = fs_read;
+    drv.write_cb = fs_write;
+    drv.seek_cb = fs_seek;
+    drv.tell_cb = fs_tell;
+    drv.dir_open_cb = fs_dir_open;
+    drv.dir_read_cb = fs_dir_read;
+    drv.dir_close_cb = fs_dir_close;
+    lv_fs_drv_register(&drv);
+    return true;
+}
+
+void lv_port_fs_print(void) {
+    port_lfs_stats_t s;
+    port_lfs_get_stats(&s);
+    printf("File system: %lu reads, %lu from the cache, %lu cache fills, %lu direct\n", (unsigned long)s.reads,
+           (unsigned long)s.hits, (unsigned long)s.fills, (unsigned long)s.direct);
+    printf("  flash: %lu reads (%lu streamed), %lu bytes, %lu page writes, %lu erases\n",
+           (unsigned long)s.bd_reads, (unsigned long)s.bd_streamed, (unsigned long)s.bd_read_bytes,
+           (unsigned long)s.bd_progs, (unsigned long)s.bd_erases);
+}
+
+#endif // LV_PORT_FS
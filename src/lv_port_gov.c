@@ -0,0 +1,104 @@
+#include "lv_port_gov.h"
+
+#if LV_PORT_REFRESH_GOV
+
+#include "st7789.h"
+#include "port_log.h"
+#include <string.h>
+
+static lv_disp_t *gov_disp;
+static lv_timer_t *gov_timer;
+static lv_port_gov_policy_t policy = LV_PORT_GOV_POLICY_DEFAULT;
+static lv_port_gov_level_t level = GOV_LEVEL_IDLE;
+static lv_port_gov_stats_t stats;
+static uint32_t level_since_ms;
+
+// Activity in the current window
+static uint32_t window_px;
+static bool window_pressed;
+static bool pen_down;
+static uint16_t quiet_windows;
+
+static void apply_level(lv_port_gov_level_t new_level) {
+    uint32_t now = lv_tick_get();
+    stats.ms_in[level] += now - level_since_ms;
+    level_since_ms = now;
+    if (new_level != level) stats.transitions++;
+    level = new_level;
+    quiet_windows = 0;
+
+    const lv_port_gov_rate_t *r = &policy.rate[level];
+    if (gov_disp && gov_disp->refr_timer) lv_timer_set_period(gov_disp->refr_timer, r->refr_period_ms);
+    st7789_set_frame_rate(r->panel_hz);
+    PORT_LOGD("gov: level %u, %u ms, %u Hz\n", level, r->refr_period_ms, r->panel_hz);
+}
+
+static void wake_timer(void) {
+    if (gov_timer && gov_timer->paused) {
+        lv_timer_reset(gov_timer); // A full window from now
+        lv_timer_resume(gov_timer);
+    }
+}
+
+static void gov_timer_cb(lv_timer_t *timer) {
+    bool active = window_pressed || pen_down || window_px >= policy.active_px ||
+                  (policy.anim_is_active && lv_anim_count_running() > 0);
+    window_px = 0;
+    window_pressed = false;
+
+    if (active) {
+        if (level != GOV_LEVEL_ACTIVE) apply_level(GOV_LEVEL_ACTIVE);
+        quiet_windows = 0;
+    } else if (level == GOV_LEVEL_ACTIVE) {
+        if (++quiet_windows >= policy.idle_windows) apply_level(GOV_LEVEL_IDLE);
+    } else {
+        // Idle and nothing happening: the hooks resume the timer
+        lv_timer_pause(timer);
+    }
+}
+
+void lv_port_gov_init(lv_disp_t *disp) {
+    gov_disp = disp;
+    level_since_ms = lv_tick_get();
+    gov_timer = lv_timer_create(gov_timer_cb, GOV_WINDOW_MS, NULL);
+    apply_level(GOV_LEVEL_IDLE);
+}
+
+void lv_port_gov_set_policy(const lv_port_gov_policy_t *p) {
+    policy = *p;
+    apply_level(level); // New rates for the current level
+}
+
+void lv_port_gov_get_policy(lv_port_gov_policy_t *p) {
+    *p = policy;
+}
+
+lv_port_gov_level_t lv_port_gov_get_level(void) {
+    return level;
+}
+
+void lv_port_gov_get_stats(lv_port_gov_stats_t *out) {
+    memcpy(out, &stats, sizeof(stats));
+    out->ms_in[level] += lv_tick_get() - level_since_ms;
+}
+
+void lv_port_gov_invalidate(const lv_area_t *area) {
+    window_px += lv_area_get_size(area);
+    // Animations are picked up at the end of the window; a large change
+    // (screen load, scroll) raises the rate right away
+    if (level == GOV_LEVEL_IDLE && window_px >= policy.active_px * 4) apply_level(GOV_LEVEL_ACTIVE);
+    wake_timer();
+}
+
+void lv_port_gov_input(bool pressed) {
+    if (pressed && !pen_down && level == GOV_LEVEL_IDLE) {
+        apply_level(GOV_LEVEL_ACTIVE); // Touch response shouldn't wait for a window
+    }
+    pen_down = pressed;
+    if (pressed) {
+        window_pressed = true;
+        wake_timer();
+    }
+}
+
+#endif // LV_PORT_REFRESH_GOV
@@ -1,6 +1,11 @@
 #include "lv_port_indev.h"
 #include "xpt2046.h" // Path to your XPT2046 driver
-#include <stdio.h> // For printf debugging
+#include "lv_port_backlight.h"
+#include "lv_port_gov.h"
+#include "lv_port_latency.h"
+#include "lv_port_prof.h"
+#include "lv_port_sched.h"
+#include "port_log.h"
 
 static void xpt2046_read_cb(lv_indev_drv_t *indev_drv, lv_indev_data_t *data);
 
@@ -16,9 +21,18 @@ void lv_port_indev_init(void) {
 
     indev_touchpad = lv_indev_drv_register(&indev_drv); // Register the driver
     if (indev_touchpad == NULL) {
-        printf("ERROR: Failed to register XPT2046 input device!\n");
+        PORT_LOGE("Failed to register XPT2046 input device!\n");
     } else {
-        printf("LVGL Input (XPT2046) Port Initialized\n");
+        PORT_LOGI("LVGL Input (XPT2046) Port Initialized\n");
+#if LV_PORT_PROFILER
+        lv_port_prof_init(NULL, indev_touchpad);
+#endif
+#if LV_PORT_TICKLESS
+        lv_port_sched_set_indev(indev_touchpad);
+#endif
+#if LV_PORT_BL_AUTODIM
+        lv_port_bl_init();
+#endif
     }
 }
 
@@ -28,6 +42,16 @@ static void xpt2046_read_cb(lv_indev_drv_t *indev_drv, lv_indev_data_t *data) {
     static uint16_t last_x = 0;
     static uint16_t last_y = 0;
 
+#if LV_PORT_LATENCY_TRACE
+    if (lv_port_latency_injected(data)) {
+        lv_port_latency_input(data);
+#if LV_PORT_REFRESH_GOV
+        lv_port_gov_input(data->state == LV_INDEV_STATE_PR);
+#endif
+        return;
+    }
+#endif
+
     bool touched = xpt2046_is_touched();
 
     if (touched) {
@@ -50,4 +74,14 @@ static void xpt2046_read_cb(lv_indev_drv_t *indev_drv, lv_indev_data_t *data) {
         data->point.y = last_y;
         data->state = LV_INDEV_STATE_REL; // Released
     }
+
+#if LV_PORT_LATENCY_TRACE
+    lv_port_latency_input(data);
+#endif
+#if LV_PORT_REFRESH_GOV
+    lv_port_gov_input(data->state == LV_INDEV_STATE_PR);
+#endif
+#if LV_PORT_BL_AUTODIM
+    lv_port_bl_input(data->state == LV_INDEV_STATE_PR);
+#endif
 }
@@ -0,0 +1,240 @@
+#include "lv_port_latency.h"
+
+#if LV_PORT_LATENCY_TRACE
+
+#include "xpt2046.h" // For the pen-down timestamp
+#include "lv_port_sched.h"
+#include "pico/time.h"
+#include <stdio.h>
+#include <string.h>
+
+// One interaction is traced at a time. Samples arriving while a trace is in
+// flight are not tagged, so a drag is measured at the trace rate rather than
+// the read rate, which keeps the bookkeeping O(1) per hook.
+typedef enum {
+    TRACE_IDLE = 0,
+    TRACE_WAIT_INVALIDATE, // sample taken, waiting for LVGL to invalidate
+    TRACE_WAIT_RENDER,     // area known, waiting for a band covering it
+    TRACE_FLUSHING         // at least one covering band flushed
+} trace_state_t;
+
+static struct {
+    trace_state_t state;
+    uint32_t t_down;
+    uint32_t t_read;
+    uint32_t t_inv;
+    uint32_t t_render;
+    uint32_t t_done;
+    lv_area_t area;
+    volatile bool band_hit; // the band being flushed now covers the traced area
+    bool refresh_over;      // the refresh ended with that band still going out
+} trace;
+
+static struct {
+    bool active;
+    bool pressed_reported;
+    uint16_t x, y;
+    uint32_t t_start;
+    uint32_t t_until;
+} inject;
+
+static lv_indev_state_t last_state = LV_INDEV_STATE_REL;
+static lv_point_t last_point;
+static lat_stats_t stats;
+
+static void stage_add(lat_stage_t stage, uint32_t us) {
+    lat_stage_stats_t *s = &stats.stage[stage];
+    if (s->count == 0 || us < s->min_us) s->min_us = us;
+    if (us > s->max_us) s->max_us = us;
+    s->sum_us += us;
+    s->count++;
+}
+
+static void trace_finish(void) {
+    stage_add(LAT_STAGE_INPUT, trace.t_read - trace.t_down);
+    stage_add(LAT_STAGE_EVENT, trace.t_inv - trace.t_read);
+    stage_add(LAT_STAGE_RENDER, trace.t_render - trace.t_inv);
+    stage_add(LAT_STAGE_FLUSH, trace.t_done - trace.t_render);
+
+    uint32_t total = trace.t_done - trace.t_down;
+    stage_add(LAT_STAGE_TOTAL, total);
+
+    uint32_t bucket = total / (LAT_HIST_BUCKET_MS * 1000);
+    if (bucket >= LAT_HIST_BUCKETS) bucket = LAT_HIST_BUCKETS - 1;
+    stats.hist[bucket]++;
+    stats.interactions++;
+
+    trace.state = TRACE_IDLE;
+    trace.refresh_over = false;
+}
+
+// With DMA flushes (ST7789_CXX) LVGL ends a refresh while its last band is
+// still going out; the trace finishes once that band's end is recorded
+static void trace_poll(void) {
+    if (trace.state == TRACE_FLUSHING && trace.refresh_over && !trace.band_hit) trace_finish();
+}
+
+// Gives up a trace that has waited too long for its stage. Checked on every
+// input sample, which is the only place a new trace can start.
+static void trace_timeout(uint32_t now) {
+    if (trace.state == TRACE_WAIT_INVALIDATE && now - trace.t_read > LAT_TRACE_TIMEOUT_MS * 1000) {
+        stats.dropped++;
+        trace.state = TRACE_IDLE;
+    } else if ((trace.state == TRACE_WAIT_RENDER || trace.state == TRACE_FLUSHING) &&
+               now - trace.t_read > LAT_TRACE_STALL_MS * 1000) {
+        stats.stalled++;
+        trace.state = TRACE_IDLE;
+        trace.band_hit = false;
+        trace.refresh_over = false;
+    }
+}
+
+void lv_port_latency_input(const lv_indev_data_t *data) {
+    uint32_t now = time_us_32();
+
+    trace_poll();
+    trace_timeout(now);
+
+    bool changed = data->state != last_state ||
+                   (data->state == LV_INDEV_STATE_PR &&
+                    (data->point.x != last_point.x || data->point.y != last_point.y));
+    bool pen_down = data->state == LV_INDEV_STATE_PR && last_state == LV_INDEV_STATE_REL;
+    last_state = data->state;
+    last_point = data->point;
+
+    if (!changed || trace.state != TRACE_IDLE) return;
+
+    trace.t_read = now;
+    trace.t_down = now;
+    if (pen_down) {
+        if (inject.active) {
+            trace.t_down = inject.t_start;
+        } else {
+            // Use the IRQ edge if it belongs to this press, otherwise the pin
+            // was already low when the read timer polled it
+            uint32_t edge = xpt2046_pen_down_time_us();
+            if (now - edge < LAT_TRACE_TIMEOUT_MS * 1000) trace.t_down = edge;
+        }
+    }
+    trace.state = TRACE_WAIT_INVALIDATE;
+}
+
+void lv_port_latency_invalidate(const lv_area_t *area) {
+    if (trace.state == TRACE_WAIT_INVALIDATE) {
+        trace.t_inv = time_us_32();
+        lv_area_copy(&trace.area, area);
+        trace.state = TRACE_WAIT_RENDER;
+    } else if (trace.state == TRACE_WAIT_RENDER) {
+        // Everything invalidated before the next refresh belongs to the same response
+        _lv_area_join(&trace.area, &trace.area, area);
+    }
+}
+
+void lv_port_latency_flush_begin(const lv_area_t *area) {
+    if (trace.state != TRACE_WAIT_RENDER && trace.state != TRACE_FLUSHING) return;
+    if (!_lv_area_is_on(area, &trace.area)) return;
+
+    if (trace.state == TRACE_WAIT_RENDER) {
+        // Flush starts right after the band has been rendered
+        trace.t_render = time_us_32();
+        trace.state = TRACE_FLUSHING;
+    }
+    trace.band_hit = true;
+}
+
+// From disp_flush, or from the DMA IRQ with ST7789_CXX
+void lv_port_latency_flush_end(void) {
+    if (trace.band_hit) {
+        trace.t_done = time_us_32();
+        trace.band_hit = false;
+    }
+}
+
+void lv_port_latency_refresh_done(void) {
+    // All bands of this refresh are out, the last covering one set t_done,
+    // unless it is still on the DMA
+    if (trace.state == TRACE_FLUSHING) {
+        if (trace.band_hit) {
+            trace.refresh_over = true;
+        } else {
+            trace_finish();
+        }
+    }
+}
+
+void lv_port_latency_inject(uint16_t x, uint16_t y, uint32_t hold_ms) {
+    inject.x = x;
+    inject.y = y;
+    inject.t_start = time_us_32();
+    inject.t_until = inject.t_start + hold_ms * 1000;
+    inject.pressed_reported = false;
+    inject.active = true;
+#if LV_PORT_TICKLESS
+    lv_port_sched_wake(); // Touch polling may be paused
+#endif
+}
+
+bool lv_port_latency_injected(lv_indev_data_t *data) {
+    if (!inject.active) return false;
+
+    data->point.x = inject.x;
+    data->point.y = inject.y;
+    if (!inject.pressed_reported || (int32_t)(inject.t_until - time_us_32()) > 0) {
+        data->state = LV_INDEV_STATE_PR;
+        inject.pressed_reported = true;
+    } else {
+        data->state = LV_INDEV_STATE_REL; // Report one release, then back to the XPT2046
+        inject.active = false;
+    }
+    return true;
+}
+
+void lv_port_latency_get_stats(lat_stats_t *out) {
+    trace_poll();
+    memcpy(out, &stats, sizeof(stats));
+}
+
+void lv_port_latency_reset(void) {
+    memset(&stats, 0, sizeof(stats));
+    trace.state = TRACE_IDLE;
+    trace.band_hit = false;
+    trace.refresh_over = false;
+}
+
+void lv_port_latency_print(void) {
+    static const char *const names[LAT_STAGE_COUNT] = {
+        "input", "event", "render", "flush", "total"
+    };
+
+    trace_poll();
+    printf("Touch-to-photon: %lu interactions, %lu dropped, %lu stalled\n",
+           (unsigned long)stats.interactions, (unsigned long)stats.dropped, (unsigned long)stats.stalled);
+    for (int i = 0; i < LAT_STAGE_COUNT; i++) {
+        const lat_stage_stats_t *s = &stats.stage[i];
+        if (s->count == 0) continue;
+        printf("  %-6s min %6lu us  avg %6lu us  max %6lu us\n", names[i],
+               (unsigned long)s->min_us, (unsigned long)(s->sum_us / s->count),
+               (unsigned long)s->max_us);
+    }
+
+    uint32_t peak = 1;
+    for (int i = 0; i < LAT_HIST_BUCKETS; i++) {
+        if (stats.hist[i] > peak) peak = stats.hist[i];
+    }
+    for (int i = 0; i < LAT_HIST_BUCKETS; i++) {
+        if (stats.hist[i] == 0) continue;
+        char bar[41];
+        uint32_t n = stats.hist[i] * (sizeof(bar) - 1) / peak;
+        memset(bar, '#', n);
+        bar[n] = '\0';
+        if (i == LAT_HIST_BUCKETS - 1) {
+            printf("  >=%3d ms %6lu %s\n", i * LAT_HIST_BUCKET_MS,
+                   (unsigned long)stats.hist[i], bar);
+        } else {
+            printf("  %3d-%3d ms %5lu %s\n", i * LAT_HIST_BUCKET_MS, (i + 1) * LAT_HIST_BUCKET_MS,
+                   (unsigned long)stats.hist[i], bar);
+        }
+    }
+}
+
+#endif // LV_PORT_LATENCY_TRACE
@@ -0,0 +1,154 @@
+#include "lv_port_layer.h"
+
+#if LV_PORT_DIRECT_LAYER
+
+#include "lv_port_blend.h"
+#include "lv_port_overdraw.h"
+#include "port_log.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    lv_draw_sw_layer_ctx_t sw; // LVGL's layer, first so its functions can take this
+    bool direct;
+    lv_color_t *under;         // Band pixels under area_act before the widget drew
+    lv_area_t clip;            // area_act, the clip while the widget draws
+} port_layer_ctx_t;
+
+static lv_port_layer_stats_t stats;
+static bool blend_mode_warned;
+
+static lv_draw_layer_ctx_t *layer_init(lv_draw_ctx_t *draw_ctx, lv_draw_layer_ctx_t *layer_ctx,
+                                       lv_draw_layer_flags_t flags) {
+    port_layer_ctx_t *pl = (port_layer_ctx_t *)layer_ctx;
+
+    // A transform needs the whole widget at once; inside LVGL's layer the
+    // target isn't the band any more
+    if (!(flags & LV_DRAW_LAYER_FLAG_CAN_SUBDIVIDE) || layer_ctx->original.screen_transp) {
+        pl->direct = false;
+        stats.lvgl++;
+        return lv_draw_sw_layer_create(draw_ctx, layer_ctx, flags);
+    }
+
+    lv_coord_t w = lv_area_get_width(&layer_ctx->area_full);
+    lv_coord_t h = lv_area_get_height(&layer_ctx->area_full);
+    lv_coord_t rows = (lv_coord_t)(LAYER_DIRECT_BUF_SIZE / (w * sizeof(lv_color_t)));
+    if (rows > h) rows = h;
+    if (rows < 1) rows = 1;
+    while ((pl->under = lv_mem_alloc((size_t)w * rows * sizeof(lv_color_t))) == NULL) {
+        if (rows == 1) {
+            stats.failed++;
+            PORT_LOGW("layer: no heap for a %d px row\n", w);
+            return NULL;
+        }
+        rows /= 2;
+    }
+    uint32_t bytes = (uint32_t)w * rows * sizeof(lv_color_t);
+    if (bytes > stats.buf_peak) stats.buf_peak = bytes;
+    stats.direct++;
+
+    pl->direct = true;
+    layer_ctx->max_row_with_alpha = rows;
+    layer_ctx->max_row_with_no_alpha = rows;
+    return layer_ctx;
+}
+
+// Next slice: saves what's under it and limits drawing to it
+static void layer_adjust(lv_draw_ctx_t *draw_ctx, lv_draw_layer_ctx_t *layer_ctx, lv_draw_layer_flags_t flags) {
+    port_layer_ctx_t *pl = (port_layer_ctx_t *)layer_ctx;
+    if (!pl->direct) {
+        lv_draw_sw_layer_adjust(draw_ctx, layer_ctx, flags);
+        return;
+    }
+    if (layer_ctx->area_act.y2 > layer_ctx->area_full.y2) layer_ctx->area_act.y2 = layer_ctx->area_full.y2;
+    pl->clip = layer_ctx->area_act;
+    draw_ctx->clip_area = &pl->clip;
+    stats.slices++;
+
+    const lv_area_t *a = &pl->clip;
+    lv_coord_t stride = lv_area_get_width(draw_ctx->buf_area);
+    lv_coord_t w = lv_area_get_width(a);
+    const lv_color_t *src = (const lv_color_t *)draw_ctx->buf + (a->y1 - draw_ctx->buf_area->y1) * stride +
+                            (a->x1 - draw_ctx->buf_area->x1);
+    lv_color_t *dst = pl->under;
+    for (lv_coord_t y = a->y1; y <= a->y2; y++) {
+        memcpy(dst, src, w * sizeof(lv_color_t));
+        dst += w;
+        src += stride;
+    }
+}
+
+// The widget is in the band now: mix it with what was there
+static void layer_blend(lv_draw_ctx_t *draw_ctx, lv_draw_layer_ctx_t *layer_ctx, const lv_draw_img_dsc_t *dsc) {
+    port_layer_ctx_t *pl = (port_layer_ctx_t *)layer_ctx;
+    if (!pl->direct) {
+        lv_draw_sw_layer_blend(draw_ctx, layer_ctx, dsc);
+        return;
+    }
+    if (dsc->blend_mode != LV_BLEND_MODE_NORMAL && !blend_mode_warned) {
+        PORT_LOGW("layer: blend mode %d drawn as normal\n", dsc->blend_mode);
+        blend_mode_warned = true;
+    }
+
+    const lv_area_t *a = &pl->clip;
+    lv_coord_t stride = lv_area_get_width(draw_ctx->buf_area);
+    lv_coord_t w = lv_area_get_width(a);
+    lv_color_t *d = (lv_color_t *)draw_ctx->buf + (a->y1 - draw_ctx->buf_area->y1) * stride +
+                    (a->x1 - draw_ctx->buf_area->x1);
+    const lv_color_t *u = pl->under;
+    lv_opa_t opa = dsc->opa;
+    stats.px += (uint32_t)w * lv_area_get_height(a);
+
+    for (lv_coord_t y = a->y1; y <= a->y2; y++) {
+        if (opa <= LV_OPA_MIN) {
+            memcpy(d, u, w * sizeof(lv_color_t));
+        } else if (opa < LV_OPA_MAX) {
+            for (lv_coord_t x = 0; x < w; x++) {
+                if (d[x].full != u[x].full) d[x] = lv_color_mix(d[x], u[x], opa);
+            }
+        }
+        d += stride;
+        u += w;
+    }
+}
+
+static void layer_destroy(lv_draw_ctx_t *draw_ctx, lv_draw_layer_ctx_t *layer_ctx) {
+    port_layer_ctx_t *pl = (port_layer_ctx_t *)layer_ctx;
+    if (pl->direct) {
+        lv_mem_free(pl->under);
+    } else {
+        lv_draw_sw_layer_destroy(draw_ctx, layer_ctx);
+    }
+}
+
+void lv_port_layer_ctx_init(lv_disp_drv_t *drv, lv_draw_ctx_t *draw_ctx) {
+#if LV_PORT_OVERDRAW
+    lv_port_overdraw_ctx_init(drv, draw_ctx);
+#elif LV_PORT_FAST_BLEND
+    lv_port_blend_ctx_init(drv, draw_ctx);
+#else
+    lv_draw_sw_init_ctx(drv, draw_ctx);
+#endif
+    draw_ctx->layer_init = layer_init;
+    draw_ctx->layer_adjust = layer_adjust;
+    draw_ctx->layer_blend = layer_blend;
+    draw_ctx->layer_destroy = layer_destroy;
+    draw_ctx->layer_instance_size = sizeof(port_layer_ctx_t);
+}
+
+void lv_port_layer_get_stats(lv_port_layer_stats_t *out) {
+    *out = stats;
+}
+
+void lv_port_layer_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void lv_port_layer_print(void) {
+    printf("Layers: %lu direct in %lu slices, %lu by LVGL, %lu failed\n", (unsigned long)stats.direct,
+           (unsigned long)stats.slices, (unsigned long)stats.lvgl, (unsigned long)stats.failed);
+    printf("  saved copy peak %lu bytes, %lu px composited\n", (unsigned long)stats.buf_peak,
+           (unsigned long)stats.px);
+}
+
+#endif // LV_PORT_DIRECT_LAYER
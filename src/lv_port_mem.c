@@ -0,0 +1,698 @@
+#include "lv_port_mem.h"
+#include "port_log.h"
+#include <stdbool.h>
+#include <string.h>
+
+// ----------------------------------------------------------------------------
+// TLSF
+// Two-level segregated fit: the first level splits sizes by power of two, the
+// second level splits each power of two into SL_INDEX_COUNT linear ranges.
+// A bitmap per level finds a non-empty list with one find-first-set, so
+// allocation and free don't depend on the number of blocks.
+// ----------------------------------------------------------------------------
+
+// Blocks hold pointers and size_t, so align to their size: 4 on the RP2040,
+// 8 in the 64-bit host simulator
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define ALIGN_SIZE_LOG2 3
+#else
+#define ALIGN_SIZE_LOG2 2
+#endif
+#define ALIGN_SIZE          (1 << ALIGN_SIZE_LOG2)
+#define SL_INDEX_COUNT_LOG2 4
+#define SL_INDEX_COUNT      (1 << SL_INDEX_COUNT_LOG2)
+#define FL_INDEX_MAX        17 // Blocks up to 128 KB
+#define FL_INDEX_SHIFT      (SL_INDEX_COUNT_LOG2 + ALIGN_SIZE_LOG2)
+#define FL_INDEX_COUNT      (FL_INDEX_MAX - FL_INDEX_SHIFT + 1)
+#define SMALL_BLOCK_SIZE    (1 << FL_INDEX_SHIFT)
+
+_Static_assert(LV_PORT_MEM_SIZE < (1U << FL_INDEX_MAX), "LV_PORT_MEM_SIZE too large for FL_INDEX_MAX");
+
+// prev_phys is stored at the end of the previous block and only valid while
+// that block is free; size and the free list links follow. A used block
+// costs only the size word.
+typedef struct block_hdr {
+    struct block_hdr *prev_phys;
+    size_t size; // Bit 0: this block is free, bit 1: previous block is free
+    struct block_hdr *next_free;
+    struct block_hdr *prev_free;
+} block_hdr_t;
+
+#define BLOCK_FREE_BIT      1U
+#define BLOCK_PREV_FREE_BIT 2U
+
+#define BLOCK_OVERHEAD     sizeof(size_t)
+#define BLOCK_START_OFFSET (offsetof(block_hdr_t, size) + sizeof(size_t))
+#define BLOCK_SIZE_MIN     (sizeof(block_hdr_t) - sizeof(block_hdr_t *))
+#define BLOCK_SIZE_MAX     ((size_t)1 << FL_INDEX_MAX)
+
+static struct {
+    block_hdr_t null_block; // Terminates every free list
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[FL_INDEX_COUNT];
+    block_hdr_t *blocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
+} tlsf;
+
+// The first block's prev_phys and the end sentinel's free list links are
+// never used but lie inside the object, so no access goes past its bounds
+static struct {
+    block_hdr_t *head;
+    size_t words[LV_PORT_MEM_SIZE / sizeof(size_t)];
+    block_hdr_t *tail[2];
+} pool;
+static block_hdr_t *sentinel; // Zero-sized used block ending the TLSF part
+static bool initialized;
+
+static lv_port_mem_stats_t stats;
+static lv_port_mem_oom_cb_t oom_cb;
+static lv_port_mem_trace_cb_t trace_cb;
+
+static inline int tlsf_ffs(uint32_t word) {
+    return __builtin_ffs((int)word) - 1;
+}
+
+static inline int tlsf_fls(uint32_t word) {
+    return word ? 31 - __builtin_clz(word) : -1;
+}
+
+static inline size_t block_size(const block_hdr_t *block) {
+    return block->size & ~(size_t)(BLOCK_FREE_BIT | BLOCK_PREV_FREE_BIT);
+}
+
+static inline void block_set_size(block_hdr_t *block, size_t size) {
+    block->size = size | (block->size & (BLOCK_FREE_BIT | BLOCK_PREV_FREE_BIT));
+}
+
+static inline bool block_is_free(const block_hdr_t *block) {
+    return (block->size & BLOCK_FREE_BIT) != 0;
+}
+
+static inline void block_set_free(block_hdr_t *block) {
+    block->size |= BLOCK_FREE_BIT;
+}
+
+static inline void block_set_used(block_hdr_t *block) {
+    block->size &= ~(size_t)BLOCK_FREE_BIT;
+}
+
+static inline bool block_is_prev_free(const block_hdr_t *block) {
+    return (block->size & BLOCK_PREV_FREE_BIT) != 0;
+}
+
+static inline void block_set_prev_free(block_hdr_t *block) {
+    block->size |= BLOCK_PREV_FREE_BIT;
+}
+
+static inline void block_set_prev_used(block_hdr_t *block) {
+    block->size &= ~(size_t)BLOCK_PREV_FREE_BIT;
+}
+
+static inline block_hdr_t *block_from_ptr(const void *ptr) {
+    return (block_hdr_t *)((uint8_t *)ptr - BLOCK_START_OFFSET);
+}
+
+static inline void *block_to_ptr(const block_hdr_t *block) {
+    return (uint8_t *)block + BLOCK_START_OFFSET;
+}
+
+static inline block_hdr_t *offset_to_block(const void *ptr, ptrdiff_t offset) {
+    return (block_hdr_t *)((uint8_t *)ptr + offset);
+}
+
+static inline block_hdr_t *block_next(const block_hdr_t *block) {
+    return offset_to_block(block_to_ptr(block), (ptrdiff_t)(block_size(block) - BLOCK_OVERHEAD));
+}
+
+static inline block_hdr_t *block_link_next(block_hdr_t *block) {
+    block_hdr_t *next = block_next(block);
+    next->prev_phys = block;
+    return next;
+}
+
+static void block_mark_as_free(block_hdr_t *block) {
+    block_hdr_t *next = block_link_next(block);
+    block_set_prev_free(next);
+    block_set_free(block);
+}
+
+static void block_mark_as_used(block_hdr_t *block) {
+    block_hdr_t *next = block_next(block);
+    block_set_prev_used(next);
+    block_set_used(block);
+}
+
+static void mapping_insert(size_t size, int *fli, int *sli) {
+    if (size < SMALL_BLOCK_SIZE) {
+        *fli = 0;
+        *sli = (int)size / (SMALL_BLOCK_SIZE / SL_INDEX_COUNT);
+    } else {
+        int fl = tlsf_fls((uint32_t)size);
+        *sli = (int)(size >> (fl - SL_INDEX_COUNT_LOG2)) ^ (1 << SL_INDEX_COUNT_LOG2);
+        *fli = fl - (FL_INDEX_SHIFT - 1);
+    }
+}
+
+// Rounds up to the next list so any block found there is large enough
+static void mapping_search(size_t size, int *fli, int *sli) {
+    if (size >= SMALL_BLOCK_SIZE) {
+        size += ((size_t)1 << (tlsf_fls((uint32_t)size) - SL_INDEX_COUNT_LOG2)) - 1;
+    }
+    mapping_insert(size, fli, sli);
+}
+
+static block_hdr_t *search_suitable_block(int *fli, int *sli) {
+    int fl = *fli;
+    uint32_t sl_map = tlsf.sl_bitmap[fl] & (~0U << *sli);
+
+    if (!sl_map) {
+        uint32_t fl_map = tlsf.fl_bitmap & (~0U << (fl + 1));
+        if (!fl_map) return NULL;
+        fl = tlsf_ffs(fl_map);
+        *fli = fl;
+        sl_map = tlsf.sl_bitmap[fl];
+    }
+    *sli = tlsf_ffs(sl_map);
+    return tlsf.blocks[fl][*sli];
+}
+
+static void remove_free_block(block_hdr_t *block, int fl, int sl) {
+    block_hdr_t *prev = block->prev_free;
+    block_hdr_t *next = block->next_free;
+    next->prev_free = prev;
+    prev->next_free = next;
+
+    if (tlsf.blocks[fl][sl] == block) {
+        tlsf.blocks[fl][sl] = next;
+        if (next == &tlsf.null_block) {
+            tlsf.sl_bitmap[fl] &= ~(1U << sl);
+            if (!tlsf.sl_bitmap[fl]) tlsf.fl_bitmap &= ~(1U << fl);
+        }
+    }
+}
+
+static void insert_free_block(block_hdr_t *block, int fl, int sl) {
+    block_hdr_t *current = tlsf.blocks[fl][sl];
+    block->next_free = current;
+    block->prev_free = &tlsf.null_block;
+    current->prev_free = block;
+
+    tlsf.blocks[fl][sl] = block;
+    tlsf.fl_bitmap |= 1U << fl;
+    tlsf.sl_bitmap[fl] |= 1U << sl;
+}
+
+static void block_remove(block_hdr_t *block) {
+    int fl, sl;
+    mapping_insert(block_size(block), &fl, &sl);
+    remove_free_block(block, fl, sl);
+}
+
+static void block_insert(block_hdr_t *block) {
+    int fl, sl;
+    mapping_insert(block_size(block), &fl, &sl);
+    insert_free_block(block, fl, sl);
+}
+
+static inline bool block_can_split(const block_hdr_t *block, size_t size) {
+    return block_size(block) >= sizeof(block_hdr_t) + size;
+}
+
+static block_hdr_t *block_split(block_hdr_t *block, size_t size) {
+    block_hdr_t *remaining = offset_to_block(block_to_ptr(block), (ptrdiff_t)(size - BLOCK_OVERHEAD));
+    size_t remain_size = block_size(block) - (size + BLOCK_OVERHEAD);
+
+    remaining->size = 0;
+    block_set_size(remaining, remain_size);
+    block_set_size(block, size);
+    block_mark_as_free(remaining);
+    return remaining;
+}
+
+static block_hdr_t *block_absorb(block_hdr_t *prev, block_hdr_t *block) {
+    prev->size += block_size(block) + BLOCK_OVERHEAD;
+    block_link_next(prev);
+    return prev;
+}
+
+static block_hdr_t *block_merge_prev(block_hdr_t *block) {
+    if (block_is_prev_free(block)) {
+        block_hdr_t *prev = block->prev_phys;
+        block_remove(prev);
+        block = block_absorb(prev, block);
+    }
+    return block;
+}
+
+static block_hdr_t *block_merge_next(block_hdr_t *block) {
+    block_hdr_t *next = block_next(block);
+    if (block_is_free(next)) {
+        block_remove(next);
+        block = block_absorb(block, next);
+    }
+    return block;
+}
+
+static void block_trim_free(block_hdr_t *block, size_t size) {
+    if (block_can_split(block, size)) {
+        block_hdr_t *remaining = block_split(block, size);
+        block_link_next(block);
+        block_set_prev_free(remaining);
+        block_insert(remaining);
+    }
+}
+
+static void block_trim_used(block_hdr_t *block, size_t size) {
+    if (block_can_split(block, size)) {
+        block_hdr_t *remaining = block_split(block, size);
+        block_set_prev_used(remaining);
+        remaining = block_merge_next(remaining);
+        block_insert(remaining);
+    }
+}
+
+static size_t adjust_request_size(size_t size) {
+    if (size == 0) return 0;
+    size_t aligned = (size + (ALIGN_SIZE - 1)) & ~(size_t)(ALIGN_SIZE - 1);
+    if (aligned >= BLOCK_SIZE_MAX) return 0;
+    return aligned < BLOCK_SIZE_MIN ? BLOCK_SIZE_MIN : aligned;
+}
+
+static void tlsf_init(void) {
+    tlsf.null_block.next_free = &tlsf.null_block;
+    tlsf.null_block.prev_free = &tlsf.null_block;
+    for (int i = 0; i < FL_INDEX_COUNT; i++) {
+        for (int j = 0; j < SL_INDEX_COUNT; j++) {
+            tlsf.blocks[i][j] = &tlsf.null_block;
+        }
+    }
+
+    // One free block over the whole pool, followed by a zero-sized used
+    // sentinel so block_next() never runs off the end. Slab pages are taken
+    // from the end, in front of which the sentinel moves.
+    size_t pool_bytes = (sizeof(pool.words) - 2 * BLOCK_OVERHEAD) & ~(size_t)(ALIGN_SIZE - 1);
+    block_hdr_t *block = (block_hdr_t *)&pool;
+    block->size = pool_bytes;
+    block_set_free(block);
+    block_set_prev_used(block);
+    block_insert(block);
+
+    sentinel = block_link_next(block);
+    sentinel->size = 0;
+    block_set_used(sentinel);
+    block_set_prev_free(sentinel);
+
+    stats.total_bytes = pool_bytes;
+    initialized = true;
+}
+
+static void *tlsf_malloc(size_t size) {
+    size_t adjust = adjust_request_size(size);
+    if (!adjust) return NULL;
+
+    int fl, sl;
+    mapping_search(adjust, &fl, &sl);
+    if (fl >= FL_INDEX_COUNT) return NULL;
+
+    block_hdr_t *block = search_suitable_block(&fl, &sl);
+    if (!block || block == &tlsf.null_block) return NULL;
+
+    remove_free_block(block, fl, sl);
+    block_trim_free(block, adjust);
+    block_mark_as_used(block);
+
+    stats.used_bytes += block_size(block) + BLOCK_OVERHEAD;
+    return block_to_ptr(block);
+}
+
+static void tlsf_free(void *ptr) {
+    block_hdr_t *block = block_from_ptr(ptr);
+    stats.used_bytes -= block_size(block) + BLOCK_OVERHEAD;
+
+    block_mark_as_free(block);
+    block = block_merge_prev(block);
+    block = block_merge_next(block);
+    block_insert(block);
+}
+
+// Grows or shrinks in place if the next block allows it, returns false otherwise
+static bool tlsf_resize(void *ptr, size_t size) {
+    block_hdr_t *block = block_from_ptr(ptr);
+    block_hdr_t *next = block_next(block);
+    size_t cur_size = block_size(block);
+    size_t combined = cur_size + block_size(next) + BLOCK_OVERHEAD;
+    size_t adjust = adjust_request_size(size);
+
+    if (!adjust) return false;
+    if (adjust > cur_size && (!block_is_free(next) || adjust > combined)) return false;
+
+    stats.used_bytes -= cur_size;
+    if (adjust > cur_size) {
+        block_merge_next(block);
+        block_mark_as_used(block);
+    }
+    block_trim_used(block, adjust);
+    stats.used_bytes += block_size(block);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Size-class slabs
+// A slab is one page of LV_PORT_MEM_SLAB_SIZE holding equal slots of one
+// class. Each slot is preceded by a tag word (size_t, like a block's size
+// word) with bit 0 set; the word in front of a TLSF block's payload is its
+// size with bit 0 (free) clear, so lv_port_mem_free() can tell the two apart.
+// Pages are taken from the end of the pool by shrinking the last TLSF block,
+// so slabs never split the TLSF part. Empty pages are kept for other
+// classes (and an empty slab for its class when it is the last one) and
+// given back from the lowest page up when a TLSF allocation fails.
+// ----------------------------------------------------------------------------
+
+typedef struct slab {
+    struct slab *next; // In the class' partial list
+    struct slab *prev;
+    void *free_list;   // Free slots of this slab
+    uint16_t used;
+    uint16_t count;
+} slab_t;
+
+static const uint16_t class_size[] = LV_PORT_MEM_CLASSES;
+#define CLASS_COUNT (sizeof(class_size) / sizeof(class_size[0]))
+
+#define SLOT_TAG(offset, cls) (((size_t)(offset) << 8) | ((size_t)(cls) << 1) | 1U)
+#define SLOT_TAG_IS_SLAB(tag) ((tag) & 1U)
+#define SLOT_TAG_CLASS(tag)   (((tag) >> 1) & 0x7FU)
+#define SLOT_TAG_OFFSET(tag)  ((tag) >> 8)
+
+#define PAGE_SIZE  LV_PORT_MEM_SLAB_SIZE
+#define PAGE_COUNT (LV_PORT_MEM_SIZE / PAGE_SIZE)
+
+static slab_t *partial[CLASS_COUNT]; // Slabs with at least one free slot
+static uint32_t page_count;          // Pages taken from the end of the pool
+static uint32_t page_empty[(PAGE_COUNT + 31) / 32]; // Bit n: page n is empty
+
+_Static_assert(PAGE_SIZE % ALIGN_SIZE == 0, "pages must stay aligned");
+
+_Static_assert(sizeof(slab_t) % ALIGN_SIZE == 0, "slots must stay aligned");
+
+static int size_to_class(size_t size) {
+    for (uint32_t i = 0; i < CLASS_COUNT; i++) {
+        if (size <= class_size[i]) return (int)i;
+    }
+    return -1;
+}
+
+static void partial_push(int cls, slab_t *slab) {
+    slab->prev = NULL;
+    slab->next = partial[cls];
+    if (slab->next) slab->next->prev = slab;
+    partial[cls] = slab;
+}
+
+static void partial_remove(int cls, slab_t *slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        partial[cls] = slab->next;
+    }
+    if (slab->next) slab->next->prev = slab->prev;
+}
+
+// Page n counts down from the end of the pool
+static inline uint8_t *page_addr(uint32_t n) {
+    return (uint8_t *)(pool.words + sizeof(pool.words) / sizeof(size_t)) - (n + 1) * PAGE_SIZE;
+}
+
+static inline uint32_t page_index(const void *page) {
+    return (uint32_t)(page_addr(0) - (const uint8_t *)page) / PAGE_SIZE;
+}
+
+// Moves the sentinel one page down, out of the last TLSF block if that is
+// free and large enough
+static bool page_take(void) {
+    if (!block_is_prev_free(sentinel)) return false;
+    block_hdr_t *last = sentinel->prev_phys;
+    size_t size = block_size(last);
+
+    if (size == PAGE_SIZE - BLOCK_OVERHEAD) {
+        // The whole block: its header becomes the sentinel
+        block_remove(last);
+        sentinel = last;
+        sentinel->size = 0;
+        block_set_used(sentinel);
+    } else if (size >= PAGE_SIZE + BLOCK_SIZE_MIN) {
+        block_remove(last);
+        block_set_size(last, size - PAGE_SIZE);
+        block_insert(last);
+        sentinel = block_link_next(last);
+        sentinel->size = 0;
+        block_set_used(sentinel);
+        block_set_prev_free(sentinel);
+    } else {
+        return false;
+    }
+    page_count++;
+    stats.used_bytes += PAGE_SIZE;
+    stats.slab_bytes += PAGE_SIZE;
+    return true;
+}
+
+// Moves the sentinel one page up, giving the lowest page back to TLSF
+static void page_give(void) {
+    block_hdr_t *block = sentinel;
+    block_set_size(block, PAGE_SIZE - BLOCK_OVERHEAD);
+    sentinel = block_next(block); // In the page's last word
+    sentinel->size = 0;
+    block_mark_as_free(block);
+    block = block_merge_prev(block);
+    block_insert(block);
+
+    page_count--;
+    page_empty[page_count / 32] &= ~(1U << (page_count % 32));
+    stats.used_bytes -= PAGE_SIZE;
+    stats.slab_bytes -= PAGE_SIZE;
+}
+
+// An empty page, the one nearest the end of the pool so the used ones stay
+// together, or a new one
+static void *page_alloc(void) {
+    for (uint32_t w = 0; w * 32 < page_count; w++) {
+        if (page_empty[w]) {
+            uint32_t n = w * 32 + (uint32_t)tlsf_ffs(page_empty[w]);
+            page_empty[w] &= ~(1U << (n % 32));
+            return page_addr(n);
+        }
+    }
+    if (!page_take()) return NULL;
+    return page_addr(page_count - 1);
+}
+
+static void page_release(void *page) {
+    uint32_t n = page_index(page);
+    page_empty[n / 32] |= 1U << (n % 32);
+}
+
+static slab_t *slab_create(int cls) {
+    uint32_t stride = sizeof(size_t) + class_size[cls];
+    uint32_t count = (PAGE_SIZE - sizeof(slab_t)) / stride;
+
+    slab_t *slab = page_alloc();
+    if (!slab) return NULL;
+
+    slab->used = 0;
+    slab->count = (uint16_t)count;
+    slab->free_list = NULL;
+
+    uint8_t *p = (uint8_t *)(slab + 1);
+    for (uint32_t i = 0; i < count; i++, p += stride) {
+        *(size_t *)p = SLOT_TAG(p + sizeof(size_t) - (uint8_t *)slab, cls);
+        void **slot = (void **)(p + sizeof(size_t));
+        *slot = slab->free_list;
+        slab->free_list = slot;
+    }
+
+    partial_push(cls, slab);
+    return slab;
+}
+
+static void *slab_alloc(int cls) {
+    slab_t *slab = partial[cls];
+    if (!slab) slab = slab_create(cls);
+    if (!slab) return NULL;
+
+    void **slot = slab->free_list;
+    slab->free_list = *slot;
+    slab->used++;
+    stats.slab_slots_used++;
+    if (!slab->free_list) partial_remove(cls, slab);
+    return slot;
+}
+
+static void slab_free(void *ptr, size_t tag) {
+    int cls = (int)SLOT_TAG_CLASS(tag);
+    slab_t *slab = (slab_t *)((uint8_t *)ptr - SLOT_TAG_OFFSET(tag));
+
+    if (!slab->free_list) partial_push(cls, slab); // Was full
+    *(void **)ptr = slab->free_list;
+    slab->free_list = ptr;
+    slab->used--;
+    stats.slab_slots_used--;
+
+    if (slab->used == 0 && (slab->next || slab->prev)) {
+        partial_remove(cls, slab);
+        page_release(slab);
+    }
+}
+
+// Gives the empty pages at the bottom of the slab area back to TLSF,
+// returns false if there were none
+static bool slab_shrink(void) {
+    for (uint32_t cls = 0; cls < CLASS_COUNT; cls++) {
+        slab_t *slab = partial[cls];
+        if (slab && slab->used == 0) {
+            partial_remove((int)cls, slab);
+            page_release(slab);
+        }
+    }
+    uint32_t before = page_count;
+    while (page_count && (page_empty[(page_count - 1) / 32] & (1U << ((page_count - 1) % 32)))) page_give();
+    return page_count != before;
+}
+
+static inline size_t ptr_tag(const void *ptr) {
+    return ((const size_t *)ptr)[-1];
+}
+
+// ----------------------------------------------------------------------------
+// LVGL interface
+// ----------------------------------------------------------------------------
+
+static void *mem_alloc(size_t size) {
+    int cls = size_to_class(size);
+    void *p = NULL;
+    if (cls >= 0) p = slab_alloc(cls);
+    if (!p) p = tlsf_malloc(size); // Also if the class couldn't get a new slab
+    if (!p && slab_shrink()) p = tlsf_malloc(size);
+    return p;
+}
+
+static void update_after_alloc(void) {
+    if (stats.used_bytes > stats.high_water_bytes) {
+        stats.high_water_bytes = stats.used_bytes;
+    }
+    if (stats.used_bytes > stats.total_bytes / 100 * LV_PORT_MEM_WARN_PCT) {
+        PORT_LOGW_EVERY(1000, "lv_port_mem: %u of %u bytes used\n", stats.used_bytes, stats.total_bytes);
+    }
+}
+
+static void *alloc_counted(size_t size) {
+    if (!initialized) tlsf_init();
+
+    void *p = mem_alloc(size);
+    if (!p && oom_cb && oom_cb(size)) {
+        p = mem_alloc(size);
+    }
+    if (!p) {
+        stats.fail_count++;
+        PORT_LOGE("lv_port_mem: failed to allocate %u bytes\n", (uint32_t)size);
+        return NULL;
+    }
+
+    stats.alloc_count++;
+    update_after_alloc();
+    return p;
+}
+
+static void free_counted(void *ptr) {
+    size_t tag = ptr_tag(ptr);
+    if (SLOT_TAG_IS_SLAB(tag)) {
+        slab_free(ptr, tag);
+    } else {
+        tlsf_free(ptr);
+    }
+    stats.free_count++;
+}
+
+void *lv_port_mem_alloc(size_t size) {
+    void *p = alloc_counted(size);
+    if (trace_cb) trace_cb('a', NULL, p, size);
+    return p;
+}
+
+void lv_port_mem_free(void *ptr) {
+    if (!ptr) return;
+    free_counted(ptr);
+    if (trace_cb) trace_cb('f', ptr, NULL, 0);
+}
+
+static void *realloc_counted(void *ptr, size_t size) {
+    if (!ptr) return alloc_counted(size);
+    if (size == 0) {
+        free_counted(ptr);
+        return NULL;
+    }
+
+    size_t cur_size;
+    size_t tag = ptr_tag(ptr);
+    if (SLOT_TAG_IS_SLAB(tag)) {
+        cur_size = class_size[SLOT_TAG_CLASS(tag)];
+        if (size <= cur_size) return ptr;
+    } else {
+        // Stay a TLSF block unless the new size belongs to a class
+        if (size_to_class(size) < 0 && tlsf_resize(ptr, size)) {
+            update_after_alloc();
+            return ptr;
+        }
+        cur_size = block_size(block_from_ptr(ptr));
+    }
+
+    void *p = alloc_counted(size);
+    if (!p) return NULL; // The old block stays valid, as realloc requires
+    memcpy(p, ptr, cur_size < size ? cur_size : size);
+    free_counted(ptr);
+    return p;
+}
+
+void *lv_port_mem_realloc(void *ptr, size_t size) {
+    void *p = realloc_counted(ptr, size);
+    if (trace_cb) trace_cb('r', ptr, p, size);
+    return p;
+}
+
+void lv_port_mem_set_oom_cb(lv_port_mem_oom_cb_t cb) {
+    oom_cb = cb;
+}
+
+void lv_port_mem_set_trace_cb(lv_port_mem_trace_cb_t cb) {
+    trace_cb = cb;
+}
+
+void lv_port_mem_get_stats(lv_port_mem_stats_t *out) {
+    if (!initialized) tlsf_init();
+
+    // Walk the free lists, this is the only O(n) part and only for reporting
+    uint32_t free_bytes = 0;
+    uint32_t largest = 0;
+    for (int fl = 0; fl < FL_INDEX_COUNT; fl++) {
+        for (int sl = 0; sl < SL_INDEX_COUNT; sl++) {
+            for (block_hdr_t *b = tlsf.blocks[fl][sl]; b != &tlsf.null_block; b = b->next_free) {
+                uint32_t size = (uint32_t)block_size(b);
+                free_bytes += size;
+                if (size > largest) largest = size;
+            }
+        }
+    }
+
+    stats.free_bytes = free_bytes;
+    stats.largest_free = largest;
+    stats.frag_pct = free_bytes ? (uint8_t)(100 - (uint64_t)largest * 100 / free_bytes) : 0;
+    stats.used_pct = (uint8_t)((uint64_t)stats.used_bytes * 100 / stats.total_bytes);
+    memcpy(out, &stats, sizeof(stats));
+}
+
+uint32_t lv_port_mem_used(void) {
+    return stats.used_bytes;
+}
+
+void lv_port_mem_reset_high_water(void) {
+    stats.high_water_bytes = stats.used_bytes;
+}
@@ -0,0 +1,183 @@
+#include "lv_port_msgq.h"
+
+#if LV_PORT_MSGQ
+
+#include "lv_port_schart.h"
+#include "lv_port_sched.h"
+#include "port_msgq.h"
+#include "pico/time.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+#include <string.h>
+
+static port_msgq_t queue;
+static uint32_t queue_buf[PORT_MSGQ_BUF_WORDS(MSGQ_SLOTS, sizeof(lv_port_msg_t))];
+static lv_port_msg_t batch[MSGQ_BATCH];
+static lv_port_msgq_stats_t stats;
+static uint32_t dropped_base; // queue.dropped at the last reset
+
+void lv_port_msgq_init(void) {
+    port_msgq_init(&queue, queue_buf, MSGQ_SLOTS, sizeof(lv_port_msg_t));
+}
+
+bool lv_port_msgq_post(lv_port_msg_t *msg) {
+    msg->t_us = time_us_32();
+    if (!port_msgq_post(&queue, msg)) return false;
+#if LV_PORT_TICKLESS
+    lv_port_sched_wake(); // Also does the SEV
+#else
+    __sev();
+#endif
+    return true;
+}
+
+bool lv_port_msgq_set_value(lv_obj_t *obj, int32_t value) {
+    lv_port_msg_t msg = {.type = LV_PORT_MSG_SET_VALUE, .obj = obj};
+    msg.u.value = value;
+    return lv_port_msgq_post(&msg);
+}
+
+bool lv_port_msgq_set_text(lv_obj_t *obj, const char *text) {
+    lv_port_msg_t msg = {.type = LV_PORT_MSG_SET_TEXT, .obj = obj};
+    strncpy(msg.u.text, text, MSGQ_TEXT_MAX - 1);
+    return lv_port_msgq_post(&msg);
+}
+
+bool lv_port_msgq_chart_push(lv_obj_t *obj, const int16_t *values, uint32_t count) {
+    if (count > MSGQ_CHART_VALUES) count = MSGQ_CHART_VALUES;
+    lv_port_msg_t msg = {.type = LV_PORT_MSG_CHART_PUSH, .obj = obj, .count = (uint8_t)count};
+    memcpy(msg.u.values, values, count * sizeof(int16_t));
+    return lv_port_msgq_post(&msg);
+}
+
+bool lv_port_msgq_call(void (*cb)(void *arg), void *arg) {
+    lv_port_msg_t msg = {.type = LV_PORT_MSG_CALL};
+    msg.u.call.cb = cb;
+    msg.u.call.arg = arg;
+    return lv_port_msgq_post(&msg);
+}
+
+static void set_value(lv_obj_t *obj, int32_t value) {
+    if (lv_obj_has_class(obj, &lv_bar_class)) { // lv_slider too
+        lv_bar_set_value(obj, value, LV_ANIM_OFF);
+    } else if (lv_obj_has_class(obj, &lv_arc_class)) {
+        lv_arc_set_value(obj, (int16_t)value);
+    } else if (lv_obj_has_class(obj, &lv_label_class)) {
+        lv_label_set_text_fmt(obj, "%ld", (long)value);
+    }
+}
+
+static void chart_push(lv_obj_t *obj, const lv_port_msg_t *msg) {
+#if LV_PORT_STREAM_CHART
+    if (lv_obj_has_class(obj, &lv_port_schart_class)) {
+        int16_t values[SCHART_MAX_SERIES] = {0}; // Series beyond count get 0
+        memcpy(values, msg->u.values, msg->count * sizeof(int16_t));
+        lv_port_schart_push(obj, values);
+        return;
+    }
+#endif
+    if (lv_obj_has_class(obj, &lv_chart_class)) {
+        lv_chart_series_t *ser = lv_chart_get_series_next(obj, NULL);
+        for (uint32_t i = 0; ser && i < msg->count; i++) {
+            lv_chart_set_next_value(obj, ser, msg->u.values[i]);
+            ser = lv_chart_get_series_next(obj, ser);
+        }
+    }
+}
+
+// A value or text that a later message of the same batch replaces
+static bool superseded(uint32_t i, uint32_t n) {
+    const lv_port_msg_t *m = &batch[i];
+    if (m->type != LV_PORT_MSG_SET_VALUE && m->type != LV_PORT_MSG_SET_TEXT) return false;
+    for (uint32_t j = i + 1; j < n; j++) {
+        if (batch[j].obj == m->obj && batch[j].type == m->type) return true;
+    }
+    return false;
+}
+
+static void apply(const lv_port_msg_t *m) {
+    if (m->type == LV_PORT_MSG_CALL) {
+        m->u.call.cb(m->u.call.arg);
+        stats.applied++;
+        return;
+    }
+#if MSGQ_CHECK_OBJ
+    if (!lv_obj_is_valid(m->obj)) {
+        stats.stale++;
+        return;
+    }
+#endif
+    stats.applied++;
+    switch (m->type) {
+    case LV_PORT_MSG_SET_VALUE:
+        set_value(m->obj, m->u.value);
+        break;
+    case LV_PORT_MSG_SET_TEXT:
+        lv_label_set_text(m->obj, m->u.text);
+        break;
+    case LV_PORT_MSG_CHART_PUSH:
+        chart_push(m->obj, m);
+        break;
+    }
+}
+
+uint32_t lv_port_msgq_drain(uint32_t max) {
+    if (max == 0) max = MSGQ_BATCH;
+    uint32_t t0 = time_us_32();
+    uint32_t total = 0;
+
+    while (total < max) {
+        uint32_t n = 0;
+        while (n < MSGQ_BATCH && total + n < max && port_msgq_pop(&queue, &batch[n])) n++;
+        if (n == 0) break;
+        total += n;
+
+        for (uint32_t i = 0; i < n; i++) {
+            const lv_port_msg_t *m = &batch[i];
+            if (superseded(i, n)) {
+                stats.coalesced++;
+            } else {
+                apply(m);
+            }
+            uint32_t lat = time_us_32() - m->t_us;
+            stats.lat_sum_us += lat;
+            if (lat > stats.lat_max_us) stats.lat_max_us = lat;
+        }
+        if (n < MSGQ_BATCH) break; // Empty
+    }
+
+    if (total) {
+        uint32_t dt = time_us_32() - t0;
+        stats.drains++;
+        if (total > stats.batch_max) stats.batch_max = total;
+        if (dt > stats.drain_max_us) stats.drain_max_us = dt;
+    }
+    return total;
+}
+
+void lv_port_msgq_get_stats(lv_port_msgq_stats_t *out) {
+    *out = stats;
+    out->dropped = queue.dropped - dropped_base;
+}
+
+void lv_port_msgq_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+    dropped_base = queue.dropped;
+}
+
+void lv_port_msgq_print(void) {
+    lv_port_msgq_stats_t s;
+    lv_port_msgq_get_stats(&s);
+    uint32_t taken = s.applied + s.coalesced + s.stale;
+    printf("Message queue: %lu applied, %lu coalesced, %lu stale, %lu dropped, %lu queued\n",
+           (unsigned long)s.applied, (unsigned long)s.coalesced, (unsigned long)s.stale, (unsigned long)s.dropped,
+           (unsigned long)port_msgq_count(&queue));
+    if (s.drains) {
+        printf("  %lu drains, batch max %lu, drain max %lu us\n", (unsigned long)s.drains,
+               (unsigned long)s.batch_max, (unsigned long)s.drain_max_us);
+        printf("  latency post -> applied: avg %lu us, max %lu us\n", (unsigned long)(s.lat_sum_us / taken),
+               (unsigned long)s.lat_max_us);
+    }
+}
+
+#endif // LV_PORT_MSGQ
@@ -0,0 +1,280 @@
+#include "lv_port_overdraw.h"
+
+#if LV_PORT_OVERDRAW
+
+#include "lv_port_blend.h"
+#include <stdio.h>
+#include <string.h>
+
+#if (ST7789_WIDTH % OVD_CELL) != 0 || (ST7789_HEIGHT % OVD_CELL) != 0
+#error "OVD_CELL must divide ST7789_WIDTH and ST7789_HEIGHT"
+#endif
+
+#define STACK_MAX 32 // Widget nesting followed for the attribution
+
+static uint8_t depth[ST7789_HEIGHT][ST7789_WIDTH]; // Writes in the current frame
+static uint8_t peak[ST7789_HEIGHT][ST7789_WIDTH];  // Most writes in one frame
+static uint32_t cell_over[OVD_CELLS_Y][OVD_CELLS_X];
+static uint32_t cell_inv[OVD_CELLS_Y][OVD_CELLS_X];
+static uint32_t cell_flush[OVD_CELLS_Y][OVD_CELLS_X];
+
+static ovd_widget_t widgets[OVD_MAX_WIDGETS];
+static uint32_t widget_count;
+static uint16_t stack[STACK_MAX]; // Indexes into widgets, the top one is drawing
+static uint32_t stack_depth;
+
+static ovd_stats_t stats;
+static void (*blend_orig)(lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc);
+static const lv_area_t panel_area = {0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1};
+
+static uint32_t widget_index(const lv_obj_t *obj) {
+    for (uint32_t i = 0; i < widget_count; i++) {
+        if (widgets[i].obj == obj && widgets[i].class_p == (obj ? obj->class_p : NULL)) return i;
+    }
+    if (widget_count == OVD_MAX_WIDGETS) return OVD_MAX_WIDGETS - 1;
+    ovd_widget_t *w = &widgets[widget_count];
+    memset(w, 0, sizeof(*w));
+    w->obj = obj;
+    w->class_p = obj ? obj->class_p : NULL;
+    w->last_frame = UINT32_MAX;
+    return widget_count++;
+}
+
+// Draw events bracket what a widget paints itself: its children are drawn
+// between DRAW_MAIN_END and DRAW_POST_BEGIN
+static void ovd_event_cb(lv_event_t *e) {
+    lv_event_code_t code = lv_event_get_code(e);
+    if (code == LV_EVENT_DRAW_MAIN_BEGIN || code == LV_EVENT_DRAW_POST_BEGIN) {
+        lv_obj_t *obj = lv_event_get_target(e);
+        uint32_t i = widget_index(obj);
+        lv_obj_get_coords(obj, &widgets[i].coords);
+        if (stack_depth < STACK_MAX) stack[stack_depth] = (uint16_t)i;
+        stack_depth++;
+    } else if (code == LV_EVENT_DRAW_MAIN_END || code == LV_EVENT_DRAW_POST_END) {
+        if (stack_depth) stack_depth--;
+    }
+}
+
+static lv_obj_tree_walk_res_t hook_obj(lv_obj_t *obj, void *user_data) {
+    if (lv_obj_get_event_user_data(obj, ovd_event_cb) == NULL) {
+        lv_obj_add_event_cb(obj, ovd_event_cb, LV_EVENT_ALL, user_data);
+    }
+    return LV_OBJ_TREE_WALK_NEXT;
+}
+
+// New widgets get the draw event hook. Every widget invalidates its area
+// before it's drawn for the first time, so this runs from the invalidation
+// hook. LVGL re-reads the event list by index while sending, so adding to
+// it from within an event is safe.
+static void hook_tree(void) {
+    static uint8_t marker; // Non-NULL user data tells hooked widgets apart
+    lv_disp_t *disp = lv_disp_get_default();
+    if (disp == NULL) return;
+    for (uint32_t i = 0; i < disp->screen_cnt; i++) lv_obj_tree_walk(disp->screens[i], hook_obj, &marker);
+    if (disp->top_layer) lv_obj_tree_walk(disp->top_layer, hook_obj, &marker);
+    if (disp->sys_layer) lv_obj_tree_walk(disp->sys_layer, hook_obj, &marker);
+}
+
+static void ovd_blend(lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc) {
+    blend_orig(draw_ctx, dsc);
+
+    if (dsc->opa <= LV_OPA_MIN) return;
+    if (dsc->mask_buf && dsc->mask_res == LV_DRAW_MASK_RES_TRANSP) return;
+    lv_area_t area;
+    if (!_lv_area_intersect(&area, dsc->blend_area, draw_ctx->clip_area)) return;
+    if (!_lv_area_intersect(&area, &area, &panel_area)) return; // Layers may reach outside
+
+    const lv_opa_t *mask = dsc->mask_res == LV_DRAW_MASK_RES_FULL_COVER ? NULL : dsc->mask_buf;
+    int32_t mask_stride = mask ? lv_area_get_width(dsc->mask_area) : 0;
+    int32_t w = lv_area_get_width(&area);
+
+    uint32_t written = 0;
+    uint32_t over = 0;
+    for (int32_t y = area.y1; y <= area.y2; y++) {
+        uint8_t *d = &depth[y][area.x1];
+        const lv_opa_t *m = NULL;
+        if (mask) m = mask + mask_stride * (y - dsc->mask_area->y1) + (area.x1 - dsc->mask_area->x1);
+        for (int32_t x = 0; x < w; x++) {
+            if (m && m[x] == 0) continue;
+            if (d[x]) over++;
+            if (d[x] < UINT8_MAX) d[x]++;
+            written++;
+        }
+    }
+
+    ovd_widget_t *wd = &widgets[stack_depth ? stack[(stack_depth > STACK_MAX ? STACK_MAX : stack_depth) - 1]
+                                            : widget_index(NULL)];
+    wd->px_written += written;
+    wd->px_over += over;
+    if (written && wd->last_frame != stats.frames) {
+        wd->last_frame = stats.frames;
+        wd->frames++;
+    }
+    stats.px_written += written;
+}
+
+void lv_port_overdraw_ctx_init(lv_disp_drv_t *drv, lv_draw_ctx_t *draw_ctx) {
+#if LV_PORT_FAST_BLEND
+    lv_port_blend_ctx_init(drv, draw_ctx);
+#else
+    lv_draw_sw_init_ctx(drv, draw_ctx);
+#endif
+    lv_draw_sw_ctx_t *sw = (lv_draw_sw_ctx_t *)draw_ctx;
+    blend_orig = sw->blend;
+    sw->blend = ovd_blend;
+}
+
+static void cells_add(uint32_t cells[OVD_CELLS_Y][OVD_CELLS_X], const lv_area_t *area) {
+    lv_area_t a;
+    if (!_lv_area_intersect(&a, area, &panel_area)) return;
+    for (int32_t cy = a.y1 / OVD_CELL; cy <= a.y2 / OVD_CELL; cy++) {
+        for (int32_t cx = a.x1 / OVD_CELL; cx <= a.x2 / OVD_CELL; cx++) cells[cy][cx]++;
+    }
+}
+
+void lv_port_overdraw_invalidate(const lv_area_t *area) {
+    cells_add(cell_inv, area);
+    stats.px_invalidated += lv_area_get_size(area);
+    hook_tree();
+}
+
+void lv_port_overdraw_flush(const lv_area_t *area) {
+    cells_add(cell_flush, area);
+    stats.px_flushed += lv_area_get_size(area);
+}
+
+void lv_port_overdraw_refresh_done(void) {
+    for (uint32_t y = 0; y < ST7789_HEIGHT; y++) {
+        for (uint32_t x = 0; x < ST7789_WIDTH; x++) {
+            uint8_t d = depth[y][x];
+            if (d == 0) continue;
+            stats.px_unique++;
+            if (d > peak[y][x]) peak[y][x] = d;
+            if (d > stats.max_depth) stats.max_depth = d;
+            cell_over[y / OVD_CELL][x / OVD_CELL] += d - 1u;
+        }
+    }
+    memset(depth, 0, sizeof(depth));
+    stack_depth = 0;
+    stats.frames++;
+}
+
+uint32_t lv_port_overdraw_value(ovd_map_t map, uint32_t x, uint32_t y) {
+    if (x >= ST7789_WIDTH || y >= ST7789_HEIGHT) return 0;
+    switch (map) {
+    case OVD_MAP_DEPTH: return peak[y][x];
+    case OVD_MAP_OVERDRAW: return cell_over[y / OVD_CELL][x / OVD_CELL];
+    case OVD_MAP_INVALIDATED: return cell_inv[y / OVD_CELL][x / OVD_CELL];
+    case OVD_MAP_FLUSHED: return cell_flush[y / OVD_CELL][x / OVD_CELL];
+    }
+    return 0;
+}
+
+uint32_t lv_port_overdraw_max(ovd_map_t map) {
+    uint32_t max = 0;
+    uint32_t step = map == OVD_MAP_DEPTH ? 1 : OVD_CELL;
+    for (uint32_t y = 0; y < ST7789_HEIGHT; y += step) {
+        for (uint32_t x = 0; x < ST7789_WIDTH; x += step) {
+            uint32_t v = lv_port_overdraw_value(map, x, y);
+            if (v > max) max = v;
+        }
+    }
+    return max;
+}
+
+uint32_t lv_port_overdraw_top(ovd_widget_t *out, uint32_t max) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < widget_count; i++) {
+        // Insertion into the sorted output, it's short
+        uint32_t j = n < max ? n++ : max;
+        while (j > 0 && out[j - 1].px_over < widgets[i].px_over) {
+            if (j < max) out[j] = out[j - 1];
+            j--;
+        }
+        if (j < max) out[j] = widgets[i];
+    }
+    return n;
+}
+
+const char *lv_port_overdraw_class_name(const lv_obj_class_t *class_p) {
+    static const struct {
+        const lv_obj_class_t *class_p;
+        const char *name;
+    } names[] = {
+        {&lv_obj_class, "obj"},
+#if LV_USE_BTN
+        {&lv_btn_class, "btn"},
+#endif
+#if LV_USE_LABEL
+        {&lv_label_class, "label"},
+#endif
+#if LV_USE_IMG
+        {&lv_img_class, "img"},
+#endif
+#if LV_USE_BAR
+        {&lv_bar_class, "bar"},
+#endif
+#if LV_USE_ARC
+        {&lv_arc_class, "arc"},
+#endif
+#if LV_USE_SLIDER
+        {&lv_slider_class, "slider"},
+#endif
+#if LV_USE_CHART
+        {&lv_chart_class, "chart"},
+#endif
+#if LV_USE_LIST
+        {&lv_list_class, "list"},
+        {&lv_list_btn_class, "list_btn"},
+        {&lv_list_text_class, "list_text"},
+#endif
+#if LV_USE_METER
+        {&lv_meter_class, "meter"},
+#endif
+    };
+    if (class_p == NULL) return "(none)";
+    for (uint32_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (names[i].class_p == class_p) return names[i].name;
+    }
+    return "?";
+}
+
+void lv_port_overdraw_get_stats(ovd_stats_t *out) {
+    *out = stats;
+}
+
+void lv_port_overdraw_reset(void) {
+    memset(&stats, 0, sizeof(stats));
+    memset(depth, 0, sizeof(depth));
+    memset(peak, 0, sizeof(peak));
+    memset(cell_over, 0, sizeof(cell_over));
+    memset(cell_inv, 0, sizeof(cell_inv));
+    memset(cell_flush, 0, sizeof(cell_flush));
+    widget_count = 0;
+    stack_depth = 0;
+    hook_tree();
+}
+
+void lv_port_overdraw_print(uint32_t top) {
+    uint32_t frames = stats.frames ? stats.frames : 1;
+    printf("Overdraw: %lu frames, per frame %llu px written, %llu distinct (%.2fx), max %u writes to a pixel\n",
+           (unsigned long)stats.frames, (unsigned long long)(stats.px_written / frames),
+           (unsigned long long)(stats.px_unique / frames),
+           stats.px_unique ? (double)stats.px_written / stats.px_unique : 0.0, stats.max_depth);
+    printf("  invalidated %llu px/frame, flushed %llu px/frame\n",
+           (unsigned long long)(stats.px_invalidated / frames), (unsigned long long)(stats.px_flushed / frames));
+
+    ovd_widget_t list[16];
+    uint32_t n = lv_port_overdraw_top(list, top < 16 ? top : 16);
+    if (n) printf("  %-10s %-22s %10s %10s %6s\n", "widget", "area", "written", "over", "frames");
+    for (uint32_t i = 0; i < n; i++) {
+        const ovd_widget_t *w = &list[i];
+        char area[24];
+        snprintf(area, sizeof(area), "%d,%d %dx%d", (int)w->coords.x1, (int)w->coords.y1,
+                 (int)lv_area_get_width(&w->coords), (int)lv_area_get_height(&w->coords));
+        printf("  %-10s %-22s %10llu %10llu %6lu\n", lv_port_overdraw_class_name(w->class_p), w->obj ? area : "-",
+               (unsigned long long)w->px_written, (unsigned long long)w->px_over, (unsigned long)w->frames);
+    }
+}
+
+#endif // LV_PORT_OVERDRAW
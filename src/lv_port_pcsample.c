@@ -0,0 +1,95 @@
+#include "lv_port_pcsample.h"
+
+#if LV_PORT_PC_SAMPLER
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/timer.h"
+#include <stdio.h>
+
+_Static_assert((PCSAMPLE_COUNT & (PCSAMPLE_COUNT - 1)) == 0, "PCSAMPLE_COUNT must be a power of two");
+
+// Ring written by the IRQ at head, read by the dump at tail. Each side
+// writes only its own index, so neither needs to mask the other.
+static uint32_t samples[PCSAMPLE_COUNT];
+static volatile uint32_t head, tail;
+static int alarm = -1; // Claimed on the first start
+static volatile bool running;
+static volatile bool full; // The IRQ stopped re-arming the alarm
+
+// Called by pcsample_irq() with the PC from the exception frame. Returning
+// from here returns from the exception, lr still holds EXC_RETURN.
+static void __attribute__((used)) pcsample_record(uint32_t pc) {
+    timer_hw->intr = 1u << alarm;
+
+    uint32_t h = head;
+    samples[h % PCSAMPLE_COUNT] = pc;
+    head = ++h;
+    if (h - tail >= PCSAMPLE_COUNT) {
+        full = true; // The dump re-arms it
+    } else if (running) {
+        timer_hw->alarm[alarm] = timer_hw->timerawl + PCSAMPLE_PERIOD_US;
+    }
+}
+
+// The interrupted PC is the 7th word of the exception frame, on the process
+// or main stack depending on bit 2 of EXC_RETURN. Cortex-M0+ has no DWT PC
+// sampler, so this is the only way to get it.
+static void __attribute__((naked)) pcsample_irq(void) {
+    __asm volatile(
+        "movs r0, #4\n"
+        "mov  r1, lr\n"
+        "tst  r0, r1\n"
+        "beq  1f\n"
+        "mrs  r0, psp\n"
+        "b    2f\n"
+        "1:\n"
+        "mrs  r0, msp\n"
+        "2:\n"
+        "ldr  r0, [r0, #24]\n"
+        "ldr  r1, =pcsample_record\n"
+        "bx   r1\n"
+        ".ltorg\n");
+}
+
+void lv_port_pcsample_start(void) {
+    if (running) return;
+
+    if (alarm < 0) {
+        alarm = hardware_alarm_claim_unused(true);
+        irq_set_exclusive_handler(TIMER_IRQ_0 + alarm, pcsample_irq);
+        irq_set_priority(TIMER_IRQ_0 + alarm, 0); // Preempt other IRQs to sample them too
+    }
+    hw_set_bits(&timer_hw->inte, 1u << alarm);
+    irq_set_enabled(TIMER_IRQ_0 + alarm, true);
+
+    running = true;
+    full = head - tail >= PCSAMPLE_COUNT;
+    if (!full) timer_hw->alarm[alarm] = timer_hw->timerawl + PCSAMPLE_PERIOD_US;
+}
+
+void lv_port_pcsample_stop(void) {
+    if (!running) return;
+    running = false;
+    hw_clear_bits(&timer_hw->inte, 1u << alarm);
+    irq_set_enabled(TIMER_IRQ_0 + alarm, false);
+}
+
+void lv_port_pcsample_dump(void) {
+    // Up to the samples taken before the call; the ones the IRQ adds while
+    // this prints stay for the next dump
+    uint32_t end = head;
+
+    while (tail != end) {
+        uint32_t t = tail;
+        printf("PCS %08lx\n", (unsigned long)samples[t % PCSAMPLE_COUNT]);
+        tail = t + 1;
+        // A slot is free again: sampling goes on if it stopped on a full ring
+        if (full && running) {
+            full = false;
+            timer_hw->alarm[alarm] = timer_hw->timerawl + PCSAMPLE_PERIOD_US;
+        }
+    }
+}
+
+#endif // LV_PORT_PC_SAMPLER
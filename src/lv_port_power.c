@@ -0,0 +1,83 @@
+#include "lv_port_power.h"
+
+#if LV_PORT_PANEL_SLEEP
+
+#include "st7789.h"
+#include "port_log.h"
+#include "pico/time.h"
+#include <string.h>
+
+static lv_disp_t *power_disp;
+static lv_timer_cb_t refr_timer_cb_orig;
+static bool asleep;
+static bool wake_pending;    // Backlight waits for the first refresh
+static uint8_t bl_level;     // Restored on wake
+static uint32_t sleep_start_ms;
+static uint32_t wake_start_us;
+static lv_port_power_stats_t stats;
+
+static void power_refr_timer(lv_timer_t *timer) {
+    if (asleep) {
+        // Keep the invalidated areas queued; _lv_inv_area resumes the timer
+        // on the next change and it lands here again
+        lv_timer_pause(timer);
+        return;
+    }
+
+    uint16_t areas = power_disp->inv_p;
+    refr_timer_cb_orig(timer);
+
+    if (wake_pending) {
+        wake_pending = false;
+        st7789_fade_backlight(bl_level, POWER_WAKE_FADE_MS);
+        stats.last_wake_us = time_us_32() - wake_start_us;
+        stats.last_wake_areas = areas;
+    }
+}
+
+void lv_port_power_init(lv_disp_t *disp) {
+    power_disp = disp;
+    if (disp && disp->refr_timer) {
+        refr_timer_cb_orig = disp->refr_timer->timer_cb;
+        lv_timer_set_cb(disp->refr_timer, power_refr_timer);
+    }
+}
+
+void lv_port_power_sleep(void) {
+    if (asleep || !power_disp) return;
+
+    bl_level = st7789_get_backlight();
+    st7789_set_backlight(0);
+    st7789_sleep();
+    asleep = true;
+    wake_pending = false;
+    sleep_start_ms = lv_tick_get();
+    stats.sleeps++;
+    PORT_LOGI("Panel asleep\n");
+}
+
+void lv_port_power_wake(void) {
+    if (!asleep) return;
+
+    wake_start_us = time_us_32();
+    st7789_wake();
+    asleep = false;
+    wake_pending = true;
+    stats.asleep_ms += lv_tick_elaps(sleep_start_ms);
+
+    // Refresh now even if nothing changed, that's what turns the light on
+    lv_timer_resume(power_disp->refr_timer);
+    lv_timer_ready(power_disp->refr_timer);
+    PORT_LOGI("Panel awake\n");
+}
+
+bool lv_port_power_is_asleep(void) {
+    return asleep;
+}
+
+void lv_port_power_get_stats(lv_port_power_stats_t *out) {
+    memcpy(out, &stats, sizeof(stats));
+    if (asleep) out->asleep_ms += lv_tick_elaps(sleep_start_ms);
+}
+
+#endif // LV_PORT_PANEL_SLEEP
@@ -0,0 +1,199 @@
+#include "lv_port_prof.h"
+
+#if LV_PORT_PROFILER
+
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <string.h>
+
+static prof_frame_t frames[PROF_FRAME_RING];
+static prof_band_t bands[PROF_BAND_RING];
+static uint32_t frame_head, frame_tail; // Free-running, index with % ring size
+static uint32_t band_head, band_tail;
+static uint32_t frames_dropped, bands_dropped;
+
+static prof_frame_t cur;       // Frame being accumulated
+static prof_band_t cur_band;
+static uint32_t seq;
+static uint32_t frame_end_us;
+static uint32_t handler_exit_us;
+static uint32_t band_start_us;  // End of the previous band, or refresh start
+static uint32_t flush_start_us;
+static bool frame_done;
+
+static lv_timer_cb_t refr_timer_cb_orig;
+static lv_timer_cb_t read_timer_cb_orig;
+
+static void prof_refr_timer(lv_timer_t *timer) {
+    uint32_t start = time_us_32();
+    uint16_t areas = cur.areas;
+
+    band_start_us = start;
+    refr_timer_cb_orig(timer);
+
+    cur.refresh_us += time_us_32() - start;
+    if (cur.areas != areas) frame_done = true; // Something reached the panel
+}
+
+static void prof_read_timer(lv_timer_t *timer) {
+    uint32_t start = time_us_32();
+    read_timer_cb_orig(timer);
+    cur.input_us += time_us_32() - start;
+}
+
+static void frame_close(uint32_t now) {
+    cur.seq = seq++;
+    cur.interval_us = now - frame_end_us;
+    cur.render_us = cur.refresh_us > cur.flush_us ? cur.refresh_us - cur.flush_us : 0;
+    frame_end_us = now;
+
+    if (frame_head - frame_tail < PROF_FRAME_RING) {
+        frames[frame_head % PROF_FRAME_RING] = cur;
+        frame_head++;
+    } else {
+        frames_dropped++;
+    }
+
+    memset(&cur, 0, sizeof(cur));
+    frame_done = false;
+}
+
+void lv_port_prof_init(lv_disp_t *disp, lv_indev_t *indev) {
+    if (disp && disp->refr_timer) {
+        refr_timer_cb_orig = disp->refr_timer->timer_cb;
+        lv_timer_set_cb(disp->refr_timer, prof_refr_timer);
+    }
+    if (indev && indev->driver->read_timer) {
+        read_timer_cb_orig = indev->driver->read_timer->timer_cb;
+        lv_timer_set_cb(indev->driver->read_timer, prof_read_timer);
+    }
+    frame_end_us = time_us_32();
+}
+
+uint32_t lv_port_prof_timer_handler(void) {
+    uint32_t enter = time_us_32();
+    if (handler_exit_us) cur.idle_us += enter - handler_exit_us;
+
+    uint32_t next = lv_timer_handler();
+
+    uint32_t exit = time_us_32();
+    cur.handler_us += exit - enter;
+    handler_exit_us = exit;
+
+    if (frame_done) frame_close(exit);
+    return next;
+}
+
+void lv_port_prof_flush_begin(const lv_area_t *area) {
+    flush_start_us = time_us_32();
+    cur_band.y1 = area->y1;
+    cur_band.y2 = area->y2;
+    cur_band.render_us = flush_start_us - band_start_us;
+    cur.areas++;
+    cur.bands++;
+}
+
+void lv_port_prof_flush_end(uint32_t bytes) {
+    uint32_t now = time_us_32();
+
+    cur_band.flush_us = now - flush_start_us;
+    cur_band.seq = seq; // The frame being accumulated gets this number on close
+    cur.flush_us += cur_band.flush_us;
+    cur.bytes += bytes;
+    band_start_us = now;
+
+    if (band_head - band_tail < PROF_BAND_RING) {
+        bands[band_head % PROF_BAND_RING] = cur_band;
+        band_head++;
+    } else {
+        bands_dropped++;
+    }
+}
+
+static uint8_t *put_varint(uint8_t *p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static uint8_t crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Fills in sync, type, len and crc around a payload already written at buf + 4
+static size_t record_finish(uint8_t *buf, uint8_t type, const uint8_t *end) {
+    size_t len = (size_t)(end - (buf + 4));
+    buf[0] = PROF_SYNC0;
+    buf[1] = PROF_SYNC1;
+    buf[2] = type;
+    buf[3] = (uint8_t)len;
+    buf[4 + len] = crc8(buf + 2, len + 2);
+    return len + 5;
+}
+
+size_t lv_port_prof_encode_frame(const prof_frame_t *f, uint8_t *buf) {
+    uint8_t *p = buf + 4;
+    p = put_varint(p, f->seq);
+    p = put_varint(p, f->interval_us);
+    p = put_varint(p, f->handler_us);
+    p = put_varint(p, f->input_us);
+    p = put_varint(p, f->refresh_us);
+    p = put_varint(p, f->render_us);
+    p = put_varint(p, f->flush_us);
+    p = put_varint(p, f->idle_us);
+    p = put_varint(p, f->bytes);
+    p = put_varint(p, f->areas);
+    p = put_varint(p, f->bands);
+    return record_finish(buf, PROF_REC_FRAME, p);
+}
+
+size_t lv_port_prof_encode_band(const prof_band_t *b, uint8_t *buf) {
+    uint8_t *p = buf + 4;
+    p = put_varint(p, b->seq);
+    p = put_varint(p, b->y1);
+    p = put_varint(p, b->y2);
+    p = put_varint(p, b->render_us);
+    p = put_varint(p, b->flush_us);
+    return record_finish(buf, PROF_REC_BAND, p);
+}
+
+static void write_raw(const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        putchar_raw(buf[i]); // No CR/LF translation, unlike putchar
+    }
+}
+
+void lv_port_prof_stream(void) {
+    uint8_t buf[64];
+
+    // Bands first, so a decoder has them when the frame they belong to arrives
+    while (band_tail != band_head) {
+        write_raw(buf, lv_port_prof_encode_band(&bands[band_tail % PROF_BAND_RING], buf));
+        band_tail++;
+    }
+    while (frame_tail != frame_head) {
+        write_raw(buf, lv_port_prof_encode_frame(&frames[frame_tail % PROF_FRAME_RING], buf));
+        frame_tail++;
+    }
+
+    if (frames_dropped || bands_dropped) {
+        uint8_t *p = buf + 4;
+        p = put_varint(p, frames_dropped);
+        p = put_varint(p, bands_dropped);
+        write_raw(buf, record_finish(buf, PROF_REC_DROP, p));
+        frames_dropped = 0;
+        bands_dropped = 0;
+    }
+}
+
+#endif // LV_PORT_PROFILER
@@ -0,0 +1,43 @@
+#include "lv_port_readback.h"
+
+#if LV_PORT_READBACK
+
+#include "lv_port_dflush.h"
+#include <stdio.h>
+
+#if LV_PORT_DIFF_FLUSH && READBACK_SEG_W != DFLUSH_SEG_W
+#error "READBACK_SEG_W must equal DFLUSH_SEG_W, the rounder aligns to one of them"
+#endif
+
+static lv_disp_t *rb_disp;
+
+static void redraw(int32_t x1, int32_t x2, int32_t y, void *ctx) {
+    lv_disp_t *disp = ctx;
+    lv_area_t a = {(lv_coord_t)x1, (lv_coord_t)y, (lv_coord_t)x2, (lv_coord_t)y};
+#if LV_PORT_DIFF_FLUSH
+    lv_port_dflush_forget(&a); // Or the redrawn row matches its hash and isn't sent
+#endif
+    _lv_inv_area(disp, &a);
+}
+
+static void readback_timer_cb(lv_timer_t *t) {
+    (void)t;
+    if (rb_disp->inv_p) return; // A frame is waiting, it goes first
+    port_readback_step(READBACK_ROWS, redraw, rb_disp);
+}
+
+void lv_port_readback_init(lv_disp_t *disp) {
+    rb_disp = disp;
+    if (port_readback_init()) lv_timer_create(readback_timer_cb, READBACK_PERIOD_MS, NULL);
+}
+
+void lv_port_readback_print(void) {
+    port_readback_stats_t s;
+    port_readback_get_stats(&s);
+    printf("Readback: %lu rows, %lu segments compared, %lu redrawn, %lu passes\n", (unsigned long)s.rows,
+           (unsigned long)s.segs, (unsigned long)s.bad, (unsigned long)s.passes);
+    printf("  %llu bytes read, longest step %lu us\n", (unsigned long long)s.bytes_read,
+           (unsigned long)s.step_us_max);
+}
+
+#endif // LV_PORT_READBACK
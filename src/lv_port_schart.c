@@ -0,0 +1,182 @@
+#include "lv_port_schart.h"
+
+#if LV_PORT_STREAM_CHART
+
+#include <string.h>
+
+typedef struct {
+    lv_obj_t obj;
+    int16_t *values;   // [series][capacity]
+    lv_color_t colors[SCHART_MAX_SERIES];
+    uint16_t capacity;
+    uint16_t head;     // Point written by the next push
+    uint16_t count;    // Points written so far, up to capacity
+    uint8_t series_count;
+    int16_t min;
+    int16_t max;
+} schart_t;
+
+static void schart_constructor(const lv_obj_class_t *class_p, lv_obj_t *obj);
+static void schart_destructor(const lv_obj_class_t *class_p, lv_obj_t *obj);
+static void schart_event(const lv_obj_class_t *class_p, lv_event_t *e);
+
+const lv_obj_class_t lv_port_schart_class = {
+    .constructor_cb = schart_constructor,
+    .destructor_cb = schart_destructor,
+    .event_cb = schart_event,
+    .width_def = LV_PCT(100),
+    .height_def = LV_DPI_DEF * 2,
+    .instance_size = sizeof(schart_t),
+    .base_class = &lv_obj_class,
+};
+
+lv_obj_t *lv_port_schart_create(lv_obj_t *parent, uint16_t capacity) {
+    lv_obj_t *obj = lv_obj_class_create_obj(&lv_port_schart_class, parent);
+    lv_obj_class_init_obj(obj);
+    ((schart_t *)obj)->capacity = capacity < SCHART_GAP + 2 ? SCHART_GAP + 2 : capacity;
+    return obj;
+}
+
+static void schart_constructor(const lv_obj_class_t *class_p, lv_obj_t *obj) {
+    (void)class_p;
+    schart_t *c = (schart_t *)obj;
+    c->values = NULL;
+    c->capacity = 0;
+    c->head = 0;
+    c->count = 0;
+    c->series_count = 0;
+    c->min = 0;
+    c->max = 100;
+    lv_obj_clear_flag(obj, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_style_line_width(obj, 2, LV_PART_ITEMS);
+}
+
+static void schart_destructor(const lv_obj_class_t *class_p, lv_obj_t *obj) {
+    (void)class_p;
+    schart_t *c = (schart_t *)obj;
+    lv_mem_free(c->values);
+    c->values = NULL;
+}
+
+int32_t lv_port_schart_add_series(lv_obj_t *obj, lv_color_t color) {
+    schart_t *c = (schart_t *)obj;
+    if (c->series_count == SCHART_MAX_SERIES) return -1;
+    int16_t *values = lv_mem_realloc(c->values, (size_t)(c->series_count + 1) * c->capacity * sizeof(int16_t));
+    if (values == NULL) return -1;
+    c->values = values;
+    memset(values + (size_t)c->series_count * c->capacity, 0, c->capacity * sizeof(int16_t));
+    c->colors[c->series_count] = color;
+    lv_obj_invalidate(obj);
+    return c->series_count++;
+}
+
+void lv_port_schart_set_range(lv_obj_t *obj, int16_t min, int16_t max) {
+    schart_t *c = (schart_t *)obj;
+    if (max <= min) max = min + 1;
+    c->min = min;
+    c->max = max;
+    lv_obj_invalidate(obj);
+}
+
+void lv_port_schart_clear(lv_obj_t *obj) {
+    schart_t *c = (schart_t *)obj;
+    c->head = 0;
+    c->count = 0;
+    lv_obj_invalidate(obj);
+}
+
+static int32_t point_x(const schart_t *c, const lv_area_t *content, int32_t i) {
+    return content->x1 + i * (lv_area_get_width(content) - 1) / (c->capacity - 1);
+}
+
+static int32_t point_y(const schart_t *c, const lv_area_t *content, int16_t v) {
+    if (v < c->min) v = c->min;
+    if (v > c->max) v = c->max;
+    return content->y2 - ((int32_t)v - c->min) * (lv_area_get_height(content) - 1) / (c->max - c->min);
+}
+
+// Points first..last (no wrap) plus the line width on both sides
+static void invalidate_points(lv_obj_t *obj, int32_t first, int32_t last) {
+    schart_t *c = (schart_t *)obj;
+    lv_area_t content;
+    lv_obj_get_content_coords(obj, &content);
+    int32_t pad = lv_obj_get_style_line_width(obj, LV_PART_ITEMS) / 2 + 1;
+    lv_area_t a = content;
+    a.x1 = point_x(c, &content, first) - pad;
+    a.x2 = point_x(c, &content, last) + pad;
+    lv_obj_invalidate_area(obj, &a);
+}
+
+void lv_port_schart_push(lv_obj_t *obj, const int16_t *values) {
+    schart_t *c = (schart_t *)obj;
+    if (c->series_count == 0) return;
+
+    uint32_t h = c->head;
+    for (uint32_t s = 0; s < c->series_count; s++) c->values[s * c->capacity + h] = values[s];
+    c->head = (uint16_t)((h + 1) % c->capacity);
+    if (c->count < c->capacity) c->count++;
+
+    // The segment from the previous point to the new one, and the segment
+    // leaving the point the gap now hides
+    int32_t first = h == 0 ? 0 : (int32_t)h - 1;
+    int32_t last = (int32_t)h + SCHART_GAP + 1;
+    if (last < c->capacity) {
+        invalidate_points(obj, first, last);
+    } else {
+        invalidate_points(obj, first, c->capacity - 1);
+        invalidate_points(obj, 0, last - c->capacity);
+    }
+}
+
+// Written and not inside the gap ahead of the head
+static bool point_visible(const schart_t *c, uint32_t i) {
+    if (i >= c->count) return false;
+    return (i + c->capacity - c->head) % c->capacity >= SCHART_GAP;
+}
+
+static void draw_series(lv_event_t *e) {
+    lv_obj_t *obj = lv_event_get_target(e);
+    schart_t *c = (schart_t *)obj;
+    lv_draw_ctx_t *draw_ctx = lv_event_get_draw_ctx(e);
+    if (c->series_count == 0 || c->count < 2) return;
+
+    lv_area_t content;
+    lv_obj_get_content_coords(obj, &content);
+    lv_area_t clip;
+    if (!_lv_area_intersect(&clip, draw_ctx->clip_area, &content)) return;
+
+    // Only the segments reaching into the clip area
+    int32_t w = lv_area_get_width(&content) - 1;
+    int32_t pad = lv_obj_get_style_line_width(obj, LV_PART_ITEMS) / 2 + 1;
+    int32_t first = (clip.x1 - pad - content.x1) * (c->capacity - 1) / (w > 0 ? w : 1);
+    int32_t last = (clip.x2 + pad - content.x1) * (c->capacity - 1) / (w > 0 ? w : 1) + 1;
+    if (first < 1) first = 1;
+    if (last > c->capacity - 1) last = c->capacity - 1;
+
+    const lv_area_t *clip_ori = draw_ctx->clip_area;
+    draw_ctx->clip_area = &clip;
+
+    lv_draw_line_dsc_t dsc;
+    lv_draw_line_dsc_init(&dsc);
+    lv_obj_init_draw_line_dsc(obj, LV_PART_ITEMS, &dsc);
+    for (uint32_t s = 0; s < c->series_count; s++) {
+        const int16_t *v = c->values + s * c->capacity;
+        dsc.color = c->colors[s];
+        for (int32_t i = first; i <= last; i++) {
+            if (!point_visible(c, i - 1) || !point_visible(c, i)) continue;
+            lv_point_t p1 = {(lv_coord_t)point_x(c, &content, i - 1), (lv_coord_t)point_y(c, &content, v[i - 1])};
+            lv_point_t p2 = {(lv_coord_t)point_x(c, &content, i), (lv_coord_t)point_y(c, &content, v[i])};
+            lv_draw_line(draw_ctx, &dsc, &p1, &p2);
+        }
+    }
+
+    draw_ctx->clip_area = clip_ori;
+}
+
+static void schart_event(const lv_obj_class_t *class_p, lv_event_t *e) {
+    (void)class_p;
+    if (lv_obj_event_base(&lv_port_schart_class, e) != LV_RES_OK) return;
+    if (lv_event_get_code(e) == LV_EVENT_DRAW_MAIN) draw_series(e);
+}
+
+#endif // LV_PORT_STREAM_CHART
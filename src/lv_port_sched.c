@@ -0,0 +1,175 @@
+#include "lv_port_sched.h"
+
+#if LV_PORT_TICKLESS
+
+#include "lv_port_msgq.h"
+#include "lv_port_prof.h"
+#include "xpt2046.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+#include <string.h>
+
+#if LV_TICK_CUSTOM == 0
+#error "LV_PORT_TICKLESS needs LV_TICK_CUSTOM 1 in lv_conf.h"
+#endif
+
+typedef enum {
+    WAKE_TIMER = 0,
+    WAKE_TOUCH,
+    WAKE_MSG
+} wake_reason_t;
+
+static lv_indev_t *touch;
+static uint32_t last_pen_us;       // Pen-down edge already handled
+static volatile bool msg_pending;  // Set by lv_port_sched_wake()
+static lv_port_sched_stats_t stats;
+static uint64_t stats_start_us;
+
+void lv_port_sched_set_indev(lv_indev_t *indev) {
+    touch = indev;
+    last_pen_us = xpt2046_pen_down_time_us();
+    if (stats_start_us == 0) stats_start_us = time_us_64();
+}
+
+void lv_port_sched_wake(void) {
+    msg_pending = true;
+    __sev(); // WFE returns even if it is entered after this
+}
+
+static lv_timer_t *touch_timer(void) {
+    return touch ? touch->driver->read_timer : NULL;
+}
+
+static bool touch_paused(void) {
+    lv_timer_t *t = touch_timer();
+    return t && t->paused;
+}
+
+static void touch_resume(void) {
+    lv_timer_t *t = touch_timer();
+    if (t && t->paused) {
+        lv_timer_resume(t);
+        lv_timer_ready(t);
+    }
+}
+
+// Polling only stops once LVGL has seen the release and any scroll throw
+// (which runs from the read timer) is over
+static void touch_pause_if_idle(void) {
+    lv_timer_t *t = touch_timer();
+    if (!t || t->paused) return;
+
+    if (touch->proc.state == LV_INDEV_STATE_RELEASED && touch->proc.types.pointer.scroll_obj == NULL &&
+        !xpt2046_is_touched()) {
+        lv_timer_pause(t);
+    }
+}
+
+bool lv_port_sched_step(void) {
+    uint64_t start = time_us_64();
+#if LV_PORT_MSGQ
+    // Widget updates from the other core, before they're rendered. A full
+    // batch may have left more, they get the next step without a sleep.
+    if (lv_port_msgq_drain(0) == MSGQ_BATCH) msg_pending = true;
+#endif
+#if LV_PORT_PROFILER
+    uint32_t next_ms = lv_port_prof_timer_handler();
+#else
+    uint32_t next_ms = lv_timer_handler();
+#endif
+    uint64_t now = time_us_64();
+    stats.run_us += now - start;
+    stats.steps++;
+
+    touch_pause_if_idle();
+
+    // next_ms counts from the tick the handler saw, which is at least the
+    // tick it started in: waking at that tick boundary is never late
+    if (next_ms > SCHED_MAX_SLEEP_MS) next_ms = SCHED_MAX_SLEEP_MS; // Also LV_NO_TIMER_READY
+    uint64_t due_us = (start / 1000 + next_ms) * 1000;
+
+    uint64_t sleep_start = now;
+    wake_reason_t reason;
+    for (;;) {
+        if (msg_pending) {
+            reason = WAKE_MSG;
+            break;
+        }
+        if (touch_paused() && (xpt2046_pen_down_time_us() != last_pen_us || xpt2046_is_touched())) {
+            reason = WAKE_TOUCH;
+            break;
+        }
+        if (now >= due_us) {
+            reason = WAKE_TIMER;
+            break;
+        }
+        // Returns on the alarm or on any other event/IRQ, e.g. the pen IRQ
+        best_effort_wfe_or_timeout(from_us_since_boot(due_us));
+        stats.wfe_returns++;
+        now = time_us_64();
+    }
+    stats.sleep_us += now - sleep_start;
+
+    bool msg = false;
+    switch (reason) {
+    case WAKE_TIMER: {
+        uint32_t late = (uint32_t)(now - due_us);
+        stats.wake_timer++;
+        stats.timer_late_sum_us += late;
+        if (late > stats.timer_late_max_us) stats.timer_late_max_us = late;
+        break;
+    }
+    case WAKE_TOUCH: {
+        uint32_t edge = xpt2046_pen_down_time_us();
+        if (edge != last_pen_us) {
+            uint32_t lat = (uint32_t)now - edge;
+            stats.touch_wake_sum_us += lat;
+            if (lat > stats.touch_wake_max_us) stats.touch_wake_max_us = lat;
+            last_pen_us = edge;
+        }
+        stats.wake_touch++;
+        touch_resume();
+        break;
+    }
+    case WAKE_MSG:
+        msg_pending = false;
+        stats.wake_msg++;
+        touch_resume(); // E.g. an injected touch from lv_port_latency_inject()
+        msg = true;
+        break;
+    }
+    return msg;
+}
+
+void lv_port_sched_get_stats(lv_port_sched_stats_t *out) {
+    memcpy(out, &stats, sizeof(stats));
+    out->total_us = time_us_64() - stats_start_us;
+}
+
+void lv_port_sched_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+    stats_start_us = time_us_64();
+}
+
+void lv_port_sched_print(void) {
+    lv_port_sched_stats_t s;
+    lv_port_sched_get_stats(&s);
+    uint64_t total = s.total_us ? s.total_us : 1;
+
+    printf("Scheduler: %lu steps in %lu ms, run %lu%%, sleep %lu%%\n", (unsigned long)s.steps,
+           (unsigned long)(s.total_us / 1000), (unsigned long)(s.run_us * 100 / total),
+           (unsigned long)(s.sleep_us * 100 / total));
+    printf("  wakes: timer %lu, touch %lu, msg %lu, WFE returns %lu\n", (unsigned long)s.wake_timer,
+           (unsigned long)s.wake_touch, (unsigned long)s.wake_msg, (unsigned long)s.wfe_returns);
+    if (s.wake_timer) {
+        printf("  timer late: avg %lu us, max %lu us\n", (unsigned long)(s.timer_late_sum_us / s.wake_timer),
+               (unsigned long)s.timer_late_max_us);
+    }
+    if (s.wake_touch) {
+        printf("  touch wake: avg %lu us, max %lu us\n", (unsigned long)(s.touch_wake_sum_us / s.wake_touch),
+               (unsigned long)s.touch_wake_max_us);
+    }
+}
+
+#endif // LV_PORT_TICKLESS
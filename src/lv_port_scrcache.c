@@ -0,0 +1,273 @@
+#include "lv_port_scrcache.h"
+
+#if LV_PORT_SCREEN_CACHE
+
+#include "lv_port_mem.h"
+#include "port_log.h"
+#include "pico/time.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const char *name;
+    lv_port_scrcache_build_cb_t build;
+    lv_obj_t *scr;      // NULL while not built
+    uint32_t step;      // Next build step
+    bool built;
+    bool wanted;        // Prefetched, built in idle slices
+    uint32_t last_used; // use_clock at the last show/prefetch
+    uint32_t mem_bytes;
+    uint32_t build_us;  // Steps so far
+    lv_port_scrcache_stats_t stats;
+} entry_t;
+
+static entry_t entries[SCRCACHE_MAX_SCREENS];
+static uint32_t entry_count;
+static uint32_t use_clock;
+static uint32_t max_alive = SCRCACHE_MAX_ALIVE;
+static uint32_t mem_budget = SCRCACHE_MEM_BUDGET;
+static entry_t *building; // Entry whose step is running, never evicted
+static lv_timer_t *idle_timer;
+#if LV_MEM_CUSTOM
+static void *oom_reserve;  // Freed for an allocation that fails
+static bool oom_pending;   // The reserve was used, evict in the idle timer
+static bool oom_refilling; // Taking the reserve again, its failure is no OOM
+#endif
+
+static uint32_t mem_used(void) {
+#if LV_MEM_CUSTOM
+    return lv_port_mem_used();
+#else
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    return mon.total_size - mon.free_size;
+#endif
+}
+
+static void scr_deleted_cb(lv_event_t *e) {
+    // Also when the application deletes the screen itself
+    entry_t *en = lv_event_get_user_data(e);
+    en->scr = NULL;
+    en->step = 0;
+    en->built = false;
+    en->mem_bytes = 0;
+    en->build_us = 0;
+}
+
+static bool in_use(const entry_t *en) {
+    lv_disp_t *disp = lv_disp_get_default();
+    return en == building || en->scr == lv_scr_act() ||
+           (disp && (en->scr == disp->prev_scr || en->scr == disp->scr_to_act));
+}
+
+// Deletes the least recently used screen other than keep
+static bool evict_one(const entry_t *keep) {
+    entry_t *victim = NULL;
+    for (uint32_t i = 0; i < entry_count; i++) {
+        entry_t *en = &entries[i];
+        if (en->scr == NULL || en == keep || in_use(en)) continue;
+        if (victim == NULL || en->last_used < victim->last_used) victim = en;
+    }
+    if (victim == NULL) return false;
+    PORT_LOGD("scrcache: evicting %s (%lu bytes)\n", victim->name, (unsigned long)victim->mem_bytes);
+    victim->stats.evictions++;
+    victim->wanted = false;
+    lv_obj_del(victim->scr); // scr_deleted_cb resets the entry
+    return true;
+}
+
+static void enforce_limits(const entry_t *keep) {
+    for (;;) {
+        uint32_t alive = 0;
+        uint32_t bytes = 0;
+        for (uint32_t i = 0; i < entry_count; i++) {
+            if (entries[i].scr) {
+                alive++;
+                bytes += entries[i].mem_bytes;
+            }
+        }
+        if (alive <= max_alive && bytes <= mem_budget) return;
+        if (!evict_one(keep)) return;
+    }
+}
+
+#if LV_MEM_CUSTOM
+// Runs inside lv_mem_alloc(): nothing here may touch LVGL objects
+static int oom_cb(size_t size) {
+    (void)size;
+    if (oom_refilling) return 0;
+    oom_pending = true;
+    lv_timer_resume(idle_timer);
+    lv_timer_ready(idle_timer);
+    if (oom_reserve == NULL) return 0;
+    lv_port_mem_free(oom_reserve);
+    oom_reserve = NULL;
+    return 1;
+}
+
+static void refill_reserve(void) {
+    if (oom_reserve) return;
+    oom_refilling = true;
+    oom_reserve = lv_port_mem_alloc(SCRCACHE_OOM_RESERVE);
+    oom_refilling = false;
+}
+#endif
+
+static void build_step(entry_t *en) {
+    uint32_t mem0 = mem_used();
+    uint64_t t0 = time_us_64();
+    building = en;
+    if (en->scr == NULL) {
+        en->scr = lv_obj_create(NULL);
+        lv_obj_add_event_cb(en->scr, scr_deleted_cb, LV_EVENT_DELETE, en);
+    }
+    if (en->build(en->scr, en->step++)) {
+        lv_obj_update_layout(en->scr); // So the switch doesn't lay it out
+        en->built = true;
+    }
+    building = NULL;
+
+    uint32_t dt = (uint32_t)(time_us_64() - t0);
+    uint32_t mem1 = mem_used();
+    en->mem_bytes += mem1 > mem0 ? mem1 - mem0 : 0;
+    en->build_us += dt;
+    if (dt > en->stats.slice_max_us) en->stats.slice_max_us = dt;
+    if (en->built) {
+        en->stats.steps = en->step;
+        en->stats.build_us = en->build_us;
+    }
+}
+
+static entry_t *next_wanted(void) {
+    entry_t *best = NULL;
+    for (uint32_t i = 0; i < entry_count; i++) {
+        entry_t *en = &entries[i];
+        if (!en->wanted || en->built) continue;
+        if (best == NULL || en->last_used > best->last_used) best = en;
+    }
+    return best;
+}
+
+static void idle_timer_cb(lv_timer_t *t) {
+#if LV_MEM_CUSTOM
+    if (oom_pending) {
+        // The heap ran out since the last run: pay the reserve back from
+        // the least recently shown screen
+        oom_pending = false;
+        if (evict_one(NULL)) {
+            PORT_LOGW("scrcache: out of LVGL heap, evicted a screen\n");
+        }
+        refill_reserve();
+    }
+#endif
+    lv_disp_t *disp = lv_disp_get_default();
+    if (disp && disp->inv_p) return; // A frame is waiting, it goes first
+
+    uint64_t end = time_us_64() + SCRCACHE_SLICE_US;
+    entry_t *en;
+    while ((en = next_wanted()) != NULL && time_us_64() < end) {
+        if (en->scr == NULL) {
+            // Room for it before it starts taking memory
+            en->last_used = ++use_clock;
+            enforce_limits(en);
+        }
+        build_step(en);
+        if (en->built) {
+            en->wanted = false;
+            enforce_limits(en);
+        }
+    }
+    if (next_wanted() == NULL) lv_timer_pause(t); // Nothing to do, no wake-ups
+}
+
+int32_t lv_port_scrcache_register(const char *name, lv_port_scrcache_build_cb_t build) {
+    if (entry_count == SCRCACHE_MAX_SCREENS) {
+        PORT_LOGE("scrcache: no room for %s\n", name);
+        return -1;
+    }
+    if (idle_timer == NULL) {
+        idle_timer = lv_timer_create(idle_timer_cb, SCRCACHE_IDLE_PERIOD_MS, NULL);
+        lv_timer_pause(idle_timer);
+#if LV_MEM_CUSTOM
+        lv_port_mem_set_oom_cb(oom_cb);
+        refill_reserve();
+#endif
+    }
+    entry_t *en = &entries[entry_count];
+    memset(en, 0, sizeof(*en));
+    en->name = name;
+    en->build = build;
+    en->stats.name = name;
+    return (int32_t)entry_count++;
+}
+
+void lv_port_scrcache_set_limits(uint32_t alive, uint32_t budget) {
+    max_alive = alive ? alive : 1;
+    mem_budget = budget;
+    enforce_limits(NULL);
+}
+
+void lv_port_scrcache_prefetch(int32_t id) {
+    if (id < 0 || (uint32_t)id >= entry_count) return;
+    entry_t *en = &entries[id];
+    en->last_used = ++use_clock;
+    if (en->built) return;
+    en->wanted = true;
+    lv_timer_resume(idle_timer);
+}
+
+lv_obj_t *lv_port_scrcache_show(int32_t id, lv_scr_load_anim_t anim, uint32_t time_ms) {
+    if (id < 0 || (uint32_t)id >= entry_count) return NULL;
+    entry_t *en = &entries[id];
+    uint64_t t0 = time_us_64();
+
+    en->last_used = ++use_clock;
+    if (en->built) {
+        en->stats.hits++;
+    } else {
+        en->stats.misses++;
+        if (en->scr == NULL) enforce_limits(en);
+        while (!en->built) build_step(en);
+    }
+    en->wanted = false;
+    lv_scr_load_anim(en->scr, anim, time_ms, 0, false); // The old screen stays cached
+    enforce_limits(en);
+
+    en->stats.switch_us = (uint32_t)(time_us_64() - t0);
+    return en->scr;
+}
+
+void lv_port_scrcache_drop(int32_t id) {
+    if (id < 0 || (uint32_t)id >= entry_count) return;
+    entry_t *en = &entries[id];
+    en->wanted = false;
+    if (en->scr && !in_use(en)) lv_obj_del(en->scr);
+}
+
+void lv_port_scrcache_get_stats(int32_t id, lv_port_scrcache_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (id < 0 || (uint32_t)id >= entry_count) return;
+    const entry_t *en = &entries[id];
+    *out = en->stats;
+    out->built = en->built;
+    out->alive = en->scr != NULL;
+    out->mem_bytes = en->mem_bytes;
+}
+
+void lv_port_scrcache_print(void) {
+    printf("Screen cache: %lu screens, at most %lu alive in %lu bytes\n", (unsigned long)entry_count,
+           (unsigned long)max_alive, (unsigned long)mem_budget);
+    printf("  %-12s %-8s %8s %6s %9s %9s %9s %5s %5s %5s\n", "screen", "state", "bytes", "steps", "build_us",
+           "slice_us", "switch_us", "hits", "miss", "evict");
+    for (uint32_t i = 0; i < entry_count; i++) {
+        lv_port_scrcache_stats_t s;
+        lv_port_scrcache_get_stats((int32_t)i, &s);
+        const char *state = entries[i].scr == lv_scr_act() ? "active" : s.built ? "cached" : s.alive ? "partial" : "-";
+        printf("  %-12s %-8s %8lu %6lu %9lu %9lu %9lu %5lu %5lu %5lu\n", s.name, state, (unsigned long)s.mem_bytes,
+               (unsigned long)s.steps, (unsigned long)s.build_us, (unsigned long)s.slice_max_us,
+               (unsigned long)s.switch_us, (unsigned long)s.hits, (unsigned long)s.misses,
+               (unsigned long)s.evictions);
+    }
+}
+
+#endif // LV_PORT_SCREEN_CACHE
@@ -0,0 +1,37 @@
+#include "port_flash.h"
+#include "port_lfs.h"
+#include "spi_tune.h"
+
+#if LV_PORT_FS || SPI_CLOCK_TUNE
+
+#include "hardware/flash.h"
+#include "pico/flash.h"
+
+typedef struct {
+    uint32_t offset;
+    const void *data;
+    uint32_t size;
+} flash_op_t;
+
+// Run by flash_safe_execute() with the other core parked and IRQs off
+static void do_erase(void *param) {
+    const flash_op_t *op = param;
+    flash_range_erase(op->offset, op->size);
+}
+
+static void do_program(void *param) {
+    const flash_op_t *op = param;
+    flash_range_program(op->offset, op->data, op->size);
+}
+
+bool port_flash_erase(uint32_t offset, uint32_t size) {
+    flash_op_t op = {offset, NULL, size};
+    return flash_safe_execute(do_erase, &op, UINT32_MAX) == PICO_OK;
+}
+
+bool port_flash_program(uint32_t offset, const void *data, uint32_t size) {
+    flash_op_t op = {offset, data, size};
+    return flash_safe_execute(do_program, &op, UINT32_MAX) == PICO_OK;
+}
+
+#endif // LV_PORT_FS || SPI_CLOCK_TUNE
@@ -0,0 +1,257 @@
+#include "port_lfs.h"
+
+#if LV_PORT_FS
+
+#include "port_flash.h"
+#include "port_log.h"
+#include "hardware/flash.h"
+#include <string.h>
+#if PORT_LFS_XIP_STREAM
+#include "hardware/dma.h"
+#include "hardware/structs/xip_ctrl.h"
+#endif
+
+static lfs_t lfs;
+static bool mounted;
+static port_lfs_file_t files[PORT_LFS_MAX_FILES];
+static port_lfs_stats_t stats;
+#if PORT_LFS_XIP_STREAM
+static int stream_dma = -1;
+#endif
+
+#if PORT_LFS_XIP_STREAM
+// Sequential read of words through the XIP stream FIFO, paced by its DREQ
+static void xip_stream(const void *src, uint32_t *dst, uint32_t words) {
+    while (!(xip_ctrl_hw->stat & XIP_STAT_FIFO_EMPTY)) (void)xip_ctrl_hw->stream_fifo;
+    xip_ctrl_hw->stream_addr = (uint32_t)(uintptr_t)src;
+    xip_ctrl_hw->stream_ctr = words;
+
+    dma_channel_config c = dma_channel_get_default_config(stream_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, DREQ_XIP_STREAM);
+    dma_channel_configure(stream_dma, &c, dst, (const void *)XIP_AUX_BASE, words, true);
+    dma_channel_wait_for_finish_blocking(stream_dma);
+}
+#endif
+
+static int bd_read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, void *buf, lfs_size_t size) {
+    (void)c;
+    uint32_t addr = PORT_LFS_OFFSET + block * PORT_LFS_BLOCK + off;
+    stats.bd_reads++;
+    stats.bd_read_bytes += size;
+
+#if PORT_LFS_XIP_STREAM
+    if (size >= PORT_LFS_STREAM_MIN && ((addr | (uintptr_t)buf) & 3) == 0) {
+        uint32_t words = size / 4;
+        xip_stream((const void *)(XIP_BASE + addr), buf, words);
+        memcpy((uint8_t *)buf + words * 4, (const void *)(XIP_NOCACHE_NOALLOC_BASE + addr + words * 4), size & 3);
+        stats.bd_streamed++;
+        return LFS_ERR_OK;
+    }
+#endif
+    uintptr_t base = size >= PORT_LFS_NOCACHE_MIN ? XIP_NOCACHE_NOALLOC_BASE : XIP_BASE;
+    memcpy(buf, (const void *)(base + addr), size);
+    return LFS_ERR_OK;
+}
+
+static int bd_prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off, const void *buf, lfs_size_t size) {
+    (void)c;
+    stats.bd_progs++;
+    return port_flash_program(PORT_LFS_OFFSET + block * PORT_LFS_BLOCK + off, buf, size) ? LFS_ERR_OK : LFS_ERR_IO;
+}
+
+static int bd_erase(const struct lfs_config *c, lfs_block_t block) {
+    (void)c;
+    stats.bd_erases++;
+    return port_flash_erase(PORT_LFS_OFFSET + block * PORT_LFS_BLOCK, PORT_LFS_BLOCK) ? LFS_ERR_OK : LFS_ERR_IO;
+}
+
+static int bd_sync(const struct lfs_config *c) {
+    (void)c;
+    return LFS_ERR_OK;
+}
+
+static uint8_t read_buf[PORT_LFS_PROG];
+static uint8_t prog_buf[PORT_LFS_PROG];
+static uint8_t lookahead_buf[16] __attribute__((aligned(4))); // 128 blocks
+
+static const struct lfs_config cfg = {
+    .read = bd_read,
+    .prog = bd_prog,
+    .erase = bd_erase,
+    .sync = bd_sync,
+    .read_size = 4,
+    .prog_size = PORT_LFS_PROG,
+    .block_size = PORT_LFS_BLOCK,
+    .block_count = PORT_LFS_SIZE / PORT_LFS_BLOCK,
+    .block_cycles = 500,
+    .cache_size = PORT_LFS_PROG,
+    .lookahead_size = sizeof(lookahead_buf),
+    .read_buffer = read_buf,
+    .prog_buffer = prog_buf,
+    .lookahead_buffer = lookahead_buf,
+};
+
+int port_lfs_mount(bool format) {
+#if PICO_ON_DEVICE
+    extern char __flash_binary_end;
+    if ((uintptr_t)&__flash_binary_end - XIP_BASE > PORT_LFS_OFFSET) {
+        PORT_LOGE("lfs: firmware overlaps the file system at %08lx\n", (unsigned long)PORT_LFS_OFFSET);
+        return LFS_ERR_NOSPC;
+    }
+#endif
+#if PORT_LFS_XIP_STREAM
+    if (stream_dma < 0) stream_dma = dma_claim_unused_channel(true);
+#endif
+    int err = lfs_mount(&lfs, &cfg);
+    if (err && format) {
+        PORT_LOGI("lfs: formatting %lu kB at %08lx\n", (unsigned long)(PORT_LFS_SIZE / 1024),
+                  (unsigned long)PORT_LFS_OFFSET);
+        err = lfs_format(&lfs, &cfg);
+        if (!err) err = lfs_mount(&lfs, &cfg);
+    }
+    if (err) {
+        PORT_LOGE("lfs: mount failed (%d)\n", err);
+        return err;
+    }
+    mounted = true;
+    return LFS_ERR_OK;
+}
+
+void port_lfs_unmount(void) {
+    if (!mounted) return;
+    for (uint32_t i = 0; i < PORT_LFS_MAX_FILES; i++) {
+        if (files[i].used) port_lfs_close(&files[i]);
+    }
+    lfs_unmount(&lfs);
+    mounted = false;
+}
+
+lfs_t *port_lfs(void) {
+    return mounted ? &lfs : NULL;
+}
+
+port_lfs_file_t *port_lfs_open(const char *path, int flags) {
+    if (!mounted) return NULL;
+    port_lfs_file_t *f = NULL;
+    for (uint32_t i = 0; i < PORT_LFS_MAX_FILES && f == NULL; i++) {
+        if (!files[i].used) f = &files[i];
+    }
+    if (f == NULL) {
+        PORT_LOGW("lfs: more than %u files open\n", PORT_LFS_MAX_FILES);
+        return NULL;
+    }
+    f->cfg = (struct lfs_file_config){.buffer = f->lfs_buf};
+    if (lfs_file_opencfg(&lfs, &f->file, path, flags, &f->cfg) < 0) return NULL;
+    f->used = true;
+    f->ra_pos = 0;
+    f->ra_len = 0;
+    f->ra_win = PORT_LFS_RA_ALIGN;
+    f->pos = 0;
+    f->lfs_pos = 0;
+    return f;
+}
+
+int port_lfs_close(port_lfs_file_t *f) {
+    f->used = false;
+    return lfs_file_close(&lfs, &f->file);
+}
+
+static int32_t read_at(port_lfs_file_t *f, uint32_t pos, void *buf, uint32_t len) {
+    if (f->lfs_pos != pos) {
+        lfs_soff_t r = lfs_file_seek(&lfs, &f->file, (lfs_soff_t)pos, LFS_SEEK_SET);
+        if (r < 0) return r;
+        f->lfs_pos = pos;
+    }
+    lfs_ssize_t n = lfs_file_read(&lfs, &f->file, buf, len);
+    if (n > 0) f->lfs_pos += (uint32_t)n;
+    return n;
+}
+
+int32_t port_lfs_read(port_lfs_file_t *f, void *buf, uint32_t len) {
+    uint8_t *dst = buf;
+    uint32_t done = 0;
+    bool hit = true;
+    stats.reads++;
+
+    while (done < len) {
+        uint32_t pos = f->pos;
+        if (pos >= f->ra_pos && pos < f->ra_pos + f->ra_len) {
+            uint32_t n = f->ra_pos + f->ra_len - pos;
+            if (n > len - done) n = len - done;
+            memcpy(dst + done, f->ra + (pos - f->ra_pos), n);
+            done += n;
+            f->pos += n;
+            continue;
+        }
+        hit = false;
+        if (len - done >= PORT_LFS_RA_SIZE) {
+            int32_t n = read_at(f, pos, dst + done, len - done);
+            if (n < 0) return n;
+            stats.direct++;
+            done += (uint32_t)n;
+            f->pos += (uint32_t)n;
+            break; // All of it, or the end of the file
+        }
+        // Read-ahead window: doubles while misses continue where the cache
+        // ended, back to one PORT_LFS_RA_ALIGN unit after a jump, so random
+        // small reads don't each pull in the whole cache
+        uint32_t start = pos & ~(PORT_LFS_RA_ALIGN - 1);
+        if (f->ra_len && start == f->ra_pos + f->ra_len) {
+            if (f->ra_win < PORT_LFS_RA_SIZE) f->ra_win *= 2;
+        } else {
+            f->ra_win = PORT_LFS_RA_ALIGN;
+        }
+        uint32_t win = f->ra_win;
+        if (pos + (len - done) > start + win) { // The rest of this read at least
+            win = (pos + (len - done) - start + PORT_LFS_RA_ALIGN - 1) & ~(PORT_LFS_RA_ALIGN - 1);
+            if (win > PORT_LFS_RA_SIZE) win = PORT_LFS_RA_SIZE;
+        }
+        int32_t n = read_at(f, start, f->ra, win);
+        if (n < 0) return n;
+        stats.fills++;
+        f->ra_pos = start;
+        f->ra_len = (uint32_t)n;
+        if ((uint32_t)n <= pos - start) break; // End of the file
+    }
+    if (hit) stats.hits++;
+    return (int32_t)done;
+}
+
+int32_t port_lfs_write(port_lfs_file_t *f, const void *buf, uint32_t len) {
+    f->ra_len = 0;
+    if (f->lfs_pos != f->pos) {
+        lfs_soff_t r = lfs_file_seek(&lfs, &f->file, (lfs_soff_t)f->pos, LFS_SEEK_SET);
+        if (r < 0) return r;
+    }
+    lfs_ssize_t n = lfs_file_write(&lfs, &f->file, buf, len);
+    if (n < 0) return n;
+    f->pos += (uint32_t)n;
+    f->lfs_pos = f->pos;
+    return n;
+}
+
+void port_lfs_seek(port_lfs_file_t *f, uint32_t pos) {
+    f->pos = pos; // LittleFS seeks on the next access that misses the cache
+}
+
+uint32_t port_lfs_tell(const port_lfs_file_t *f) {
+    return f->pos;
+}
+
+uint32_t port_lfs_size(port_lfs_file_t *f) {
+    lfs_soff_t size = lfs_file_size(&lfs, &f->file);
+    return size < 0 ? 0 : (uint32_t)size;
+}
+
+void port_lfs_get_stats(port_lfs_stats_t *out) {
+    *out = stats;
+}
+
+void port_lfs_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+#endif // LV_PORT_FS
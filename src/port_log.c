@@ -0,0 +1,91 @@
+#include "port_log.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+
+// One single-producer/single-consumer ring per core. The producer side only
+// masks interrupts on its own core for the few stores of a record, so IRQ
+// handlers can log too; the cores never wait for each other.
+typedef struct {
+    port_log_rec_t rec[PORT_LOG_RING];
+    volatile uint32_t head;    // Written by the producing core
+    volatile uint32_t tail;    // Written by the consumer
+    volatile uint32_t dropped; // Since boot, written by the producing core
+    uint32_t dropped_reported; // Written by the consumer
+} log_ring_t;
+
+static log_ring_t rings[NUM_CORES];
+
+void port_log_write(uint8_t level, const char *fmt, const uint32_t *args, uint32_t nargs) {
+    log_ring_t *r = &rings[get_core_num()];
+    uint32_t t_us = time_us_32();
+
+    if (nargs > PORT_LOG_MAX_ARGS) nargs = PORT_LOG_MAX_ARGS;
+
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t head = r->head;
+    if (head - r->tail >= PORT_LOG_RING) {
+        // Full: keep the older records, they explain how we got here
+        r->dropped++;
+        restore_interrupts(irq);
+        return;
+    }
+
+    port_log_rec_t *rec = &r->rec[head & (PORT_LOG_RING - 1)];
+    rec->fmt = fmt;
+    rec->t_us = t_us;
+    rec->level = level;
+    rec->nargs = (uint8_t)nargs;
+    for (uint32_t i = 0; i < nargs; i++) {
+        rec->args[i] = args[i];
+    }
+
+    __dmb(); // Record contents before the new head for the other core
+    r->head = head + 1;
+    restore_interrupts(irq);
+}
+
+static void print_record(const port_log_rec_t *rec, uint32_t core) {
+    static const char level_chars[] = "-EWID";
+    const uint32_t *a = rec->args;
+
+    printf("[%c%lu %10lu] ", level_chars[rec->level], (unsigned long)core, (unsigned long)rec->t_us);
+    // Unused trailing arguments are ignored by printf
+    printf(rec->fmt, a[0], a[1], a[2], a[3]);
+}
+
+uint32_t port_log_flush(uint32_t max_records) {
+    uint32_t printed = 0;
+
+    for (uint32_t core = 0; core < NUM_CORES; core++) {
+        log_ring_t *r = &rings[core];
+
+        uint32_t dropped = r->dropped;
+        if (dropped != r->dropped_reported) {
+            printf("[log] core%lu: %lu records dropped\n", (unsigned long)core,
+                   (unsigned long)(dropped - r->dropped_reported));
+            r->dropped_reported = dropped;
+        }
+
+        uint32_t tail = r->tail;
+        while (tail != r->head) {
+            if (max_records && printed >= max_records) {
+                r->tail = tail;
+                return printed;
+            }
+            __dmb(); // Head seen before the record it publishes
+            print_record(&r->rec[tail & (PORT_LOG_RING - 1)], core);
+            __dmb(); // Done reading before the slot is handed back
+            r->tail = ++tail;
+            printed++;
+        }
+    }
+    return printed;
+}
+
+uint32_t port_log_dropped(void) {
+    uint32_t total = 0;
+    for (uint32_t core = 0; core < NUM_CORES; core++) {
+        total += rings[core].dropped;
+    }
+    return total;
+}
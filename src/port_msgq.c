@@ -0,0 +1,98 @@
+#include "port_msgq.h"
+#include <string.h>
+
+// Slot sequence numbers, for the slot of position pos:
+//   pos            free, the producer reserving pos may write it
+//   pos + 1        published, the consumer may read it
+//   pos + slots    read, free again for the producer of the next lap
+
+static inline volatile uint32_t *slot_seq(const port_msgq_t *q, uint32_t pos) {
+    return (volatile uint32_t *)(q->buf + (pos & q->mask) * q->stride);
+}
+
+static inline void *slot_rec(const port_msgq_t *q, uint32_t pos) {
+    return q->buf + (pos & q->mask) * q->stride + 4;
+}
+
+#if PORT_MSGQ_SPINLOCK
+// The M0+ doesn't reorder, the barriers keep the compiler and the other
+// core's view in order like on the SDK's own queues
+static inline uint32_t load_acquire(volatile uint32_t *p) {
+    uint32_t v = *p;
+    __dmb();
+    return v;
+}
+
+static inline void store_release(volatile uint32_t *p, uint32_t v) {
+    __dmb();
+    *p = v;
+}
+#else
+static inline uint32_t load_acquire(volatile uint32_t *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_release(volatile uint32_t *p, uint32_t v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+#endif
+
+void port_msgq_init(port_msgq_t *q, uint32_t *buf, uint32_t slots, uint32_t rec_size) {
+    q->buf = (uint8_t *)buf;
+    q->mask = slots - 1;
+    q->rec_size = rec_size;
+    q->stride = PORT_MSGQ_STRIDE(rec_size);
+    q->head = 0;
+    q->tail = 0;
+    q->dropped = 0;
+    for (uint32_t i = 0; i < slots; i++) *slot_seq(q, i) = i;
+#if PORT_MSGQ_SPINLOCK
+    q->lock = spin_lock_init(spin_lock_claim_unused(true));
+#endif
+}
+
+bool port_msgq_post(port_msgq_t *q, const void *rec) {
+    uint32_t pos;
+#if PORT_MSGQ_SPINLOCK
+    uint32_t irq = spin_lock_blocking(q->lock);
+    pos = q->head;
+    if (load_acquire(slot_seq(q, pos)) != pos) {
+        q->dropped++;
+        spin_unlock(q->lock, irq);
+        return false;
+    }
+    q->head = pos + 1;
+    spin_unlock(q->lock, irq);
+#else
+    pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    for (;;) {
+        int32_t dif = (int32_t)(load_acquire(slot_seq(q, pos)) - pos);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (dif < 0) {
+            __atomic_fetch_add(&q->dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        } else {
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED); // Another producer took pos
+        }
+    }
+#endif
+    memcpy(slot_rec(q, pos), rec, q->rec_size);
+    store_release(slot_seq(q, pos), pos + 1);
+    return true;
+}
+
+bool port_msgq_pop(port_msgq_t *q, void *rec) {
+    uint32_t pos = q->tail;
+    if (load_acquire(slot_seq(q, pos)) != pos + 1) return false;
+    memcpy(rec, slot_rec(q, pos), q->rec_size);
+    store_release(slot_seq(q, pos), pos + q->mask + 1);
+    q->tail = pos + 1;
+    return true;
+}
+
+uint32_t port_msgq_count(const port_msgq_t *q) {
+    return q->head - q->tail;
+}
@@ -0,0 +1,172 @@
+#include "port_readback.h"
+
+#if LV_PORT_READBACK
+
+#include "port_fast_mem.h"
+#include "port_log.h"
+#include <string.h>
+
+#if (ST7789_WIDTH % READBACK_SEG_W) != 0 || (READBACK_SEG_W % 2) != 0
+#error "READBACK_SEG_W must be even and divide ST7789_WIDTH"
+#endif
+
+#define SEG_COUNT (ST7789_HEIGHT * READBACK_SEGS)
+
+// CRC-16/CCITT (polynomial 0x1021), MSB first
+static const uint16_t crc_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0,
+};
+
+static uint16_t seg_crc[SEG_COUNT];
+static uint32_t seg_valid[(SEG_COUNT + 31) / 32]; // CRC known for the panel content
+static uint16_t row_buf[ST7789_WIDTH];
+static uint32_t next_row;
+static bool enabled;
+static port_readback_stats_t stats;
+
+// Over the bytes in the order they go out on the bus
+static inline uint16_t crc_segment(const uint16_t *p) {
+    const uint8_t *b = (const uint8_t *)p;
+    uint16_t crc = 0xFFFF;
+    for (int i = 0; i < READBACK_SEG_W * 2; i++) {
+        crc = (uint16_t)((crc << 8) ^ crc_table[(crc >> 8) ^ b[i]]);
+    }
+    return crc;
+}
+
+static inline bool seg_is_valid(uint32_t i) {
+    return (seg_valid[i >> 5] >> (i & 31)) & 1;
+}
+
+static inline void seg_clear(uint32_t i) {
+    seg_valid[i >> 5] &= ~(1u << (i & 31));
+}
+
+bool port_readback_init(void) {
+    uint32_t id = st7789_read_id();
+    enabled = id != 0 && id != 0xFFFFFF;
+    if (enabled) {
+        PORT_LOGI("readback: panel ID %06x\n", id);
+    } else {
+        PORT_LOGW("readback: no answer on MISO (ID %06x), off\n", id);
+    }
+    return enabled;
+}
+
+void PORT_FAST_FUNC(port_readback_record)(int32_t x1, int32_t y1, int32_t x2, int32_t y2, const uint16_t *pixels) {
+    int32_t w = x2 - x1 + 1;
+    int32_t s0 = x1 / READBACK_SEG_W, s1 = x2 / READBACK_SEG_W;
+    for (int32_t y = y1; y <= y2; y++) {
+        const uint16_t *row = pixels + (y - y1) * w;
+        for (int32_t s = s0; s <= s1; s++) {
+            uint32_t i = y * READBACK_SEGS + s;
+            int32_t sx = s * READBACK_SEG_W;
+            if (sx < x1 || sx + READBACK_SEG_W - 1 > x2) {
+                seg_clear(i);
+                continue;
+            }
+            seg_crc[i] = crc_segment(row + (sx - x1));
+            seg_valid[i >> 5] |= 1u << (i & 31);
+        }
+    }
+}
+
+void port_readback_forget(void) {
+    memset(seg_valid, 0, sizeof(seg_valid));
+}
+
+// Checks one row, returns the bad segments
+static uint32_t check_row(uint32_t y, port_readback_bad_cb_t bad, void *ctx) {
+    int32_t first = -1, last = -1;
+    for (int32_t s = 0; s < READBACK_SEGS; s++) {
+        if (!seg_is_valid(y * READBACK_SEGS + s)) continue;
+        if (first < 0) first = s;
+        last = s;
+    }
+    if (first < 0) return 0;
+
+    // One read over the span of the segments with a CRC
+    int32_t x0 = first * READBACK_SEG_W;
+    int32_t x1 = (last + 1) * READBACK_SEG_W - 1;
+    if (!st7789_read_rect((uint16_t)x0, (uint16_t)y, (uint16_t)x1, (uint16_t)y, row_buf)) return 0;
+    stats.rows++;
+    stats.bytes_read += 1 + 3u * (uint32_t)(x1 - x0 + 1);
+
+    uint32_t n = 0;
+    int32_t run = -1; // First bad segment of the current run
+    for (int32_t s = first; s <= last + 1; s++) {
+        uint32_t i = y * READBACK_SEGS + s;
+        bool mismatch = false;
+        if (s <= last && seg_is_valid(i)) {
+            stats.segs++;
+            mismatch = crc_segment(row_buf + (s - first) * READBACK_SEG_W) != seg_crc[i];
+        }
+        if (mismatch) {
+            seg_clear(i);
+            n++;
+            if (run < 0) run = s;
+        } else if (run >= 0) {
+            if (bad) bad(run * READBACK_SEG_W, s * READBACK_SEG_W - 1, (int32_t)y, ctx);
+            run = -1;
+        }
+    }
+    stats.bad += n;
+    return n;
+}
+
+uint32_t port_readback_step(uint32_t rows, port_readback_bad_cb_t bad, void *ctx) {
+    if (!enabled || st7789_is_sleeping()) return 0;
+    uint32_t t0 = time_us_32();
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        n += check_row(next_row, bad, ctx);
+        if (++next_row == ST7789_HEIGHT) {
+            next_row = 0;
+            stats.passes++;
+        }
+    }
+    uint32_t dt = time_us_32() - t0;
+    if (dt > stats.step_us_max) stats.step_us_max = dt;
+    return n;
+}
+
+void port_readback_get_stats(port_readback_stats_t *out) {
+    memcpy(out, &stats, sizeof(stats));
+}
+
+void port_readback_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+#endif // LV_PORT_READBACK
@@ -0,0 +1,274 @@
+#include "spi_bus.h"
+
+#if SPI_BUS_SHARED
+
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+typedef struct {
+    uint cs_pin;
+    uint32_t baud;
+} bus_dev_cfg_t;
+
+typedef struct {
+    spi_bus_dev_t dev;
+    uint8_t prio;
+    uint8_t len;
+    uint8_t tx[SPI_BUS_TXN_MAX];
+    spi_bus_done_cb_t cb;
+    void *ctx;
+    uint32_t queued_us;
+} bus_txn_t;
+
+static spi_inst_t *bus_spi;
+static bus_dev_cfg_t devs[SPI_BUS_DEV_COUNT];
+static int baud_dev = -1; // Device the baud rate is set for
+static spin_lock_t *bus_lock;
+static volatile bool busy;
+static bus_txn_t queue[SPI_BUS_QUEUE];
+static volatile uint32_t queue_len;
+static int dma_chan = -1;
+static spi_bus_stats_t stats;
+
+static struct {
+    spi_bus_dev_t dev;
+    const uint8_t *row;      // Current row
+    size_t row_bytes;
+    size_t row_left;         // Bytes left in the current row
+    size_t rows_left;        // Including the current one
+    size_t stride;
+    size_t burst;            // Bytes in flight
+    void (*resume)(void);
+    volatile bool done;
+} stream;
+
+static void select_dev(spi_bus_dev_t dev) {
+    if (baud_dev != (int)dev) {
+        spi_set_baudrate(bus_spi, devs[dev].baud);
+        baud_dev = dev;
+    }
+    gpio_put(devs[dev].cs_pin, 0);
+}
+
+static void deselect_dev(spi_bus_dev_t dev) {
+    gpio_put(devs[dev].cs_pin, 1);
+}
+
+static bool try_acquire(void) {
+    uint32_t irq = spin_lock_blocking(bus_lock);
+    bool ok = !busy;
+    if (ok) busy = true;
+    spin_unlock(bus_lock, irq);
+    return ok;
+}
+
+static void acquire(void) {
+    while (!try_acquire()) {
+        tight_loop_contents();
+    }
+}
+
+// The TX-only DMA leaves the RX FIFO full and overrun
+static void drain_rx(void) {
+    while (spi_is_readable(bus_spi)) {
+        (void)spi_get_hw(bus_spi)->dr;
+    }
+    spi_get_hw(bus_spi)->icr = SPI_SSPICR_RORIC_BITS;
+}
+
+static void run_txn(const bus_txn_t *t) {
+    uint8_t rx[SPI_BUS_TXN_MAX];
+    uint32_t wait = time_us_32() - t->queued_us;
+    if (wait > stats.txn_wait_max_us) stats.txn_wait_max_us = wait;
+
+    drain_rx();
+    select_dev(t->dev);
+    spi_write_read_blocking(bus_spi, t->tx, rx, t->len);
+    deselect_dev(t->dev);
+    stats.txns++;
+    if (t->cb) t->cb(rx, t->len, t->ctx);
+}
+
+// Runs up to max queued transactions, the caller holds the bus
+static void run_queue(uint32_t max) {
+    while (max--) {
+        bus_txn_t t;
+        uint32_t irq = spin_lock_blocking(bus_lock);
+        if (queue_len == 0) {
+            spin_unlock(bus_lock, irq);
+            return;
+        }
+        t = queue[0];
+        queue_len--;
+        memmove(&queue[0], &queue[1], queue_len * sizeof(queue[0]));
+        spin_unlock(bus_lock, irq);
+        run_txn(&t);
+    }
+}
+
+// Transactions queued while the bus was held run before it is freed, the
+// check and the release are atomic against new submits
+static void release(void) {
+    for (;;) {
+        run_queue(UINT32_MAX);
+        uint32_t irq = spin_lock_blocking(bus_lock);
+        if (queue_len == 0) {
+            busy = false;
+            spin_unlock(bus_lock, irq);
+            return;
+        }
+        spin_unlock(bus_lock, irq);
+    }
+}
+
+static void stream_next_burst(void) {
+    stream.burst = stream.row_left < SPI_BUS_BURST ? stream.row_left : SPI_BUS_BURST;
+    const uint8_t *src = stream.row + (stream.row_bytes - stream.row_left);
+    dma_channel_transfer_from_buffer_now(dma_chan, src, stream.burst);
+}
+
+static void bus_dma_irq(void) {
+    if (!(dma_hw->ints1 & (1u << dma_chan))) return; // Shared handler
+    dma_hw->ints1 = 1u << dma_chan;
+
+    // The last bytes are still in the FIFO when the DMA is done
+    while (spi_is_busy(bus_spi)) {
+        tight_loop_contents();
+    }
+    drain_rx();
+    stats.bursts++;
+
+    stream.row_left -= stream.burst;
+    if (stream.row_left == 0 && --stream.rows_left) {
+        stream.row += stream.stride;
+        stream.row_left = stream.row_bytes;
+    }
+    if (stream.row_left == 0) {
+        deselect_dev(stream.dev);
+        stream.done = true;
+        release();
+        return;
+    }
+
+    if (queue_len) {
+        deselect_dev(stream.dev);
+        run_queue(SPI_BUS_GAP_TXNS);
+        stats.gaps++;
+        drain_rx();
+        select_dev(stream.dev);
+        if (stream.resume) stream.resume();
+    }
+    stream_next_burst();
+}
+
+void spi_bus_init(spi_inst_t *spi, uint sck_pin, uint mosi_pin, uint miso_pin) {
+    if (bus_spi) return;
+    bus_spi = spi;
+    bus_lock = spin_lock_init(spin_lock_claim_unused(true));
+
+    spi_init(spi, 1000 * 1000); // Set per device on select
+    spi_set_format(spi, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    gpio_set_function(sck_pin, GPIO_FUNC_SPI);
+    gpio_set_function(mosi_pin, GPIO_FUNC_SPI);
+    gpio_set_function(miso_pin, GPIO_FUNC_SPI);
+
+    dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, spi_get_dreq(spi, true));
+    dma_channel_configure(dma_chan, &c, &spi_get_hw(spi)->dr, NULL, 0, false);
+    dma_channel_set_irq1_enabled(dma_chan, true);
+    irq_add_shared_handler(DMA_IRQ_1, bus_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+}
+
+void spi_bus_add_device(spi_bus_dev_t dev, uint cs_pin, uint32_t baud) {
+    gpio_init(cs_pin);
+    gpio_set_dir(cs_pin, GPIO_OUT);
+    gpio_put(cs_pin, 1);
+    devs[dev].cs_pin = cs_pin;
+    devs[dev].baud = baud;
+}
+
+uint32_t spi_bus_set_baud(spi_bus_dev_t dev, uint32_t baud) {
+    acquire();
+    devs[dev].baud = baud;
+    uint32_t actual = spi_set_baudrate(bus_spi, baud);
+    baud_dev = dev;
+    release();
+    return actual;
+}
+
+void spi_bus_write(spi_bus_dev_t dev, const uint8_t *tx, size_t len) {
+    acquire();
+    drain_rx();
+    select_dev(dev);
+    spi_write_blocking(bus_spi, tx, len);
+    deselect_dev(dev);
+    release();
+}
+
+void spi_bus_stream(spi_bus_dev_t dev, const uint8_t *data, size_t row_bytes, size_t h, size_t stride_bytes,
+                    void (*resume)(void)) {
+    if (row_bytes == 0 || h == 0) return;
+    acquire();
+    stream.dev = dev;
+    stream.row = data;
+    stream.row_bytes = row_bytes;
+    stream.row_left = row_bytes;
+    stream.rows_left = h;
+    stream.stride = stride_bytes;
+    stream.resume = resume;
+    stream.done = false;
+    stats.streams++;
+
+    drain_rx();
+    select_dev(dev);
+    stream_next_burst();
+    while (!stream.done) {
+        tight_loop_contents();
+    }
+}
+
+bool spi_bus_submit(spi_bus_dev_t dev, spi_bus_prio_t prio, const uint8_t *tx, size_t len,
+                    spi_bus_done_cb_t cb, void *ctx) {
+    if (len > SPI_BUS_TXN_MAX) return false;
+
+    uint32_t irq = spin_lock_blocking(bus_lock);
+    if (queue_len >= SPI_BUS_QUEUE) {
+        stats.queue_full++;
+        spin_unlock(bus_lock, irq);
+        return false;
+    }
+    uint32_t i = queue_len;
+    while (i > 0 && queue[i - 1].prio < prio) {
+        queue[i] = queue[i - 1];
+        i--;
+    }
+    bus_txn_t *t = &queue[i];
+    t->dev = dev;
+    t->prio = (uint8_t)prio;
+    t->len = (uint8_t)len;
+    memcpy(t->tx, tx, len);
+    t->cb = cb;
+    t->ctx = ctx;
+    t->queued_us = time_us_32();
+    queue_len++;
+
+    bool start = !busy;
+    if (start) busy = true;
+    spin_unlock(bus_lock, irq);
+
+    if (start) release(); // Runs it (and anything else queued) now
+    return true;
+}
+
+void spi_bus_get_stats(spi_bus_stats_t *out) {
+    memcpy(out, &stats, sizeof(stats));
+}
+
+#endif // SPI_BUS_SHARED
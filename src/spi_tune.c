@@ -0,0 +1,244 @@
+#include "spi_tune.h"
+
+#if SPI_CLOCK_TUNE
+
+#include "hardware/clocks.h"
+#include "hardware/flash.h"
+#include "port_flash.h"
+#include "port_log.h"
+#include <string.h>
+#if LIB_PICO_STDIO_UART
+#include "hardware/uart.h"
+#endif
+
+#define TUNE_MAGIC   0x4E555453u // "STUN"
+#define TUNE_ROW_MAX 320         // Longest panel row (landscape)
+
+// In the flash sector at SPI_TUNE_FLASH_OFFSET
+typedef struct {
+    uint32_t magic;
+    uint32_t baud;
+    uint32_t peri_hz;
+    uint32_t peri;
+    uint32_t sys_hz; // clk_sys it was tuned at
+    uint32_t key;    // Wiring it was tuned for
+    uint32_t check;  // FNV-1a of the words above
+} tune_record_t;
+
+static uint16_t row_buf[TUNE_ROW_MAX];
+static spi_tune_result_t last;
+
+uint32_t spi_tune_rates(const uint32_t *peri_hz, uint32_t sources, uint32_t min, uint32_t max,
+                        spi_tune_rate_t *out, uint32_t max_rates) {
+    uint32_t n = 0;
+    for (uint32_t src = 0; src < sources; src++) {
+        for (uint32_t div = 2; peri_hz[src] / div >= min; div += 2) {
+            uint32_t baud = peri_hz[src] / div;
+            if (baud > max) continue;
+            // Sorted insert, equal rates keep the earlier source
+            uint32_t i = 0;
+            while (i < n && out[i].baud > baud) i++;
+            if (i < n && out[i].baud == baud) continue;
+            if (n == max_rates) {
+                if (i == n) break;
+                n--; // Drop the slowest
+            }
+            memmove(&out[i + 1], &out[i], (n - i) * sizeof(out[0]));
+            out[i].baud = baud;
+            out[i].peri_hz = peri_hz[src];
+            out[i].peri = (uint8_t)src;
+            n++;
+        }
+    }
+    return n;
+}
+
+static bool passes(const spi_tune_rate_t *r, uint32_t first, uint32_t count, spi_tune_probe_t probe, void *ctx,
+                   spi_tune_result_t *res) {
+    for (uint32_t pass = first; pass < first + count; pass++) {
+        res->probes++;
+        if (!probe(r, pass, ctx)) return false;
+    }
+    return true;
+}
+
+bool spi_tune_search(const spi_tune_rate_t *rates, uint32_t n, spi_tune_probe_t probe, void *ctx,
+                     spi_tune_result_t *res) {
+    memset(res, 0, sizeof(*res));
+    spi_tune_rate_t top = {0}; // Passed with no failure above it: the link's limit is still unknown
+    for (uint32_t i = 0; i < n; i++) {
+        const spi_tune_rate_t *r = &rates[i];
+        // Too close to a rate that failed, or to one whose limit is unknown
+        uint32_t edge = res->fail_min ? res->fail_min : top.baud;
+        if (edge && (uint64_t)r->baud * 100 > (uint64_t)edge * (100 - SPI_TUNE_MARGIN_PCT)) {
+            continue;
+        }
+        res->rates_tried++;
+        if (passes(r, 0, SPI_TUNE_PASSES, probe, ctx, res) &&
+            passes(r, SPI_TUNE_PASSES, SPI_TUNE_CONFIRM, probe, ctx, res)) {
+            if (edge) {
+                res->rate = *r;
+                res->ok = true;
+                return true;
+            }
+            top = *r;
+            continue;
+        }
+        res->fail_min = r->baud;
+    }
+    // Nothing slower to step down to: the rate that passed is all there is
+    if (top.baud && !res->fail_min) {
+        res->rate = top;
+        res->ok = true;
+    }
+    return res->ok;
+}
+
+// Pixel i of pattern pass, in the byte order it goes out
+static uint16_t pattern(uint32_t pass, uint32_t i) {
+    switch (pass) {
+    case 0:
+        return (i & 1) ? 0xFFFF : 0x0000; // Every bit toggles
+    case 1:
+        return (i & 1) ? 0xAAAA : 0x5555;
+    case 2:
+        return (uint16_t)(1u << (i % 16)); // Walking one
+    default:
+        return (uint16_t)(((pass << 16) + i) * 2654435761u >> 16);
+    }
+}
+
+static void set_rate(st7789_t *p, const spi_tune_rate_t *r) {
+    if (clock_get_hz(clk_peri) != r->peri_hz) {
+        uint32_t auxsrc = r->peri == SPI_TUNE_PERI_PLL_USB ? CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB
+                                                           : CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS;
+        clock_configure(clk_peri, 0, auxsrc, r->peri_hz, r->peri_hz);
+#if LIB_PICO_STDIO_UART
+        uart_set_baudrate(uart_default, PICO_DEFAULT_UART_BAUD_RATE);
+#endif
+    }
+    st7789_panel_set_baud(p, r->baud);
+}
+
+// Rows at the bottom: all are written before the first is read back
+static bool probe(const spi_tune_rate_t *r, uint32_t pass, void *ctx) {
+    st7789_t *p = ctx;
+    uint32_t w = p->cfg.width;
+    uint32_t y0 = p->cfg.height - SPI_TUNE_ROWS;
+    set_rate(p, r);
+
+    for (uint32_t y = 0; y < SPI_TUNE_ROWS; y++) {
+        for (uint32_t x = 0; x < w; x++) row_buf[x] = pattern(pass, y * w + x);
+        st7789_panel_set_window(p, 0, y0 + y, w - 1, y0 + y);
+        st7789_panel_send_pixels(p, row_buf, w);
+    }
+    for (uint32_t y = 0; y < SPI_TUNE_ROWS; y++) {
+        if (!st7789_panel_read_rect(p, 0, y0 + y, w - 1, y0 + y, row_buf)) return false;
+        for (uint32_t x = 0; x < w; x++) {
+            if (row_buf[x] != pattern(pass, y * w + x)) return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t record_check(const tune_record_t *rec) {
+    const uint32_t *words = (const uint32_t *)rec;
+    uint32_t h = 0x811C9DC5u;
+    for (uint32_t i = 0; i < offsetof(tune_record_t, check) / 4; i++) h = (h ^ words[i]) * 0x01000193u;
+    return h;
+}
+
+static uint32_t wiring_key(const st7789_t *p) {
+    const st7789_config_t *c = &p->cfg;
+    return spi_get_index(c->spi) | (uint32_t)c->pin_sck << 4 | (uint32_t)c->pin_mosi << 10 |
+           (uint32_t)c->pin_miso << 16 | (uint32_t)c->pin_cs << 22 | (uint32_t)(c->pin_dc & 0xF) << 28;
+}
+
+static bool record_load(const st7789_t *p, tune_record_t *rec) {
+    memcpy(rec, (const void *)(XIP_BASE + SPI_TUNE_FLASH_OFFSET), sizeof(*rec));
+    return rec->magic == TUNE_MAGIC && rec->check == record_check(rec) && rec->sys_hz == clock_get_hz(clk_sys) &&
+           rec->key == wiring_key(p);
+}
+
+static void record_store(const st7789_t *p, const spi_tune_rate_t *r) {
+#if PICO_ON_DEVICE
+    extern char __flash_binary_end;
+    if ((uintptr_t)&__flash_binary_end - XIP_BASE > SPI_TUNE_FLASH_OFFSET) {
+        PORT_LOGE("spi_tune: firmware overlaps the calibration at %08lx\n", (unsigned long)SPI_TUNE_FLASH_OFFSET);
+        return;
+    }
+#endif
+    static uint8_t page[FLASH_PAGE_SIZE];
+    tune_record_t rec = {
+        .magic = TUNE_MAGIC, .baud = r->baud, .peri_hz = r->peri_hz, .peri = r->peri,
+        .sys_hz = clock_get_hz(clk_sys), .key = wiring_key(p),
+    };
+    rec.check = record_check(&rec);
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, &rec, sizeof(rec));
+    if (!port_flash_erase(SPI_TUNE_FLASH_OFFSET, FLASH_SECTOR_SIZE) ||
+        !port_flash_program(SPI_TUNE_FLASH_OFFSET, page, sizeof(page))) {
+        PORT_LOGE("spi_tune: can't store the rate\n");
+    }
+}
+
+uint32_t spi_tune_panel(st7789_t *p, bool recalibrate) {
+    memset(&last, 0, sizeof(last));
+    uint32_t id = st7789_panel_read_id(p);
+    if (id == 0 || id == 0xFFFFFF) {
+        PORT_LOGW("spi_tune: panel doesn't answer on MISO, stays at %u Hz\n", st7789_panel_get_baud(p));
+        return st7789_panel_get_baud(p);
+    }
+    uint8_t backlight = st7789_get_backlight();
+    st7789_set_backlight(0); // The test rows aren't for the eye
+
+    tune_record_t rec;
+    if (!recalibrate && record_load(p, &rec)) {
+        spi_tune_rate_t r = {rec.baud, rec.peri_hz, (uint8_t)rec.peri};
+        last.probes = 1;
+        if (probe(&r, SPI_TUNE_PASSES, p)) {
+            last.rate = r;
+            last.ok = true;
+            last.stored = true;
+        } else {
+            PORT_LOGW("spi_tune: stored %u Hz fails, tuning again\n", rec.baud);
+        }
+    }
+
+    if (!last.stored) {
+        uint32_t peri_hz[] = {
+            clock_get_hz(clk_sys),
+#if SPI_TUNE_PERI_USB
+            clock_get_hz(clk_usb),
+#endif
+        };
+        spi_tune_rate_t rates[SPI_TUNE_MAX_RATES];
+        uint32_t n = spi_tune_rates(peri_hz, sizeof(peri_hz) / sizeof(peri_hz[0]), SPI_TUNE_MIN_BAUD,
+                                    SPI_TUNE_MAX_BAUD, rates, SPI_TUNE_MAX_RATES);
+        if (spi_tune_search(rates, n, probe, p, &last)) {
+            record_store(p, &last.rate);
+        } else {
+            PORT_LOGE("spi_tune: no rate passed, back to %u Hz\n", (uint32_t)p->cfg.baud);
+            spi_tune_rate_t def = {p->cfg.baud, clock_get_hz(clk_sys), SPI_TUNE_PERI_SYS};
+            set_rate(p, &def);
+        }
+    }
+    if (last.ok) set_rate(p, &last.rate);
+    st7789_set_backlight(backlight);
+
+    if (last.stored) {
+        PORT_LOGI("spi_tune: SPI %u Hz (clk_peri %u Hz) as stored\n", st7789_panel_get_baud(p),
+                  clock_get_hz(clk_peri));
+    } else {
+        PORT_LOGI("spi_tune: SPI %u Hz (clk_peri %u Hz), slowest failing %u Hz\n", st7789_panel_get_baud(p),
+                  clock_get_hz(clk_peri), last.fail_min);
+        PORT_LOGI("  %u rates tried, %u patterns\n", last.rates_tried, last.probes);
+    }
+    return st7789_panel_get_baud(p);
+}
+
+void spi_tune_get_result(spi_tune_result_t *res) {
+    memcpy(res, &last, sizeof(last));
+}
+
+#endif // SPI_CLOCK_TUNE
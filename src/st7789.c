@@ -1,57 +1,140 @@
 #include "st7789.h"
 #include "pico/time.h"
-#include <stdio.h> // For printf, if needed
-
-// SPI configuration
-#define SPI_BAUD_RATE (62.5 * 1000 * 1000) // 40 MHz, adjust as needed, max for ST7789 is often ~62.5 MHz
-
-static inline void cs_select() {
-    gpio_put(PIN_CS, 0);
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/sync.h"
+#include "port_log.h"
+#include "port_fast_mem.h"
+#include "spi_bus.h"
+
+// PWM compare values for 0..100 %, (p / 100)^2.2 * ST7789_BL_PWM_WRAP
+static const uint16_t bl_gamma[101] = {
+       0,    1,    1,    2,    3,    6,    8,   12,   16,   20,
+      26,   32,   39,   46,   54,   63,   73,   83,   94,  106,
+     119,  132,  146,  161,  177,  194,  211,  230,  249,  269,
+     290,  311,  334,  357,  382,  407,  433,  460,  487,  516,
+     545,  576,  607,  640,  673,  707,  742,  778,  815,  852,
+     891,  931,  972, 1013, 1056, 1099, 1144, 1189, 1235, 1283,
+    1331, 1380, 1431, 1482, 1534, 1587, 1642, 1697, 1753, 1810,
+    1868, 1928, 1988, 2049, 2111, 2175, 2239, 2304, 2371, 2438,
+    2506, 2576, 2646, 2718, 2790, 2864, 2939, 3014, 3091, 3169,
+    3248, 3328, 3409, 3491, 3574, 3658, 3743, 3830, 3917, 4005,
+    4095,
+};
+
+static uint bl_pin = ST7789_NO_PIN; // PWM backlight, of the first panel that has one
+static uint bl_slice;
+static int bl_dma_chan = -1;
+static volatile uint8_t bl_target_pct;
+static uint16_t bl_fade_table[ST7789_BL_FADE_MAX_STEPS];
+
+// Datasheet timing around sleep in/out
+#define SLPIN_TO_SLPOUT_US   120000
+#define SLPOUT_TO_SLPIN_US   120000
+#define SLPOUT_TO_CMD_US     5000
+
+st7789_t st7789_default_panel;
+static const st7789_config_t default_cfg = ST7789_CONFIG_DEFAULT;
+
+// With ST7789_SINGLE_PANEL the config is default_cfg whatever the handle,
+// its fields fold to constants and the handle pointer goes unused
+#define PCFG(p) (ST7789_SINGLE_PANEL ? &default_cfg : &(p)->cfg)
+#define ON_SHARED_BUS(p) (SPI_BUS_SHARED && (ST7789_SINGLE_PANEL || (p)->on_shared_bus))
+
+// Panels with a DMA channel, for the shared DMA IRQ handler
+static st7789_t *async_panels[ST7789_MAX_PANELS];
+// Panel whose async send holds each SPI instance
+static st7789_t *volatile spi_owner[2];
+
+#if SPI_BUS_SHARED
+static st7789_t *bus_panel; // The panel registered as SPI_BUS_DEV_DISPLAY
+#endif
+
+static inline void cs_select(st7789_t *p) {
+    gpio_put(PCFG(p)->pin_cs, 0);
 }
 
-static inline void cs_deselect() {
-    gpio_put(PIN_CS, 1);
+static inline void cs_deselect(st7789_t *p) {
+    gpio_put(PCFG(p)->pin_cs, 1);
 }
 
-static inline void dc_command() {
-    gpio_put(PIN_DC, 0);
+static inline void dc_command(st7789_t *p) {
+    gpio_put(PCFG(p)->pin_dc, 0);
 }
 
-static inline void dc_data() {
-    gpio_put(PIN_DC, 1);
+static inline void dc_data(st7789_t *p) {
+    gpio_put(PCFG(p)->pin_dc, 1);
 }
 
-static inline void reset_display() {
-    gpio_put(PIN_RST, 0);
+static inline void reset_display(st7789_t *p) {
+    if (PCFG(p)->pin_rst == ST7789_NO_PIN) return;
+    gpio_put(PCFG(p)->pin_rst, 0);
     sleep_ms(10);
-    gpio_put(PIN_RST, 1);
+    gpio_put(PCFG(p)->pin_rst, 1);
     sleep_ms(120); // Wait for display to recover
 }
 
-void st7789_write_cmd(uint8_t cmd) {
-    cs_select();
-    dc_command();
-    spi_write_blocking(SPI_PORT, &cmd, 1);
-    cs_deselect();
+// An async send on the same SPI (this panel's or another's) must finish
+// before DC/CS change or the next bytes go out
+static inline void wait_spi(st7789_t *p) {
+    while (spi_owner[spi_get_index(PCFG(p)->spi)]) {
+        tight_loop_contents();
+    }
+}
+
+// Short command/parameter writes, CS around each
+static inline void display_write(st7789_t *p, const uint8_t *data, size_t len) {
+#if SPI_BUS_SHARED
+    if (ON_SHARED_BUS(p)) {
+        spi_bus_write(SPI_BUS_DEV_DISPLAY, data, len);
+        return;
+    }
+#endif
+    cs_select(p);
+    spi_write_blocking(PCFG(p)->spi, data, len);
+    cs_deselect(p);
 }
 
-void st7789_write_data(const uint8_t *data, size_t len) {
-    cs_select();
-    dc_data();
-    spi_write_blocking(SPI_PORT, data, len);
-    cs_deselect();
+#if SPI_BUS_SHARED
+// The bus deselected the panel for a touch transaction, WRMEMC picks the
+// memory write up where it stopped. Called with the panel selected.
+static void resume_memory_write(void) {
+    const uint8_t cmd = ST7789_WRMEMC;
+    dc_command(bus_panel);
+    spi_write_blocking(PCFG(bus_panel)->spi, &cmd, 1);
+    dc_data(bus_panel);
 }
+#endif
 
-void st7789_write_data_byte(uint8_t data) {
-    cs_select();
-    dc_data();
-    spi_write_blocking(SPI_PORT, &data, 1);
-    cs_deselect();
+void PORT_FAST_FUNC(st7789_panel_write_cmd)(st7789_t *p, uint8_t cmd) {
+    wait_spi(p);
+    dc_command(p);
+    display_write(p, &cmd, 1);
+}
+
+void PORT_FAST_FUNC(st7789_panel_write_data)(st7789_t *p, const uint8_t *data, size_t len) {
+    wait_spi(p);
+    dc_data(p);
+    display_write(p, data, len);
+}
+
+static void panel_write_byte(st7789_t *p, uint8_t data) {
+    st7789_panel_write_data(p, &data, 1);
 }
 
-void st7789_send_pixels(const uint16_t* pixels, size_t len) {
-    cs_select();
-    dc_data();
+void PORT_FAST_FUNC(st7789_panel_send_pixels)(st7789_t *p, const uint16_t *pixels, size_t len) {
+    wait_spi(p);
+#if SPI_BUS_SHARED
+    if (ON_SHARED_BUS(p)) {
+        dc_data(p);
+        spi_bus_stream(SPI_BUS_DEV_DISPLAY, (const uint8_t *)pixels, len * 2, 1, 0, resume_memory_write);
+        return;
+    }
+#endif
+    cs_select(p);
+    dc_data(p);
     // SPI expects uint8_t*, so cast. Also, send MSB first for 16-bit colors.
     // The ST7789 expects data in big-endian (MSB first) for 16-bit colors.
     // If your LV_COLOR_16_SWAP is 0, LVGL provides colors in RGB565 big-endian.
@@ -59,32 +142,248 @@ void st7789_send_pixels(const uint16_t* pixels, size_t len) {
     // The spi_write_blocking function sends bytes as they are.
     // We might need to swap bytes if LV_COLOR_16_SWAP is used differently than the display expects.
     // For simplicity, this example assumes LVGL provides data in the correct byte order for ST7789.
-    spi_write_blocking(SPI_PORT, (const uint8_t*)pixels, len * 2); // len is number of pixels, each pixel is 2 bytes
-    cs_deselect();
+    spi_write_blocking(PCFG(p)->spi, (const uint8_t*)pixels, len * 2); // len is number of pixels, each pixel is 2 bytes
+    cs_deselect(p);
 }
 
-void st7789_init() {
+void PORT_FAST_FUNC(st7789_panel_send_pixels_rect)(st7789_t *p, const uint16_t *pixels, size_t w, size_t h,
+                                                   size_t stride) {
+    wait_spi(p);
+#if SPI_BUS_SHARED
+    if (ON_SHARED_BUS(p)) {
+        dc_data(p);
+        spi_bus_stream(SPI_BUS_DEV_DISPLAY, (const uint8_t *)pixels, w * 2, h, stride * 2, resume_memory_write);
+        return;
+    }
+#endif
+    cs_select(p);
+    dc_data(p);
+    // CS stays low so the rows continue the same memory write
+    for (size_t y = 0; y < h; y++) {
+        spi_write_blocking(PCFG(p)->spi, (const uint8_t *)(pixels + y * stride), w * 2);
+    }
+    cs_deselect(p);
+}
+
+static void panel_dma_irq(void) {
+    for (uint32_t i = 0; i < ST7789_MAX_PANELS; i++) {
+        st7789_t *p = async_panels[i];
+        if (!p || !(dma_hw->ints1 & (1u << p->dma_chan))) continue;
+        dma_hw->ints1 = 1u << p->dma_chan;
+
+        // The last bytes are still in the FIFO when the DMA is done
+        spi_inst_t *spi = PCFG(p)->spi;
+        while (spi_is_busy(spi)) {
+            tight_loop_contents();
+        }
+        // The TX-only DMA leaves the RX FIFO full and overrun
+        while (spi_is_readable(spi)) {
+            (void)spi_get_hw(spi)->dr;
+        }
+        spi_get_hw(spi)->icr = SPI_SSPICR_RORIC_BITS;
+        cs_deselect(p);
+
+        p->busy = false;
+        spi_owner[spi_get_index(spi)] = NULL;
+        if (p->done_cb) p->done_cb(p, p->done_ctx);
+    }
+}
+
+static bool panel_dma_init(st7789_t *p) {
+    uint32_t slot = 0;
+    while (slot < ST7789_MAX_PANELS && async_panels[slot]) slot++;
+    if (slot == ST7789_MAX_PANELS) {
+        PORT_LOGE("st7789: more than %u async panels\n", ST7789_MAX_PANELS);
+        return false;
+    }
+
+    p->dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(p->dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, spi_get_dreq(PCFG(p)->spi, true));
+    dma_channel_configure(p->dma_chan, &c, &spi_get_hw(PCFG(p)->spi)->dr, NULL, 0, false);
+
+    if (slot == 0) {
+        irq_add_shared_handler(DMA_IRQ_1, panel_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_1, true);
+    }
+    async_panels[slot] = p;
+    dma_channel_set_irq1_enabled(p->dma_chan, true);
+    return true;
+}
+
+void PORT_FAST_FUNC(st7789_panel_send_pixels_async)(st7789_t *p, const uint16_t *pixels, size_t len,
+                                                    st7789_done_cb_t cb, void *ctx) {
+    if (!ON_SHARED_BUS(p) && (p->dma_chan >= 0 || panel_dma_init(p))) {
+        wait_spi(p);
+        p->done_cb = cb;
+        p->done_ctx = ctx;
+        p->busy = true;
+        spi_owner[spi_get_index(PCFG(p)->spi)] = p;
+        cs_select(p);
+        dc_data(p);
+        dma_channel_transfer_from_buffer_now(p->dma_chan, pixels, len * 2);
+        return;
+    }
+    // The shared bus streams by itself
+    st7789_panel_send_pixels(p, pixels, len);
+    if (cb) cb(p, ctx);
+}
+
+void st7789_panel_wait(st7789_t *p) {
+    while (p->busy) {
+        tight_loop_contents();
+    }
+}
+
+// Pacing slice: wraps once per fade step, steps spread over duration_ms.
+// The 8-bit divider limits a step to about 130 ms at 125 MHz.
+static void backlight_pace(uint32_t duration_ms, uint32_t steps) {
+    uint64_t clocks = (uint64_t)clock_get_hz(clk_sys) * duration_ms / 1000 / steps;
+    uint32_t div = (uint32_t)(clocks / 65536) + 1;
+    if (div > 255) div = 255;
+    if (clocks > div * 65536ull) clocks = div * 65536ull;
+    pwm_config pace = pwm_get_default_config();
+    pwm_config_set_clkdiv_int(&pace, div);
+    pwm_config_set_wrap(&pace, (uint16_t)(clocks / div - 1));
+    pwm_init(ST7789_BL_FADE_SLICE, &pace, true);
+}
+
+static void backlight_init(uint pin) {
+    bl_pin = pin;
+    gpio_set_function(pin, GPIO_FUNC_PWM);
+    bl_slice = pwm_gpio_to_slice_num(pin);
+    pwm_config cfg = pwm_get_default_config();
+    pwm_config_set_wrap(&cfg, ST7789_BL_PWM_WRAP);
+    pwm_init(bl_slice, &cfg, false);
+    pwm_set_gpio_level(pin, 0);
+    pwm_set_enabled(bl_slice, true);
+
+    backlight_pace(1000, ST7789_BL_FADE_HZ);
+
+    bl_dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(bl_dma_chan);
+    // 16-bit writes are replicated to both halves of CC, channel B of the
+    // backlight slice isn't used
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pwm_get_dreq(ST7789_BL_FADE_SLICE));
+    dma_channel_configure(bl_dma_chan, &c, &pwm_hw->slice[bl_slice].cc, bl_fade_table, 0, false);
+}
+
+// Current duty back to percent x 100, for fades that start mid-fade
+static uint32_t backlight_level_pct100(void) {
+    uint16_t level = (uint16_t)(pwm_hw->slice[bl_slice].cc & 0xFFFF);
+    uint32_t i = 0;
+    while (i < 100 && bl_gamma[i + 1] <= level) i++;
+    if (i == 100) return 10000;
+    uint32_t span = bl_gamma[i + 1] - bl_gamma[i];
+    return i * 100 + (span ? (level - bl_gamma[i]) * 100 / span : 0);
+}
+
+static uint16_t backlight_gamma_pct100(uint32_t p) {
+    uint32_t i = p / 100;
+    if (i >= 100) return bl_gamma[100];
+    return (uint16_t)(bl_gamma[i] + (bl_gamma[i + 1] - bl_gamma[i]) * (p % 100) / 100);
+}
+
+// Init sequences: command, parameter count, parameters. INIT_DELAY in the
+// count adds a delay in ms after the parameters. MADCTL and COLMOD come
+// from the panel config and go between the two tables.
+#define INIT_DELAY 0x80
+
+static const uint8_t init_reset[] = {
+    ST7789_SWRESET, INIT_DELAY, 150, // Software reset
+    ST7789_SLPOUT, INIT_DELAY, 255,  // Sleep out; the datasheet says 5 ms is enough, but some displays need more
+};
+
+static const uint8_t init_on[] = {
+    // Porch, gate, VCOM, power and gamma settings go here if a module needs
+    // them (often defaults are fine), e.g.
+    //   ST7789_INVON, 0,                                     // Invert display colors
+    //   0xB2, 5, 0x0C, 0x0C, 0x00, 0x33, 0x33,               // Porch setting
+    //   ST7789_GCTRL, 1, 0x35,                               // Gate control
+    //   ST7789_VCOMS, 1, 0x19,                               // Try 0x2B or 0x3F if flicker
+    //   ST7789_PWCTRL1, 2, 0xA4, 0xA1,
+    //   ST7789_PVGAMCTRL, 14, 0xD0, 0x08, 0x0E, 0x09, 0x09, 0x05, 0x31, 0x33, 0x48, 0x17, 0x14, 0x15, 0x31, 0x34,
+    //   ST7789_NVGAMCTRL, 14, 0xD0, 0x08, 0x0E, 0x09, 0x09, 0x05, 0x31, 0x33, 0x48, 0x17, 0x14, 0x15, 0x31, 0x34,
+    ST7789_NORON, INIT_DELAY, 10,    // Normal display mode on
+    ST7789_DISPON, INIT_DELAY, 100,  // Display on
+};
+
+static void run_init_table(st7789_t *p, const uint8_t *t, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        uint8_t cmd = t[i++];
+        uint8_t n = t[i] & ~INIT_DELAY;
+        bool delay = (t[i++] & INIT_DELAY) != 0;
+        st7789_panel_write_cmd(p, cmd);
+        if (n) st7789_panel_write_data(p, &t[i], n);
+        i += n;
+        if (cmd == ST7789_SLPOUT) p->slpout_time = get_absolute_time();
+        if (delay) sleep_ms(t[i++]);
+    }
+}
+
+void st7789_panel_init(st7789_t *p, const st7789_config_t *cfg) {
+#if ST7789_SINGLE_PANEL
+    if (p != &st7789_default_panel || cfg != &default_cfg) {
+        PORT_LOGE("st7789: ST7789_SINGLE_PANEL only drives the default panel\n");
+    }
+#endif
+    p->cfg = *cfg;
+    p->dma_chan = -1;
+    p->busy = false;
+    p->done_cb = NULL;
+    p->on_shared_bus = false;
+    p->miso_ready = false;
+    p->sleeping = false;
+
     // Initialize GPIOs
-    gpio_init(PIN_CS);
-    gpio_set_dir(PIN_CS, GPIO_OUT);
-    gpio_put(PIN_CS, 1); // Deselect
+#if SPI_BUS_SHARED
+    if (cfg->spi == SPI_PORT) {
+        if (bus_panel) PORT_LOGE("st7789: only one panel on the shared SPI bus\n");
+        bus_panel = p;
+        p->on_shared_bus = true;
+        spi_bus_init(SPI_PORT, PIN_SPI_SCK, PIN_SPI_MOSI, PIN_SPI_MISO);
+        spi_bus_add_device(SPI_BUS_DEV_DISPLAY, cfg->pin_cs, cfg->baud);
+        p->baud = spi_bus_set_baud(SPI_BUS_DEV_DISPLAY, cfg->baud);
+    }
+#endif
+    if (!p->on_shared_bus) {
+        gpio_init(cfg->pin_cs);
+        gpio_set_dir(cfg->pin_cs, GPIO_OUT);
+        gpio_put(cfg->pin_cs, 1); // Deselect
+    }
 
-    gpio_init(PIN_DC);
-    gpio_set_dir(PIN_DC, GPIO_OUT);
+    gpio_init(cfg->pin_dc);
+    gpio_set_dir(cfg->pin_dc, GPIO_OUT);
 
-    gpio_init(PIN_RST);
-    gpio_set_dir(PIN_RST, GPIO_OUT);
+    if (cfg->pin_rst != ST7789_NO_PIN) {
+        gpio_init(cfg->pin_rst);
+        gpio_set_dir(cfg->pin_rst, GPIO_OUT);
+    }
 
-    gpio_init(PIN_BLK);
-    gpio_set_dir(PIN_BLK, GPIO_OUT);
-    // TODO: If using PWM for backlight, initialize PWM here instead
-    gpio_put(PIN_BLK, 1); // Backlight ON
+    if (cfg->pin_blk != ST7789_NO_PIN) {
+        if (bl_pin == ST7789_NO_PIN) {
+            backlight_init(cfg->pin_blk); // Off until the end of the init sequence
+        } else {
+            gpio_init(cfg->pin_blk);
+            gpio_set_dir(cfg->pin_blk, GPIO_OUT);
+            gpio_put(cfg->pin_blk, 0);
+        }
+    }
 
     // Initialize SPI
-    spi_init(SPI_PORT, SPI_BAUD_RATE);
-    gpio_set_function(PIN_SPI_SCK, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_SPI_MOSI, GPIO_FUNC_SPI);
-    // gpio_set_function(PIN_SPI_MISO, GPIO_FUNC_SPI); // If MISO is used
+    if (!p->on_shared_bus) {
+        p->baud = spi_init(cfg->spi, cfg->baud); // Panels sharing an SPI instance need the same baud rate
+        gpio_set_function(cfg->pin_sck, GPIO_FUNC_SPI);
+        gpio_set_function(cfg->pin_mosi, GPIO_FUNC_SPI);
+        // MISO is switched to SPI by the first read, see panel_read_begin()
+    }
 
     // SPI format: 8 bits, CPHA=0, CPOL=0 (Mode 0) is common for ST7789
     // ST7789 datasheet says: SCK is low when CS is high (idle state). Data is latched on SCK rising edge.
@@ -93,13 +392,9 @@ void st7789_init() {
     // If you have issues, try spi_set_format(SPI_PORT, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
     // or SPI_CPOL_1, SPI_CPHA_1.
 
-    reset_display();
+    reset_display(p);
 
-    st7789_write_cmd(ST7789_SWRESET); // Software reset
-    sleep_ms(150);
-
-    st7789_write_cmd(ST7789_SLPOUT); // Sleep out
-    sleep_ms(255); // ST7789 datasheet says 5ms is enough, but some displays need more
+    run_init_table(p, init_reset, sizeof(init_reset));
 
     // Memory Data Access Control (MADCTL)
     // Bit 7: MY (Row Address Order) - 0 = Top to Bottom, 1 = Bottom to Top
@@ -112,124 +407,308 @@ void st7789_init() {
     // For 240W x 320H portrait:
     //   If display native is 240x320: MADCTL = 0x00
     //   If display native is 320x240 and you want portrait: MADCTL = 0xA0 (MY=1, MV=1) or 0x60 (MX=1, MV=1)
-    //   Common for 240x320 displays:
-    uint8_t madctl_val = 0x00; // Default: RGB, Top-to-Bottom, Left-to-Right
-    // madctl_val |= (1<<7); // MY: Row Addr Order (0=T2B, 1=B2T)
-    // madctl_val |= (1<<6); // MX: Col Addr Order (0=L2R, 1=R2L)
-    // madctl_val |= (1<<5); // MV: Row/Col Exchange
-    // madctl_val |= (1<<3); // BGR Order (1 for BGR, 0 for RGB)
-
-    // For landscape mode, you might want to set MV=1 (Row/Column Exchange) and adjust MY/MX accordingly.
-
+    //
     // 0x00: Standard portrait.
     // 0xC0: (MY | MX) Portrait, but flipped on both axes.
-    // 0x60: (MX | MV) Landscape (320W x 240H).
+    // 0x60: (MX | MV) Landscape (320W x 240H), swap width/height in the config.
     // 0xA0: (MY | MV) Landscape, flipped.
     // Add 0x08 (BGR bit) if colors are swapped (e.g., red looks blue).
-    st7789_write_cmd(ST7789_MADCTL);
-    st7789_write_data_byte(madctl_val);
+    st7789_panel_write_cmd(p, ST7789_MADCTL);
+    panel_write_byte(p, cfg->madctl);
 
     // Interface Pixel Format (COLMOD)
     // 0x55: 16 bits/pixel (RGB565)
     // 0x66: 18 bits/pixel
-    st7789_write_cmd(ST7789_COLMOD);
-    st7789_write_data_byte(0x55); // 16-bit color
-    sleep_ms(10);
-
-    // Optional: Inversion control if colors look weird
-    // st7789_write_cmd(ST7789_INVON); // Invert display colors
-    // st7789_write_cmd(ST7789_INVOFF); // Normal display colors
-
-    // Set Porch settings if needed (usually not required for basic operation)
-    /*
-    st7789_write_cmd(0xB2); // Porch Setting
-    st7789_write_data_byte(0x0C);
-    st7789_write_data_byte(0x0C);
-    st7789_write_data_byte(0x00);
-    st7789_write_data_byte(0x33);
-    st7789_write_data_byte(0x33);
-
-    st7789_write_cmd(0xB7); // Gate Control
-    st7789_write_data_byte(0x35);
-    */
-
-    // Set VCOM if needed
-    /*
-    st7789_write_cmd(ST7789_VCOMS);
-    st7789_write_data_byte(0x19); // Default 0x19, try 0x2B or 0x3F if flicker
-    */
-
-    // Power Control, Gamma Settings etc. (Often defaults are fine)
-    // Refer to ST7789 datasheet or example code for your specific module if needed
-    // For example, some displays need:
-    /*
-    st7789_write_cmd(ST7789_PWCTRL1);
-    uint8_t pwctrl1_data[] = {0xA4, 0xA1};
-    st7789_write_data(pwctrl1_data, sizeof(pwctrl1_data));
-
-    st7789_write_cmd(ST7789_PVGAMCTRL); // Positive Gamma Control
-    uint8_t pvgam_data[] = {0xD0, 0x08, 0x0E, 0x09, 0x09, 0x05, 0x31, 0x33, 0x48, 0x17, 0x14, 0x15, 0x31, 0x34};
-    st7789_write_data(pvgam_data, sizeof(pvgam_data));
-
-    st7789_write_cmd(ST7789_NVGAMCTRL); // Negative Gamma Control
-    uint8_t nvgam_data[] = {0xD0, 0x08, 0x0E, 0x09, 0x09, 0x05, 0x31, 0x33, 0x48, 0x17, 0x14, 0x15, 0x31, 0x34};
-    st7789_write_data(nvgam_data, sizeof(nvgam_data));
-    */
-
-    st7789_write_cmd(ST7789_NORON);  // Normal display mode on
+    st7789_panel_write_cmd(p, ST7789_COLMOD);
+    panel_write_byte(p, cfg->colmod);
     sleep_ms(10);
 
-    st7789_write_cmd(ST7789_DISPON); // Display on
-    sleep_ms(100);
+    run_init_table(p, init_on, sizeof(init_on));
 
     // Clear screen (optional, LVGL will draw over it)
     // st7789_set_window(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1);
     // st7789_fill_color(0x0000, (uint32_t)ST7789_WIDTH * ST7789_HEIGHT); // Fill with black
 
-    st7789_set_backlight(100); // Full backlight
-    printf("ST7789 Initialized\n");
+    if (cfg->pin_blk == bl_pin) {
+        st7789_set_backlight(100); // Full backlight
+    } else if (cfg->pin_blk != ST7789_NO_PIN) {
+        gpio_put(cfg->pin_blk, 1);
+    }
+    PORT_LOGI("ST7789 Initialized (CS %u, SPI %u Hz)\n", cfg->pin_cs, p->baud);
 }
 
-void st7789_set_window(uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end) {
-    st7789_write_cmd(ST7789_CASET); // Column Address Set
+// CASET + RASET, the memory command follows
+static void PORT_FAST_FUNC(panel_window)(st7789_t *p, uint16_t x_start, uint16_t y_start, uint16_t x_end,
+                                         uint16_t y_end) {
+    x_start += PCFG(p)->x_offset;
+    x_end += PCFG(p)->x_offset;
+    y_start += PCFG(p)->y_offset;
+    y_end += PCFG(p)->y_offset;
+
+    st7789_panel_write_cmd(p, ST7789_CASET); // Column Address Set
     uint8_t caset_data[] = {
         (x_start >> 8) & 0xFF, x_start & 0xFF,
         (x_end >> 8) & 0xFF, x_end & 0xFF
     };
-    st7789_write_data(caset_data, sizeof(caset_data));
+    st7789_panel_write_data(p, caset_data, sizeof(caset_data));
 
-    st7789_write_cmd(ST7789_RASET); // Row Address Set
+    st7789_panel_write_cmd(p, ST7789_RASET); // Row Address Set
     uint8_t raset_data[] = {
         (y_start >> 8) & 0xFF, y_start & 0xFF,
         (y_end >> 8) & 0xFF, y_end & 0xFF
     };
-    st7789_write_data(raset_data, sizeof(raset_data));
+    st7789_panel_write_data(p, raset_data, sizeof(raset_data));
+}
 
-    st7789_write_cmd(ST7789_RAMWR); // Memory Write
+void PORT_FAST_FUNC(st7789_panel_set_window)(st7789_t *p, uint16_t x_start, uint16_t y_start, uint16_t x_end,
+                                             uint16_t y_end) {
+    panel_window(p, x_start, y_start, x_end, y_end);
+    st7789_panel_write_cmd(p, ST7789_RAMWR); // Memory Write
+}
+
+void st7789_panel_set_frame_rate(st7789_t *p, uint8_t hz) {
+    // FRCTRL2 RTNA: fps = 10 MHz / ((320 + porches) * (250 + 16 * RTNA)),
+    // with the default porches of 12 + 12 lines. 0x0F is 60 Hz.
+    if (hz < 39) hz = 39;
+    uint32_t clocks_per_line = 10000000u / (344u * hz);
+    uint32_t rtna = clocks_per_line > 250 ? (clocks_per_line - 250 + 8) / 16 : 0;
+    if (rtna > 0x1F) rtna = 0x1F;
+
+    st7789_panel_write_cmd(p, ST7789_FRCTRL2);
+    panel_write_byte(p, (uint8_t)rtna); // NLA = 0: dot inversion
+}
+
+void st7789_panel_sleep(st7789_t *p) {
+    if (p->sleeping) return;
+    sleep_until(delayed_by_us(p->slpout_time, SLPOUT_TO_SLPIN_US));
+
+    st7789_panel_write_cmd(p, ST7789_DISPOFF);
+    st7789_panel_write_cmd(p, ST7789_SLPIN);
+    p->slpin_time = get_absolute_time();
+    p->sleeping = true;
+}
+
+void st7789_panel_wake(st7789_t *p) {
+    if (!p->sleeping) return;
+    sleep_until(delayed_by_us(p->slpin_time, SLPIN_TO_SLPOUT_US));
+
+    st7789_panel_write_cmd(p, ST7789_SLPOUT);
+    p->slpout_time = get_absolute_time();
+    sleep_until(delayed_by_us(p->slpout_time, SLPOUT_TO_CMD_US));
+
+    st7789_panel_write_cmd(p, ST7789_DISPON);
+    p->sleeping = false;
+}
+
+bool st7789_panel_is_sleeping(const st7789_t *p) {
+    return p->sleeping;
+}
+
+uint32_t st7789_panel_set_baud(st7789_t *p, uint32_t baud) {
+#if SPI_BUS_SHARED
+    if (ON_SHARED_BUS(p)) {
+        p->baud = spi_bus_set_baud(SPI_BUS_DEV_DISPLAY, baud);
+        return p->baud;
+    }
+#endif
+    wait_spi(p);
+    p->baud = spi_set_baudrate(PCFG(p)->spi, baud);
+    return p->baud;
+}
+
+uint32_t st7789_panel_get_baud(const st7789_t *p) {
+    return p->baud;
+}
+
+// A read ends when CS goes high, so the command and the data phase go in
+// one selection; the panel drives SDO only up to ST7789_READ_BAUD
+static bool panel_read_begin(st7789_t *p, uint8_t cmd) {
+    if (ON_SHARED_BUS(p) || PCFG(p)->pin_miso == ST7789_NO_PIN) return false;
+    if (!p->miso_ready) {
+        gpio_set_function(PCFG(p)->pin_miso, GPIO_FUNC_SPI);
+        p->miso_ready = true;
+    }
+    wait_spi(p);
+    cs_select(p);
+    dc_command(p);
+    spi_write_blocking(PCFG(p)->spi, &cmd, 1);
+    dc_data(p);
+    spi_set_baudrate(PCFG(p)->spi, ST7789_READ_BAUD);
+    return true;
+}
+
+static void panel_read_end(st7789_t *p) {
+    cs_deselect(p);
+    spi_set_baudrate(PCFG(p)->spi, p->baud);
+}
+
+uint32_t st7789_panel_read_id(st7789_t *p) {
+    uint8_t rx[4];
+    if (!panel_read_begin(p, ST7789_RDDID)) return 0;
+    spi_read_blocking(PCFG(p)->spi, 0, rx, sizeof(rx));
+    panel_read_end(p);
+    // One dummy clock before the 24 ID bits
+    uint32_t v = ((uint32_t)rx[0] << 24) | ((uint32_t)rx[1] << 16) | ((uint32_t)rx[2] << 8) | rx[3];
+    return (v >> 7) & 0xFFFFFF;
+}
+
+bool st7789_panel_read_rect(st7789_t *p, uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end,
+                            uint16_t *out) {
+    if (ON_SHARED_BUS(p) || PCFG(p)->pin_miso == ST7789_NO_PIN) return false;
+    panel_window(p, x_start, y_start, x_end, y_end);
+    if (!panel_read_begin(p, ST7789_RAMRD)) return false;
+
+    // A dummy byte, then 18-bit pixels as R, G, B bytes (6 bits each, upper
+    // bits) whatever COLMOD is; they go back to RGB565, big-endian in memory
+    uint8_t rx[3 * 32];
+    spi_read_blocking(PCFG(p)->spi, 0, rx, 1);
+    size_t left = (size_t)(x_end - x_start + 1) * (y_end - y_start + 1);
+    uint8_t *dst = (uint8_t *)out;
+    while (left) {
+        size_t n = left < 32 ? left : 32;
+        spi_read_blocking(PCFG(p)->spi, 0, rx, n * 3);
+        for (size_t i = 0; i < n; i++) {
+            uint8_t r = rx[3 * i] >> 3, g = rx[3 * i + 1] >> 2, b = rx[3 * i + 2] >> 3;
+            *dst++ = (uint8_t)((r << 3) | (g >> 3));
+            *dst++ = (uint8_t)((g << 5) | b);
+        }
+        left -= n;
+    }
+    panel_read_end(p);
+    return true;
+}
+
+void st7789_init() {
+    st7789_panel_init(&st7789_default_panel, &default_cfg);
+}
+
+void PORT_FAST_FUNC(st7789_write_cmd)(uint8_t cmd) {
+    st7789_panel_write_cmd(&st7789_default_panel, cmd);
+}
+
+void PORT_FAST_FUNC(st7789_write_data)(const uint8_t *data, size_t len) {
+    st7789_panel_write_data(&st7789_default_panel, data, len);
+}
+
+void st7789_write_data_byte(uint8_t data) {
+    panel_write_byte(&st7789_default_panel, data);
+}
+
+void PORT_FAST_FUNC(st7789_send_pixels)(const uint16_t* pixels, size_t len) {
+    st7789_panel_send_pixels(&st7789_default_panel, pixels, len);
+}
+
+void PORT_FAST_FUNC(st7789_send_pixels_rect)(const uint16_t *pixels, size_t w, size_t h, size_t stride) {
+    st7789_panel_send_pixels_rect(&st7789_default_panel, pixels, w, h, stride);
+}
+
+void PORT_FAST_FUNC(st7789_set_window)(uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end) {
+    st7789_panel_set_window(&st7789_default_panel, x_start, y_start, x_end, y_end);
 }
 
 // For basic testing
 void st7789_fill_color(uint16_t color, uint32_t len) {
+    st7789_t *p = &st7789_default_panel;
     uint8_t hi = (color >> 8) & 0xFF;
     uint8_t lo = color & 0xFF;
-    cs_select();
-    dc_data();
+    wait_spi(p);
+#if SPI_BUS_SHARED
+    if (ON_SHARED_BUS(p)) {
+        uint8_t line[2 * 32];
+        for (uint32_t i = 0; i < 32; i++) {
+            line[2 * i] = hi;
+            line[2 * i + 1] = lo;
+        }
+        // Stride 0 repeats the line, the remainder goes first
+        uint32_t rows = len / 32, rest = len % 32;
+        dc_data(p);
+        if (rest) {
+            spi_bus_stream(SPI_BUS_DEV_DISPLAY, line, rest * 2, 1, 0, resume_memory_write);
+        }
+        if (rows) {
+            if (rest) {
+                st7789_write_cmd(ST7789_WRMEMC);
+                dc_data(p);
+            }
+            spi_bus_stream(SPI_BUS_DEV_DISPLAY, line, sizeof(line), rows, 0, resume_memory_write);
+        }
+        return;
+    }
+#endif
+    cs_select(p);
+    dc_data(p);
     for (uint32_t i = 0; i < len; i++) {
-        spi_write_blocking(SPI_PORT, &hi, 1);
-        spi_write_blocking(SPI_PORT, &lo, 1);
+        spi_write_blocking(PCFG(p)->spi, &hi, 1);
+        spi_write_blocking(PCFG(p)->spi, &lo, 1);
     }
-    cs_deselect();
+    cs_deselect(p);
 }
 
-
 void st7789_set_backlight(uint8_t brightness_percent) {
+    if (bl_pin == ST7789_NO_PIN) return;
+    if (brightness_percent > 100) brightness_percent = 100;
+    uint32_t irq = save_and_disable_interrupts();
+    if (bl_dma_chan >= 0) dma_channel_abort(bl_dma_chan);
+    bl_target_pct = brightness_percent;
+    pwm_set_gpio_level(bl_pin, bl_gamma[brightness_percent]);
+    restore_interrupts(irq);
+}
+
+void st7789_fade_backlight(uint8_t brightness_percent, uint32_t duration_ms) {
     if (brightness_percent > 100) brightness_percent = 100;
-    // Simple ON/OFF for now. For PWM:
-    // uint16_t duty = (brightness_percent * PWM_MAX_DUTY) / 100;
-    // pwm_set_gpio_level(PIN_BLK, duty);
-    if (brightness_percent > 0) {
-        gpio_put(PIN_BLK, 1);
-    } else {
-        gpio_put(PIN_BLK, 0);
+    uint32_t steps = duration_ms * ST7789_BL_FADE_HZ / 1000;
+    if (steps > ST7789_BL_FADE_MAX_STEPS) steps = ST7789_BL_FADE_MAX_STEPS;
+    if (steps < 2 || bl_dma_chan < 0) {
+        st7789_set_backlight(brightness_percent);
+        return;
     }
+
+    // Interrupts off: the pen IRQ may start a fade while the LVGL thread is
+    // in here, and the table is rewritten while the old DMA is stopped
+    uint32_t irq = save_and_disable_interrupts();
+    dma_channel_abort(bl_dma_chan);
+
+    // Linear in percent, i.e. in perceived brightness
+    int32_t from = (int32_t)backlight_level_pct100();
+    int32_t to = brightness_percent * 100;
+    for (uint32_t i = 0; i < steps; i++) {
+        int32_t p = from + (to - from) * (int32_t)(i + 1) / (int32_t)steps;
+        bl_fade_table[i] = backlight_gamma_pct100((uint32_t)p);
+    }
+    bl_target_pct = brightness_percent;
+    backlight_pace(duration_ms, steps); // Longer than MAX_STEPS at FADE_HZ: slower steps
+    dma_channel_transfer_from_buffer_now(bl_dma_chan, bl_fade_table, steps);
+    restore_interrupts(irq);
+}
+
+uint8_t st7789_get_backlight(void) {
+    return bl_target_pct;
+}
+
+void st7789_set_frame_rate(uint8_t hz) {
+    st7789_panel_set_frame_rate(&st7789_default_panel, hz);
+}
+
+void st7789_sleep(void) {
+    st7789_panel_sleep(&st7789_default_panel);
+}
+
+void st7789_wake(void) {
+    st7789_panel_wake(&st7789_default_panel);
+}
+
+bool st7789_is_sleeping(void) {
+    return st7789_panel_is_sleeping(&st7789_default_panel);
+}
+
+uint32_t st7789_get_baud(void) {
+    return st7789_panel_get_baud(&st7789_default_panel);
+}
+
+uint32_t st7789_read_id(void) {
+    return st7789_panel_read_id(&st7789_default_panel);
+}
+
+bool st7789_read_rect(uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end, uint16_t *out) {
+    return st7789_panel_read_rect(&st7789_default_panel, x_start, y_start, x_end, y_end, out);
 }
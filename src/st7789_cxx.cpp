@@ -0,0 +1,48 @@
+#include "st7789_cxx.h"
+
+#if ST7789_CXX
+
+#include "st7789.hpp"
+#include "port_fast_mem.h"
+#include <type_traits>
+
+namespace {
+
+using Bus = std::conditional_t<ST7789_CXX_BUS == 1, st7789_cxx::SpiDma<st7789_cxx::DefaultWiring>,
+                               st7789_cxx::SpiBlocking<st7789_cxx::DefaultWiring>>;
+using Panel = st7789_cxx::St7789<Bus, ST7789_WIDTH, ST7789_HEIGHT, (st7789_cxx::Rotation)ST7789_CXX_ROTATION>;
+
+static_assert(Panel::width == ST7789_CXX_HOR_RES && Panel::height == ST7789_CXX_VER_RES);
+
+} // namespace
+
+void st7789_cxx_init(void) {
+    Panel::init();
+}
+
+void PORT_FAST_FUNC(st7789_cxx_set_window)(uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end) {
+    Panel::set_window(x_start, y_start, x_end, y_end);
+}
+
+void PORT_FAST_FUNC(st7789_cxx_send_pixels)(const uint16_t *pixels, size_t len) {
+    Panel::send_pixels(pixels, len);
+}
+
+void PORT_FAST_FUNC(st7789_cxx_send_pixels_rect)(const uint16_t *pixels, size_t w, size_t h, size_t stride) {
+    Panel::send_pixels_rect(pixels, w, h, stride);
+}
+
+void PORT_FAST_FUNC(st7789_cxx_send_pixels_async)(const uint16_t *pixels, size_t len, st7789_cxx_done_cb_t cb,
+                                                  void *ctx) {
+    Panel::send_pixels_async(pixels, len, cb, ctx);
+}
+
+void st7789_cxx_wait(void) {
+    Panel::wait();
+}
+
+uint32_t st7789_cxx_get_baud(void) {
+    return Panel::baud();
+}
+
+#endif // ST7789_CXX
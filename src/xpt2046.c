@@ -1,11 +1,77 @@
 #include "xpt2046.h"
 #include "pico/time.h"
-#include <stdio.h> // For printf debugging
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "port_log.h"
+#include "spi_bus.h"
 #include "lvgl.h"  // For LV_HOR_RES_MAX, LV_VER_RES_MAX
 
 // SPI configuration for XPT2046 (typically slower than display)
 #define XPT_SPI_BAUD_RATE (2.5 * 1000 * 1000) // 2 MHz, XPT2046 max is often around 2.5MHz
 
+// Timestamp of the last pen-down edge, written from the GPIO IRQ
+static volatile uint32_t pen_down_us = 0;
+static void (*volatile pen_down_cb)(void);
+
+#if SPI_BUS_SHARED
+// On the shared bus a blocking read from read_cb would wait for the frame in
+// flight. A timer queues the X/Y/Z1 conversions as one bus transaction while
+// the pen is down, and get_raw_touch_point() returns the latest result.
+static repeating_timer_t sample_timer;
+static volatile bool sampling;
+static volatile bool sample_valid;
+static volatile uint16_t sample_x, sample_y, sample_z;
+
+static const uint8_t sample_cmd[9] = {
+    XPT2046_CMD_READ_X, 0, 0,
+    XPT2046_CMD_READ_Y, 0, 0,
+    XPT2046_CMD_READ_Z1, 0, 0,
+};
+
+static void sample_done(const uint8_t *rx, size_t len, void *ctx) {
+    (void)len;
+    (void)ctx;
+    sample_x = ((rx[1] << 8) | rx[2]) >> 3;
+    sample_y = ((rx[4] << 8) | rx[5]) >> 3;
+    sample_z = ((rx[7] << 8) | rx[8]) >> 3;
+    sample_valid = true;
+}
+
+static bool sample_tick(repeating_timer_t *t) {
+    (void)t;
+    if (gpio_get(PIN_XPT_IRQ)) {
+        // Pen up: stop until the next falling edge
+        sampling = false;
+        sample_valid = false;
+        return false;
+    }
+    // Full queue: a sample is already waiting for the bus
+    spi_bus_submit(SPI_BUS_DEV_TOUCH, SPI_BUS_PRIO_HIGH, sample_cmd, sizeof(sample_cmd), sample_done, NULL);
+    return true;
+}
+
+static void sample_start(void) {
+    if (sampling) return;
+    sampling = true;
+    sample_valid = false;
+    spi_bus_submit(SPI_BUS_DEV_TOUCH, SPI_BUS_PRIO_HIGH, sample_cmd, sizeof(sample_cmd), sample_done, NULL);
+    add_repeating_timer_us(-(int64_t)(1000000 / XPT_SAMPLE_HZ), sample_tick, NULL, &sample_timer);
+}
+#endif
+
+static void xpt2046_pen_irq_handler(void) {
+    if (gpio_get_irq_event_mask(PIN_XPT_IRQ) & GPIO_IRQ_EDGE_FALL) {
+        gpio_acknowledge_irq(PIN_XPT_IRQ, GPIO_IRQ_EDGE_FALL);
+        pen_down_us = time_us_32();
+#if SPI_BUS_SHARED
+        sample_start();
+#endif
+        void (*cb)(void) = pen_down_cb;
+        if (cb) cb();
+    }
+}
+
+#if !SPI_BUS_SHARED
 static inline void xpt_cs_select() {
     gpio_put(PIN_XPT_CS, 0);
     // Small delay might be needed for some XPT2046 chips after CS goes low
@@ -34,18 +100,33 @@ static uint16_t xpt2046_read_value(uint8_t cmd) {
     // or >> 4. For a 0-4095 range, >>3 is typical.
     return ((rx_buf[1] << 8) | rx_buf[2]) >> 3;
 }
+#endif
 
 void xpt2046_init(void) {
     // Initialize GPIO for CS
+#if SPI_BUS_SHARED
+    spi_bus_add_device(SPI_BUS_DEV_TOUCH, PIN_XPT_CS, XPT_SPI_BAUD_RATE); // After st7789_init()
+#else
     gpio_init(PIN_XPT_CS);
     gpio_set_dir(PIN_XPT_CS, GPIO_OUT);
     gpio_put(PIN_XPT_CS, 1); // Deselect
+#endif
 
     // Initialize GPIO for IRQ
     gpio_init(PIN_XPT_IRQ);
     gpio_set_dir(PIN_XPT_IRQ, GPIO_IN);
     gpio_pull_up(PIN_XPT_IRQ); // XPT2046 IRQ is often open-drain, active low. Pull-up needed.
 
+    // Timestamp the falling edge so the time from finger-down to the first
+    // read_cb poll can be measured (the pin itself is still polled as before)
+    gpio_add_raw_irq_handler(PIN_XPT_IRQ, xpt2046_pen_irq_handler);
+    gpio_set_irq_enabled(PIN_XPT_IRQ, GPIO_IRQ_EDGE_FALL, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+#if SPI_BUS_SHARED
+    if (xpt2046_is_touched()) sample_start(); // Edge missed before the IRQ was on
+    PORT_LOGI("XPT2046 Initialized on the shared SPI bus\n");
+#else
     // Initialize SPI1
     spi_init(XPT_SPI_PORT, XPT_SPI_BAUD_RATE);
     gpio_set_function(PIN_XPT_SCK, GPIO_FUNC_SPI);
@@ -55,7 +136,8 @@ void xpt2046_init(void) {
     // XPT2046 typically uses SPI Mode 0 (CPOL=0, CPHA=0)
     spi_set_format(XPT_SPI_PORT, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
 
-    printf("XPT2046 Initialized on SPI1\n");
+    PORT_LOGI("XPT2046 Initialized on SPI1\n");
+#endif
 }
 
 bool xpt2046_is_touched(void) {
@@ -63,6 +145,14 @@ bool xpt2046_is_touched(void) {
     return gpio_get(PIN_XPT_IRQ) == 0;
 }
 
+uint32_t xpt2046_pen_down_time_us(void) {
+    return pen_down_us;
+}
+
+void xpt2046_set_pen_down_cb(void (*cb)(void)) {
+    pen_down_cb = cb;
+}
+
 // Gets RAW ADC values
 bool xpt2046_get_raw_touch_point(uint16_t *raw_x, uint16_t *raw_y, uint16_t *raw_z) {
     if (!xpt2046_is_touched()) {
@@ -75,12 +165,25 @@ bool xpt2046_get_raw_touch_point(uint16_t *raw_x, uint16_t *raw_y, uint16_t *raw
     // using the PD0/PD1 bits in the command byte.
     // For simplicity here, we do direct reads.
 
+#if SPI_BUS_SHARED
+    uint32_t irq = save_and_disable_interrupts();
+    bool valid = sample_valid;
+    *raw_x = sample_x;
+    *raw_y = sample_y;
+    if (raw_z) *raw_z = sample_z;
+    restore_interrupts(irq);
+    if (!valid) {
+        return false; // First sample of this touch not in yet
+    }
+#else
     *raw_x = xpt2046_read_value(XPT2046_CMD_READ_X);
     *raw_y = xpt2046_read_value(XPT2046_CMD_READ_Y);
     if (raw_z) { // Optional Z reading
         *raw_z = xpt2046_read_value(XPT2046_CMD_READ_Z1); // Or combine Z1 and Z2
     }
-     printf("RAW_X: %u, RAW_Y: %u\n", *raw_x, *raw_y); // <<< DEBUG PRINT
+#endif
+    // Raw values for calibration, build with PORT_LOG_LEVEL=PORT_LOG_LEVEL_DEBUG to see them
+    PORT_LOGD_EVERY(100, "RAW_X: %u, RAW_Y: %u\n", *raw_x, *raw_y);
     // A very basic filter: if X or Y is 0 or 4095 (max ADC value), it might be noise
     // This depends on your calibration range, so adjust if needed.
     if (*raw_x == 0 || *raw_x >= 4095 || *raw_y == 0 || *raw_y >= 4095) {
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Regression gate for the reference-screen benchmark (sim/bench.c).
+
+Compares the JSON of a run against a baseline run and fails if a metric got
+worse by more than its tolerance, or if a screen or metric of the baseline is
+missing from the run (a screen that crashed or was dropped must not pass):
+
+    lvgl_bench --json bench.json
+    bench_gate.py baseline.json bench.json --tolerance 2
+
+Bytes, bus time, area and heap peak come from the simulator's virtual time
+and are the same on every run, so the default tolerance is small. The render
+time is host CPU time and only checked with `--render-tolerance`. Absolute
+limits can be added with `--max screen.metric=value` (or `*.metric=value`).
+"""
+
+import argparse
+import json
+import sys
+
+# Metric -> True if higher is better
+METRICS = {
+    "fps": True,
+    "bytes_per_frame": False,
+    "bus_us_per_frame": False,
+    "area_px_per_frame": False,
+    "mem_peak": False,
+}
+
+
+def load(path):
+    with open(path) as f:
+        return json.load(f)["screens"]
+
+
+def parse_limits(items):
+    limits = []
+    for item in items or []:
+        try:
+            key, value = item.split("=", 1)
+            screen, metric = key.split(".", 1)
+            limits.append((screen, metric, float(value)))
+        except ValueError:
+            sys.exit("bad --max %r, expected screen.metric=value" % item)
+    return limits
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("baseline", help="JSON of the reference run")
+    ap.add_argument("current", help="JSON of the run to check")
+    ap.add_argument("--tolerance", type=float, default=1.0,
+                    help="allowed change for the worse in percent (default 1)")
+    ap.add_argument("--render-tolerance", type=float,
+                    help="also check render_us, allowed increase in percent")
+    ap.add_argument("--max", action="append", metavar="SCREEN.METRIC=VALUE",
+                    help="absolute upper limit, e.g. anim.bus_us_per_frame=20000")
+    args = ap.parse_args()
+
+    base, cur = load(args.baseline), load(args.current)
+    metrics = dict(METRICS)
+    if args.render_tolerance is not None:
+        metrics["render_us"] = False
+
+    failed = 0
+    print("%-10s %-18s %10s %10s %8s" % ("screen", "metric", "baseline", "current", "change"))
+    for screen in sorted(cur):
+        if screen not in base:
+            print("%-10s (not in the baseline)" % screen)
+            continue
+        for metric, higher_better in metrics.items():
+            b, c = base[screen].get(metric), cur[screen].get(metric)
+            if b is None:
+                continue
+            if c is None:
+                print("%-10s %-18s %10g %10s %8s  FAIL" % (screen, metric, b, "-", ""))
+                failed += 1
+                continue
+            change = (c - b) * 100.0 / b if b else (0.0 if c == b else float("inf"))
+            tol = args.render_tolerance if metric == "render_us" else args.tolerance
+            worse = -change if higher_better else change
+            mark = ""
+            if worse > tol:
+                mark = "  FAIL"
+                failed += 1
+            print("%-10s %-18s %10g %10g %+7.1f%%%s" % (screen, metric, b, c, change, mark))
+    for screen in sorted(base):
+        if screen not in cur:
+            print("%-10s (missing from the current run)  FAIL" % screen)
+            failed += 1
+
+    for screen, metric, limit in parse_limits(args.max):
+        for name in sorted(cur) if screen == "*" else [screen]:
+            value = cur.get(name, {}).get(metric)
+            if value is None:
+                sys.exit("no %s.%s in %s" % (name, metric, args.current))
+            if value > limit:
+                print("%s.%s = %g over the limit %g  FAIL" % (name, metric, value, limit))
+                failed += 1
+
+    if failed:
+        print("%d check(s) failed" % failed)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Hot function list for the RP2040 LVGL port.
+
+Maps the PC samples from lv_port_pcsample_dump() ("PCS <hex>" lines, other
+serial output is ignored) to the functions of a firmware build and selects
+the hottest LVGL functions that fit in `--max-bytes` of SRAM.
+
+    hot_funcs.py build/app.elf.map capture.txt -o hot_funcs.objcopy
+
+The output is an objcopy response file that renames the selected
+.text.<func> sections of liblvgl.a to .time_critical.<func>, which the
+pico-sdk linker script copies to SRAM at boot:
+
+    add_custom_command(TARGET lvgl POST_BUILD
+        COMMAND ${CMAKE_OBJCOPY} @${CMAKE_SOURCE_DIR}/hot_funcs.objcopy $<TARGET_FILE:lvgl>)
+
+Functions of the drivers and ports are placed with PORT_FAST_FUNC instead
+(port_fast_mem.h), they show up in the report as already in SRAM.
+"""
+
+import argparse
+import bisect
+import re
+import sys
+
+from ram_budget import SRAM_BASE, SRAM_END, parse_map
+
+FLASH_BASE = 0x10000000
+FLASH_END = 0x11000000
+
+SAMPLE_RE = re.compile(r"\bPCS ([0-9a-fA-F]{8})\b")
+
+
+def read_samples(paths):
+    pcs = []
+    for path in paths:
+        with open(path, errors="replace") as f:
+            for line in f:
+                m = SAMPLE_RE.search(line)
+                if m:
+                    pcs.append(int(m.group(1), 16) & ~1)
+    return pcs
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("map", help="linker map of the profiled firmware")
+    ap.add_argument("samples", nargs="+", help="serial captures with PCS lines")
+    ap.add_argument("--max-bytes", type=int, default=8 * 1024,
+                    help="SRAM to spend on moved functions (default 8192)")
+    ap.add_argument("--lib", default="liblvgl",
+                    help="only move functions from objects whose path contains this")
+    ap.add_argument("--min-pct", type=float, default=0.5,
+                    help="ignore functions with fewer samples than this percentage")
+    ap.add_argument("--top", type=int, default=20, help="functions to list in the report")
+    ap.add_argument("-o", "--out", help="write the objcopy response file here")
+    args = ap.parse_args()
+
+    pcs = read_samples(args.samples)
+    if not pcs:
+        sys.exit("no PCS lines in the captures")
+
+    _, sections, _ = parse_map(args.map)
+    funcs = sorted((addr, size, name, obj) for name, addr, size, obj in sections
+                   if name.startswith(".text.") and size and FLASH_BASE <= addr < FLASH_END)
+    starts = [f[0] for f in funcs]
+
+    hits = {}
+    in_sram = other = 0
+    for pc in pcs:
+        if SRAM_BASE <= pc < SRAM_END:
+            in_sram += 1
+            continue
+        i = bisect.bisect_right(starts, pc) - 1
+        if i >= 0 and pc < funcs[i][0] + funcs[i][1]:
+            hits[i] = hits.get(i, 0) + 1
+        else:
+            other += 1  # Boot ROM, SDK code without its own section, ...
+
+    total = len(pcs)
+    ranked = sorted(hits.items(), key=lambda kv: -kv[1])
+
+    print("%d samples: %.1f%% already in SRAM, %.1f%% outside named functions"
+          % (total, 100.0 * in_sram / total, 100.0 * other / total))
+    print("%7s %6s %7s  %s" % ("samples", "%", "bytes", "function"))
+    for i, n in ranked[:args.top]:
+        _, size, name, obj = funcs[i]
+        print("%7d %5.1f%% %7d  %s  (%s)" % (n, 100.0 * n / total, size, name[6:],
+                                              obj.rsplit("/", 1)[-1]))
+
+    # Greedy by samples; a function that doesn't fit doesn't stop smaller ones
+    chosen, used, covered = [], 0, 0
+    for i, n in ranked:
+        _, size, name, obj = funcs[i]
+        if 100.0 * n / total < args.min_pct:
+            break
+        if args.lib not in obj:
+            continue
+        size = (size + 3) & ~3
+        if used + size > args.max_bytes:
+            continue
+        chosen.append(name)
+        used += size
+        covered += n
+
+    print("selected %d functions, %d of %d bytes of SRAM, covering %.1f%% of the samples"
+          % (len(chosen), used, args.max_bytes, 100.0 * covered / total))
+
+    if args.out:
+        with open(args.out, "w") as f:
+            for name in chosen:
+                f.write("--rename-section %s=.time_critical.%s\n" % (name, name[6:]))
+        print("wrote %s" % args.out)
+
+
+if __name__ == "__main__":
+    main()
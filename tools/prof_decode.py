@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""Decode the binary profiler stream written by lv_port_prof_stream().
+
+Reads a capture file or a serial device (put it in raw mode first, e.g.
+`stty -F /dev/ttyACM0 raw`), prints per-field summaries and optionally
+exports the frames and bands as CSV. Text printed by the firmware between
+records is skipped.
+
+    prof_decode.py capture.bin --csv frames.csv --bands-csv bands.csv
+"""
+
+import argparse
+import csv
+import sys
+
+SYNC = b"\xa5\x5a"
+
+REC_FRAME = 0x01
+REC_BAND = 0x02
+REC_DROP = 0x03
+
+# Must match the field order in lv_port_prof_encode_*()
+FIELDS = {
+    REC_FRAME: ["seq", "interval_us", "handler_us", "input_us", "refresh_us",
+                "render_us", "flush_us", "idle_us", "bytes", "areas", "bands"],
+    REC_BAND: ["seq", "y1", "y2", "render_us", "flush_us"],
+    REC_DROP: ["frames", "bands"],
+}
+
+
+def crc8(data):
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def varints(payload):
+    values, v, shift = [], 0, 0
+    for b in payload:
+        v |= (b & 0x7F) << shift
+        if b & 0x80:
+            shift += 7
+        else:
+            values.append(v)
+            v, shift = 0, 0
+    if shift:
+        raise ValueError("truncated varint")
+    return values
+
+
+def decode(data):
+    """Yields (type, dict) for every valid record in data."""
+    pos = 0
+    while True:
+        pos = data.find(SYNC, pos)
+        if pos < 0 or pos + 5 > len(data):
+            return
+        rtype, length = data[pos + 2], data[pos + 3]
+        end = pos + 4 + length
+        if end >= len(data):
+            return
+        if rtype not in FIELDS or crc8(data[pos + 2:end]) != data[end]:
+            pos += 1  # False sync inside text or a corrupted record
+            continue
+        try:
+            values = varints(data[pos + 4:end])
+        except ValueError:
+            pos += 1
+            continue
+        if len(values) != len(FIELDS[rtype]):
+            pos += 1
+            continue
+        yield rtype, dict(zip(FIELDS[rtype], values))
+        pos = end + 1
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0
+    i = min(len(sorted_values) - 1, int(round(p / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[i]
+
+
+def summarize(frames, bands, dropped):
+    if not frames:
+        print("no frame records found")
+        return
+    total_us = sum(f["interval_us"] for f in frames)
+    fps = len(frames) * 1e6 / total_us if total_us else 0
+    print("%d frames, %d bands, %.1f frames/s, dropped %d frames / %d bands"
+          % (len(frames), len(bands), fps, dropped[0], dropped[1]))
+    print("%-12s %10s %10s %10s %10s" % ("field", "min", "avg", "p95", "max"))
+    for name in FIELDS[REC_FRAME][1:]:
+        values = sorted(f[name] for f in frames)
+        print("%-12s %10d %10d %10d %10d" % (name, values[0], sum(values) // len(values),
+                                              percentile(values, 95), values[-1]))
+    if bands:
+        render = sorted(b["render_us"] for b in bands)
+        flush = sorted(b["flush_us"] for b in bands)
+        print("band render  avg %d us, p95 %d us; band flush avg %d us, p95 %d us"
+              % (sum(render) // len(render), percentile(render, 95),
+                 sum(flush) // len(flush), percentile(flush, 95)))
+
+
+def write_csv(path, fields, rows):
+    with open(path, "w", newline="") as f:
+        w = csv.DictWriter(f, fieldnames=fields)
+        w.writeheader()
+        w.writerows(rows)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("input", help="capture file or serial device, '-' for stdin")
+    ap.add_argument("--csv", help="write frame records to this CSV file")
+    ap.add_argument("--bands-csv", help="write band records to this CSV file")
+    args = ap.parse_args()
+
+    if args.input == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.input, "rb") as f:
+            data = f.read()
+
+    frames, bands, dropped = [], [], [0, 0]
+    for rtype, rec in decode(data):
+        if rtype == REC_FRAME:
+            frames.append(rec)
+        elif rtype == REC_BAND:
+            bands.append(rec)
+        else:
+            dropped[0] += rec["frames"]
+            dropped[1] += rec["bands"]
+
+    summarize(frames, bands, dropped)
+    if args.csv:
+        write_csv(args.csv, FIELDS[REC_FRAME], frames)
+    if args.bands_csv:
+        write_csv(args.bands_csv, FIELDS[REC_BAND], bands)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""RAM budget planner for the RP2040 LVGL port.
+
+Reads the linker map of a firmware build and the LVGL/port configuration,
+prints where the 264 kB of SRAM go, and derives the largest draw band
+(DISP_BUF_LINES) and buffer count (DISP_BUF_COUNT) that fit while keeping
+`--headroom` bytes free for the malloc heap and stack growth.
+
+    ram_budget.py build/app.elf.map --header inc/disp_buf_config.h
+
+lv_port_disp.c picks up the generated header on the next build. Run it again
+after the build, the buffers in the map then already have the new size.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(HERE)
+
+SRAM_BASE = 0x20000000
+SRAM_END = 0x20042000  # Striped banks + SCRATCH_X + SCRATCH_Y
+
+DEFAULT_CONFIGS = [
+    os.path.join(ROOT, "lv_conf.h"),
+    os.path.join(ROOT, "inc", "st7789.h"),
+    os.path.join(ROOT, "inc", "lv_port_mem.h"),
+]
+
+
+def parse_defines(paths):
+    """Collects simple object-like #defines; the first definition wins."""
+    raw = {}
+    define = re.compile(r"^\s*#\s*define\s+([A-Za-z_]\w*)\s+([^/\n]+?)\s*(?:/[*/].*)?$")
+    for path in paths:
+        with open(path) as f:
+            for line in f:
+                m = define.match(line)
+                if m and m.group(1) not in raw:
+                    raw[m.group(1)] = m.group(2)
+    return raw
+
+
+def evaluate(name, raw, seen=()):
+    if name not in raw or name in seen:
+        return None
+    expr = re.sub(r"\b(\d+)[uUlL]+\b", r"\1", raw[name])
+
+    def subst(m):
+        value = evaluate(m.group(0), raw, seen + (name,))
+        return str(value) if value is not None else m.group(0)
+
+    expr = re.sub(r"\b[A-Za-z_]\w*\b", subst, expr)
+    try:
+        return int(eval(expr, {"__builtins__": {}}))
+    except Exception:
+        return None
+
+
+def parse_map(path):
+    """Returns (regions, input sections, symbols) from a GNU ld map file."""
+    regions, sections, symbols = {}, [], {}
+    region_re = re.compile(r"^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+    input_re = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+)$")
+    name_only_re = re.compile(r"^ (\S+)$")
+    cont_re = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+)$")
+    symbol_re = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+([A-Za-z_]\w*)(?:\s*=.*)?$")
+
+    with open(path) as f:
+        lines = f.read().splitlines()
+
+    i, in_regions, in_map = 0, False, False
+    pending = None
+    while i < len(lines):
+        line = lines[i]
+        i += 1
+        if line.startswith("Memory Configuration"):
+            in_regions = True
+            continue
+        if line.startswith("Linker script and memory map"):
+            in_regions, in_map = False, True
+            continue
+        if in_regions:
+            m = region_re.match(line)
+            if m and m.group(1) not in ("Name", "*default*"):
+                regions[m.group(1)] = (int(m.group(2), 16), int(m.group(3), 16))
+            continue
+        if not in_map:
+            continue
+
+        if pending:
+            m = cont_re.match(line)
+            if m:
+                sections.append((pending, int(m.group(1), 16), int(m.group(2), 16), m.group(3).strip()))
+            pending = None
+            if m:
+                continue
+        m = input_re.match(line)
+        if m:
+            sections.append((m.group(1), int(m.group(2), 16), int(m.group(3), 16), m.group(4).strip()))
+            continue
+        m = name_only_re.match(line)
+        if m and m.group(1).startswith("."):
+            pending = m.group(1)
+            continue
+        m = symbol_re.match(line)
+        if m:
+            symbols[m.group(2)] = int(m.group(1), 16)
+    return regions, sections, symbols
+
+
+def categorize(name, obj):
+    base = name.rsplit(".", 1)[-1]
+    if base in ("buf_1", "buf_2"):
+        return "draw buffers"
+    if (base == "pool" and "lv_port_mem" in obj) or base == "work_mem_int":
+        return "LVGL heap pool"
+    if name.startswith((".heap", ".stack", ".stack1")):
+        return None  # Reported from the symbols
+    if "lvgl" in obj:
+        return "LVGL static"
+    return "application/SDK"
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("map", help="linker map of the firmware (e.g. build/app.elf.map)")
+    ap.add_argument("--config", action="append", help="config headers (default: lv_conf.h and port headers)")
+    ap.add_argument("--headroom", type=int, default=24 * 1024,
+                    help="bytes to keep free for malloc and stack growth (default 24576)")
+    ap.add_argument("--buffers", type=int, choices=(1, 2), help="force the buffer count")
+    ap.add_argument("--min-lines", type=int, default=16,
+                    help="below this band height one buffer is used instead of two")
+    ap.add_argument("--header", help="write DISP_BUF_LINES/DISP_BUF_COUNT to this header")
+    args = ap.parse_args()
+
+    raw = parse_defines(args.config or DEFAULT_CONFIGS)
+    hor_res = evaluate("ST7789_WIDTH", raw) or evaluate("LV_HOR_RES_MAX", raw)
+    ver_res = evaluate("ST7789_HEIGHT", raw) or evaluate("LV_VER_RES_MAX", raw)
+    bpp = (evaluate("LV_COLOR_DEPTH", raw) or 16) // 8
+    if not hor_res or not ver_res:
+        sys.exit("can't find the display resolution in the config headers")
+
+    regions, sections, symbols = parse_map(args.map)
+
+    usage = {}
+    for name, addr, size, obj in sections:
+        if size == 0 or not (SRAM_BASE <= addr < SRAM_END):
+            continue
+        cat = categorize(name, obj)
+        if cat:
+            usage[cat] = usage.get(cat, 0) + size
+
+    ram_total = sum(length for origin, length in regions.values()
+                    if SRAM_BASE <= origin < SRAM_END) or (SRAM_END - SRAM_BASE)
+    heap_start = symbols.get("__end__", symbols.get("end"))
+    stack_limit = symbols.get("__StackLimit")
+    if heap_start is None or stack_limit is None:
+        sys.exit("map has no __end__/__StackLimit, is it a pico-sdk build?")
+    arena = stack_limit - heap_start  # malloc heap + core0 stack overflow room
+
+    print("SRAM budget (%d bytes)" % ram_total)
+    for cat in ("draw buffers", "LVGL heap pool", "LVGL static", "application/SDK"):
+        if cat in usage:
+            print("  %-18s %7d" % (cat, usage[cat]))
+    print("  %-18s %7d" % ("malloc arena", arena))
+    print("  %-18s %7d" % ("stacks (scratch)", ram_total - (stack_limit - SRAM_BASE)))
+
+    # Transient LVGL needs come out of the LVGL heap, not from the arena
+    pool = evaluate("LV_PORT_MEM_SIZE", raw) if evaluate("LV_MEM_CUSTOM", raw) else evaluate("LV_MEM_SIZE", raw)
+    layer = evaluate("LV_LAYER_SIMPLE_BUF_SIZE", raw) or 0
+    rot = evaluate("LV_DISP_ROT_MAX_BUF", raw) or 0
+    if pool:
+        print("LVGL heap %d bytes; transient needs: simple layer %d, rotation %d" % (pool, layer, rot))
+        if max(layer, rot) > pool // 2:
+            print("  warning: a transient buffer takes more than half of the LVGL heap")
+
+    # The current buffers are given back and re-split
+    available = usage.get("draw buffers", 0) + arena - args.headroom
+    line_bytes = hor_res * bpp
+    count = args.buffers or 2
+    lines = min(ver_res, available // (line_bytes * count)) if available > 0 else 0
+    if not args.buffers and count == 2 and lines < args.min_lines:
+        count = 1
+        lines = min(ver_res, available // line_bytes) if available > 0 else 0
+    if lines <= 0:
+        sys.exit("no room for a draw buffer with %d bytes of headroom" % args.headroom)
+
+    print("band: %d lines x %d buffer(s) = %d bytes, headroom %d bytes"
+          % (lines, count, lines * line_bytes * count, args.headroom))
+
+    if args.header:
+        with open(args.header, "w") as f:
+            f.write("// Generated by tools/ram_budget.py from %s, do not edit\n"
+                    % os.path.basename(args.map))
+            f.write("#ifndef DISP_BUF_CONFIG_H\n#define DISP_BUF_CONFIG_H\n\n")
+            f.write("#define DISP_BUF_LINES %d\n" % lines)
+            f.write("#define DISP_BUF_COUNT %d\n" % count)
+            f.write("\n#endif // DISP_BUF_CONFIG_H\n")
+        print("wrote %s" % args.header)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""Code size comparison of two builds of the RP2040 LVGL port.
+
+Sums the input sections of the objects matching `--obj` (default: the
+ST7789 driver and the display port) in two linker maps and prints the
+per-function difference, e.g. to check that a driver change such as
+ST7789_SINGLE_PANEL costs no flash or SRAM against the previous build:
+
+    size_diff.py old/app.elf.map build/app.elf.map --obj st7789 --obj lv_port_disp
+
+Exits with status 1 if the matched code grew by more than `--max-growth`
+bytes, so it can run as a post-build check. Host maps work the same way,
+`make -C sim size-cxx` compares the C and the C++ driver with it.
+"""
+
+import argparse
+import re
+import subprocess
+import sys
+
+from ram_budget import parse_map
+
+KINDS = (".text", ".time_critical", ".rodata", ".data", ".bss")
+
+
+def collect(path, objs):
+    _, sections, _ = parse_map(path)
+    sizes = {}
+    for name, _addr, size, obj in sections:
+        if size == 0 or not any(o in obj for o in objs):
+            continue
+        kind = next((k for k in KINDS if name.startswith(k)), None)
+        if kind is None:
+            continue
+        func = name[len(kind):].lstrip(".") or "(%s)" % obj.rsplit("/", 1)[-1]
+        key = (kind, func)
+        sizes[key] = sizes.get(key, 0) + size
+    return sizes
+
+
+def demangle(sizes):
+    """C++ names through c++filt when there is one, without template and
+    function arguments (st7789_cxx::St7789<>::init)."""
+    keys = [k for k in sizes if k[1].startswith("_Z")]
+    if not keys:
+        return sizes
+    try:
+        out = subprocess.run(["c++filt"], input="\n".join(k[1] for k in keys), capture_output=True,
+                             text=True, check=True).stdout.splitlines()
+    except (OSError, subprocess.CalledProcessError):
+        return sizes
+    for key, name in zip(keys, out):
+        prev = None
+        while prev != name:
+            prev, name = name, re.sub(r"<[^<>]*>", "\0", name)
+        name = name.replace("\0", "<>").split("(")[0]
+        new = (key[0], name)
+        sizes[new] = sizes.get(new, 0) + sizes.pop(key)
+    return sizes
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("old", help="linker map of the reference build")
+    ap.add_argument("new", help="linker map of the build to check")
+    ap.add_argument("--obj", action="append",
+                    help="object path substring to include (default: st7789, lv_port_disp)")
+    ap.add_argument("--max-growth", type=int, default=0,
+                    help="code (.text + .time_critical) growth allowed in bytes (default 0)")
+    ap.add_argument("--all", action="store_true", help="also list unchanged sections")
+    args = ap.parse_args()
+
+    objs = args.obj or ["st7789", "lv_port_disp"]
+    old, new = demangle(collect(args.old, objs)), demangle(collect(args.new, objs))
+    if not old and not new:
+        sys.exit("no sections of %s in the maps, built with -ffunction-sections?" % ", ".join(objs))
+
+    totals = {}
+    print("%-14s %-40s %7s %7s %7s" % ("section", "function", "old", "new", "diff"))
+    for key in sorted(set(old) | set(new)):
+        o, n = old.get(key, 0), new.get(key, 0)
+        totals[key[0]] = (totals.get(key[0], (0, 0))[0] + o, totals.get(key[0], (0, 0))[1] + n)
+        if o != n or args.all:
+            print("%-14s %-40s %7d %7d %+7d" % (key[0], key[1][:40], o, n, n - o))
+
+    print()
+    for kind in KINDS:
+        if kind in totals:
+            o, n = totals[kind]
+            print("%-14s %-40s %7d %7d %+7d" % (kind, "total", o, n, n - o))
+
+    code = sum(totals.get(k, (0, 0))[1] - totals.get(k, (0, 0))[0] for k in (".text", ".time_critical"))
+    if code > args.max_growth:
+        print("code grew by %d bytes (allowed %d)" % (code, args.max_growth))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()